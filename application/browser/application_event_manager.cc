@@ -4,6 +4,9 @@
 
 #include "xwalk/application/browser/application_event_manager.h"
 
+#include "base/lazy_instance.h"
+#include "base/stl_util.h"
+#include "base/synchronization/lock.h"
 #include "content/public/browser/browser_thread.h"
 #include "content/public/browser/web_contents_observer.h"
 #include "xwalk/application/browser/application_event_router.h"
@@ -16,14 +19,51 @@ using content::BrowserThread;
 namespace xwalk {
 namespace application {
 
+namespace {
+
+// The ids of all the event names seen, which are few.
+class EventIdRegistry {
+ public:
+  EventIdRegistry() {}
+
+  EventId GetId(const std::string& event_name) {
+    base::AutoLock auto_lock(lock_);
+    EventIdMap::const_iterator it = ids_.find(event_name);
+    if (it != ids_.end())
+      return it->second;
+    const EventId id = ids_.size();
+    ids_[event_name] = id;
+    return id;
+  }
+
+ private:
+  typedef base::hash_map<std::string, EventId> EventIdMap;
+
+  base::Lock lock_;
+  EventIdMap ids_;
+
+  DISALLOW_COPY_AND_ASSIGN(EventIdRegistry);
+};
+
+base::LazyInstance<EventIdRegistry>::Leaky g_event_ids =
+    LAZY_INSTANCE_INITIALIZER;
+
+}  // namespace
+
 scoped_refptr<Event> Event::CreateEvent(
     const std::string& event_name, scoped_ptr<base::ListValue> event_args) {
   return scoped_refptr<Event>(new Event(event_name, event_args.Pass()));
 }
 
+// static
+EventId Event::GetEventId(const std::string& event_name) {
+  return g_event_ids.Get().GetId(event_name);
+}
+
 Event::Event(const std::string& event_name,
              scoped_ptr<base::ListValue> event_args)
   : name_(event_name),
+    id_(GetEventId(event_name)),
     args_(event_args.Pass()) {
   DCHECK(args_);
 }
@@ -33,6 +73,11 @@ Event::~Event() {
 
 ApplicationEventManager::ApplicationEventManager(ApplicationSystem* system)
   : system_(system) {
+  const InstalledApplicationInfoMap& applications =
+      system_->application_service()->GetInstalledApplications();
+  InstalledApplicationInfoMap::const_iterator it = applications.begin();
+  for (; it != applications.end(); ++it)
+    SetApplicationEvents(it->first, it->second.events);
 }
 
 ApplicationEventManager::~ApplicationEventManager() {
@@ -60,31 +105,90 @@ void ApplicationEventManager::OnAppUnloaded(const std::string& app_id) {
 void ApplicationEventManager::SendEvent(const std::string& app_id,
                                         scoped_refptr<Event> event) {
   DCHECK(BrowserThread::CurrentlyOn(BrowserThread::UI));
-  if (ApplicationEventRouter* app_router = GetAppRouter(app_id))
+  // The event waits in the lazy event queue of the application until its
+  // main document is loaded.
+  if (!ContainsKey(app_routers_, app_id) &&
+      IsHandledByMainDocument(app_id, event->id()) &&
+      !system_->application_service()->LaunchInBackground(app_id))
+    return;
+
+  if (ApplicationEventRouter* app_router = GetAppRouter(app_id)) {
     app_router->DispatchEvent(event);
+    system_->process_manager()->OnEventDispatched(app_id);
+  }
+}
+
+void ApplicationEventManager::BroadcastEvent(scoped_refptr<Event> event) {
+  DCHECK(BrowserThread::CurrentlyOn(BrowserThread::UI));
+  AppIdSet app_ids;
+  AppRouterMap::const_iterator router_it = app_routers_.begin();
+  for (; router_it != app_routers_.end(); ++router_it)
+    app_ids.insert(router_it->first);
+  EventAppMap::const_iterator it = event_apps_.find(event->id());
+  if (it != event_apps_.end())
+    app_ids.insert(it->second.begin(), it->second.end());
+
+  AppIdSet::const_iterator app_it = app_ids.begin();
+  for (; app_it != app_ids.end(); ++app_it)
+    SendEvent(*app_it, event);
+}
+
+void ApplicationEventManager::SetApplicationEvents(
+    const std::string& app_id, const std::set<std::string>& events) {
+  EventAppMap::iterator it = event_apps_.begin();
+  while (it != event_apps_.end()) {
+    it->second.erase(app_id);
+    if (it->second.empty())
+      event_apps_.erase(it++);
+    else
+      ++it;
+  }
+
+  std::set<std::string>::const_iterator event_it = events.begin();
+  for (; event_it != events.end(); ++event_it)
+    event_apps_[Event::GetEventId(*event_it)].insert(app_id);
 }
 
 void ApplicationEventManager::AttachObserver(const std::string& app_id,
                                              const std::string& event_name,
                                              EventObserver* observer) {
   DCHECK(content::BrowserThread::CurrentlyOn(BrowserThread::UI));
-  if (ApplicationEventRouter* app_router = GetAppRouter(app_id))
+  if (ApplicationEventRouter* app_router = GetAppRouter(app_id)) {
     app_router->AttachObserver(event_name, observer);
+    observer_apps_[observer].insert(app_id);
+  }
 }
 
 void ApplicationEventManager::DetachObserver(const std::string& app_id,
                                              const std::string& event_name,
                                              EventObserver* observer) {
   DCHECK(content::BrowserThread::CurrentlyOn(BrowserThread::UI));
-  if (ApplicationEventRouter* app_router = GetAppRouter(app_id))
-    app_router->DetachObserver(event_name, observer);
+  ApplicationEventRouter* app_router = GetAppRouter(app_id);
+  if (!app_router)
+    return;
+  app_router->DetachObserver(event_name, observer);
+  if (app_router->HasObserver(observer))
+    return;
+  ObserverAppMap::iterator it = observer_apps_.find(observer);
+  if (it == observer_apps_.end())
+    return;
+  it->second.erase(app_id);
+  if (it->second.empty())
+    observer_apps_.erase(it);
 }
 
 void ApplicationEventManager::DetachObserver(EventObserver* observer) {
   DCHECK(content::BrowserThread::CurrentlyOn(BrowserThread::UI));
-  AppRouterMap::iterator it = app_routers_.begin();
-  for (; it != app_routers_.end(); ++it)
-    it->second->DetachObserver(observer);
+  ObserverAppMap::iterator it = observer_apps_.find(observer);
+  if (it == observer_apps_.end())
+    return;
+  AppIdSet::const_iterator app_it = it->second.begin();
+  for (; app_it != it->second.end(); ++app_it) {
+    AppRouterMap::iterator router_it = app_routers_.find(*app_it);
+    if (router_it != app_routers_.end())
+      router_it->second->DetachObserver(observer);
+  }
+  observer_apps_.erase(it);
 }
 
 void ApplicationEventManager::OnMainDocumentCreated(
@@ -105,5 +209,11 @@ ApplicationEventRouter* ApplicationEventManager::GetAppRouter(
   return NULL;
 }
 
+bool ApplicationEventManager::IsHandledByMainDocument(
+    const std::string& app_id, EventId event_id) const {
+  EventAppMap::const_iterator it = event_apps_.find(event_id);
+  return it != event_apps_.end() && ContainsKey(it->second, app_id);
+}
+
 }  // namespace application
 }  // namespace xwalk
@@ -10,6 +10,7 @@
 #include <string>
 
 #include "base/callback.h"
+#include "base/containers/hash_tables.h"
 #include "base/gtest_prod_util.h"
 #include "base/memory/linked_ptr.h"
 #include "base/memory/ref_counted.h"
@@ -26,13 +27,22 @@ namespace application {
 class ApplicationEventRouter;
 class ApplicationSystem;
 
+// Event names are interned, so that events are routed by number.
+typedef int EventId;
+
+// An event is shared by all the observers it is dispatched to, and so are its
+// arguments.
 class Event : public base::RefCounted<Event> {
  public:
   static scoped_refptr<Event> CreateEvent(
       const std::string& event_name, scoped_ptr<base::ListValue> event_args);
 
+  // Returns the id of |event_name|, the same for the whole process.
+  static EventId GetEventId(const std::string& event_name);
+
   const std::string& name() const { return name_; }
-  base::ListValue* args() const { return args_.get(); }
+  EventId id() const { return id_; }
+  const base::ListValue* args() const { return args_.get(); }
 
  private:
   friend class base::RefCounted<Event>;
@@ -41,6 +51,7 @@ class Event : public base::RefCounted<Event> {
 
   // The event to dispatch.
   std::string name_;
+  EventId id_;
   // Arguments to send to the event handler.
   scoped_ptr<base::ListValue> args_;
 };
@@ -56,10 +67,17 @@ class ApplicationEventManager {
   // Destroy app router when app is unloaded.
   void OnAppUnloaded(const std::string& app_id);
 
+  // Sending an event the main document of |app_id| handles while |app_id|
+  // isn't running launches it in the background to handle it.
   void SendEvent(const std::string& app_id,
                  scoped_refptr<Event> event);
-  // TODO(xiang): Dispatch event to all loaded applications.
-  void BroadcastEvent(scoped_refptr<Event> event) { NOTIMPLEMENTED(); }
+  // Sends |event| to the loaded applications and to those which handle it.
+  void BroadcastEvent(scoped_refptr<Event> event);
+
+  // Records the events the main document of the installed application
+  // |app_id| handles.
+  void SetApplicationEvents(const std::string& app_id,
+                            const std::set<std::string>& events);
 
   void AttachObserver(const std::string& app_id,
                       const std::string& event_name,
@@ -73,12 +91,28 @@ class ApplicationEventManager {
                              content::WebContents* contents);
 
  private:
+  friend class ApplicationEventManagerTest;
+
   ApplicationEventRouter* GetAppRouter(const std::string& app_id);
+  bool IsHandledByMainDocument(const std::string& app_id,
+                               EventId event_id) const;
 
-  typedef std::map<std::string, linked_ptr<ApplicationEventRouter> >
+  typedef base::hash_map<std::string, linked_ptr<ApplicationEventRouter> >
       AppRouterMap;
   AppRouterMap app_routers_;
 
+  typedef std::set<std::string> AppIdSet;
+  typedef base::hash_map<EventObserver*, AppIdSet> ObserverAppMap;
+  // The applications each observer is attached to, so that detaching an
+  // observer doesn't visit all the routers. It may still list applications
+  // unloaded since.
+  ObserverAppMap observer_apps_;
+
+  typedef base::hash_map<EventId, AppIdSet> EventAppMap;
+  // The installed applications whose main document handles each event, built
+  // from the storage at startup.
+  EventAppMap event_apps_;
+
   ApplicationSystem* system_;
 
   DISALLOW_COPY_AND_ASSIGN(ApplicationEventManager);
@@ -0,0 +1,174 @@
+// Copyright (c) 2013 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "xwalk/application/browser/application_event_manager.h"
+
+#include "base/memory/scoped_vector.h"
+#include "base/strings/stringprintf.h"
+#include "content/public/test/test_browser_thread_bundle.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "xwalk/application/browser/application_event_router.h"
+#include "xwalk/application/browser/application_system.h"
+#include "xwalk/application/browser/event_observer.h"
+#include "xwalk/runtime/browser/runtime_context.h"
+
+namespace xwalk {
+namespace application {
+
+namespace {
+
+class CountingEventObserver : public EventObserver {
+ public:
+  explicit CountingEventObserver(ApplicationEventManager* manager)
+    : EventObserver(manager),
+      count_(0) {
+  }
+
+  virtual void Observe(const std::string& app_id,
+                       scoped_refptr<Event> event) OVERRIDE {
+    ++count_;
+  }
+
+  int count() const { return count_; }
+
+ private:
+  int count_;
+};
+
+std::string AppId(int i) {
+  return base::StringPrintf("app_%d", i);
+}
+
+std::string EventName(int i) {
+  return base::StringPrintf("EVENT_%d", i);
+}
+
+}  // namespace
+
+class ApplicationEventManagerTest : public testing::Test {
+ public:
+  virtual void SetUp() OVERRIDE {
+    runtime_context_.reset(new xwalk::RuntimeContext);
+    system_ = ApplicationSystem::Create(runtime_context_.get());
+    event_manager_ = system_->event_manager();
+  }
+
+  // Loads |app_id| and lets it receive events right away.
+  void LoadApp(const std::string& app_id) {
+    event_manager_->OnAppLoaded(app_id);
+    event_manager_->GetAppRouter(app_id)->DidStopLoading(NULL);
+  }
+
+  void SendEvent(const std::string& app_id, const std::string& event_name) {
+    event_manager_->SendEvent(app_id, Event::CreateEvent(
+        event_name, scoped_ptr<base::ListValue>(new base::ListValue())));
+  }
+
+  bool IsAttached(const std::string& app_id, EventObserver* observer) {
+    return event_manager_->GetAppRouter(app_id)->HasObserver(observer);
+  }
+
+ protected:
+  ApplicationEventManager* event_manager_;
+
+ private:
+  content::TestBrowserThreadBundle thread_bundle_;
+  scoped_ptr<xwalk::RuntimeContext> runtime_context_;
+  scoped_ptr<ApplicationSystem> system_;
+};
+
+TEST_F(ApplicationEventManagerTest, EventIds) {
+  EXPECT_EQ(Event::GetEventId("EVENT_A"), Event::GetEventId("EVENT_A"));
+  EXPECT_NE(Event::GetEventId("EVENT_A"), Event::GetEventId("EVENT_B"));
+  scoped_refptr<Event> event = Event::CreateEvent(
+      "EVENT_A", scoped_ptr<base::ListValue>(new base::ListValue()));
+  EXPECT_EQ(Event::GetEventId("EVENT_A"), event->id());
+}
+
+TEST_F(ApplicationEventManagerTest, DetachObserver) {
+  for (int i = 0; i < 3; ++i)
+    LoadApp(AppId(i));
+  CountingEventObserver observer(event_manager_);
+  event_manager_->AttachObserver(AppId(0), EventName(0), &observer);
+  event_manager_->AttachObserver(AppId(0), EventName(1), &observer);
+  event_manager_->AttachObserver(AppId(1), EventName(0), &observer);
+
+  SendEvent(AppId(0), EventName(0));
+  SendEvent(AppId(0), EventName(1));
+  SendEvent(AppId(1), EventName(0));
+  SendEvent(AppId(2), EventName(0));
+  EXPECT_EQ(3, observer.count());
+
+  event_manager_->DetachObserver(AppId(0), EventName(0), &observer);
+  EXPECT_TRUE(IsAttached(AppId(0), &observer));
+  event_manager_->DetachObserver(AppId(0), EventName(1), &observer);
+  EXPECT_FALSE(IsAttached(AppId(0), &observer));
+  EXPECT_TRUE(IsAttached(AppId(1), &observer));
+
+  event_manager_->AttachObserver(AppId(2), EventName(0), &observer);
+  event_manager_->DetachObserver(&observer);
+  EXPECT_FALSE(IsAttached(AppId(1), &observer));
+  EXPECT_FALSE(IsAttached(AppId(2), &observer));
+  for (int i = 0; i < 3; ++i)
+    SendEvent(AppId(i), EventName(0));
+  EXPECT_EQ(3, observer.count());
+}
+
+// Each observer is notified only of the events it's attached to, and deleting
+// the observers detaches them from every application.
+TEST_F(ApplicationEventManagerTest, DispatchToManyObservers) {
+  const int kAppCount = 10;
+  const int kEventCount = 20;
+  const int kObserversPerApp = 10;
+  const int kDispatchCount = 2000;
+
+  for (int i = 0; i < kAppCount; ++i)
+    LoadApp(AppId(i));
+
+  // Half the observers listen to the even events, the others to the odd
+  // ones.
+  ScopedVector<CountingEventObserver> observers;
+  for (int i = 0; i < kAppCount; ++i) {
+    for (int j = 0; j < kObserversPerApp; ++j) {
+      CountingEventObserver* observer =
+          new CountingEventObserver(event_manager_);
+      observers.push_back(observer);
+      for (int k = j % 2; k < kEventCount; k += 2)
+        event_manager_->AttachObserver(AppId(i), EventName(k), observer);
+    }
+  }
+
+  std::vector<scoped_refptr<Event> > events;
+  for (int i = 0; i < kEventCount; ++i) {
+    events.push_back(Event::CreateEvent(
+        EventName(i), scoped_ptr<base::ListValue>(new base::ListValue())));
+  }
+
+  // kAppCount and kEventCount are even, so each application gets only even
+  // or only odd events.
+  for (int i = 0; i < kDispatchCount; ++i)
+    event_manager_->SendEvent(AppId(i % kAppCount), events[i % kEventCount]);
+
+  const int kEventsPerApp = kDispatchCount / kAppCount;
+  for (int i = 0; i < kAppCount; ++i) {
+    for (int j = 0; j < kObserversPerApp; ++j) {
+      EXPECT_EQ(j % 2 == i % 2 ? kEventsPerApp : 0,
+                observers[i * kObserversPerApp + j]->count());
+    }
+  }
+
+  // The observers detach themselves when deleted.
+  CountingEventObserver remaining_observer(event_manager_);
+  for (int i = 0; i < kAppCount; ++i) {
+    event_manager_->AttachObserver(AppId(i), EventName(i % kEventCount),
+                                   &remaining_observer);
+  }
+  observers.clear();
+  for (int i = 0; i < kAppCount; ++i)
+    SendEvent(AppId(i), EventName(i % kEventCount));
+  EXPECT_EQ(kAppCount, remaining_observer.count());
+}
+
+}  // namespace application
+}  // namespace xwalk
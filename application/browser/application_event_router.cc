@@ -7,22 +7,55 @@
 #include <algorithm>
 
 #include "base/bind.h"
+#include "base/command_line.h"
 #include "base/message_loop/message_loop.h"
 #include "base/stl_util.h"
+#include "base/strings/string_number_conversions.h"
 #include "content/public/browser/browser_thread.h"
 #include "content/public/browser/web_contents_observer.h"
 #include "xwalk/application/browser/application_event_manager.h"
 #include "xwalk/application/browser/application_system.h"
 #include "xwalk/application/common/event_names.h"
+#include "xwalk/runtime/common/xwalk_switches.h"
 
 namespace xwalk {
 namespace application {
 
+namespace {
+
+// The default maximum number of lazy events queued per application.
+const size_t kDefaultLazyEventCapacity = 64;
+
+// The number of lazy events processed per task.
+const size_t kLazyEventsPerTask = 4;
+
+size_t GetLazyEventCapacity() {
+  const CommandLine& cmd_line = *CommandLine::ForCurrentProcess();
+  if (!cmd_line.HasSwitch(switches::kLazyEventQueueSize))
+    return kDefaultLazyEventCapacity;
+  int capacity;
+  if (!base::StringToInt(
+          cmd_line.GetSwitchValueASCII(switches::kLazyEventQueueSize),
+          &capacity) || capacity <= 0) {
+    LOG(WARNING) << "Invalid --" << switches::kLazyEventQueueSize;
+    return kDefaultLazyEventCapacity;
+  }
+  return capacity;
+}
+
+}  // namespace
+
 ApplicationEventRouter::ApplicationEventRouter(
     ApplicationSystem* system, const std::string& app_id)
-    : system_(system),
+    : lazy_event_capacity_(GetLazyEventCapacity()),
+      dropped_event_count_(0),
+      coalesced_event_count_(0),
+      lazy_events_scheduled_(false),
+      on_launched_id_(Event::GetEventId(kOnLaunched)),
+      application_launched_(false),
+      system_(system),
       app_id_(app_id),
-      application_launched_(false) {
+      weak_ptr_factory_(this) {
 }
 
 ApplicationEventRouter::~ApplicationEventRouter() {
@@ -32,12 +65,16 @@ ApplicationEventRouter::~ApplicationEventRouter() {
 void ApplicationEventRouter::DidStopLoading(
     content::RenderViewHost* render_view_host) {
   application_launched_ = true;
-  ProcessLazyEvents();
+  if (!lazy_events_scheduled_)
+    ProcessLazyEvents();
 }
 
 void ApplicationEventRouter::RenderProcessGone(
     base::TerminationStatus status) {
   application_launched_ = false;
+  // The events left are processed if the main document is loaded again.
+  weak_ptr_factory_.InvalidateWeakPtrs();
+  lazy_events_scheduled_ = false;
   DetachAllObservers();
 }
 
@@ -48,58 +85,81 @@ void ApplicationEventRouter::ObserveMainDocument(
 
 void ApplicationEventRouter::SetMainEvents(
     const std::set<std::string>& events) {
-  main_events_ = events;
+  main_events_.clear();
+  std::set<std::string>::const_iterator it = events.begin();
+  for (; it != events.end(); ++it)
+    main_events_.insert(Event::GetEventId(*it));
 }
 
 void ApplicationEventRouter::AttachObserver(const std::string& event_name,
                                             EventObserver* observer) {
-  if (!ContainsKey(observers_, event_name)) {
-    observers_.insert(std::make_pair(
-          event_name, new ObserverList<EventObserver>()));
-  }
-  observers_[event_name]->AddObserver(observer);
+  const EventId event_id = Event::GetEventId(event_name);
+  linked_ptr<ObserverList<EventObserver> >& observers = observers_[event_id];
+  if (!observers.get())
+    observers.reset(new ObserverList<EventObserver>());
+  observers->AddObserver(observer);
+  observer_events_[observer].insert(event_id);
 }
 
 void ApplicationEventRouter::DetachObserver(const std::string& event_name,
                                             EventObserver* observer) {
-  if (!ContainsKey(observers_, event_name)) {
+  const EventId event_id = Event::GetEventId(event_name);
+  ObserverEventMap::iterator it = observer_events_.find(observer);
+  if (it == observer_events_.end() || !it->second.erase(event_id)) {
     DLOG(WARNING) << "Can't find attached observer for application(" << app_id_
                   << ") with event(" << event_name << ").";
     return;
   }
-
-  observers_[event_name]->RemoveObserver(observer);
-  if (!observers_[event_name]->might_have_observers()) {
-    observers_.erase(event_name);
-  }
+  if (it->second.empty())
+    observer_events_.erase(it);
+  DetachObserverFromEvent(event_id, observer);
 }
 
 void ApplicationEventRouter::DetachObserver(EventObserver* observer) {
-  ObserverListMap::iterator it = observers_.begin();
-  while (it != observers_.end())
-    DetachObserver((it++)->first, observer);
+  ObserverEventMap::iterator it = observer_events_.find(observer);
+  if (it == observer_events_.end())
+    return;
+  EventIdSet::const_iterator event_it = it->second.begin();
+  for (; event_it != it->second.end(); ++event_it)
+    DetachObserverFromEvent(*event_it, observer);
+  observer_events_.erase(it);
+}
+
+bool ApplicationEventRouter::HasObserver(EventObserver* observer) const {
+  return ContainsKey(observer_events_, observer);
+}
+
+void ApplicationEventRouter::DetachObserverFromEvent(EventId event_id,
+                                                     EventObserver* observer) {
+  ObserverListMap::iterator it = observers_.find(event_id);
+  if (it == observers_.end())
+    return;
+  it->second->RemoveObserver(observer);
+  if (!it->second->might_have_observers())
+    observers_.erase(it);
 }
 
 void ApplicationEventRouter::DispatchEvent(scoped_refptr<Event> event) {
-  const std::string& event_name = event->name();
+  const EventId event_id = event->id();
 
-  if (main_events_.find(event_name) != main_events_.end() ||
-      event_name == kOnLaunched) {
-    if (!application_launched_) {
-        lazy_events_.push_back(event);
+  if (ContainsKey(main_events_, event_id) || event_id == on_launched_id_) {
+    // The events received while the lazy ones are processed are queued
+    // behind them, to keep their order.
+    if (!application_launched_ || lazy_events_scheduled_) {
+      QueueLazyEvent(event);
       return;
     }
   }
 
   if (!application_launched_) {
-    LOG(WARNING) << "Ignore event: " << event_name
+    LOG(WARNING) << "Ignore event: " << event->name()
                  << " send to terminated application:" << app_id_;
     return;
   }
 
-  if (!ContainsKey(observers_, event_name) ||
-      !observers_[event_name]->might_have_observers()) {
-    LOG(INFO) << "No registered handler to handle event:" << event_name;
+  ObserverListMap::iterator it = observers_.find(event_id);
+  if (it == observers_.end() || !it->second->might_have_observers()) {
+    DVLOG(1) << "No registered handler to handle event:" << event->name();
     return;
   }
 
@@ -112,24 +172,79 @@ void ApplicationEventRouter::DetachAllObservers() {
     it->second->Clear();
   }
   observers_.clear();
+  observer_events_.clear();
+}
+
+void ApplicationEventRouter::QueueLazyEvent(scoped_refptr<Event> event) {
+  // Only the latest state reported by an event matters to the application.
+  EventIndex::iterator it = lazy_event_index_.find(event->id());
+  if (it != lazy_event_index_.end()) {
+    *it->second = event;
+    ++coalesced_event_count_;
+    return;
+  }
+
+  const EventPriority priority =
+      event->id() == on_launched_id_ ? PRIORITY_HIGH : PRIORITY_NORMAL;
+  if (lazy_event_count() >= lazy_event_capacity_) {
+    // Make room by dropping the oldest event of the lowest priority, unless
+    // it's of a higher priority than |event|.
+    EventList* victims = &lazy_events_[PRIORITY_NORMAL];
+    if (victims->empty() && priority == PRIORITY_HIGH)
+      victims = &lazy_events_[PRIORITY_HIGH];
+    ++dropped_event_count_;
+    if (victims->empty()) {
+      LOG(WARNING) << "Dropped event: " << event->name()
+                   << " sent to application: " << app_id_;
+      return;
+    }
+    LOG(WARNING) << "Dropped event: " << victims->front()->name()
+                 << " sent to application: " << app_id_;
+    lazy_event_index_.erase(victims->front()->id());
+    victims->pop_front();
+  }
+
+  EventList& events = lazy_events_[priority];
+  lazy_event_index_[event->id()] = events.insert(events.end(), event);
+}
+
+scoped_refptr<Event> ApplicationEventRouter::TakeLazyEvent() {
+  for (int priority = 0; priority < PRIORITY_COUNT; ++priority) {
+    EventList& events = lazy_events_[priority];
+    if (events.empty())
+      continue;
+    scoped_refptr<Event> event = events.front();
+    lazy_event_index_.erase(event->id());
+    events.pop_front();
+    return event;
+  }
+  return NULL;
 }
 
 void ApplicationEventRouter::ProcessLazyEvents() {
-  if (lazy_events_.empty())
+  lazy_events_scheduled_ = false;
+  if (!application_launched_)
     return;
 
-  EventVector::iterator it = lazy_events_.begin();
-  for (; it != lazy_events_.end(); ++it)
-    ProcessEvent(*it);
-  lazy_events_.clear();
+  for (size_t i = 0; i < kLazyEventsPerTask && lazy_event_count(); ++i)
+    ProcessEvent(TakeLazyEvent());
+
+  if (!lazy_event_count())
+    return;
+  lazy_events_scheduled_ = true;
+  base::MessageLoop::current()->PostTask(
+      FROM_HERE,
+      base::Bind(&ApplicationEventRouter::ProcessLazyEvents,
+                 weak_ptr_factory_.GetWeakPtr()));
 }
 
 void ApplicationEventRouter::ProcessEvent(scoped_refptr<Event> event) {
-  const std::string& event_name = event->name();
-  if (ContainsKey(observers_, event_name)) {
-    FOR_EACH_OBSERVER(
-        EventObserver, *observers_[event_name], Observe(app_id_, event));
-  }
+  ObserverListMap::iterator it = observers_.find(event->id());
+  if (it == observers_.end())
+    return;
+  // Keeps the list alive if its last observer is detached while notified.
+  linked_ptr<ObserverList<EventObserver> > observers = it->second;
+  FOR_EACH_OBSERVER(EventObserver, *observers, Observe(app_id_, event));
 }
 
 }  // namespace application
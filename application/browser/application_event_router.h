@@ -12,12 +12,15 @@
 #include <string>
 #include <vector>
 
+#include "base/containers/hash_tables.h"
 #include "base/gtest_prod_util.h"
 #include "base/memory/linked_ptr.h"
 #include "base/memory/ref_counted.h"
+#include "base/memory/weak_ptr.h"
 #include "base/observer_list.h"
 #include "base/values.h"
 #include "content/public/browser/web_contents_observer.h"
+#include "xwalk/application/browser/application_event_manager.h"
 #include "xwalk/application/browser/event_observer.h"
 
 namespace content {
@@ -49,36 +52,73 @@ class ApplicationEventRouter : public content::WebContentsObserver {
   void AttachObserver(const std::string& event_name, EventObserver* observer);
   void DetachObserver(const std::string& event_name, EventObserver* observer);
   void DetachObserver(EventObserver* observer);
+  // Whether |observer| is attached to any event.
+  bool HasObserver(EventObserver* observer) const;
 
   // If the application is not launched or not finish loading the main document
   // the |event| will be regarded as lazy event and queued for later processing.
+  // A queued event replaces the one of the same name already queued, if any.
   void DispatchEvent(scoped_refptr<Event> event);
 
+  // The number of lazy events waiting to be processed.
+  size_t lazy_event_count() const {
+    return lazy_events_[PRIORITY_HIGH].size() +
+        lazy_events_[PRIORITY_NORMAL].size();
+  }
+  // The number of lazy events dropped because the queue was full.
+  size_t dropped_event_count() const { return dropped_event_count_; }
+  // The number of lazy events replaced by a later one of the same name.
+  size_t coalesced_event_count() const { return coalesced_event_count_; }
+
  private:
   friend class ApplicationEventRouterTest;
   FRIEND_TEST_ALL_PREFIXES(ApplicationEventRouterTest, DetachObservers);
 
-  void DetachObserverFromEvent(const std::string& event_name,
-                               EventObserver* observer);
+  // The lazy events of a higher priority are processed first.
+  enum EventPriority {
+    PRIORITY_HIGH,
+    PRIORITY_NORMAL,
+    PRIORITY_COUNT
+  };
+
+  void DetachObserverFromEvent(EventId event_id, EventObserver* observer);
   void DetachAllObservers();
 
   void ProcessEvent(scoped_refptr<Event> event);
+  void QueueLazyEvent(scoped_refptr<Event> event);
+  // Processes a few lazy events, and posts a task to process the next ones so
+  // that the replay doesn't hold the UI thread.
   void ProcessLazyEvents();
+  scoped_refptr<Event> TakeLazyEvent();
 
-  // Key by event name.
-  typedef std::map<std::string, linked_ptr<ObserverList<EventObserver> > >
+  // Key by event id.
+  typedef base::hash_map<EventId, linked_ptr<ObserverList<EventObserver> > >
     ObserverListMap;
   // All attached observers.
   ObserverListMap observers_;
 
-  typedef std::vector<scoped_refptr<Event> > EventVector;
-  // Lazy events queued before application launched.
-  EventVector lazy_events_;
+  typedef std::set<EventId> EventIdSet;
+  typedef base::hash_map<EventObserver*, EventIdSet> ObserverEventMap;
+  // The events each observer is attached to.
+  ObserverEventMap observer_events_;
+
+  typedef std::list<scoped_refptr<Event> > EventList;
+  // Lazy events queued before application launched, by priority.
+  EventList lazy_events_[PRIORITY_COUNT];
+  // The queued lazy events, by id.
+  typedef base::hash_map<EventId, EventList::iterator> EventIndex;
+  EventIndex lazy_event_index_;
+  // The maximum number of lazy events queued.
+  size_t lazy_event_capacity_;
+  size_t dropped_event_count_;
+  size_t coalesced_event_count_;
+  // True while a task to process lazy events is posted.
+  bool lazy_events_scheduled_;
 
-  typedef std::set<std::string> EventSet;
   // Events registered in main document, will be filled when application is
   // loaded.
-  EventSet main_events_;
+  base::hash_set<EventId> main_events_;
+  const EventId on_launched_id_;
 
   // True when application's main document or entry page is finished loading.
   bool application_launched_;
@@ -86,6 +126,8 @@ class ApplicationEventRouter : public content::WebContentsObserver {
   ApplicationSystem* system_;
   std::string app_id_;
 
+  base::WeakPtrFactory<ApplicationEventRouter> weak_ptr_factory_;
+
   DISALLOW_COPY_AND_ASSIGN(ApplicationEventRouter);
 };
 
@@ -2,12 +2,15 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+#include "base/run_loop.h"
+#include "base/strings/string_number_conversions.h"
 #include "content/public/test/test_browser_thread_bundle.h"
 #include "testing/gtest/include/gtest/gtest.h"
 #include "xwalk/application/browser/application_event_manager.h"
 #include "xwalk/application/browser/application_event_router.h"
 #include "xwalk/application/browser/event_observer.h"
 #include "xwalk/application/browser/application_system.h"
+#include "xwalk/application/common/event_names.h"
 #include "xwalk/runtime/browser/runtime_context.h"
 
 namespace xwalk {
@@ -43,6 +46,23 @@ class MockEventObserver : public EventObserver {
   }
 };
 
+class RecordingEventObserver : public EventObserver {
+ public:
+  explicit RecordingEventObserver(ApplicationEventManager* manager)
+    : EventObserver(manager) {
+  }
+
+  virtual void Observe(const std::string& app_id,
+                       scoped_refptr<Event> event) OVERRIDE {
+    events_.push_back(event);
+  }
+
+  const std::vector<scoped_refptr<Event> >& events() const { return events_; }
+
+ private:
+  std::vector<scoped_refptr<Event> > events_;
+};
+
 }  // namespace
 
 class ApplicationEventRouterTest : public testing::Test {
@@ -62,7 +82,7 @@ class ApplicationEventRouterTest : public testing::Test {
 
   int GetObserverCount(const std::string& event_name) {
     ApplicationEventRouter::ObserverListMap::iterator it =
-        router_->observers_.find(event_name);
+        router_->observers_.find(Event::GetEventId(event_name));
     if (it == router_->observers_.end() || !it->second->might_have_observers())
       return 0;
     ObserverList<EventObserver>::Iterator ob_it(*it->second);
@@ -76,6 +96,10 @@ class ApplicationEventRouterTest : public testing::Test {
     return router_->observers_.size();
   }
 
+  void SetLazyEventCapacity(size_t capacity) {
+    router_->lazy_event_capacity_ = capacity;
+  }
+
  protected:
   ApplicationEventManager* event_manager_;
   scoped_ptr<ApplicationEventRouter> router_;
@@ -155,5 +179,93 @@ TEST_F(ApplicationEventRouterTest, EventDispatch) {
   ASSERT_EQ(g_call_sequence.size(), 3);
 }
 
+// Events queued before the main document is loaded replace the previous
+// ones of the same name.
+TEST_F(ApplicationEventRouterTest, LazyEventsCoalesced) {
+  RecordingEventObserver observer(event_manager_);
+  std::set<std::string> main_events;
+  main_events.insert(kMockEvent0);
+  main_events.insert(kMockEvent1);
+  router_->SetMainEvents(main_events);
+  router_->AttachObserver(kMockEvent0, &observer);
+  router_->AttachObserver(kMockEvent1, &observer);
+
+  scoped_refptr<Event> latest = Event::CreateEvent(
+      kMockEvent0, scoped_ptr<base::ListValue>(new base::ListValue()));
+  router_->DispatchEvent(Event::CreateEvent(
+      kMockEvent0, scoped_ptr<base::ListValue>(new base::ListValue())));
+  router_->DispatchEvent(Event::CreateEvent(
+      kMockEvent1, scoped_ptr<base::ListValue>(new base::ListValue())));
+  router_->DispatchEvent(latest);
+  EXPECT_EQ(2u, router_->lazy_event_count());
+  EXPECT_EQ(1u, router_->coalesced_event_count());
+  EXPECT_EQ(0u, router_->dropped_event_count());
+
+  router_->DidStopLoading(NULL);
+  ASSERT_EQ(2u, observer.events().size());
+  EXPECT_EQ(latest, observer.events()[0]);
+  EXPECT_EQ(kMockEvent1, observer.events()[1]->name());
+  EXPECT_EQ(0u, router_->lazy_event_count());
+}
+
+// onLaunched is processed before the other events, and isn't dropped when the
+// queue is full.
+TEST_F(ApplicationEventRouterTest, LazyEventsPriorityAndCapacity) {
+  RecordingEventObserver observer(event_manager_);
+  std::set<std::string> main_events;
+  main_events.insert(kMockEvent0);
+  main_events.insert(kMockEvent1);
+  router_->SetMainEvents(main_events);
+  router_->AttachObserver(kMockEvent0, &observer);
+  router_->AttachObserver(kMockEvent1, &observer);
+  router_->AttachObserver(kOnLaunched, &observer);
+  SetLazyEventCapacity(2);
+
+  const char* names[] = { kMockEvent0, kMockEvent1, kOnLaunched };
+  for (size_t i = 0; i < arraysize(names); ++i) {
+    router_->DispatchEvent(Event::CreateEvent(
+        names[i], scoped_ptr<base::ListValue>(new base::ListValue())));
+  }
+  EXPECT_EQ(2u, router_->lazy_event_count());
+  EXPECT_EQ(1u, router_->dropped_event_count());
+
+  router_->DidStopLoading(NULL);
+  ASSERT_EQ(2u, observer.events().size());
+  EXPECT_EQ(kOnLaunched, observer.events()[0]->name());
+  EXPECT_EQ(kMockEvent1, observer.events()[1]->name());
+}
+
+// Many lazy events are processed across several tasks, and the events
+// received meanwhile are processed after them.
+TEST_F(ApplicationEventRouterTest, LazyEventsPaced) {
+  RecordingEventObserver observer(event_manager_);
+  const size_t kEventCount = 16;
+  std::set<std::string> main_events;
+  for (size_t i = 0; i < kEventCount; ++i) {
+    const std::string name = "MOCK_EVENT_" + base::Uint64ToString(i);
+    main_events.insert(name);
+    router_->AttachObserver(name, &observer);
+  }
+  router_->SetMainEvents(main_events);
+
+  for (size_t i = 0; i < kEventCount; ++i) {
+    router_->DispatchEvent(Event::CreateEvent(
+        "MOCK_EVENT_" + base::Uint64ToString(i),
+        scoped_ptr<base::ListValue>(new base::ListValue())));
+  }
+  EXPECT_EQ(kEventCount, router_->lazy_event_count());
+
+  router_->DidStopLoading(NULL);
+  EXPECT_LT(observer.events().size(), kEventCount);
+  EXPECT_GT(router_->lazy_event_count(), 0u);
+
+  router_->DispatchEvent(Event::CreateEvent(
+      kMockEvent0, scoped_ptr<base::ListValue>(new base::ListValue())));
+  base::RunLoop().RunUntilIdle();
+  ASSERT_EQ(kEventCount + 1, observer.events().size());
+  EXPECT_EQ(kMockEvent0, observer.events().back()->name());
+  EXPECT_EQ(0u, router_->lazy_event_count());
+}
+
 }  // namespace application
 }  // namespace xwalk
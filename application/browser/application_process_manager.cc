@@ -5,18 +5,27 @@
 #include "xwalk/application/browser/application_process_manager.h"
 
 #include <string>
+#include <vector>
 
+#include "base/bind.h"
+#include "base/command_line.h"
 #include "base/stl_util.h"
+#include "base/strings/string_number_conversions.h"
+#include "content/public/browser/site_instance.h"
+#include "content/public/browser/web_contents.h"
+#include "content/public/browser/web_contents_observer.h"
 #include "net/base/net_util.h"
 #include "xwalk/application/browser/application_event_manager.h"
 #include "xwalk/application/browser/application_service.h"
 #include "xwalk/application/browser/application_system.h"
+#include "xwalk/application/browser/renderer_pool.h"
 #include "xwalk/application/common/application_manifest_constants.h"
 #include "xwalk/application/common/constants.h"
 #include "xwalk/application/common/manifest_handlers/main_document_handler.h"
 #include "xwalk/application/common/event_names.h"
 #include "xwalk/runtime/browser/runtime.h"
 #include "xwalk/runtime/browser/runtime_context.h"
+#include "xwalk/runtime/common/xwalk_switches.h"
 
 using xwalk::Runtime;
 using xwalk::RuntimeContext;
@@ -27,6 +36,18 @@ namespace keys = application_manifest_keys;
 
 namespace application {
 
+namespace {
+
+// The memory the prelaunched render processes may use, when it's not given
+// on the command line.
+const int kDefaultPrelaunchMemoryBudgetMB = 64;
+
+// The time an application launched in the background to handle events stays
+// without receiving any before being suspended.
+const int kBackgroundIdleTimeoutSeconds = 10;
+
+}  // namespace
+
 class FinishEventObserver : public EventObserver {
  public:
   FinishEventObserver(
@@ -42,19 +63,54 @@ class FinishEventObserver : public EventObserver {
     std::string ack_event_name;
     event->args()->GetString(0, &ack_event_name);
     if (ack_event_name == xwalk::application::kOnSuspend)
-      process_manager_->CloseMainDocument();
+      process_manager_->CloseMainDocument(app_id);
+  }
+
+
+ private:
+  ApplicationProcessManager* process_manager_;
+};
+
+// Reports when a runtime first finishes loading, and first paints.
+class RuntimeLaunchObserver : public content::WebContentsObserver {
+ public:
+  RuntimeLaunchObserver(ApplicationProcessManager* process_manager,
+                        Runtime* runtime)
+      : content::WebContentsObserver(runtime->web_contents()),
+        process_manager_(process_manager),
+        runtime_(runtime),
+        loaded_(false),
+        painted_(false) {
+  }
+
+  virtual void DidStopLoading(
+      content::RenderViewHost* render_view_host) OVERRIDE {
+    if (loaded_)
+      return;
+    loaded_ = true;
+    process_manager_->OnRuntimeLoaded(runtime_);
   }
 
+  virtual void DidFirstVisuallyNonEmptyPaint(int32 page_id) OVERRIDE {
+    if (painted_)
+      return;
+    painted_ = true;
+    process_manager_->OnRuntimePainted(runtime_);
+  }
 
  private:
   ApplicationProcessManager* process_manager_;
+  Runtime* runtime_;
+  bool loaded_;
+  bool painted_;
 };
 
 ApplicationProcessManager::ApplicationProcessManager(
     RuntimeContext* runtime_context)
     : runtime_context_(runtime_context),
-      main_runtime_(NULL),
-      weak_ptr_factory_(this) {
+      weak_ptr_factory_(this),
+      background_idle_timeout_(
+          base::TimeDelta::FromSeconds(kBackgroundIdleTimeoutSeconds)) {
 }
 
 ApplicationProcessManager::~ApplicationProcessManager() {
@@ -70,42 +126,177 @@ bool ApplicationProcessManager::LaunchApplication(
   return RunFromLocalPath(application);
 }
 
+bool ApplicationProcessManager::LaunchInBackground(
+    const ApplicationData* application) {
+  if (!RunMainDocument(application))
+    return false;
+
+  linked_ptr<base::Timer> timer(new base::Timer(true, false));
+  timer->Start(
+      FROM_HERE, background_idle_timeout_,
+      base::Bind(&ApplicationProcessManager::OnBackgroundApplicationIdle,
+                 base::Unretained(this), application->ID()));
+  idle_timers_[application->ID()] = timer;
+  return true;
+}
+
+void ApplicationProcessManager::OnEventDispatched(const std::string& app_id) {
+  IdleTimerMap::iterator it = idle_timers_.find(app_id);
+  if (it != idle_timers_.end())
+    it->second->Reset();
+}
+
+void ApplicationProcessManager::CloseApplication(const std::string& app_id) {
+  if (ContainsKey(main_runtimes_, app_id))
+    CloseMainDocument(app_id);
+
+  std::vector<Runtime*> runtimes;
+  for (std::set<Runtime*>::const_iterator it = runtimes_.begin();
+       it != runtimes_.end(); ++it) {
+    if (GetApplicationID(*it) == app_id)
+      runtimes.push_back(*it);
+  }
+  for (size_t i = 0; i < runtimes.size(); ++i)
+    runtimes[i]->Close();
+}
+
+Runtime* ApplicationProcessManager::GetMainDocumentRuntime(
+    const std::string& app_id) const {
+  MainRuntimeMap::const_iterator it = main_runtimes_.find(app_id);
+  return it != main_runtimes_.end() ? it->second : NULL;
+}
+
+std::string ApplicationProcessManager::GetApplicationID(
+    const Runtime* runtime) const {
+  RuntimeApplicationMap::const_iterator it =
+      runtime_applications_.find(runtime);
+  if (it != runtime_applications_.end())
+    return it->second;
+
+  ApplicationService* service =
+      runtime_context_->GetApplicationSystem()->application_service();
+  const GURL& url = runtime->web_contents()->GetURL();
+  if (url.SchemeIs(kApplicationScheme) &&
+      service->GetRunningApplication(url.host()))
+    return url.host();
+  return std::string();
+}
+
+std::string ApplicationProcessManager::GetApplicationIDForProcess(
+    const content::RenderProcessHost* host) const {
+  for (std::set<Runtime*>::const_iterator it = runtimes_.begin();
+       it != runtimes_.end(); ++it) {
+    if ((*it)->web_contents()->GetRenderProcessHost() == host)
+      return GetApplicationID(*it);
+  }
+  return std::string();
+}
+
+void ApplicationProcessManager::PrelaunchRenderers() {
+  const CommandLine& cmd_line = *CommandLine::ForCurrentProcess();
+  int size = 0;
+  if (!base::StringToInt(
+          cmd_line.GetSwitchValueASCII(switches::kPrelaunchRenderers),
+          &size) || size <= 0)
+    return;
+
+  int memory_budget_mb = kDefaultPrelaunchMemoryBudgetMB;
+  if (cmd_line.HasSwitch(switches::kPrelaunchMemoryBudget) &&
+      (!base::StringToInt(
+           cmd_line.GetSwitchValueASCII(switches::kPrelaunchMemoryBudget),
+           &memory_budget_mb) || memory_budget_mb <= 0)) {
+    LOG(WARNING) << "Invalid --" << switches::kPrelaunchMemoryBudget;
+    memory_budget_mb = kDefaultPrelaunchMemoryBudgetMB;
+  }
+
+  renderer_pool_.reset(new RendererPool(
+      runtime_context_, size, static_cast<size_t>(memory_budget_mb) << 20));
+  renderer_pool_->Fill();
+}
+
+bool ApplicationProcessManager::IsPrelaunchedProcess(
+    const content::RenderProcessHost* host) const {
+  return renderer_pool_ && renderer_pool_->Contains(host);
+}
+
 void ApplicationProcessManager::OnRuntimeAdded(Runtime* runtime) {
   DCHECK(runtime);
   runtimes_.insert(runtime);
+  launch_observers_[runtime] =
+      make_linked_ptr(new RuntimeLaunchObserver(this, runtime));
+}
+
+void ApplicationProcessManager::OnRuntimeOpened(Runtime* opener,
+                                                Runtime* runtime) {
+  // The windows an application opens belong to it, whatever URL they load.
+  const std::string app_id = GetApplicationID(opener);
+  if (!app_id.empty())
+    runtime_applications_[runtime] = app_id;
 }
 
 void ApplicationProcessManager::OnRuntimeRemoved(Runtime* runtime) {
   DCHECK(runtime);
+  const std::string app_id = GetApplicationID(runtime);
   runtimes_.erase(runtime);
-  // FIXME: main_runtime_ should always be the last one to close
-  // in RuntimeRegistry. Need to fix the issue from browser tests.
-  if (runtimes_.size() == 1 &&
-      ContainsKey(runtimes_, main_runtime_)) {
-    ApplicationSystem* system = runtime_context_->GetApplicationSystem();
-    ApplicationEventManager* event_manager = system->event_manager();
-    ApplicationService* service = system->application_service();
-    std::string app_id = service->GetRunningApplication()->ID();
-
-    // If onSuspend is not registered in main document,
-    // we close the main document immediately.
-    if (!IsOnSuspendHandlerRegistered(app_id)) {
-      CloseMainDocument();
-      return;
-    }
+  runtime_applications_.erase(runtime);
+  launch_observers_.erase(runtime);
+  if (app_id.empty())
+    return;
 
-    DCHECK(!finish_observer_);
-    finish_observer_.reset(
-        new FinishEventObserver(event_manager, this));
-    event_manager->AttachObserver(
-      app_id, kOnJavaScriptEventAck,
-      finish_observer_.get());
+  MainRuntimeMap::iterator main_runtime = main_runtimes_.find(app_id);
+  if (main_runtime != main_runtimes_.end() &&
+      main_runtime->second == runtime) {
+    // The main document closed itself.
+    main_runtimes_.erase(main_runtime);
+    finish_observers_.erase(app_id);
+    main_runtime = main_runtimes_.end();
+  }
 
-    scoped_ptr<base::ListValue> event_args(new base::ListValue);
-    scoped_refptr<Event> event = Event::CreateEvent(
-        xwalk::application::kOnSuspend, event_args.Pass());
-    event_manager->SendEvent(app_id, event);
+  if (main_runtime == main_runtimes_.end()) {
+    if (!HasRuntimes(app_id))
+      OnApplicationTerminated(app_id);
+    return;
   }
+
+  // FIXME: The main document should always be the last runtime of its
+  // application to close. Need to fix the issue from browser tests.
+  if (!HasRuntimes(app_id))
+    SuspendMainDocument(app_id);
+}
+
+void ApplicationProcessManager::SuspendMainDocument(const std::string& app_id) {
+  if (ContainsKey(finish_observers_, app_id))
+    return;
+  runtime_context_->GetApplicationSystem()->application_service()->
+      OnApplicationSuspended(app_id);
+
+  // If onSuspend is not registered in main document,
+  // we close the main document immediately.
+  if (!IsOnSuspendHandlerRegistered(app_id)) {
+    CloseMainDocument(app_id);
+    return;
+  }
+
+  ApplicationEventManager* event_manager =
+      runtime_context_->GetApplicationSystem()->event_manager();
+  linked_ptr<EventObserver> finish_observer(
+      new FinishEventObserver(event_manager, this));
+  finish_observers_[app_id] = finish_observer;
+  event_manager->AttachObserver(
+    app_id, kOnJavaScriptEventAck,
+    finish_observer.get());
+
+  scoped_ptr<base::ListValue> event_args(new base::ListValue);
+  scoped_refptr<Event> event = Event::CreateEvent(
+      xwalk::application::kOnSuspend, event_args.Pass());
+  event_manager->SendEvent(app_id, event);
+}
+
+Runtime* ApplicationProcessManager::CreateRuntime(const GURL& url) {
+  scoped_refptr<content::SiteInstance> site_instance;
+  if (renderer_pool_)
+    site_instance = renderer_pool_->Take();
+  return Runtime::Create(runtime_context_, url, site_instance.get());
 }
 
 bool ApplicationProcessManager::RunMainDocument(
@@ -115,20 +306,26 @@ bool ApplicationProcessManager::RunMainDocument(
   if (!main_info || !main_info->GetMainURL().is_valid())
     return false;
 
-  main_runtime_ = Runtime::Create(runtime_context_, main_info->GetMainURL());
+  Runtime* main_runtime = CreateRuntime(main_info->GetMainURL());
+  main_runtimes_[application->ID()] = main_runtime;
+  runtime_applications_[main_runtime] = application->ID();
   ApplicationEventManager* event_manager =
       runtime_context_->GetApplicationSystem()->event_manager();
   event_manager->OnMainDocumentCreated(
-      application->ID(), main_runtime_->web_contents());
+      application->ID(), main_runtime->web_contents());
   return true;
 }
 
-void ApplicationProcessManager::CloseMainDocument() {
-  DCHECK(main_runtime_);
+void ApplicationProcessManager::CloseMainDocument(const std::string& app_id) {
+  MainRuntimeMap::iterator it = main_runtimes_.find(app_id);
+  DCHECK(it != main_runtimes_.end());
 
-  finish_observer_.reset();
-  main_runtime_->Close();
-  main_runtime_ = NULL;
+  finish_observers_.erase(app_id);
+  // Forgotten first, so that closing it isn't taken for the main document
+  // closing itself.
+  Runtime* main_runtime = it->second;
+  main_runtimes_.erase(it);
+  main_runtime->Close();
 }
 
 bool ApplicationProcessManager::RunFromLocalPath(
@@ -143,7 +340,9 @@ bool ApplicationProcessManager::RunFromLocalPath(
       return false;
     }
 
-    Runtime::CreateWithDefaultWindow(runtime_context_, url);
+    Runtime* runtime = CreateRuntime(url);
+    runtime->AttachDefaultWindow();
+    runtime_applications_[runtime] = application->ID();
     return true;
   }
 
@@ -163,5 +362,59 @@ bool ApplicationProcessManager::IsOnSuspendHandlerRegistered(
   return true;
 }
 
+bool ApplicationProcessManager::HasRuntimes(const std::string& app_id) const {
+  for (std::set<Runtime*>::const_iterator it = runtimes_.begin();
+       it != runtimes_.end(); ++it) {
+    if (*it != GetMainDocumentRuntime(app_id) &&
+        GetApplicationID(*it) == app_id)
+      return true;
+  }
+  return false;
+}
+
+void ApplicationProcessManager::OnBackgroundApplicationIdle(
+    const std::string& app_id) {
+  Runtime* main_runtime = GetMainDocumentRuntime(app_id);
+  if (!main_runtime)
+    return;
+  // The events of the main document are only dispatched once it's loaded.
+  if (main_runtime->web_contents()->IsLoading()) {
+    idle_timers_[app_id]->Reset();
+    return;
+  }
+
+  // Deletes the timer running this task, which is safe.
+  idle_timers_.erase(app_id);
+  // The windows the application opened keep it running until they're closed,
+  // as if it was launched by the user.
+  if (!HasRuntimes(app_id))
+    SuspendMainDocument(app_id);
+}
+
+void ApplicationProcessManager::OnRuntimeLoaded(Runtime* runtime) {
+  const std::string app_id = GetApplicationID(runtime);
+  if (!app_id.empty()) {
+    runtime_context_->GetApplicationSystem()->application_service()->
+        OnApplicationLoaded(app_id);
+  }
+}
+
+void ApplicationProcessManager::OnRuntimePainted(Runtime* runtime) {
+  const std::string app_id = GetApplicationID(runtime);
+  // The main document isn't shown.
+  if (!app_id.empty() && runtime != GetMainDocumentRuntime(app_id)) {
+    runtime_context_->GetApplicationSystem()->application_service()->
+        OnApplicationVisible(app_id);
+  }
+}
+
+void ApplicationProcessManager::OnApplicationTerminated(
+    const std::string& app_id) {
+  idle_timers_.erase(app_id);
+  ApplicationService* service =
+      runtime_context_->GetApplicationSystem()->application_service();
+  service->OnApplicationTerminated(app_id);
+}
+
 }  // namespace application
 }  // namespace xwalk
@@ -11,15 +11,21 @@
 
 #include "base/callback.h"
 #include "base/compiler_specific.h"
+#include "base/memory/linked_ptr.h"
 #include "base/memory/ref_counted.h"
 #include "base/memory/weak_ptr.h"
 #include "base/time/time.h"
+#include "base/timer/timer.h"
 #include "xwalk/application/browser/event_observer.h"
 #include "xwalk/application/common/application_data.h"
 #include "xwalk/runtime/browser/runtime_registry.h"
 
 class GURL;
 
+namespace content {
+class RenderProcessHost;
+}
+
 namespace xwalk {
 class Runtime;
 class RuntimeContext;
@@ -30,9 +36,11 @@ namespace application {
 
 class ApplicationHost;
 class Manifest;
+class RendererPool;
+class RuntimeLaunchObserver;
 
-// This manages dynamic state of running applications. By now, it only launches
-// one application, later it will manages all event pages' lifecycle.
+// This manages dynamic state of running applications: the runtimes of each
+// one, and the lifecycle of their main documents.
 class ApplicationProcessManager : public RuntimeRegistryObserver {
  public:
   explicit ApplicationProcessManager(xwalk::RuntimeContext* runtime_context);
@@ -40,26 +48,86 @@ class ApplicationProcessManager : public RuntimeRegistryObserver {
 
   bool LaunchApplication(xwalk::RuntimeContext* runtime_context,
                          const ApplicationData* application);
-
-  Runtime* GetMainDocumentRuntime() const { return main_runtime_; }
+  // Runs only the main document of |application|, to handle events. It's
+  // suspended once it received no event for a while, unless it opened
+  // windows meanwhile.
+  bool LaunchInBackground(const ApplicationData* application);
+  // Delays the suspension of |app_id| if it runs in the background.
+  void OnEventDispatched(const std::string& app_id);
+  void set_background_idle_timeout(base::TimeDelta timeout) {
+    background_idle_timeout_ = timeout;
+  }
+
+  // Closes all the runtimes of the application |app_id|, main document
+  // included.
+  void CloseApplication(const std::string& app_id);
+
+  // Returns NULL if |app_id| doesn't run a main document.
+  Runtime* GetMainDocumentRuntime(const std::string& app_id) const;
+
+  // Returns the id of the running application |runtime| belongs to, or an
+  // empty string.
+  std::string GetApplicationID(const Runtime* runtime) const;
+  // Same, for the application rendered by |host|.
+  std::string GetApplicationIDForProcess(
+      const content::RenderProcessHost* host) const;
+
+  // Starts the render processes the applications launched next will use, if
+  // asked to on the command line. See switches::kPrelaunchRenderers.
+  void PrelaunchRenderers();
+  // Returns true if |host| was started ahead of time and isn't used by an
+  // application yet.
+  bool IsPrelaunchedProcess(const content::RenderProcessHost* host) const;
 
   // RuntimeRegistryObserver implementation.
   virtual void OnRuntimeAdded(Runtime* runtime) OVERRIDE;
   virtual void OnRuntimeRemoved(Runtime* runtime) OVERRIDE;
   virtual void OnRuntimeAppIconChanged(Runtime* runtime) OVERRIDE {}
+  virtual void OnRuntimeOpened(Runtime* opener, Runtime* runtime) OVERRIDE;
 
  private:
   friend class FinishEventObserver;
+  friend class RuntimeLaunchObserver;
+  typedef std::map<std::string, Runtime*> MainRuntimeMap;
+  typedef std::map<const Runtime*, std::string> RuntimeApplicationMap;
+  typedef std::map<std::string, linked_ptr<EventObserver> >
+      FinishObserverMap;
+  typedef std::map<std::string, linked_ptr<base::Timer> > IdleTimerMap;
+  typedef std::map<const Runtime*, linked_ptr<RuntimeLaunchObserver> >
+      LaunchObserverMap;
+
+  // Creates a runtime loading |url|, in a prelaunched process if any.
+  Runtime* CreateRuntime(const GURL& url);
   bool RunMainDocument(const ApplicationData* application);
   bool RunFromLocalPath(const ApplicationData* application);
-  void CloseMainDocument();
+  void CloseMainDocument(const std::string& app_id);
+  // Sends onSuspend to the main document of |app_id| if it handles it, and
+  // closes it.
+  void SuspendMainDocument(const std::string& app_id);
+  void OnBackgroundApplicationIdle(const std::string& app_id);
+  // Called when |runtime| first finishes loading, and first paints.
+  void OnRuntimeLoaded(Runtime* runtime);
+  void OnRuntimePainted(Runtime* runtime);
   bool IsOnSuspendHandlerRegistered(const std::string& app_id) const;
+  bool HasRuntimes(const std::string& app_id) const;
+  void OnApplicationTerminated(const std::string& app_id);
 
   xwalk::RuntimeContext* runtime_context_;
-  xwalk::Runtime* main_runtime_;
   base::WeakPtrFactory<ApplicationProcessManager> weak_ptr_factory_;
   std::set<Runtime*> runtimes_;
-  scoped_ptr<EventObserver> finish_observer_;
+  // The main documents of the running applications, by application id.
+  MainRuntimeMap main_runtimes_;
+  // The applications of the runtimes created by LaunchApplication(), and of
+  // those their pages opened. Other runtimes are matched to an application
+  // by their URL.
+  RuntimeApplicationMap runtime_applications_;
+  // Wait for the onSuspend event of an application to be handled.
+  FinishObserverMap finish_observers_;
+  // The applications running in the background, with their idle timers.
+  IdleTimerMap idle_timers_;
+  base::TimeDelta background_idle_timeout_;
+  LaunchObserverMap launch_observers_;
+  scoped_ptr<RendererPool> renderer_pool_;
 
   DISALLOW_COPY_AND_ASSIGN(ApplicationProcessManager);
 };
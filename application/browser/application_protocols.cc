@@ -5,51 +5,212 @@
 #include "xwalk/application/browser/application_protocols.h"
 
 #include <algorithm>
+#include <map>
 #include <string>
 #include <vector>
 
+#include "base/bind.h"
+#include "base/bind_helpers.h"
+#include "base/file_util.h"
 #include "base/files/file_path.h"
+#include "base/format_macros.h"
+#include "base/hash.h"
+#include "base/lazy_instance.h"
 #include "base/memory/weak_ptr.h"
-#include "base/threading/thread_restrictions.h"
+#include "base/message_loop/message_loop.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/string_split.h"
+#include "base/strings/stringprintf.h"
+#include "base/synchronization/lock.h"
 #include "base/threading/worker_pool.h"
 #include "base/threading/sequenced_worker_pool.h"
 #include "content/public/browser/browser_thread.h"
 #include "content/public/browser/resource_request_info.h"
 #include "url/url_util.h"
+#include "net/base/io_buffer.h"
+#include "net/base/mime_util.h"
 #include "net/base/net_errors.h"
+#include "net/filter/filter.h"
+#include "net/http/http_byte_range.h"
+#include "net/http/http_request_headers.h"
 #include "net/http/http_response_headers.h"
 #include "net/http/http_response_info.h"
+#include "net/http/http_util.h"
 #include "net/url_request/url_request_error_job.h"
 #include "net/url_request/url_request_file_job.h"
+#include "net/url_request/url_request_job.h"
 #include "net/url_request/url_request_simple_job.h"
+#include "net/url_request/url_request_status.h"
+#include "xwalk/application/browser/application_resource_cache.h"
+#include "xwalk/application/common/application_archive.h"
 #include "xwalk/application/common/application_data.h"
 #include "xwalk/application/common/application_file_util.h"
 #include "xwalk/application/common/application_manifest_constants.h"
-#include "xwalk/application/common/application_resource.h"
 #include "xwalk/application/common/constants.h"
 #include "xwalk/application/common/manifest_handlers/main_document_handler.h"
 
 using content::ResourceRequestInfo;
+using xwalk::application::ApplicationArchive;
 using xwalk::application::ApplicationData;
+using xwalk::application::ApplicationResourceCache;
 using xwalk::application::MainDocumentInfo;
 namespace keys = xwalk::application_manifest_keys;
 
 namespace {
 
+// Installed applications don't change until they are reinstalled, which
+// changes the validators of their resources.
+const char kImmutableCacheControl[] =
+    "Cache-Control: public, max-age=31536000, immutable";
+// The files of applications launched from a directory can be edited at any
+// time, their resources are revalidated with the ETag on each use.
+const char kRevalidateCacheControl[] = "Cache-Control: no-cache";
+
+// How a resource that exists is answered, depending on the validators and
+// the range of the request.
+struct ResourceResponse {
+  enum Status {
+    FULL,
+    PARTIAL,
+    NOT_MODIFIED,
+    RANGE_NOT_SATISFIABLE,
+  };
+
+  ResourceResponse()
+      : status(FULL),
+        immutable(false),
+        size(0),
+        first_byte(0),
+        last_byte(-1) {
+  }
+
+  int64 content_length() const {
+    return status == PARTIAL ? last_byte - first_byte + 1 : size;
+  }
+
+  Status status;
+  // Whether the resource is from an installed application.
+  bool immutable;
+  std::string etag;
+  int64 size;
+  base::Time last_modified;
+  // The bytes requested, inclusive, for PARTIAL responses.
+  int64 first_byte;
+  int64 last_byte;
+};
+
+// Strong validator of a resource, from when its application was installed,
+// its path in the application and its uncompressed size: a reinstallation
+// changes it, but not how the resource is stored or read.
+std::string MakeETag(const base::Time& install_time,
+                     const base::FilePath& relative_path,
+                     int64 size) {
+  return base::StringPrintf("\"%" PRIx64 "-%x-%" PRIx64 "\"",
+                            static_cast<uint64>(install_time.ToInternalValue()),
+                            base::Hash(relative_path.AsUTF8Unsafe()),
+                            static_cast<uint64>(size));
+}
+
+std::string FormatHTTPDate(const base::Time& time) {
+  static const char* const kDays[] = {
+    "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"
+  };
+  static const char* const kMonths[] = {
+    "Jan", "Feb", "Mar", "Apr", "May", "Jun",
+    "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"
+  };
+  base::Time::Exploded exploded;
+  time.UTCExplode(&exploded);
+  return base::StringPrintf("%s, %02d %s %04d %02d:%02d:%02d GMT",
+                            kDays[exploded.day_of_week],
+                            exploded.day_of_month,
+                            kMonths[exploded.month - 1],
+                            exploded.year,
+                            exploded.hour,
+                            exploded.minute,
+                            exploded.second);
+}
+
+bool MatchesETag(const std::string& header_value, const std::string& etag) {
+  std::vector<std::string> etags;
+  base::SplitString(header_value, ',', &etags);
+  for (size_t i = 0; i < etags.size(); ++i) {
+    if (etags[i] == "*" || etags[i] == etag)
+      return true;
+  }
+  return false;
+}
+
+// Sets the status of |response|, whose validators and size are set, from
+// the conditional and range headers of the request.
+void PrepareResourceResponse(const net::HttpRequestHeaders& headers,
+                             ResourceResponse* response) {
+  std::string value;
+  if (headers.GetHeader(net::HttpRequestHeaders::kIfNoneMatch, &value)) {
+    if (MatchesETag(value, response->etag)) {
+      response->status = ResourceResponse::NOT_MODIFIED;
+      return;
+    }
+  } else if (headers.GetHeader(net::HttpRequestHeaders::kIfModifiedSince,
+                               &value)) {
+    base::Time since;
+    if (base::Time::FromString(value.c_str(), &since) &&
+        response->last_modified.ToTimeT() <= since.ToTimeT()) {
+      response->status = ResourceResponse::NOT_MODIFIED;
+      return;
+    }
+  }
+
+  if (!headers.GetHeader(net::HttpRequestHeaders::kRange, &value))
+    return;
+  // The whole resource is sent if it changed since the range was known.
+  std::string if_range;
+  if (headers.GetHeader("If-Range", &if_range) &&
+      if_range != response->etag &&
+      if_range != FormatHTTPDate(response->last_modified))
+    return;
+
+  // Invalid ranges are ignored, as are multiple ranges that would need a
+  // multipart response.
+  std::vector<net::HttpByteRange> ranges;
+  if (!net::HttpUtil::ParseRangeHeader(value, &ranges) || ranges.size() != 1)
+    return;
+  net::HttpByteRange range = ranges[0];
+  if (!range.ComputeBounds(response->size)) {
+    response->status = ResourceResponse::RANGE_NOT_SATISFIABLE;
+    return;
+  }
+  response->status = ResourceResponse::PARTIAL;
+  response->first_byte = range.first_byte_position();
+  response->last_byte = range.last_byte_position();
+}
+
+// |response| is NULL when the resource isn't one of the application, like
+// the generated main document.
 net::HttpResponseHeaders* BuildHttpHeaders(
     const std::string& mime_type, const std::string& method,
     const base::FilePath& file_path, const base::FilePath& relative_path,
-    bool is_authority_match) {
+    bool is_authority_match, const ResourceResponse* response) {
   std::string raw_headers;
+  bool found = false;
   if (method == "GET") {
-    if (relative_path.empty())
+    if (relative_path.empty()) {
       raw_headers.append("HTTP/1.1 400 Bad Request");
-    else if (!is_authority_match)
+    } else if (!is_authority_match) {
       raw_headers.append("HTTP/1.1 403 Forbidden");
-    else if (file_path.empty())
+    } else if (file_path.empty()) {
       raw_headers.append("HTTP/1.1 404 Not Found");
-    else
-      raw_headers.append("HTTP/1.1 200 OK");
+    } else {
+      found = response != NULL;
+      if (!found || response->status == ResourceResponse::FULL)
+        raw_headers.append("HTTP/1.1 200 OK");
+      else if (response->status == ResourceResponse::PARTIAL)
+        raw_headers.append("HTTP/1.1 206 Partial Content");
+      else if (response->status == ResourceResponse::NOT_MODIFIED)
+        raw_headers.append("HTTP/1.1 304 Not Modified");
+      else
+        raw_headers.append("HTTP/1.1 416 Requested Range Not Satisfiable");
+    }
   } else {
     raw_headers.append("HTTP/1.1 501 Not Implemented");
   }
@@ -63,6 +224,37 @@ net::HttpResponseHeaders* BuildHttpHeaders(
     raw_headers.append(mime_type);
   }
 
+  if (found) {
+    raw_headers.append(1, '\0');
+    raw_headers.append("Accept-Ranges: bytes");
+    raw_headers.append(1, '\0');
+    raw_headers.append("ETag: " + response->etag);
+    raw_headers.append(1, '\0');
+    raw_headers.append("Last-Modified: " +
+                       FormatHTTPDate(response->last_modified));
+    raw_headers.append(1, '\0');
+    raw_headers.append(response->immutable ? kImmutableCacheControl
+                                           : kRevalidateCacheControl);
+
+    if (response->status == ResourceResponse::FULL ||
+        response->status == ResourceResponse::PARTIAL) {
+      raw_headers.append(1, '\0');
+      raw_headers.append("Content-Length: " +
+                         base::Int64ToString(response->content_length()));
+    }
+    if (response->status == ResourceResponse::PARTIAL) {
+      raw_headers.append(1, '\0');
+      raw_headers.append(base::StringPrintf(
+          "Content-Range: bytes %" PRId64 "-%" PRId64 "/%" PRId64,
+          response->first_byte, response->last_byte, response->size));
+    } else if (response->status ==
+               ResourceResponse::RANGE_NOT_SATISFIABLE) {
+      raw_headers.append(1, '\0');
+      raw_headers.append("Content-Range: bytes */" +
+                         base::Int64ToString(response->size));
+    }
+  }
+
   raw_headers.append(2, '\0');
   return new net::HttpResponseHeaders(raw_headers);
 }
@@ -102,7 +294,7 @@ class GeneratedMainDocumentJob: public net::URLRequestSimpleJob {
 
   virtual void GetResponseInfo(net::HttpResponseInfo* info) OVERRIDE {
     response_info_.headers = BuildHttpHeaders(mime_type_, "GET", relative_path_,
-        relative_path_, true);
+        relative_path_, true, NULL);
     *info = response_info_;
   }
 
@@ -115,10 +307,11 @@ class GeneratedMainDocumentJob: public net::URLRequestSimpleJob {
   net::HttpResponseInfo response_info_;
 };
 
-void ReadResourceFilePath(
-    const xwalk::application::ApplicationResource& resource,
-    base::FilePath* file_path) {
-  *file_path = resource.GetFilePath();
+void ResolveResource(
+    const scoped_refptr<ApplicationResourceCache>& cache,
+    const base::FilePath& relative_path,
+    ApplicationResourceCache::Resource* resource) {
+  *resource = cache->Resolve(relative_path);
 }
 
 class URLRequestApplicationJob : public net::URLRequestFileJob {
@@ -127,37 +320,70 @@ class URLRequestApplicationJob : public net::URLRequestFileJob {
       net::URLRequest* request,
       net::NetworkDelegate* network_delegate,
       const scoped_refptr<base::TaskRunner>& file_task_runner,
-      const std::string& application_id,
-      const base::FilePath& directory_path,
+      const scoped_refptr<ApplicationResourceCache>& resource_cache,
+      const base::Time& install_time,
       const base::FilePath& relative_path,
       bool is_authority_match)
       : net::URLRequestFileJob(
           request, network_delegate, base::FilePath(), file_task_runner),
+        install_time_(install_time),
         relative_path_(relative_path),
         is_authority_match_(is_authority_match),
-        resource_(application_id, directory_path, relative_path),
+        resource_cache_(resource_cache),
+        serves_gzip_file_(false),
         weak_factory_(this) {
   }
 
+  virtual bool GetMimeType(std::string* mime_type) const OVERRIDE {
+    if (resource_.mime_type.empty())
+      return net::GetMimeTypeFromFile(resource_.file_path, mime_type);
+    *mime_type = resource_.mime_type;
+    return true;
+  }
+
+  virtual net::Filter* SetupFilter() const OVERRIDE {
+    if (serves_gzip_file_)
+      return net::Filter::GZipFactory();
+    return net::URLRequestFileJob::SetupFilter();
+  }
+
   virtual void GetResponseInfo(net::HttpResponseInfo* info) OVERRIDE {
     std::string mime_type;
     GetMimeType(&mime_type);
     std::string method = request()->method();
     response_info_.headers = BuildHttpHeaders(mime_type, method, file_path_,
-        relative_path_, is_authority_match_);
+        relative_path_, is_authority_match_, &response_);
     *info = response_info_;
   }
 
+  virtual void SetExtraRequestHeaders(
+      const net::HttpRequestHeaders& headers) OVERRIDE {
+    // The range is only passed on to URLRequestFileJob once it's known
+    // that it's sent, in StartWithResource().
+    request_headers_ = headers;
+  }
+
   virtual void Start() OVERRIDE {
-    base::FilePath* read_file_path = new base::FilePath;
+    // Resources already resolved, or that can't be, are served without going
+    // through the worker pool.
+    if (!resource_cache_ || relative_path_.empty() ||
+        resource_cache_->Lookup(relative_path_, &resource_)) {
+      base::MessageLoop::current()->PostTask(
+          FROM_HERE,
+          base::Bind(&URLRequestApplicationJob::StartWithResource,
+                     weak_factory_.GetWeakPtr()));
+      return;
+    }
 
+    ApplicationResourceCache::Resource* resource =
+        new ApplicationResourceCache::Resource;
     bool posted = base::WorkerPool::PostTaskAndReply(
         FROM_HERE,
-        base::Bind(&ReadResourceFilePath, resource_,
-                   base::Unretained(read_file_path)),
-        base::Bind(&URLRequestApplicationJob::OnFilePathRead,
+        base::Bind(&ResolveResource, resource_cache_, relative_path_,
+                   base::Unretained(resource)),
+        base::Bind(&URLRequestApplicationJob::OnResourceResolved,
                    weak_factory_.GetWeakPtr(),
-                   base::Owned(read_file_path)),
+                   base::Owned(resource)),
         true /* task is slow */);
     DCHECK(posted);
   }
@@ -165,29 +391,285 @@ class URLRequestApplicationJob : public net::URLRequestFileJob {
  private:
   virtual ~URLRequestApplicationJob() {}
 
-  void OnFilePathRead(base::FilePath* read_file_path) {
-    file_path_ = *read_file_path;
-    if (file_path_.empty())
+  void OnResourceResolved(ApplicationResourceCache::Resource* resource) {
+    resource_ = *resource;
+    StartWithResource();
+  }
+
+  void StartWithResource() {
+    file_path_ = resource_.file_path;
+    if (file_path_.empty()) {
+      NotifyHeadersComplete();
+      return;
+    }
+
+    // The compressed copy of the resource is inflated by the filter of this
+    // job, so it's read whatever the request accepts, and the response is
+    // the resource itself: it isn't encoded and has the size of the
+    // resource. Ranges are ranges of the resource too.
+    serves_gzip_file_ = !resource_.gzip_file_path.empty() &&
+        !request_headers_.HasHeader(net::HttpRequestHeaders::kRange);
+    if (serves_gzip_file_)
+      file_path_ = resource_.gzip_file_path;
+
+    // Applications launched from a directory, not installed, are identified
+    // by their files.
+    response_.immutable = !install_time_.is_null();
+    response_.etag = MakeETag(
+        install_time_.is_null() ? resource_.last_modified : install_time_,
+        relative_path_, resource_.size);
+    response_.size = resource_.size;
+    response_.last_modified = resource_.last_modified;
+    PrepareResourceResponse(request_headers_, &response_);
+    if (response_.status == ResourceResponse::NOT_MODIFIED ||
+        response_.status == ResourceResponse::RANGE_NOT_SATISFIABLE) {
       NotifyHeadersComplete();
-    else
-      URLRequestFileJob::Start();
+      return;
+    }
+
+    if (response_.status == ResourceResponse::PARTIAL) {
+      net::HttpRequestHeaders range_headers;
+      range_headers.SetHeader(net::HttpRequestHeaders::kRange,
+          base::StringPrintf("bytes=%" PRId64 "-%" PRId64,
+                             response_.first_byte, response_.last_byte));
+      URLRequestFileJob::SetExtraRequestHeaders(range_headers);
+    }
+    URLRequestFileJob::Start();
   }
 
   net::HttpResponseInfo response_info_;
+  base::Time install_time_;
   base::FilePath relative_path_;
   bool is_authority_match_;
-  xwalk::application::ApplicationResource resource_;
+  scoped_refptr<ApplicationResourceCache> resource_cache_;
+  ApplicationResourceCache::Resource resource_;
+  bool serves_gzip_file_;
+  net::HttpRequestHeaders request_headers_;
+  ResourceResponse response_;
   base::WeakPtrFactory<URLRequestApplicationJob> weak_factory_;
 };
 
-class ApplicationProtocolHandler
-    : public net::URLRequestJobFactory::ProtocolHandler {
+// Serves the resources of applications installed as archives, reading them
+// from the archive mapped in memory.
+class URLRequestApplicationArchiveJob : public net::URLRequestJob {
+ public:
+  URLRequestApplicationArchiveJob(
+      net::URLRequest* request,
+      net::NetworkDelegate* network_delegate,
+      const scoped_refptr<ApplicationArchive>& archive,
+      const base::Time& install_time,
+      const base::FilePath& relative_path,
+      bool is_authority_match)
+      : net::URLRequestJob(request, network_delegate),
+        archive_(archive),
+        install_time_(install_time),
+        entry_(NULL),
+        remaining_bytes_(0),
+        relative_path_(relative_path),
+        is_authority_match_(is_authority_match),
+        weak_factory_(this) {
+    if (is_authority_match_ && !relative_path_.empty())
+      entry_ = archive_->FindEntry(relative_path_);
+  }
+
+  virtual void Start() OVERRIDE {
+    // Headers must not be reported from Start().
+    base::MessageLoop::current()->PostTask(
+        FROM_HERE,
+        base::Bind(&URLRequestApplicationArchiveJob::StartAsync,
+                   weak_factory_.GetWeakPtr()));
+  }
+
+  virtual void Kill() OVERRIDE {
+    weak_factory_.InvalidateWeakPtrs();
+    net::URLRequestJob::Kill();
+  }
+
+  virtual bool GetMimeType(std::string* mime_type) const OVERRIDE {
+    return net::GetMimeTypeFromFile(relative_path_, mime_type);
+  }
+
+  virtual void GetResponseInfo(net::HttpResponseInfo* info) OVERRIDE {
+    std::string mime_type;
+    GetMimeType(&mime_type);
+    response_info_.headers = BuildHttpHeaders(mime_type, request()->method(),
+        entry_ ? relative_path_ : base::FilePath(), relative_path_,
+        is_authority_match_, &response_);
+    *info = response_info_;
+  }
+
+  virtual void SetExtraRequestHeaders(
+      const net::HttpRequestHeaders& headers) OVERRIDE {
+    request_headers_ = headers;
+  }
+
+  virtual bool ReadRawData(net::IOBuffer* buf,
+                           int buf_size,
+                           int* bytes_read) OVERRIDE {
+    if (!reader_ || !remaining_bytes_) {
+      *bytes_read = 0;
+      return true;
+    }
+
+    int result = reader_->Read(buf->data(), static_cast<int>(
+        std::min(static_cast<int64>(buf_size), remaining_bytes_)));
+    if (result < 0) {
+      LOG(ERROR) << "Corrupted application resource: "
+                 << relative_path_.AsUTF8Unsafe();
+      NotifyDone(net::URLRequestStatus(net::URLRequestStatus::FAILED,
+                                       net::ERR_CONTENT_DECODING_FAILED));
+      return false;
+    }
+    remaining_bytes_ -= result;
+    *bytes_read = result;
+    return true;
+  }
+
+ private:
+  virtual ~URLRequestApplicationArchiveJob() {}
+
+  void StartAsync() {
+    if (!entry_ || request()->method() != "GET") {
+      NotifyHeadersComplete();
+      return;
+    }
+
+    response_.immutable = !install_time_.is_null();
+    response_.etag = MakeETag(
+        install_time_.is_null() ? archive_->last_modified() : install_time_,
+        relative_path_, entry_->size);
+    response_.size = entry_->size;
+    response_.last_modified = archive_->last_modified();
+    PrepareResourceResponse(request_headers_, &response_);
+    if (response_.status == ResourceResponse::FULL ||
+        response_.status == ResourceResponse::PARTIAL) {
+      reader_.reset(new ApplicationArchive::EntryReader(archive_.get(),
+                                                        *entry_));
+      if (!reader_->Skip(response_.first_byte)) {
+        LOG(ERROR) << "Corrupted application resource: "
+                   << relative_path_.AsUTF8Unsafe();
+        NotifyStartError(net::URLRequestStatus(
+            net::URLRequestStatus::FAILED, net::ERR_CONTENT_DECODING_FAILED));
+        return;
+      }
+      remaining_bytes_ = response_.content_length();
+      set_expected_content_size(remaining_bytes_);
+    }
+    NotifyHeadersComplete();
+  }
+
+  scoped_refptr<ApplicationArchive> archive_;
+  base::Time install_time_;
+  const ApplicationArchive::Entry* entry_;
+  scoped_ptr<ApplicationArchive::EntryReader> reader_;
+  int64 remaining_bytes_;
+  net::HttpRequestHeaders request_headers_;
+  ResourceResponse response_;
+  net::HttpResponseInfo response_info_;
+  base::FilePath relative_path_;
+  bool is_authority_match_;
+  base::WeakPtrFactory<URLRequestApplicationArchiveJob> weak_factory_;
+};
+
+// Waits for the application to be mounted, then restarts the request to
+// serve it with the job for the resources of the application.
+class URLRequestPendingMountJob : public net::URLRequestJob {
  public:
-  explicit ApplicationProtocolHandler(const ApplicationData* application)
-    : application_(application) {
-    CHECK(application_);
+  URLRequestPendingMountJob(net::URLRequest* request,
+                            net::NetworkDelegate* network_delegate)
+      : net::URLRequestJob(request, network_delegate),
+        weak_factory_(this) {
+  }
+
+  virtual void Start() OVERRIDE {
+    // The mount finishes on the FILE thread, before the tasks posted after
+    // it to that thread.
+    content::BrowserThread::PostTaskAndReply(
+        content::BrowserThread::FILE, FROM_HERE,
+        base::Bind(&base::DoNothing),
+        base::Bind(&URLRequestPendingMountJob::OnMountFinished,
+                   weak_factory_.GetWeakPtr()));
+  }
+
+  virtual void Kill() OVERRIDE {
+    weak_factory_.InvalidateWeakPtrs();
+    net::URLRequestJob::Kill();
+  }
+
+ private:
+  virtual ~URLRequestPendingMountJob() {}
+
+  void OnMountFinished() {
+    NotifyRestartRequired();
   }
 
+  base::WeakPtrFactory<URLRequestPendingMountJob> weak_factory_;
+};
+
+// The resources of a running application, served to the app:// requests
+// for its id. Until |pending| is cleared, on the FILE thread, it isn't known
+// how they are stored.
+struct MountedApplication {
+  MountedApplication() : pending(false) {}
+
+  scoped_refptr<const ApplicationData> application;
+  scoped_refptr<ApplicationArchive> archive;
+  scoped_refptr<ApplicationResourceCache> resource_cache;
+  bool pending;
+};
+
+// The applications served by the app:// protocol, by id. Applications are
+// mounted on the UI thread when they're launched, and looked up on the IO
+// thread for each request.
+class MountedApplicationRegistry {
+ public:
+  void Mount(const MountedApplication& mounted) {
+    base::AutoLock auto_lock(lock_);
+    applications_[mounted.application->ID()] = mounted;
+  }
+
+  // Completes the mount of |mounted|, unless the application was unmounted
+  // meanwhile.
+  void FinishMount(const MountedApplication& mounted) {
+    base::AutoLock auto_lock(lock_);
+    MountedApplicationMap::iterator it =
+        applications_.find(mounted.application->ID());
+    if (it == applications_.end() ||
+        it->second.application != mounted.application)
+      return;
+    it->second = mounted;
+  }
+
+  void Unmount(const std::string& application_id) {
+    base::AutoLock auto_lock(lock_);
+    applications_.erase(application_id);
+  }
+
+  bool Lookup(const std::string& application_id,
+              MountedApplication* mounted) {
+    base::AutoLock auto_lock(lock_);
+    MountedApplicationMap::const_iterator it =
+        applications_.find(application_id);
+    if (it == applications_.end())
+      return false;
+    *mounted = it->second;
+    return true;
+  }
+
+ private:
+  typedef std::map<std::string, MountedApplication> MountedApplicationMap;
+
+  base::Lock lock_;
+  MountedApplicationMap applications_;
+};
+
+base::LazyInstance<MountedApplicationRegistry>::Leaky g_mounted_applications =
+    LAZY_INSTANCE_INITIALIZER;
+
+class ApplicationProtocolHandler
+    : public net::URLRequestJobFactory::ProtocolHandler {
+ public:
+  ApplicationProtocolHandler() {}
   virtual ~ApplicationProtocolHandler() {}
 
   virtual net::URLRequestJob* MaybeCreateJob(
@@ -195,7 +677,6 @@ class ApplicationProtocolHandler
       net::NetworkDelegate* network_delegate) const OVERRIDE;
 
  private:
-  const ApplicationData* application_;
   DISALLOW_COPY_AND_ASSIGN(ApplicationProtocolHandler);
 };
 
@@ -204,19 +685,32 @@ ApplicationProtocolHandler::MaybeCreateJob(
     net::URLRequest* request, net::NetworkDelegate* network_delegate) const {
   std::string application_id = request->url().host();
 
-  bool is_authority_match = application_id == application_->ID();
+  // Only the resources of the applications running are served.
+  MountedApplication mounted;
+  bool is_authority_match =
+      g_mounted_applications.Get().Lookup(application_id, &mounted);
   base::FilePath relative_path =
       xwalk::application::ApplicationURLToRelativeFilePath(request->url());
-  base::FilePath directory_path;
-  if (is_authority_match)
-    directory_path = application_->Path();
-
   std::string path = request->url().path();
   if (is_authority_match &&
       path.size() > 1 &&
       path.substr(1) == xwalk::application::kGeneratedMainDocumentFilename) {
     return new GeneratedMainDocumentJob(request, network_delegate,
-        relative_path, application_);
+        relative_path, mounted.application);
+  }
+
+  if (mounted.pending)
+    return new URLRequestPendingMountJob(request, network_delegate);
+
+  // The resources are validated against the installation of their
+  // application.
+  base::Time install_time;
+  if (mounted.application)
+    install_time = mounted.application->install_time();
+
+  if (mounted.archive) {
+    return new URLRequestApplicationArchiveJob(request, network_delegate,
+        mounted.archive, install_time, relative_path, is_authority_match);
   }
 
   return new URLRequestApplicationJob(
@@ -225,8 +719,8 @@ ApplicationProtocolHandler::MaybeCreateJob(
       content::BrowserThread::GetBlockingPool()->
       GetTaskRunnerWithShutdownBehavior(
           base::SequencedWorkerPool::SKIP_ON_SHUTDOWN),
-      application_id,
-      directory_path,
+      mounted.resource_cache,
+      install_time,
       relative_path,
       is_authority_match);
 }
@@ -234,7 +728,58 @@ ApplicationProtocolHandler::MaybeCreateJob(
 }  // namespace
 
 linked_ptr<net::URLRequestJobFactory::ProtocolHandler>
-CreateApplicationProtocolHandler(const ApplicationData* application) {
+CreateApplicationProtocolHandler() {
   return  linked_ptr<net::URLRequestJobFactory::ProtocolHandler>(
-      new ApplicationProtocolHandler(application));
+      new ApplicationProtocolHandler);
 }
+
+namespace xwalk {
+namespace application {
+
+namespace {
+
+// The archive of applications installed as archives is opened once, when
+// they're launched. Only the resources of installed applications are cached,
+// the files of those launched from a directory can change at any time.
+void OpenApplicationResources(
+    scoped_refptr<const ApplicationData> application) {
+  MountedApplication mounted;
+  mounted.application = application;
+  const base::FilePath archive_path =
+      application->Path().Append(kPackageArchiveFilename);
+  if (base::PathExists(archive_path)) {
+    mounted.archive = ApplicationArchive::Open(archive_path,
+        application->Path().Append(kPackageArchiveIndexFilename));
+  }
+  if (!mounted.archive) {
+    if (application->install_time().is_null()) {
+      mounted.resource_cache =
+          ApplicationResourceCache::CreateUncached(application->Path());
+    } else {
+      mounted.resource_cache = ApplicationResourceCache::Get(
+          application->ID(), application->Path());
+    }
+  }
+  g_mounted_applications.Get().FinishMount(mounted);
+}
+
+}  // namespace
+
+void MountApplicationForProtocol(const ApplicationData* application) {
+  // The requests that come before the resources are opened wait for them.
+  MountedApplication mounted;
+  mounted.application = application;
+  mounted.pending = true;
+  g_mounted_applications.Get().Mount(mounted);
+  content::BrowserThread::PostTask(
+      content::BrowserThread::FILE, FROM_HERE,
+      base::Bind(&OpenApplicationResources,
+                 make_scoped_refptr(application)));
+}
+
+void UnmountApplicationForProtocol(const std::string& application_id) {
+  g_mounted_applications.Get().Unmount(application_id);
+}
+
+}  // namespace application
+}  // namespace xwalk
@@ -5,6 +5,8 @@
 #ifndef XWALK_APPLICATION_BROWSER_APPLICATION_PROTOCOLS_H_
 #define XWALK_APPLICATION_BROWSER_APPLICATION_PROTOCOLS_H_
 
+#include <string>
+
 #include "base/memory/linked_ptr.h"
 #include "net/url_request/url_request_job_factory.h"
 #include "xwalk/application/browser/application_system.h"
@@ -12,13 +14,21 @@
 namespace xwalk {
 namespace application {
 class ApplicationData;
-}
-}
 
-// Creates the handlers for the app:// scheme.
+// Serves the resources of |application| to the app:// requests for its id,
+// until UnmountApplicationForProtocol() is called. Called on the UI thread
+// when the application is launched; its resources are opened on the FILE
+// thread, the requests that come before wait for them.
+void MountApplicationForProtocol(const ApplicationData* application);
+void UnmountApplicationForProtocol(const std::string& application_id);
+
+}  // namespace application
+}  // namespace xwalk
+
+// Creates the handlers for the app:// scheme, which serves the resources of
+// all the running applications.
 linked_ptr<net::URLRequestJobFactory::ProtocolHandler>
-CreateApplicationProtocolHandler(
-    const xwalk::application::ApplicationData* application);
+CreateApplicationProtocolHandler();
 
 
 #endif  // XWALK_APPLICATION_BROWSER_APPLICATION_PROTOCOLS_H_
@@ -0,0 +1,214 @@
+// Copyright (c) 2013 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "xwalk/application/browser/application_resource_cache.h"
+
+#include "base/file_util.h"
+#include "base/lazy_instance.h"
+#include "base/platform_file.h"
+#include "net/base/mime_util.h"
+#include "xwalk/application/browser/installer/resource_precompressor.h"
+#include "xwalk/application/common/application_resource.h"
+#include "xwalk/application/common/constants.h"
+
+namespace xwalk {
+namespace application {
+
+namespace {
+
+// The cache is simply cleared when it grows beyond this, so that requests for
+// random missing resources don't make it grow forever.
+const size_t kMaxResources = 4096;
+
+// Whether |file_path|, resolved within |absolute_root|, is one of the files
+// written by PrecompressResources(): the list of the compressed copies, or a
+// listed copy. They aren't resources of the application.
+bool IsPrecompressorFile(
+    const base::FilePath& absolute_root,
+    const base::FilePath& file_path,
+    const std::set<base::FilePath>& precompressed_resources) {
+  if (file_path == absolute_root.Append(kPrecompressedResourcesFilename))
+    return true;
+  base::FilePath relative_path;
+  return file_path.MatchesExtension(kGzipResourceExtension) &&
+      absolute_root.AppendRelativePath(file_path.RemoveExtension(),
+                                       &relative_path) &&
+      precompressed_resources.count(relative_path) != 0;
+}
+
+}  // namespace
+
+// The caches of all the applications, by application id.
+class ApplicationResourceCacheRegistry {
+ public:
+  scoped_refptr<ApplicationResourceCache> Get(
+      const std::string& application_id,
+      const base::FilePath& application_root) {
+    base::AutoLock auto_lock(lock_);
+    scoped_refptr<ApplicationResourceCache>& cache = caches_[application_id];
+    if (!cache)
+      cache = new ApplicationResourceCache(application_root, true);
+    return cache;
+  }
+
+  scoped_refptr<ApplicationResourceCache> Take(
+      const std::string& application_id) {
+    base::AutoLock auto_lock(lock_);
+    scoped_refptr<ApplicationResourceCache> cache;
+    CacheMap::iterator it = caches_.find(application_id);
+    if (it != caches_.end()) {
+      cache = it->second;
+      caches_.erase(it);
+    }
+    return cache;
+  }
+
+ private:
+  typedef std::map<std::string, scoped_refptr<ApplicationResourceCache> >
+      CacheMap;
+
+  base::Lock lock_;
+  CacheMap caches_;
+};
+
+namespace {
+
+base::LazyInstance<ApplicationResourceCacheRegistry>::Leaky g_registry =
+    LAZY_INSTANCE_INITIALIZER;
+
+}  // namespace
+
+ApplicationResourceCache::Resource::Resource()
+    : size(0),
+      gzip_size(0) {
+}
+
+ApplicationResourceCache::Resource::~Resource() {
+}
+
+ApplicationResourceCache::ApplicationResourceCache(
+    const base::FilePath& application_root,
+    bool keeps_resources)
+    : application_root_(application_root),
+      keeps_resources_(keeps_resources),
+      generation_(0) {
+}
+
+ApplicationResourceCache::~ApplicationResourceCache() {
+}
+
+// static
+scoped_refptr<ApplicationResourceCache> ApplicationResourceCache::Get(
+    const std::string& application_id,
+    const base::FilePath& application_root) {
+  return g_registry.Get().Get(application_id, application_root);
+}
+
+// static
+scoped_refptr<ApplicationResourceCache>
+ApplicationResourceCache::CreateUncached(
+    const base::FilePath& application_root) {
+  return make_scoped_refptr(
+      new ApplicationResourceCache(application_root, false));
+}
+
+// static
+void ApplicationResourceCache::Invalidate(const std::string& application_id) {
+  // The caches still used, by a running application, must not keep the
+  // resources of the previous installation.
+  scoped_refptr<ApplicationResourceCache> cache =
+      g_registry.Get().Take(application_id);
+  if (cache)
+    cache->Clear();
+}
+
+bool ApplicationResourceCache::Lookup(const base::FilePath& relative_path,
+                                      Resource* resource) {
+  base::AutoLock auto_lock(lock_);
+  ResourceMap::const_iterator it = resources_.find(relative_path);
+  if (it == resources_.end())
+    return false;
+  *resource = it->second;
+  return true;
+}
+
+ApplicationResourceCache::Resource ApplicationResourceCache::Resolve(
+    const base::FilePath& relative_path) {
+  base::FilePath absolute_root;
+  int generation;
+  std::set<base::FilePath> precompressed_resources;
+  {
+    base::AutoLock auto_lock(lock_);
+    absolute_root = absolute_root_;
+    generation = generation_;
+    precompressed_resources = precompressed_resources_;
+  }
+
+  bool read_precompressed_resources = false;
+  if (absolute_root.empty()) {
+    absolute_root = base::MakeAbsoluteFilePath(application_root_);
+    if (!absolute_root.empty()) {
+      ReadPrecompressedResources(absolute_root, &precompressed_resources);
+      read_precompressed_resources = true;
+    }
+  }
+  const bool precompressed = precompressed_resources.count(relative_path) != 0;
+
+  Resource resource;
+  if (!absolute_root.empty()) {
+    resource.file_path = ApplicationResource::GetFilePathFromAbsoluteRoot(
+        absolute_root, relative_path,
+        ApplicationResource::SYMLINKS_MUST_RESOLVE_WITHIN_ROOT);
+    // The files written at installation are only read in place of the
+    // resources, they can't be requested themselves.
+    if (IsPrecompressorFile(absolute_root, resource.file_path,
+                            precompressed_resources))
+      resource.file_path.clear();
+  }
+
+  base::PlatformFileInfo info;
+  if (!resource.file_path.empty() &&
+      file_util::GetFileInfo(resource.file_path, &info) &&
+      !info.is_directory) {
+    net::GetMimeTypeFromFile(resource.file_path, &resource.mime_type);
+    resource.size = info.size;
+    resource.last_modified = info.last_modified;
+
+    // Compressed copies older than their resource are out of date.
+    const base::FilePath gzip_file_path =
+        resource.file_path.AddExtension(kGzipResourceExtension);
+    if (precompressed && file_util::GetFileInfo(gzip_file_path, &info) &&
+        !info.is_directory && info.last_modified >= resource.last_modified) {
+      resource.gzip_file_path = gzip_file_path;
+      resource.gzip_size = info.size;
+    }
+  } else {
+    resource.file_path.clear();
+  }
+
+  if (!keeps_resources_)
+    return resource;
+
+  base::AutoLock auto_lock(lock_);
+  if (generation != generation_ || absolute_root.empty())
+    return resource;
+  absolute_root_ = absolute_root;
+  if (read_precompressed_resources)
+    precompressed_resources_.swap(precompressed_resources);
+  if (resources_.size() >= kMaxResources)
+    resources_.clear();
+  resources_[relative_path] = resource;
+  return resource;
+}
+
+void ApplicationResourceCache::Clear() {
+  base::AutoLock auto_lock(lock_);
+  absolute_root_.clear();
+  precompressed_resources_.clear();
+  resources_.clear();
+  ++generation_;
+}
+
+}  // namespace application
+}  // namespace xwalk
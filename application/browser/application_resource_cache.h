@@ -0,0 +1,101 @@
+// Copyright (c) 2013 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef XWALK_APPLICATION_BROWSER_APPLICATION_RESOURCE_CACHE_H_
+#define XWALK_APPLICATION_BROWSER_APPLICATION_RESOURCE_CACHE_H_
+
+#include <map>
+#include <set>
+#include <string>
+
+#include "base/basictypes.h"
+#include "base/files/file_path.h"
+#include "base/memory/ref_counted.h"
+#include "base/synchronization/lock.h"
+#include "base/time/time.h"
+
+namespace xwalk {
+namespace application {
+
+// Remembers where the resources of an installed application were found, so
+// that the app:// requests for a resource already resolved don't check its
+// path on the file system again. Resources that don't exist are remembered
+// too.
+//
+// There's one cache per application, shared by all the threads. It's cleared
+// when the application is installed or uninstalled. Applications launched
+// from a directory get one that doesn't cache anything, see CreateUncached().
+class ApplicationResourceCache
+    : public base::RefCountedThreadSafe<ApplicationResourceCache> {
+ public:
+  struct Resource {
+    Resource();
+    ~Resource();
+
+    // Empty if the resource doesn't exist.
+    base::FilePath file_path;
+    std::string mime_type;
+    int64 size;
+    base::Time last_modified;
+
+    // The compressed copy of the resource written when it was installed, if
+    // any. Copies not listed by PrecompressResources(), like those shipped in
+    // the package, are ignored.
+    base::FilePath gzip_file_path;
+    int64 gzip_size;
+  };
+
+  // Returns the cache of the application |application_id| installed in
+  // |application_root|.
+  static scoped_refptr<ApplicationResourceCache> Get(
+      const std::string& application_id,
+      const base::FilePath& application_root);
+
+  // Returns a cache that resolves each resource again, for an application
+  // launched from |application_root|, whose files can change at any time.
+  static scoped_refptr<ApplicationResourceCache> CreateUncached(
+      const base::FilePath& application_root);
+
+  // Forgets the resources of |application_id|, for when its files change.
+  static void Invalidate(const std::string& application_id);
+
+  // Returns false if |relative_path| hasn't been resolved yet.
+  bool Lookup(const base::FilePath& relative_path, Resource* resource);
+
+  // Finds |relative_path| on the file system and caches the result. Does
+  // blocking I/O.
+  Resource Resolve(const base::FilePath& relative_path);
+
+ private:
+  friend class base::RefCountedThreadSafe<ApplicationResourceCache>;
+  friend class ApplicationResourceCacheRegistry;
+  typedef std::map<base::FilePath, Resource> ResourceMap;
+
+  ApplicationResourceCache(const base::FilePath& application_root,
+                           bool keeps_resources);
+  ~ApplicationResourceCache();
+
+  void Clear();
+
+  const base::FilePath application_root_;
+  const bool keeps_resources_;
+
+  base::Lock lock_;
+  // |application_root_| resolved by base::MakeAbsoluteFilePath(), computed
+  // on the first resolution.
+  base::FilePath absolute_root_;
+  // The resources with a compressed copy, read with |absolute_root_|.
+  std::set<base::FilePath> precompressed_resources_;
+  ResourceMap resources_;
+  // Incremented when the cache is cleared, so that resolutions started
+  // before aren't cached.
+  int generation_;
+
+  DISALLOW_COPY_AND_ASSIGN(ApplicationResourceCache);
+};
+
+}  // namespace application
+}  // namespace xwalk
+
+#endif  // XWALK_APPLICATION_BROWSER_APPLICATION_RESOURCE_CACHE_H_
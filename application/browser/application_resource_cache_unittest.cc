@@ -0,0 +1,153 @@
+// Copyright (c) 2013 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "xwalk/application/browser/application_resource_cache.h"
+
+#include "base/file_util.h"
+#include "base/files/scoped_temp_dir.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "xwalk/application/browser/installer/resource_precompressor.h"
+#include "xwalk/application/common/constants.h"
+
+namespace xwalk {
+namespace application {
+
+class ApplicationResourceCacheTest : public testing::Test {
+ public:
+  virtual void SetUp() OVERRIDE {
+    ASSERT_TRUE(temp_dir_.CreateUniqueTempDir());
+    root_ = temp_dir_.path().AppendASCII("app");
+    ASSERT_TRUE(file_util::CreateDirectory(root_.AppendASCII("js")));
+    WriteFile(root_.AppendASCII("index.html"), "<html></html>");
+    WriteFile(root_.AppendASCII("js").AppendASCII("main.js"), "main();");
+    WriteFile(temp_dir_.path().AppendASCII("outside.html"), "outside");
+    cache_ = ApplicationResourceCache::Get("cache_test_app", root_);
+  }
+
+  virtual void TearDown() OVERRIDE {
+    ApplicationResourceCache::Invalidate("cache_test_app");
+  }
+
+  void WriteFile(const base::FilePath& path, const std::string& data) {
+    ASSERT_EQ(static_cast<int>(data.size()),
+              file_util::WriteFile(path, data.data(), data.size()));
+  }
+
+ protected:
+  base::ScopedTempDir temp_dir_;
+  base::FilePath root_;
+  scoped_refptr<ApplicationResourceCache> cache_;
+};
+
+TEST_F(ApplicationResourceCacheTest, ResolveAndLookup) {
+  base::FilePath relative_path(FILE_PATH_LITERAL("index.html"));
+  ApplicationResourceCache::Resource resource;
+  EXPECT_FALSE(cache_->Lookup(relative_path, &resource));
+
+  resource = cache_->Resolve(relative_path);
+  EXPECT_EQ(base::MakeAbsoluteFilePath(root_.AppendASCII("index.html")),
+            resource.file_path);
+  EXPECT_EQ("text/html", resource.mime_type);
+  EXPECT_EQ(13, resource.size);
+
+  ApplicationResourceCache::Resource cached;
+  ASSERT_TRUE(cache_->Lookup(relative_path, &cached));
+  EXPECT_EQ(resource.file_path, cached.file_path);
+  EXPECT_EQ(resource.mime_type, cached.mime_type);
+
+  EXPECT_EQ(cache_, ApplicationResourceCache::Get("cache_test_app", root_));
+}
+
+TEST_F(ApplicationResourceCacheTest, NegativeEntries) {
+  const base::FilePath::CharType* paths[] = {
+    FILE_PATH_LITERAL("missing.js"),
+    FILE_PATH_LITERAL("js"),
+    FILE_PATH_LITERAL("../outside.html"),
+  };
+
+  for (size_t i = 0; i < arraysize(paths); ++i) {
+    base::FilePath relative_path(paths[i]);
+    EXPECT_TRUE(cache_->Resolve(relative_path).file_path.empty());
+    ApplicationResourceCache::Resource resource;
+    ASSERT_TRUE(cache_->Lookup(relative_path, &resource)) << i;
+    EXPECT_TRUE(resource.file_path.empty());
+  }
+}
+
+TEST_F(ApplicationResourceCacheTest, UncachedSeesNewFiles) {
+  scoped_refptr<ApplicationResourceCache> uncached =
+      ApplicationResourceCache::CreateUncached(root_);
+  base::FilePath relative_path(FILE_PATH_LITERAL("added.html"));
+  EXPECT_TRUE(uncached->Resolve(relative_path).file_path.empty());
+  ApplicationResourceCache::Resource resource;
+  EXPECT_FALSE(uncached->Lookup(relative_path, &resource));
+
+  WriteFile(root_.AppendASCII("added.html"), "added");
+  resource = uncached->Resolve(relative_path);
+  EXPECT_FALSE(resource.file_path.empty());
+  EXPECT_EQ(5, resource.size);
+  EXPECT_FALSE(uncached->Lookup(relative_path, &resource));
+
+  // The cache of the application isn't affected.
+  EXPECT_FALSE(cache_->Lookup(relative_path, &resource));
+}
+
+TEST_F(ApplicationResourceCacheTest, Invalidate) {
+  base::FilePath relative_path =
+      base::FilePath(FILE_PATH_LITERAL("js")).AppendASCII("main.js");
+  EXPECT_FALSE(cache_->Resolve(relative_path).file_path.empty());
+
+  // A reinstallation replaces the files, the cache in use must forget them
+  // and the next users get a new one.
+  ApplicationResourceCache::Invalidate("cache_test_app");
+  ApplicationResourceCache::Resource resource;
+  EXPECT_FALSE(cache_->Lookup(relative_path, &resource));
+  EXPECT_NE(cache_, ApplicationResourceCache::Get("cache_test_app", root_));
+}
+
+TEST_F(ApplicationResourceCacheTest, OnlyInstalledCompressedCopies) {
+  std::string script(100000, 'a');
+  WriteFile(root_.AppendASCII("script.js"), script);
+  std::string compressed;
+  ASSERT_TRUE(GzipCompress(script, &compressed));
+  WriteFile(root_.AppendASCII("shipped.js"), script);
+  WriteFile(root_.AppendASCII("shipped.js.gz"), compressed);
+  ASSERT_EQ(1, PrecompressResources(root_));
+  ApplicationResourceCache::Invalidate("cache_test_app");
+  cache_ = ApplicationResourceCache::Get("cache_test_app", root_);
+
+  ApplicationResourceCache::Resource resource =
+      cache_->Resolve(base::FilePath(FILE_PATH_LITERAL("script.js")));
+  EXPECT_EQ(resource.file_path.AddExtension(FILE_PATH_LITERAL(".gz")),
+            resource.gzip_file_path);
+  EXPECT_GT(resource.gzip_size, 0);
+
+  // A copy shipped in the package may not match the resource.
+  resource = cache_->Resolve(base::FilePath(FILE_PATH_LITERAL("shipped.js")));
+  EXPECT_TRUE(resource.gzip_file_path.empty());
+}
+
+TEST_F(ApplicationResourceCacheTest, CompressedCopiesNotServed) {
+  std::string script(100000, 'a');
+  WriteFile(root_.AppendASCII("script.js"), script);
+  std::string compressed;
+  ASSERT_TRUE(GzipCompress(script, &compressed));
+  WriteFile(root_.AppendASCII("shipped.js.gz"), compressed);
+  ASSERT_EQ(1, PrecompressResources(root_));
+  ApplicationResourceCache::Invalidate("cache_test_app");
+  cache_ = ApplicationResourceCache::Get("cache_test_app", root_);
+
+  EXPECT_TRUE(cache_->Resolve(base::FilePath(
+      FILE_PATH_LITERAL("script.js.gz"))).file_path.empty());
+  EXPECT_TRUE(cache_->Resolve(base::FilePath(
+      FILE_PATH_LITERAL("./script.js.gz"))).file_path.empty());
+  EXPECT_TRUE(cache_->Resolve(base::FilePath(
+      kPrecompressedResourcesFilename)).file_path.empty());
+  // Files of the package are served whatever their name.
+  EXPECT_FALSE(cache_->Resolve(base::FilePath(
+      FILE_PATH_LITERAL("shipped.js.gz"))).file_path.empty());
+}
+
+}  // namespace application
+}  // namespace xwalk
@@ -4,20 +4,28 @@
 
 #include "xwalk/application/browser/application_service.h"
 
+#include <set>
 #include <string>
 
+#include "base/bind.h"
+#include "base/command_line.h"
 #include "base/file_util.h"
+#include "base/files/scoped_temp_dir.h"
 #include "base/memory/scoped_ptr.h"
-#include "base/message_loop/message_loop.h"
-#include "content/public/browser/web_contents.h"
-#include "content/public/browser/web_contents_observer.h"
+#include "base/stl_util.h"
 #include "xwalk/application/browser/application_event_manager.h"
 #include "xwalk/application/browser/application_process_manager.h"
+#include "xwalk/application/browser/application_protocols.h"
+#include "xwalk/application/browser/application_resource_cache.h"
 #include "xwalk/application/browser/application_system.h"
 #include "xwalk/application/browser/installer/package.h"
+#include "xwalk/application/browser/installer/resource_precompressor.h"
+#include "xwalk/application/common/application_archive.h"
 #include "xwalk/application/common/application_file_util.h"
+#include "xwalk/application/common/constants.h"
 #include "xwalk/runtime/browser/runtime.h"
 #include "xwalk/runtime/browser/runtime_context.h"
+#include "xwalk/runtime/common/xwalk_switches.h"
 
 #if defined(OS_TIZEN_MOBILE)
 #include "xwalk/application/browser/installer/tizen/package_installer.h"
@@ -27,32 +35,6 @@ using xwalk::RuntimeContext;
 
 namespace {
 
-void WaitForFinishLoad(content::WebContents* content) {
-  class CloseAfterLoadObserver : public content::WebContentsObserver {
-   public:
-    static CloseAfterLoadObserver* Create(content::WebContents* content) {
-      return new CloseAfterLoadObserver(content);
-    }
-
-    virtual void DidFinishLoad(
-        int64 frame_id,
-        const GURL& validate_url,
-        bool is_main_frame,
-        content::RenderViewHost* render_view_host) OVERRIDE {
-      // FIXME: Quit message loop here at present. This should go away once
-      // we have Application in place.
-      base::MessageLoop::current()->QuitWhenIdle();
-      delete this;
-    }
-
-   private:
-    explicit CloseAfterLoadObserver(content::WebContents* content)
-        : content::WebContentsObserver(content) {}
-  };
-
-  CloseAfterLoadObserver* observer = CloseAfterLoadObserver::Create(content);
-}
-
 #if defined(OS_TIZEN_MOBILE)
 bool InstallPackageOnTizen(xwalk::application::ApplicationService* service,
                            const std::string& app_id,
@@ -79,6 +61,31 @@ bool UninstallPackageOnTizen(xwalk::application::ApplicationService* service,
 }
 #endif  // OS_TIZEN_MOBILE
 
+// Keeps the zip file of |package| in |dir| with an index of its entries, and
+// extracts only its manifest. Packages that can't be read in place are
+// extracted instead.
+bool ExtractPackageAsArchive(
+    xwalk::application::Package* package,
+    const base::FilePath& dir,
+    const xwalk::application::Package::ProgressCallback& progress_callback) {
+  using xwalk::application::ApplicationArchive;
+  const base::FilePath archive_path =
+      dir.Append(xwalk::application::kPackageArchiveFilename);
+  if (!package->ExtractManifestTo(dir, archive_path, progress_callback))
+    return false;
+
+  scoped_refptr<ApplicationArchive> archive =
+      ApplicationArchive::Open(archive_path, base::FilePath());
+  if (archive && archive->WriteIndex(
+          dir.Append(xwalk::application::kPackageArchiveIndexFilename)))
+    return true;
+
+  LOG(WARNING) << "The package can't be run from its archive, extracting it.";
+  archive = NULL;
+  return base::DeleteFile(archive_path, false) &&
+      package->ExtractTo(dir, progress_callback);
+}
+
 }  // namespace
 
 namespace xwalk {
@@ -90,9 +97,11 @@ const base::FilePath::CharType kApplicationsDir[] =
 ApplicationService::ApplicationService(RuntimeContext* runtime_context)
     : runtime_context_(runtime_context),
       app_storage_(new ApplicationStorage(runtime_context->GetPath())) {
+  app_storage_->AddObserver(this);
 }
 
 ApplicationService::~ApplicationService() {
+  app_storage_->RemoveObserver(this);
 }
 
 bool ApplicationService::Install(const base::FilePath& path, std::string* id) {
@@ -127,14 +136,41 @@ bool ApplicationService::Install(const base::FilePath& path, std::string* id) {
       return false;
     }
 
-    base::FilePath temp_dir;
-    package->Extract(&temp_dir);
+    // The package is extracted into a staging directory next to its final
+    // location, so it's moved there with a rename once complete and
+    // verified, and removed if anything fails.
+    base::ScopedTempDir staging_dir;
+    if (!staging_dir.CreateUniqueTempDirUnderPath(data_dir)) {
+      LOG(ERROR) << "Can't create the directory of " << app_id;
+      return false;
+    }
+
+    Package::ProgressCallback progress_callback =
+        base::Bind(&ApplicationService::OnInstallProgress,
+                   base::Unretained(this), app_id);
+    bool extracted = CommandLine::ForCurrentProcess()->HasSwitch(
+        switches::kInstallAsArchive) ?
+        ExtractPackageAsArchive(package.get(), staging_dir.path(),
+                                progress_callback) :
+        package->ExtractTo(staging_dir.path(), progress_callback);
+    if (!extracted) {
+      LOG(ERROR) << "Can't extract the XPK/WGT file.";
+      return false;
+    }
+    if (CommandLine::ForCurrentProcess()->HasSwitch(
+            switches::kPrecompressResources)) {
+      int count = PrecompressResources(staging_dir.path());
+      VLOG(1) << "Compressed " << count << " resources of " << app_id;
+    }
+
     unpacked_dir = data_dir.AppendASCII(app_id);
     if (base::DirectoryExists(unpacked_dir) &&
         !base::DeleteFile(unpacked_dir, true))
       return false;
-    if (!base::Move(temp_dir, unpacked_dir))
+    if (!base::Move(staging_dir.path(), unpacked_dir))
       return false;
+    ignore_result(staging_dir.Take());
+    ApplicationResourceCache::Invalidate(app_id);
   } else {
     unpacked_dir = path;
   }
@@ -165,22 +201,39 @@ bool ApplicationService::Install(const base::FilePath& path, std::string* id) {
   LOG(INFO) << "Installed application with id: " << application->ID()
             << " successfully.";
   *id = application->ID();
+  runtime_context_->GetApplicationSystem()->event_manager()->
+      SetApplicationEvents(application->ID(), application->GetEvents());
 
   FOR_EACH_OBSERVER(Observer, observers_,
                     OnApplicationInstalled(application->ID()));
 
   // We need to run main document after installation in order to
-  // register system events.
-  if (application->HasMainDocument() && Launch(application->ID())) {
-    ApplicationSystem* system = runtime_context_->GetApplicationSystem();
-    ApplicationProcessManager* pm = system->process_manager();
-    WaitForFinishLoad(pm->GetMainDocumentRuntime()->web_contents());
-  }
+  // register system events. It's suspended once done.
+  if (application->HasMainDocument())
+    LaunchInBackground(application->ID());
 
   return true;
 }
 
 bool ApplicationService::Uninstall(const std::string& id) {
+  if (!app_storage_->Contains(id)) {
+    LOG(ERROR) << "Cannot uninstall application with id " << id
+               << "; application is not installed.";
+    return false;
+  }
+
+  // Closing the application is asynchronous, and it still uses its files
+  // and its stored data until it's terminated.
+  if (ContainsKey(running_applications_, id)) {
+    pending_uninstalls_.insert(id);
+    Terminate(id);
+    return true;
+  }
+
+  return RemoveApplication(id);
+}
+
+bool ApplicationService::RemoveApplication(const std::string& id) {
 #if defined(OS_TIZEN_MOBILE)
   if (!UninstallPackageOnTizen(this, id, runtime_context_->GetPath()))
     return false;
@@ -191,18 +244,48 @@ bool ApplicationService::Uninstall(const std::string& id) {
                << "; application is not installed.";
     return false;
   }
+  ApplicationResourceCache::Invalidate(id);
+  runtime_context_->GetApplicationSystem()->event_manager()->
+      SetApplicationEvents(id, std::set<std::string>());
+
+  if (!DeleteApplicationResources(id))
+    return false;
+
+  FOR_EACH_OBSERVER(Observer, observers_, OnApplicationUninstalled(id));
+
+  return true;
+}
+
+void ApplicationService::OnApplicationAdditionFailed(
+    const std::string& app_id) {
+  // Install() already succeeded, the installation is undone as if the
+  // application was uninstalled.
+  LOG(ERROR) << "Application with id " << app_id << " couldn't be stored, "
+             << "its installation is undone.";
+  pending_uninstalls_.erase(app_id);
+  runtime_context_->GetApplicationSystem()->event_manager()->
+      SetApplicationEvents(app_id, std::set<std::string>());
+  if (ContainsKey(running_applications_, app_id)) {
+    pending_deletions_.insert(app_id);
+    Terminate(app_id);
+  } else {
+    ApplicationResourceCache::Invalidate(app_id);
+    DeleteApplicationResources(app_id);
+  }
+
+  FOR_EACH_OBSERVER(Observer, observers_, OnApplicationUninstalled(app_id));
+}
 
+bool ApplicationService::DeleteApplicationResources(
+    const std::string& app_id) {
   const base::FilePath resources =
-      runtime_context_->GetPath().Append(kApplicationsDir).AppendASCII(id);
+      runtime_context_->GetPath().Append(kApplicationsDir).AppendASCII(app_id);
   if (base::DirectoryExists(resources) &&
       !base::DeleteFile(resources, true)) {
     LOG(ERROR) << "Error occurred while trying to remove application with id "
-               << id << "; Cannot remove all resources.";
+               << app_id << "; Cannot remove all resources.";
     return false;
   }
-
-  FOR_EACH_OBSERVER(Observer, observers_, OnApplicationUninstalled(id));
-
   return true;
 }
 
@@ -213,10 +296,11 @@ bool ApplicationService::Launch(const std::string& id) {
     return false;
   }
 
-  return Launch(application);
+  return Launch(application, false);
 }
 
-bool ApplicationService::Launch(const base::FilePath& path) {
+bool ApplicationService::Launch(const base::FilePath& path,
+                                std::string* id) {
   if (!base::DirectoryExists(path))
     return false;
 
@@ -229,10 +313,33 @@ bool ApplicationService::Launch(const base::FilePath& path) {
     return false;
   }
 
-  return Launch(application);
+  *id = application->ID();
+  return Launch(application, false);
+}
+
+bool ApplicationService::LaunchInBackground(const std::string& id) {
+  scoped_refptr<const ApplicationData> application = GetApplicationByID(id);
+  if (!application || !application->HasMainDocument()) {
+    LOG(ERROR) << "Application with id " << id
+               << " can't be launched in the background.";
+    return false;
+  }
+
+  return Launch(application, true);
 }
 
-const ApplicationData::ApplicationDataMap&
+bool ApplicationService::Terminate(const std::string& id) {
+  if (!ContainsKey(running_applications_, id)) {
+    LOG(ERROR) << "Application with id " << id << " isn't running.";
+    return false;
+  }
+
+  ApplicationSystem* system = runtime_context_->GetApplicationSystem();
+  system->process_manager()->CloseApplication(id);
+  return true;
+}
+
+const InstalledApplicationInfoMap&
 ApplicationService::GetInstalledApplications() const {
   return app_storage_->GetInstalledApplications();
 }
@@ -242,8 +349,46 @@ scoped_refptr<ApplicationData> ApplicationService::GetApplicationByID(
   return app_storage_->GetApplicationData(id);
 }
 
-const ApplicationData* ApplicationService::GetRunningApplication() const {
-  return application_.get();
+const ApplicationData* ApplicationService::GetRunningApplication(
+    const std::string& id) const {
+  RunningApplicationMap::const_iterator it = running_applications_.find(id);
+  return it != running_applications_.end() ? it->second.get() : NULL;
+}
+
+const ApplicationService::RunningApplicationMap&
+ApplicationService::GetRunningApplications() const {
+  return running_applications_;
+}
+
+void ApplicationService::OnApplicationLoaded(const std::string& id) {
+  if (ContainsKey(running_applications_, id))
+    FOR_EACH_OBSERVER(Observer, observers_, OnApplicationLoaded(id));
+}
+
+void ApplicationService::OnApplicationVisible(const std::string& id) {
+  if (ContainsKey(running_applications_, id))
+    FOR_EACH_OBSERVER(Observer, observers_, OnApplicationVisible(id));
+}
+
+void ApplicationService::OnApplicationSuspended(const std::string& id) {
+  if (ContainsKey(running_applications_, id))
+    FOR_EACH_OBSERVER(Observer, observers_, OnApplicationSuspended(id));
+}
+
+void ApplicationService::OnApplicationTerminated(const std::string& id) {
+  if (!running_applications_.erase(id))
+    return;
+
+  UnmountApplicationForProtocol(id);
+  runtime_context_->GetApplicationSystem()->event_manager()->OnAppUnloaded(id);
+  FOR_EACH_OBSERVER(Observer, observers_, OnApplicationTerminated(id));
+
+  if (pending_uninstalls_.erase(id)) {
+    RemoveApplication(id);
+  } else if (pending_deletions_.erase(id)) {
+    ApplicationResourceCache::Invalidate(id);
+    DeleteApplicationResources(id);
+  }
 }
 
 void ApplicationService::AddObserver(Observer* observer) {
@@ -255,15 +400,45 @@ void ApplicationService::RemoveObserver(Observer* observer) {
 }
 
 bool ApplicationService::Launch(
-    scoped_refptr<const ApplicationData> application) {
-  application_ = application;
+    scoped_refptr<const ApplicationData> application, bool in_background) {
+  const std::string& id = application->ID();
+  if (ContainsKey(pending_uninstalls_, id) ||
+      ContainsKey(pending_deletions_, id)) {
+    LOG(ERROR) << "Application with id " << id << " is being uninstalled.";
+    return false;
+  }
+  if (ContainsKey(running_applications_, id)) {
+    LOG(INFO) << "Application with id " << id << " is already running.";
+    return true;
+  }
+
+  // The application must be known to be running before its runtimes are
+  // created, since they load its resources and extensions.
+  running_applications_[id] = application;
+  MountApplicationForProtocol(application.get());
   ApplicationSystem* system = runtime_context_->GetApplicationSystem();
   ApplicationEventManager* event_manager = system->event_manager();
-  event_manager->OnAppLoaded(application->ID());
+  event_manager->OnAppLoaded(id);
 
-  return system->process_manager()->LaunchApplication(
-      runtime_context_,
-      application);
+  ApplicationProcessManager* process_manager = system->process_manager();
+  if (in_background ?
+      process_manager->LaunchInBackground(application) :
+      process_manager->LaunchApplication(runtime_context_, application)) {
+    return true;
+  }
+
+  running_applications_.erase(id);
+  UnmountApplicationForProtocol(id);
+  event_manager->OnAppUnloaded(id);
+  return false;
+}
+
+void ApplicationService::OnInstallProgress(const std::string& app_id,
+                                           int64 bytes_done,
+                                           int64 total_bytes) {
+  FOR_EACH_OBSERVER(Observer, observers_,
+                    OnApplicationInstallProgress(app_id, bytes_done,
+                                                 total_bytes));
 }
 
 ApplicationStorage* ApplicationService::application_storage() {
@@ -5,6 +5,8 @@
 #ifndef XWALK_APPLICATION_BROWSER_APPLICATION_SERVICE_H_
 #define XWALK_APPLICATION_BROWSER_APPLICATION_SERVICE_H_
 
+#include <map>
+#include <set>
 #include <string>
 #include "base/files/file_path.h"
 #include "base/memory/scoped_ptr.h"
@@ -22,28 +24,63 @@ namespace application {
 
 // This will manages applications install, uninstall, update and so on. It'll
 // also maintain all installed applications' info.
-class ApplicationService {
+//
+// Any number of applications can run at the same time in the browser
+// process, each one at most once.
+class ApplicationService : public ApplicationStorage::Observer {
  public:
+  typedef std::map<std::string, scoped_refptr<const ApplicationData> >
+      RunningApplicationMap;
+
   explicit ApplicationService(xwalk::RuntimeContext* runtime_context);
   virtual ~ApplicationService();
 
   bool Install(const base::FilePath& path, std::string* id);
+  // A running application is terminated first, and only removed once it's
+  // terminated.
   bool Uninstall(const std::string& id);
+  // Launching an application already running does nothing.
   bool Launch(const std::string& id);
-  bool Launch(const base::FilePath& path);
+  // |id| is set to the id of the application launched from |path|.
+  bool Launch(const base::FilePath& path, std::string* id);
+  // Runs only the main document of the installed application |id|, to
+  // handle an event. See ApplicationProcessManager::LaunchInBackground().
+  bool LaunchInBackground(const std::string& id);
+  // Closes all the windows of the running application |id|.
+  bool Terminate(const std::string& id);
 
   scoped_refptr<ApplicationData> GetApplicationByID(
        const std::string& id) const;
-  const ApplicationData::ApplicationDataMap& GetInstalledApplications() const;
-  // Currently there's only one running application at a time.
-  const ApplicationData* GetRunningApplication() const;
+  const InstalledApplicationInfoMap& GetInstalledApplications() const;
+  // Returns NULL if the application |id| isn't running.
+  const ApplicationData* GetRunningApplication(const std::string& id) const;
+  const RunningApplicationMap& GetRunningApplications() const;
+
+  // Called by the ApplicationProcessManager when a document of the
+  // application |id| is loaded, and when one of its windows is painted.
+  void OnApplicationLoaded(const std::string& id);
+  void OnApplicationVisible(const std::string& id);
+  // Called by the ApplicationProcessManager when the main document of the
+  // application |id| is suspended, before it's closed.
+  void OnApplicationSuspended(const std::string& id);
+  // Called by the ApplicationProcessManager once the last runtime of the
+  // application |id| is closed.
+  void OnApplicationTerminated(const std::string& id);
 
   // Client code may use this class (and register with AddObserver below) to
   // keep track of applications installed/uninstalled.
   struct Observer {
    public:
     virtual void OnApplicationInstalled(const std::string& app_id) {}
+    // Called while the package of |app_id| is extracted.
+    virtual void OnApplicationInstallProgress(const std::string& app_id,
+                                              int64 bytes_done,
+                                              int64 total_bytes) {}
     virtual void OnApplicationUninstalled(const std::string& app_id) {}
+    virtual void OnApplicationLoaded(const std::string& app_id) {}
+    virtual void OnApplicationVisible(const std::string& app_id) {}
+    virtual void OnApplicationSuspended(const std::string& app_id) {}
+    virtual void OnApplicationTerminated(const std::string& app_id) {}
    protected:
     ~Observer() {}
   };
@@ -53,11 +90,28 @@ class ApplicationService {
   ApplicationStorage* application_storage();
 
  private:
-  bool Launch(scoped_refptr<const ApplicationData> application);
+  // ApplicationStorage::Observer implementation.
+  virtual void OnApplicationAdditionFailed(const std::string& app_id) OVERRIDE;
+
+  bool Launch(scoped_refptr<const ApplicationData> application,
+              bool in_background);
+  // Removes the application |id|, which isn't running, from the storage and
+  // deletes its resources.
+  bool RemoveApplication(const std::string& id);
+  // Deletes the resources of |app_id| extracted from its package, if any.
+  bool DeleteApplicationResources(const std::string& app_id);
+  void OnInstallProgress(const std::string& app_id,
+                         int64 bytes_done,
+                         int64 total_bytes);
 
   xwalk::RuntimeContext* runtime_context_;
   scoped_ptr<ApplicationStorage> app_storage_;
-  scoped_refptr<const ApplicationData> application_;
+  RunningApplicationMap running_applications_;
+  // The running applications to uninstall once they're terminated.
+  std::set<std::string> pending_uninstalls_;
+  // The running applications whose installation failed, to delete the
+  // resources of once they're terminated.
+  std::set<std::string> pending_deletions_;
   ObserverList<Observer> observers_;
 
   DISALLOW_COPY_AND_ASSIGN(ApplicationService);
@@ -6,19 +6,103 @@
 
 #include <utility>
 
+#include "base/bind.h"
+#include "base/message_loop/message_loop.h"
+#include "base/synchronization/waitable_event.h"
+#include "base/threading/platform_thread.h"
+#include "base/threading/sequenced_worker_pool.h"
+#include "content/public/browser/browser_thread.h"
 #include "xwalk/application/common/application_file_util.h"
 #include "xwalk/runtime/browser/runtime_context.h"
 
+using content::BrowserThread;
+
 namespace xwalk {
 namespace application {
 
+namespace {
+
+// The changes made within this delay of the first one are written together.
+const int kFlushDelayMs = 100;
+
+// A failed transaction is usually due to a busy database, it's retried after
+// waiting a bit longer each time.
+const int kMaxWriteAttempts = 3;
+const int kRetryDelayMs = 50;
+
+const char kDatabaseSequenceName[] = "xwalk_application_storage";
+
+scoped_refptr<base::SequencedTaskRunner> GetDatabaseTaskRunner() {
+  base::SequencedWorkerPool* pool = BrowserThread::GetBlockingPool();
+  // Changes must not be lost at shutdown.
+  return pool->GetSequencedTaskRunnerWithShutdownBehavior(
+      pool->GetNamedSequenceToken(kDatabaseSequenceName),
+      base::SequencedWorkerPool::BLOCK_SHUTDOWN);
+}
+
+typedef base::Callback<void(scoped_ptr<ApplicationChangeList>, bool)>
+    ChangesWrittenCallback;
+
+// The retries wait on the database sequence, since |impl| may be deleted on
+// it right after this task.
+void ApplyChanges(ApplicationStorageImpl* impl,
+                  scoped_refptr<base::MessageLoopProxy> origin_loop,
+                  const ChangesWrittenCallback& callback,
+                  scoped_ptr<ApplicationChangeList> changes) {
+  bool succeeded = impl->ApplyChanges(*changes);
+  for (int attempt = 1; !succeeded && attempt < kMaxWriteAttempts;
+       ++attempt) {
+    base::PlatformThread::Sleep(
+        base::TimeDelta::FromMilliseconds(kRetryDelayMs * attempt));
+    succeeded = impl->ApplyChanges(*changes);
+  }
+  if (!succeeded) {
+    LOG(ERROR) << "Unable to write " << changes->size()
+               << " application changes to DB.";
+  }
+  origin_loop->PostTask(FROM_HERE,
+                        base::Bind(callback, base::Passed(&changes),
+                                   succeeded));
+}
+
+void ReadManifests(ApplicationStorageImpl* impl,
+                   const std::string& id,
+                   StoredManifests* manifests,
+                   bool* succeeded,
+                   base::WaitableEvent* done) {
+  *succeeded = impl->ReadManifests(id, manifests);
+  done->Signal();
+}
+
+}  // namespace
+
 ApplicationStorage::ApplicationStorage(const base::FilePath& path)
     : data_path_(path),
-      impl_(new ApplicationStorageImpl(path)) {
-  impl_->Init(applications_);
+      db_task_runner_(GetDatabaseTaskRunner()),
+      impl_(new ApplicationStorageImpl(path)),
+      flush_scheduled_(false),
+      origin_loop_(base::MessageLoopProxy::current()),
+      weak_factory_(this),
+      write_weak_factory_(this) {
+  impl_->Init(infos_);
+}
+
+ApplicationStorage::ApplicationStorage(
+    const base::FilePath& path,
+    scoped_refptr<base::SequencedTaskRunner> db_task_runner)
+    : data_path_(path),
+      db_task_runner_(db_task_runner),
+      impl_(new ApplicationStorageImpl(path)),
+      flush_scheduled_(false),
+      origin_loop_(base::MessageLoopProxy::current()),
+      weak_factory_(this),
+      write_weak_factory_(this) {
+  impl_->Init(infos_);
 }
 
 ApplicationStorage::~ApplicationStorage() {
+  Flush();
+  db_task_runner_->DeleteSoon(FROM_HERE, impl_);
 }
 
 bool ApplicationStorage::AddApplication(
@@ -29,69 +113,202 @@ bool ApplicationStorage::AddApplication(
     return false;
   }
 
-  if (!impl_->AddApplication(app_data.get(), base::Time::Now()) ||
-      !Insert(app_data))
-    return false;
+  ApplicationChange change =
+      ApplicationStorageImpl::MakeAddition(app_data.get(), base::Time::Now());
+  InstalledApplicationInfo& info = infos_[app_data->ID()];
+  info = ApplicationStorageImpl::MakeInfo(app_data.get());
+  info.install_time = change.install_time;
+  applications_[app_data->ID()] = app_data;
 
+  AddChange(change);
   return true;
 }
 
 bool ApplicationStorage::RemoveApplication(const std::string& id) {
-  if (applications_.erase(id) != 1) {
+  if (infos_.erase(id) != 1) {
     LOG(ERROR) << "Application " << id << " is invalid.";
     return false;
   }
+  applications_.erase(id);
 
-  if (!impl_->RemoveApplication(id)) {
-    LOG(ERROR) << "Error occurred while trying to remove application"
-                  "information with id "
-               << id << " from database.";
-    return false;
-  }
-
+  AddChange(ApplicationStorageImpl::MakeRemoval(id));
   return true;
 }
 
 bool ApplicationStorage::UpdateApplication(
     scoped_refptr<ApplicationData> app_data) {
-  ApplicationData::ApplicationDataMapIterator it =
-      applications_.find(app_data->ID());
-  if (it == applications_.end()) {
+  InstalledApplicationInfoMap::iterator it = infos_.find(app_data->ID());
+  if (it == infos_.end()) {
     LOG(ERROR) << "Application " << app_data->ID() << " is invalid.";
     return false;
   }
 
-  it->second = app_data;
-  if (!impl_->UpdateApplication(app_data.get(), base::Time::Now()))
-    return false;
+  ApplicationChange change =
+      ApplicationStorageImpl::MakeUpdate(app_data.get(), base::Time::Now());
+  it->second = ApplicationStorageImpl::MakeInfo(app_data.get());
+  it->second.install_time = change.install_time;
+  applications_[app_data->ID()] = app_data;
 
+  AddChange(change);
   return true;
 }
 
 bool ApplicationStorage::Contains(const std::string& app_id) const {
-  return applications_.find(app_id) != applications_.end();
+  return infos_.find(app_id) != infos_.end();
 }
 
 scoped_refptr<ApplicationData> ApplicationStorage::GetApplicationData(
-    const std::string& application_id) const {
+    const std::string& application_id) {
   ApplicationData::ApplicationDataMap::const_iterator it =
       applications_.find(application_id);
   if (it != applications_.end()) {
     return it->second;
   }
 
-  return NULL;
+  InstalledApplicationInfoMap::iterator info = infos_.find(application_id);
+  if (info == infos_.end())
+    return NULL;
+
+  // The manifests are read on the database sequence, after the changes
+  // already posted there.
+  StoredManifests manifests;
+  bool read = false;
+  if (db_task_runner_->RunsTasksOnCurrentThread()) {
+    read = impl_->ReadManifests(application_id, &manifests);
+  } else {
+    base::WaitableEvent done(false, false);
+    db_task_runner_->PostTask(
+        FROM_HERE,
+        base::Bind(&ReadManifests, base::Unretained(impl_), application_id,
+                   &manifests, &read, &done));
+    done.Wait();
+  }
+  if (!read)
+    return NULL;
+
+  bool outdated = false;
+  std::string error;
+  scoped_refptr<ApplicationData> application =
+      ApplicationStorageImpl::CreateApplication(info->second, manifests,
+                                                &outdated, &error);
+  if (!application) {
+    LOG(ERROR) << "Unable to load application " << application_id << ": "
+               << error;
+    return NULL;
+  }
+  // The binary manifest couldn't be decoded, it's encoded again.
+  if (outdated) {
+    AddChange(ApplicationStorageImpl::MakeUpdate(application.get(),
+                                                 info->second.install_time));
+  }
+  applications_[application_id] = application;
+  return application;
 }
 
-const ApplicationData::ApplicationDataMap&
+const InstalledApplicationInfoMap&
 ApplicationStorage::GetInstalledApplications() const {
-  return applications_;
+  return infos_;
+}
+
+void ApplicationStorage::Flush() {
+  weak_factory_.InvalidateWeakPtrs();
+  flush_scheduled_ = false;
+  if (pending_changes_.empty())
+    return;
+
+  scoped_ptr<ApplicationChangeList> changes(new ApplicationChangeList);
+  changes->swap(pending_changes_);
+  // |impl_| is deleted on the same sequence, after the last changes.
+  db_task_runner_->PostTask(
+      FROM_HERE,
+      base::Bind(&ApplyChanges,
+                 base::Unretained(impl_),
+                 origin_loop_,
+                 base::Bind(&ApplicationStorage::OnChangesWritten,
+                            write_weak_factory_.GetWeakPtr()),
+                 base::Passed(&changes)));
+}
+
+void ApplicationStorage::AddObserver(Observer* observer) {
+  observers_.AddObserver(observer);
 }
 
-bool ApplicationStorage::Insert(scoped_refptr<ApplicationData> app_data) {
-  return applications_.insert(
-      std::pair<std::string, scoped_refptr<ApplicationData> >(
-          app_data->ID(), app_data)).second;
+void ApplicationStorage::RemoveObserver(Observer* observer) {
+  observers_.RemoveObserver(observer);
+}
+
+void ApplicationStorage::AddChange(const ApplicationChange& change) {
+  ScheduleFlush();
+  pending_changes_.push_back(change);
+  ++unwritten_change_counts_[change.id];
+}
+
+void ApplicationStorage::ScheduleFlush() {
+  if (flush_scheduled_)
+    return;
+  flush_scheduled_ = true;
+  base::MessageLoop::current()->PostDelayedTask(
+      FROM_HERE,
+      base::Bind(&ApplicationStorage::Flush, weak_factory_.GetWeakPtr()),
+      base::TimeDelta::FromMilliseconds(kFlushDelayMs));
+}
+
+void ApplicationStorage::OnChangesWritten(
+    scoped_ptr<ApplicationChangeList> changes, bool succeeded) {
+  std::vector<std::string> failed_additions;
+  for (size_t i = 0; i < changes->size(); ++i) {
+    const ApplicationChange& change = (*changes)[i];
+    // Not counted anymore if its addition failed meanwhile.
+    std::map<std::string, int>::iterator count =
+        unwritten_change_counts_.find(change.id);
+    bool last_change = false;
+    if (count != unwritten_change_counts_.end() && --count->second == 0) {
+      unwritten_change_counts_.erase(count);
+      last_change = true;
+    }
+
+    if (succeeded) {
+      ApplicationData::ApplicationDataMap::iterator it =
+          applications_.find(change.id);
+      if (last_change && it != applications_.end())
+        ApplicationStorageImpl::MarkStored(it->second.get());
+      continue;
+    }
+
+    if (change.type == ApplicationChange::ADD) {
+      // Not listed anymore, so that the application isn't seen as installed
+      // until the next restart only.
+      if (infos_.erase(change.id)) {
+        applications_.erase(change.id);
+        failed_additions.push_back(change.id);
+      }
+    } else if (change.type == ApplicationChange::REMOVE ||
+               Contains(change.id)) {
+      // Written by the next flush.
+      pending_changes_.push_back(change);
+      ++unwritten_change_counts_[change.id];
+    }
+  }
+
+  // The changes made since to the applications not added are dropped.
+  for (size_t i = 0; i < failed_additions.size(); ++i) {
+    ApplicationChangeList::iterator it = pending_changes_.begin();
+    while (it != pending_changes_.end()) {
+      if (it->id == failed_additions[i])
+        it = pending_changes_.erase(it);
+      else
+        ++it;
+    }
+    unwritten_change_counts_.erase(failed_additions[i]);
+  }
+
+  if (!pending_changes_.empty())
+    ScheduleFlush();
+
+  for (size_t i = 0; i < failed_additions.size(); ++i) {
+    FOR_EACH_OBSERVER(Observer, observers_,
+                      OnApplicationAdditionFailed(failed_additions[i]));
+  }
 }
 
 }  // namespace application
@@ -10,16 +10,42 @@
 #include <vector>
 
 #include "base/memory/ref_counted.h"
+#include "base/memory/weak_ptr.h"
+#include "base/message_loop/message_loop_proxy.h"
 #include "base/observer_list.h"
+#include "base/sequenced_task_runner.h"
 #include "xwalk/application/common/application_data.h"
 #include "xwalk/application/common/application_storage_impl.h"
 
 namespace xwalk {
 namespace application {
 
+// The installed applications, kept in memory and written to the database
+// behind the scenes. Only their list is read from the database at startup,
+// each application is created when it's first asked for, from its manifest
+// read then on the database sequence.
+// The changes made in a short time are written together,
+// in a single transaction on the database sequence, so that the UI thread
+// never waits for the database.
+//
+// A transaction that fails is retried a few times. If it still fails, the
+// applications it added are removed again and the observers are told, the
+// updates and removals are queued again and written by the next flush.
 class ApplicationStorage {
  public:
+  class Observer {
+   public:
+    // The addition of |app_id| couldn't be written, it isn't installed
+    // anymore.
+    virtual void OnApplicationAdditionFailed(const std::string& app_id) = 0;
+   protected:
+    virtual ~Observer() {}
+  };
+
   explicit ApplicationStorage(const base::FilePath& path);
+  // Writes the database on |db_task_runner|.
+  ApplicationStorage(const base::FilePath& path,
+                     scoped_refptr<base::SequencedTaskRunner> db_task_runner);
   ~ApplicationStorage();
 
   bool AddApplication(scoped_refptr<ApplicationData> app_data);
@@ -30,16 +56,45 @@ class ApplicationStorage {
 
   bool Contains(const std::string& app_id) const;
 
+  // Creates the application if it wasn't yet, waiting for its manifest to
+  // be read on the database sequence.
   scoped_refptr<ApplicationData> GetApplicationData(
-      const std::string& application_id) const;
+      const std::string& application_id);
+
+  const InstalledApplicationInfoMap& GetInstalledApplications() const;
 
-  const ApplicationData::ApplicationDataMap& GetInstalledApplications() const;
+  // Posts the changes not written yet to the database sequence now.
+  void Flush();
+
+  void AddObserver(Observer* observer);
+  void RemoveObserver(Observer* observer);
 
  private:
-  bool Insert(scoped_refptr<ApplicationData> app_data);
+  void AddChange(const ApplicationChange& change);
+  // Posts a delayed Flush() unless one is already posted.
+  void ScheduleFlush();
+  // Called with the changes of a transaction once it's done.
+  void OnChangesWritten(scoped_ptr<ApplicationChangeList> changes,
+                        bool succeeded);
+
   base::FilePath data_path_;
-  scoped_ptr<ApplicationStorageImpl> impl_;
+  scoped_refptr<base::SequencedTaskRunner> db_task_runner_;
+  // Owned, used and deleted on |db_task_runner_| once initialized.
+  ApplicationStorageImpl* impl_;
+  // The list of the installed applications.
+  InstalledApplicationInfoMap infos_;
+  // The applications created so far.
   ApplicationData::ApplicationDataMap applications_;
+  ApplicationChangeList pending_changes_;
+  bool flush_scheduled_;
+  // The number of changes of each application not written yet, so that it
+  // isn't marked as stored while newer changes are pending.
+  std::map<std::string, int> unwritten_change_counts_;
+  scoped_refptr<base::MessageLoopProxy> origin_loop_;
+  ObserverList<Observer> observers_;
+  // Invalidated when the changes are flushed before the delay.
+  base::WeakPtrFactory<ApplicationStorage> weak_factory_;
+  base::WeakPtrFactory<ApplicationStorage> write_weak_factory_;
   DISALLOW_COPY_AND_ASSIGN(ApplicationStorage);
 };
 
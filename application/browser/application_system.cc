@@ -7,6 +7,9 @@
 #include <string>
 #include "base/command_line.h"
 #include "base/file_util.h"
+#include "base/message_loop/message_loop.h"
+#include "content/public/browser/web_contents.h"
+#include "content/public/browser/web_contents_observer.h"
 #include "net/base/net_util.h"
 #include "xwalk/application/browser/application_event_manager.h"
 #include "xwalk/application/browser/application_process_manager.h"
@@ -14,6 +17,7 @@
 #include "xwalk/application/common/event_names.h"
 #include "xwalk/application/extension/application_event_extension.h"
 #include "xwalk/application/extension/application_runtime_extension.h"
+#include "xwalk/runtime/browser/runtime.h"
 #include "xwalk/runtime/browser/runtime_context.h"
 #include "xwalk/runtime/common/xwalk_switches.h"
 
@@ -21,6 +25,36 @@
 #include "xwalk/application/browser/application_system_linux.h"
 #endif
 
+namespace {
+
+void WaitForFinishLoad(content::WebContents* content) {
+  class CloseAfterLoadObserver : public content::WebContentsObserver {
+   public:
+    static CloseAfterLoadObserver* Create(content::WebContents* content) {
+      return new CloseAfterLoadObserver(content);
+    }
+
+    virtual void DidFinishLoad(
+        int64 frame_id,
+        const GURL& validate_url,
+        bool is_main_frame,
+        content::RenderViewHost* render_view_host) OVERRIDE {
+      // FIXME: Quit message loop here at present. This should go away once
+      // we have Application in place.
+      base::MessageLoop::current()->QuitWhenIdle();
+      delete this;
+    }
+
+   private:
+    explicit CloseAfterLoadObserver(content::WebContents* content)
+        : content::WebContentsObserver(content) {}
+  };
+
+  CloseAfterLoadObserver* observer = CloseAfterLoadObserver::Create(content);
+}
+
+}  // namespace
+
 namespace xwalk {
 namespace application {
 
@@ -50,13 +84,13 @@ bool ApplicationSystem::HandleApplicationManagementCommands(
     bool& run_default_message_loop) {
   run_default_message_loop = false;
   if (cmd_line.HasSwitch(switches::kListApplications)) {
-    const ApplicationData::ApplicationDataMap& apps =
+    const InstalledApplicationInfoMap& apps =
         application_service_->GetInstalledApplications();
     LOG(INFO) << "Application ID                       Application Name";
     LOG(INFO) << "-----------------------------------------------------";
-    ApplicationData::ApplicationDataMap::const_iterator it;
+    InstalledApplicationInfoMap::const_iterator it;
     for (it = apps.begin(); it != apps.end(); ++it)
-      LOG(INFO) << it->first << "     " << it->second->Name();
+      LOG(INFO) << it->first << "     " << it->second.name;
     LOG(INFO) << "-----------------------------------------------------";
     return true;
   }
@@ -90,8 +124,12 @@ bool ApplicationSystem::HandleApplicationManagementCommands(
     std::string app_id;
     if (application_service_->Install(path, &app_id)) {
       LOG(INFO) << "[OK] Application installed: " << app_id;
-      if (application_service_->GetApplicationByID(app_id)->HasMainDocument())
+      // The main document registers its events while it loads.
+      if (Runtime* main_runtime =
+              process_manager_->GetMainDocumentRuntime(app_id)) {
+        WaitForFinishLoad(main_runtime->web_contents());
         run_default_message_loop = true;
+      }
     } else {
       LOG(ERROR) << "[ERR] Application install failure: " << path.value();
     }
@@ -112,7 +150,7 @@ bool ApplicationSystem::LaunchFromCommandLine(
   std::string command_name = cmd_line.GetProgram().BaseName().MaybeAsASCII();
   if (ApplicationData::IsIDValid(command_name)) {
     *run_default_message_loop = application_service_->Launch(command_name);
-    SendOnLaunchedEvent();
+    SendOnLaunchedEvent(command_name);
     return true;
   }
 #endif
@@ -126,7 +164,7 @@ bool ApplicationSystem::LaunchFromCommandLine(
     std::string app_id = std::string(args[0].begin(), args[0].end());
     if (ApplicationData::IsIDValid(app_id)) {
         *run_default_message_loop = application_service_->Launch(app_id);
-        SendOnLaunchedEvent();
+        SendOnLaunchedEvent(app_id);
         return true;
     }
   }
@@ -134,20 +172,21 @@ bool ApplicationSystem::LaunchFromCommandLine(
   // Handles local directory.
   base::FilePath path;
   if (net::FileURLToFilePath(url, &path) && base::DirectoryExists(path)) {
-    *run_default_message_loop = application_service_->Launch(path);
-    SendOnLaunchedEvent();
+    std::string app_id;
+    *run_default_message_loop = application_service_->Launch(path, &app_id);
+    SendOnLaunchedEvent(app_id);
     return true;
   }
 
   return false;
 }
 
-void ApplicationSystem::SendOnLaunchedEvent() {
+void ApplicationSystem::SendOnLaunchedEvent(const std::string& app_id) {
+  if (!application_service_->GetRunningApplication(app_id))
+    return;
   scoped_refptr<Event> event = Event::CreateEvent(
       kOnLaunched, scoped_ptr<base::ListValue>(new base::ListValue));
-  DCHECK(application_service_->GetRunningApplication());
-  event_manager_->SendEvent(
-      application_service_->GetRunningApplication()->ID(), event);
+  event_manager_->SendEvent(app_id, event);
 }
 
 bool ApplicationSystem::IsRunningAsService() const {
@@ -157,13 +196,14 @@ bool ApplicationSystem::IsRunningAsService() const {
 void ApplicationSystem::CreateExtensions(
     content::RenderProcessHost* host,
     extensions::XWalkExtensionVector* extensions) {
-  // FIXME(xiang): When service mode is enabled, we need to check whether the
-  // RPH belongs to an active application.
-  if (!application_service_->GetRunningApplication())
+  // The processes started ahead of time get the extensions too, they learn
+  // their application once it's loaded in them.
+  if (process_manager_->GetApplicationIDForProcess(host).empty() &&
+      !process_manager_->IsPrelaunchedProcess(host))
     return;
 
-  extensions->push_back(new ApplicationRuntimeExtension(this));
-  extensions->push_back(new ApplicationEventExtension(this));
+  extensions->push_back(new ApplicationRuntimeExtension(this, host));
+  extensions->push_back(new ApplicationEventExtension(this, host));
 }
 
 }  // namespace application
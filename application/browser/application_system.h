@@ -6,6 +6,7 @@
 #define XWALK_APPLICATION_BROWSER_APPLICATION_SYSTEM_H_
 
 #include <map>
+#include <string>
 
 #include "base/memory/ref_counted.h"
 #include "base/memory/scoped_ptr.h"
@@ -92,8 +93,9 @@ class ApplicationSystem {
   explicit ApplicationSystem(RuntimeContext* runtime_context);
 
  private:
-  // Dispatch the onLaunched event to current running application.
-  void SendOnLaunchedEvent();
+  // Dispatch the onLaunched event to the application |app_id|, if it's
+  // running.
+  void SendOnLaunchedEvent(const std::string& app_id);
 
   xwalk::RuntimeContext* runtime_context_;
   scoped_ptr<ApplicationProcessManager> process_manager_;
@@ -4,20 +4,48 @@
 
 #include "xwalk/application/browser/installer/package.h"
 
+#include <vector>
+
+#include "base/bind.h"
 #include "base/file_util.h"
 #include "base/files/file_path.h"
 #include "base/logging.h"
 #include "base/path_service.h"
 #include "third_party/zlib/google/zip.h"
+#include "third_party/zlib/google/zip_reader.h"
+#include "xwalk/application/common/constants.h"
 #include "xwalk/application/common/id_util.h"
+#include "xwalk/application/browser/installer/package_extractor.h"
 #include "xwalk/application/browser/installer/wgt_package.h"
 #include "xwalk/application/browser/installer/xpk_package.h"
 
 namespace xwalk {
 namespace application {
 
+namespace {
+
+bool IsManifestFile(const base::FilePath& relative_path) {
+  return relative_path == base::FilePath(kManifestFilename);
+}
+
+// Extracts the manifest of the zip file at |zip_path| to |target_dir|, like
+// the entry filter used with an archive does when reading the package.
+bool UnzipManifest(const base::FilePath& zip_path,
+                   const base::FilePath& target_dir) {
+  zip::ZipReader reader;
+  if (!reader.Open(zip_path))
+    return false;
+  if (!reader.LocateAndOpenEntry(base::FilePath(kManifestFilename)))
+    return true;
+  return reader.ExtractCurrentEntryIntoDirectory(target_dir);
+}
+
+}  // namespace
+
 Package::Package(const base::FilePath& source_path)
-  : source_path_(source_path) {
+  : is_valid_(false),
+    zip_offset_(0),
+    source_path_(source_path) {
 }
 
 Package::~Package() {
@@ -51,15 +79,129 @@ bool Package::Extract(base::FilePath* target_path) {
     return false;
   }
 
-  if (!zip::Unzip(source_path_, temp_dir_.path())) {
-    LOG(ERROR) << "An error occurred during package extraction";
+  if (!ExtractTo(temp_dir_.path(), ProgressCallback()))
     return false;
-  }
 
   *target_path = temp_dir_.path();
   return true;
 }
 
+bool Package::ExtractTo(const base::FilePath& target_dir,
+                        const ProgressCallback& progress_callback) {
+  return ExtractFiles(target_dir, base::FilePath(), progress_callback);
+}
+
+bool Package::ExtractManifestTo(const base::FilePath& target_dir,
+                                const base::FilePath& archive_path,
+                                const ProgressCallback& progress_callback) {
+  return ExtractFiles(target_dir, archive_path, progress_callback);
+}
+
+bool Package::BeginVerification() {
+  return true;
+}
+
+void Package::UpdateVerification(const char* data, size_t size) {
+}
+
+bool Package::FinishVerification() {
+  return true;
+}
+
+bool Package::ExtractFiles(const base::FilePath& target_dir,
+                           const base::FilePath& archive_path,
+                           const ProgressCallback& progress_callback) {
+  if (!IsValid()) {
+    LOG(ERROR) << "XPK/WGT file is not valid.";
+    return false;
+  }
+
+  FILE* file = file_->get();
+  if (fseek(file, 0, SEEK_END))
+    return false;
+  int64 size = ftell(file) - zip_offset_;
+  if (size <= 0)
+    return false;
+
+  ScopedStdioHandle archive;
+  if (!archive_path.empty()) {
+    archive.Set(file_util::OpenFile(archive_path, "wb"));
+    if (!archive.get())
+      return false;
+  }
+
+  PackageExtractor extractor(file, zip_offset_, size);
+  extractor.set_data_callback(base::Bind(
+      &Package::ProcessZipData, base::Unretained(this), archive.get()));
+  extractor.set_progress_callback(progress_callback);
+  if (archive.get())
+    extractor.set_entry_filter(base::Bind(&IsManifestFile));
+
+  if (!BeginVerification())
+    return false;
+  switch (extractor.ExtractTo(target_dir)) {
+    case PackageExtractor::SUCCEEDED:
+      break;
+    case PackageExtractor::FAILED:
+      LOG(ERROR) << "An error occurred during package extraction";
+      FinishVerification();
+      return false;
+    case PackageExtractor::UNSUPPORTED:
+      // Verify and extract in two passes, the zip file may not be readable
+      // in a single one.
+      FinishVerification();
+      if (archive.get()) {
+        archive.Set(file_util::OpenFile(archive_path, "wb"));
+        if (!archive.get())
+          return false;
+      }
+      if (!ProcessZipFile(archive.get())) {
+        LOG(ERROR) << "The package signature is not valid.";
+        return false;
+      }
+      if (archive.get()) {
+        // Only the manifest goes next to the archive, it is read from the
+        // copy just made.
+        if (fflush(archive.get()) || ferror(archive.get()))
+          return false;
+        if (!UnzipManifest(archive_path, target_dir)) {
+          LOG(ERROR) << "An error occurred during manifest extraction";
+          return false;
+        }
+      } else if (!zip::Unzip(source_path_, target_dir)) {
+        LOG(ERROR) << "An error occurred during package extraction";
+        return false;
+      }
+      if (!progress_callback.is_null())
+        progress_callback.Run(size, size);
+      return true;
+  }
+
+  if (!FinishVerification()) {
+    LOG(ERROR) << "The package signature is not valid.";
+    return false;
+  }
+  return !archive.get() || !ferror(archive.get());
+}
+
+void Package::ProcessZipData(FILE* archive, const char* data, size_t size) {
+  UpdateVerification(data, size);
+  if (archive)
+    fwrite(data, 1, size, archive);
+}
+
+bool Package::ProcessZipFile(FILE* archive) {
+  FILE* file = file_->get();
+  if (fseek(file, zip_offset_, SEEK_SET) || !BeginVerification())
+    return false;
+
+  std::vector<char> buffer(1 << 16);
+  size_t length;
+  while ((length = fread(&buffer[0], 1, buffer.size(), file)) > 0)
+    ProcessZipData(archive, &buffer[0], length);
+  return FinishVerification();
+}
+
 // Create a temporary directory to decompress the zipped package file.
 // As the package information might already exists under data_path,
 // it's safer to extract the XPK/WGT file into a temporary directory first.
@@ -8,6 +8,8 @@
 #include <string>
 #include <vector>
 
+#include "base/basictypes.h"
+#include "base/callback.h"
 #include "base/files/file_path.h"
 #include "base/files/scoped_temp_dir.h"
 #include "base/memory/scoped_handle.h"
@@ -18,10 +20,14 @@ namespace application {
 
 // Base class for all types of packages (right now .wgt and .xpk)
 // The actual zip file, id, is_valid_, source_path_ are common in all packages
-// specifics like signature checking for XPK are taken care of in
-//  XPKPackage::Validate()
+// specifics like signature checking for XPK are taken care of by the
+// verification hooks of XPKPackage.
 class Package {
  public:
+  // Bytes of the package processed so far, out of |total_bytes|.
+  typedef base::Callback<void(int64 bytes_done, int64 total_bytes)>
+      ProgressCallback;
+
   virtual ~Package();
   bool IsValid() const { return is_valid_; }
   const std::string& Id() const { return id_; }
@@ -30,16 +36,47 @@ class Package {
   // The function will unzip the XPK/WGT file and return the target path where
   // to decompress by the parameter |target_path|.
   bool Extract(base::FilePath* target_path);
+  // Extracts the package into the existing directory |target_dir|, checking
+  // its signature while reading it. Returns false if the package can't be
+  // extracted or isn't genuine, the content of |target_dir| must be
+  // discarded then.
+  bool ExtractTo(const base::FilePath& target_dir,
+                 const ProgressCallback& progress_callback);
+  // Like ExtractTo(), but only the manifest is extracted, the zip file being
+  // copied to |archive_path| in the same pass so that the application can
+  // run from it.
+  bool ExtractManifestTo(const base::FilePath& target_dir,
+                         const base::FilePath& archive_path,
+                         const ProgressCallback& progress_callback);
  protected:
   explicit Package(const base::FilePath& source_path);
+  // Called with the content of the zip file, from |zip_offset_| to the end of
+  // the package, between BeginVerification() and FinishVerification().
+  virtual bool BeginVerification();
+  virtual void UpdateVerification(const char* data, size_t size);
+  virtual bool FinishVerification();
   scoped_ptr<ScopedStdioHandle> file_;
   bool is_valid_;
   std::string id_;
+  // Where the zip file starts in the package.
+  int64 zip_offset_;
   // Unzipping of the zipped file happens in a temporary directory
   bool CreateTempDirectory();
   base::FilePath source_path_;
   // Temporary directory for unpacking.
   base::ScopedTempDir temp_dir_;
+
+ private:
+  // Extracts the package, or only its manifest when |archive_path| isn't
+  // empty.
+  bool ExtractFiles(const base::FilePath& target_dir,
+                    const base::FilePath& archive_path,
+                    const ProgressCallback& progress_callback);
+  // Verifies the zip file data, and copies it to |archive| if not NULL.
+  void ProcessZipData(FILE* archive, const char* data, size_t size);
+  // Reads the whole zip file through ProcessZipData(), when it's extracted
+  // apart. Returns whether it's genuine.
+  bool ProcessZipFile(FILE* archive);
 };
 
 }  // namespace application
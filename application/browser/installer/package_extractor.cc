@@ -0,0 +1,453 @@
+// Copyright (c) 2013 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "xwalk/application/browser/installer/package_extractor.h"
+
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "base/bind.h"
+#include "base/file_util.h"
+#include "base/logging.h"
+#include "base/memory/ref_counted.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/synchronization/condition_variable.h"
+#include "base/synchronization/lock.h"
+#include "base/sys_info.h"
+#include "base/threading/worker_pool.h"
+#include "third_party/zlib/zlib.h"
+
+namespace xwalk {
+namespace application {
+
+namespace {
+
+const uint32 kLocalFileHeaderSignature = 0x04034b50;
+const uint32 kCentralDirectorySignature = 0x02014b50;
+const uint32 kEndOfCentralDirectorySignature = 0x06054b50;
+const size_t kLocalFileHeaderSize = 30;
+
+const uint16 kEncryptedFlag = 1 << 0;
+const uint16 kDataDescriptorFlag = 1 << 3;
+const uint16 kStoredMethod = 0;
+const uint16 kDeflatedMethod = 8;
+// Sizes of ZIP64 entries are only found in their extra field.
+const uint32 kZip64Size = 0xFFFFFFFF;
+
+const size_t kReadBufferSize = 1 << 16;
+const size_t kInflateBufferSize = 1 << 16;
+
+// Entries with more compressed data than this are inflated while being read,
+// the others are buffered and written on the worker pool.
+const uint32 kMaxBufferedEntrySize = 4 << 20;
+// Upper bound of the buffered data waiting to be written.
+const int64 kMaxBufferedSize = 32 << 20;
+
+uint16 ReadUInt16(const uint8* data) {
+  return data[0] | (data[1] << 8);
+}
+
+uint32 ReadUInt32(const uint8* data) {
+  return data[0] | (data[1] << 8) | (data[2] << 16) |
+      (static_cast<uint32>(data[3]) << 24);
+}
+
+struct EntryInfo {
+  base::FilePath path;
+  uint16 method;
+  uint32 crc;
+  uint32 compressed_size;
+  uint32 uncompressed_size;
+};
+
+// Writes the data of an entry into its file, inflating it if needed, and
+// checks its size and CRC once complete.
+class EntryWriter {
+ public:
+  EntryWriter()
+      : file_(NULL),
+        method_(kStoredMethod),
+        stream_initialized_(false),
+        stream_end_(false),
+        crc_(crc32(0L, Z_NULL, 0)),
+        size_(0) {
+  }
+
+  ~EntryWriter() {
+    if (stream_initialized_)
+      inflateEnd(&stream_);
+    if (file_)
+      file_util::CloseFile(file_);
+  }
+
+  bool Open(const base::FilePath& path, uint16 method) {
+    method_ = method;
+    if (method_ == kDeflatedMethod) {
+      memset(&stream_, 0, sizeof(stream_));
+      // Zip entries hold raw deflate data, without zlib header.
+      if (inflateInit2(&stream_, -MAX_WBITS) != Z_OK)
+        return false;
+      stream_initialized_ = true;
+      output_.resize(kInflateBufferSize);
+    }
+
+    file_ = file_util::OpenFile(path, "wb");
+    return file_ != NULL;
+  }
+
+  bool Write(const char* data, size_t size) {
+    if (method_ == kStoredMethod)
+      return WriteOutput(data, size);
+    if (stream_end_)
+      return true;
+
+    stream_.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+    stream_.avail_in = size;
+    do {
+      stream_.next_out = reinterpret_cast<Bytef*>(&output_[0]);
+      stream_.avail_out = output_.size();
+      int result = inflate(&stream_, Z_NO_FLUSH);
+      if (result == Z_STREAM_END)
+        stream_end_ = true;
+      else if (result != Z_OK && result != Z_BUF_ERROR)
+        return false;
+      if (!WriteOutput(&output_[0], output_.size() - stream_.avail_out))
+        return false;
+    } while (stream_.avail_out == 0 && !stream_end_);
+    return true;
+  }
+
+  bool Close(uint32 crc, uint32 size) {
+    FILE* file = file_;
+    file_ = NULL;
+    if (!file_util::CloseFile(file))
+      return false;
+    if (method_ == kDeflatedMethod && !stream_end_)
+      return false;
+    return crc_ == crc && size_ == size;
+  }
+
+ private:
+  bool WriteOutput(const char* data, size_t size) {
+    if (!size)
+      return true;
+    crc_ = crc32(crc_, reinterpret_cast<const Bytef*>(data), size);
+    size_ += size;
+    return fwrite(data, 1, size, file_) == size;
+  }
+
+  FILE* file_;
+  uint16 method_;
+  z_stream stream_;
+  bool stream_initialized_;
+  bool stream_end_;
+  std::vector<char> output_;
+  uint32 crc_;
+  uint32 size_;
+
+  DISALLOW_COPY_AND_ASSIGN(EntryWriter);
+};
+
+// Keeps track of the entries being written on the worker pool, and blocks
+// the reader when too many of them are waiting.
+class PendingWrites : public base::RefCountedThreadSafe<PendingWrites> {
+ public:
+  explicit PendingWrites(int max_writes)
+      : condition_(&lock_),
+        max_writes_(max_writes),
+        writes_(0),
+        buffered_size_(0),
+        failed_(false) {
+  }
+
+  // Waits until an entry of |size| bytes can be buffered, and counts it.
+  void Add(int64 size) {
+    base::AutoLock auto_lock(lock_);
+    while (writes_ > 0 && (writes_ >= max_writes_ ||
+                           buffered_size_ + size > kMaxBufferedSize))
+      condition_.Wait();
+    ++writes_;
+    buffered_size_ += size;
+  }
+
+  void Done(int64 size, bool succeeded) {
+    base::AutoLock auto_lock(lock_);
+    --writes_;
+    buffered_size_ -= size;
+    if (!succeeded)
+      failed_ = true;
+    condition_.Broadcast();
+  }
+
+  // Waits for all the writes, returns false if any of them failed.
+  bool WaitForAll() {
+    base::AutoLock auto_lock(lock_);
+    while (writes_ > 0)
+      condition_.Wait();
+    return !failed_;
+  }
+
+  bool failed() {
+    base::AutoLock auto_lock(lock_);
+    return failed_;
+  }
+
+ private:
+  friend class base::RefCountedThreadSafe<PendingWrites>;
+  ~PendingWrites() {}
+
+  base::Lock lock_;
+  base::ConditionVariable condition_;
+  const int max_writes_;
+  int writes_;
+  int64 buffered_size_;
+  bool failed_;
+
+  DISALLOW_COPY_AND_ASSIGN(PendingWrites);
+};
+
+// Runs on the worker pool.
+void WriteEntry(scoped_refptr<PendingWrites> writes,
+                const EntryInfo& entry,
+                scoped_ptr<std::string> data) {
+  EntryWriter writer;
+  bool succeeded = writer.Open(entry.path, entry.method) &&
+      writer.Write(data->data(), data->size()) &&
+      writer.Close(entry.crc, entry.uncompressed_size);
+  LOG_IF(ERROR, !succeeded) << "Can't extract " << entry.path.value();
+  writes->Done(data->size(), succeeded);
+}
+
+// Reads the archive sequentially through a buffer, handing every chunk read
+// to the data callback.
+class ArchiveReader {
+ public:
+  ArchiveReader(FILE* file,
+                int64 size,
+                const PackageExtractor::DataCallback& data_callback,
+                const PackageExtractor::ProgressCallback& progress_callback)
+      : file_(file),
+        size_(size),
+        position_(0),
+        buffer_(kReadBufferSize),
+        begin_(0),
+        end_(0),
+        data_callback_(data_callback),
+        progress_callback_(progress_callback) {
+  }
+
+  bool Read(void* output, size_t size) {
+    char* out = static_cast<char*>(output);
+    while (size) {
+      if (begin_ == end_ && !Fill())
+        return false;
+      size_t length = std::min(size, end_ - begin_);
+      memcpy(out, &buffer_[begin_], length);
+      begin_ += length;
+      out += length;
+      size -= length;
+    }
+    return true;
+  }
+
+  // Reads |size| bytes into |writer| without copying them.
+  bool ReadInto(EntryWriter* writer, size_t size) {
+    while (size) {
+      if (begin_ == end_ && !Fill())
+        return false;
+      size_t length = std::min(size, end_ - begin_);
+      if (!writer->Write(&buffer_[begin_], length))
+        return false;
+      begin_ += length;
+      size -= length;
+    }
+    return true;
+  }
+
+  bool Skip(size_t size) {
+    while (size) {
+      if (begin_ == end_ && !Fill())
+        return false;
+      size_t length = std::min(size, end_ - begin_);
+      begin_ += length;
+      size -= length;
+    }
+    return true;
+  }
+
+  // Reads what's left, like the central directory, so the data callback
+  // sees the whole archive.
+  bool ReadToEnd() {
+    begin_ = end_;
+    while (position_ < size_) {
+      if (!Fill())
+        return false;
+      begin_ = end_;
+    }
+    return true;
+  }
+
+ private:
+  bool Fill() {
+    size_t length = static_cast<size_t>(
+        std::min(static_cast<int64>(buffer_.size()), size_ - position_));
+    if (!length)
+      return false;
+    length = fread(&buffer_[0], 1, length, file_);
+    if (!length)
+      return false;
+
+    position_ += length;
+    begin_ = 0;
+    end_ = length;
+    if (!data_callback_.is_null())
+      data_callback_.Run(&buffer_[0], length);
+    if (!progress_callback_.is_null())
+      progress_callback_.Run(position_, size_);
+    return true;
+  }
+
+  FILE* file_;
+  const int64 size_;
+  int64 position_;
+  std::vector<char> buffer_;
+  size_t begin_;
+  size_t end_;
+  const PackageExtractor::DataCallback& data_callback_;
+  const PackageExtractor::ProgressCallback& progress_callback_;
+
+  DISALLOW_COPY_AND_ASSIGN(ArchiveReader);
+};
+
+PackageExtractor::Result ExtractEntries(
+    ArchiveReader* reader,
+    const base::FilePath& target_dir,
+    const PackageExtractor::EntryFilter& entry_filter,
+    PendingWrites* writes) {
+  for (;;) {
+    uint8 header[kLocalFileHeaderSize];
+    if (!reader->Read(header, sizeof(uint32)))
+      return PackageExtractor::FAILED;
+
+    uint32 signature = ReadUInt32(header);
+    if (signature == kCentralDirectorySignature ||
+        signature == kEndOfCentralDirectorySignature)
+      return PackageExtractor::SUCCEEDED;
+    if (signature != kLocalFileHeaderSignature)
+      return PackageExtractor::UNSUPPORTED;
+
+    if (!reader->Read(header + sizeof(uint32),
+                      kLocalFileHeaderSize - sizeof(uint32)))
+      return PackageExtractor::FAILED;
+
+    uint16 flags = ReadUInt16(header + 6);
+    EntryInfo entry;
+    entry.method = ReadUInt16(header + 8);
+    entry.crc = ReadUInt32(header + 14);
+    entry.compressed_size = ReadUInt32(header + 18);
+    entry.uncompressed_size = ReadUInt32(header + 22);
+    uint16 name_length = ReadUInt16(header + 26);
+    uint16 extra_length = ReadUInt16(header + 28);
+
+    if ((flags & (kEncryptedFlag | kDataDescriptorFlag)) ||
+        (entry.method != kStoredMethod && entry.method != kDeflatedMethod) ||
+        entry.compressed_size == kZip64Size ||
+        entry.uncompressed_size == kZip64Size)
+      return PackageExtractor::UNSUPPORTED;
+
+    std::string name(name_length, '\0');
+    if (!name_length || !reader->Read(&name[0], name_length) ||
+        !reader->Skip(extra_length))
+      return PackageExtractor::FAILED;
+
+    base::FilePath relative_path = base::FilePath::FromUTF8Unsafe(name);
+    if (relative_path.IsAbsolute() || relative_path.ReferencesParent()) {
+      LOG(ERROR) << "Invalid entry in package: " << name;
+      return PackageExtractor::FAILED;
+    }
+    entry.path = target_dir.Append(relative_path);
+
+    if (!entry_filter.is_null() && !entry_filter.Run(relative_path)) {
+      if (!reader->Skip(entry.compressed_size))
+        return PackageExtractor::FAILED;
+      continue;
+    }
+
+    if (name[name.size() - 1] == '/') {
+      if (!reader->Skip(entry.compressed_size) ||
+          !file_util::CreateDirectory(entry.path))
+        return PackageExtractor::FAILED;
+      continue;
+    }
+
+    // Directories are created here, in archive order, so the writes don't
+    // race on them.
+    if (!file_util::CreateDirectory(entry.path.DirName()))
+      return PackageExtractor::FAILED;
+
+    if (entry.compressed_size > kMaxBufferedEntrySize) {
+      EntryWriter writer;
+      if (!writer.Open(entry.path, entry.method) ||
+          !reader->ReadInto(&writer, entry.compressed_size) ||
+          !writer.Close(entry.crc, entry.uncompressed_size)) {
+        LOG(ERROR) << "Can't extract " << entry.path.value();
+        return PackageExtractor::FAILED;
+      }
+      continue;
+    }
+
+    scoped_ptr<std::string> data(new std::string(entry.compressed_size, 0));
+    if (entry.compressed_size &&
+        !reader->Read(&(*data)[0], entry.compressed_size))
+      return PackageExtractor::FAILED;
+
+    if (writes->failed())
+      return PackageExtractor::FAILED;
+    writes->Add(entry.compressed_size);
+    if (!base::WorkerPool::PostTask(
+            FROM_HERE,
+            base::Bind(&WriteEntry, make_scoped_refptr(writes), entry,
+                       base::Passed(&data)),
+            false)) {
+      writes->Done(entry.compressed_size, false);
+      return PackageExtractor::FAILED;
+    }
+  }
+}
+
+}  // namespace
+
+PackageExtractor::PackageExtractor(FILE* file, int64 offset, int64 size)
+    : file_(file),
+      offset_(offset),
+      size_(size) {
+}
+
+PackageExtractor::~PackageExtractor() {
+}
+
+PackageExtractor::Result PackageExtractor::ExtractTo(
+    const base::FilePath& target_dir) {
+  if (!file_ || fseek(file_, offset_, SEEK_SET))
+    return FAILED;
+
+  ArchiveReader reader(file_, size_, data_callback_, progress_callback_);
+  scoped_refptr<PendingWrites> writes(
+      new PendingWrites(base::SysInfo::NumberOfProcessors()));
+  Result result = ExtractEntries(&reader, target_dir, entry_filter_,
+                                 writes.get());
+
+  // The writes already posted are waited for even on failure, so nothing
+  // touches |target_dir| once this returns.
+  if (!writes->WaitForAll() && result == SUCCEEDED)
+    result = FAILED;
+  if (result == SUCCEEDED && !reader.ReadToEnd())
+    result = FAILED;
+  return result;
+}
+
+}  // namespace application
+}  // namespace xwalk
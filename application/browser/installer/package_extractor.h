@@ -0,0 +1,75 @@
+// Copyright (c) 2013 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef XWALK_APPLICATION_BROWSER_INSTALLER_PACKAGE_EXTRACTOR_H_
+#define XWALK_APPLICATION_BROWSER_INSTALLER_PACKAGE_EXTRACTOR_H_
+
+#include <stdio.h>
+
+#include "base/basictypes.h"
+#include "base/callback.h"
+#include "base/files/file_path.h"
+
+namespace xwalk {
+namespace application {
+
+// Extracts the zip archive stored in a package reading it only once, from
+// start to end. Every byte read is also handed to the data callback, so the
+// signature of the package can be checked in the same pass.
+//
+// The entries are found through their local headers, in archive order, and
+// written by the worker pool while the following ones are read. Entries too
+// big to be buffered are inflated directly while being read.
+class PackageExtractor {
+ public:
+  typedef base::Callback<void(const char* data, size_t size)> DataCallback;
+  typedef base::Callback<void(int64 bytes_read, int64 total_bytes)>
+      ProgressCallback;
+  // Returns whether to extract the file at |relative_path| in the archive.
+  typedef base::Callback<bool(const base::FilePath& relative_path)>
+      EntryFilter;
+
+  enum Result {
+    SUCCEEDED,
+    FAILED,
+    // The archive uses features only found through its central directory,
+    // like data descriptors, and must be extracted by other means. The data
+    // callback may have seen only part of the archive then.
+    UNSUPPORTED,
+  };
+
+  // The archive is the |size| bytes of |file| starting at |offset|.
+  PackageExtractor(FILE* file, int64 offset, int64 size);
+  ~PackageExtractor();
+
+  void set_data_callback(const DataCallback& callback) {
+    data_callback_ = callback;
+  }
+  void set_progress_callback(const ProgressCallback& callback) {
+    progress_callback_ = callback;
+  }
+  // All the files are extracted if there's no filter.
+  void set_entry_filter(const EntryFilter& filter) {
+    entry_filter_ = filter;
+  }
+
+  // Extracts the archive into |target_dir|, that must exist. All the entries
+  // have been written, or given up, when it returns.
+  Result ExtractTo(const base::FilePath& target_dir);
+
+ private:
+  FILE* file_;
+  int64 offset_;
+  int64 size_;
+  DataCallback data_callback_;
+  ProgressCallback progress_callback_;
+  EntryFilter entry_filter_;
+
+  DISALLOW_COPY_AND_ASSIGN(PackageExtractor);
+};
+
+}  // namespace application
+}  // namespace xwalk
+
+#endif  // XWALK_APPLICATION_BROWSER_INSTALLER_PACKAGE_EXTRACTOR_H_
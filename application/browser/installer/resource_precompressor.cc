@@ -0,0 +1,140 @@
+// Copyright (c) 2013 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "xwalk/application/browser/installer/resource_precompressor.h"
+
+#include <string.h>
+
+#include <vector>
+
+#include "base/file_util.h"
+#include "base/files/file_enumerator.h"
+#include "base/logging.h"
+#include "base/strings/string_split.h"
+#include "base/strings/string_util.h"
+#include "third_party/zlib/zlib.h"
+#include "xwalk/application/common/constants.h"
+
+namespace xwalk {
+namespace application {
+
+namespace {
+
+// Smaller resources are read in a single disk access anyway.
+const int64 kMinResourceSize = 4 * 1024;
+
+// Above this the resource is more likely a data file than something loaded
+// when the application starts, and reading it whole costs too much memory.
+const int64 kMaxResourceSize = 32 * 1024 * 1024;
+
+// The compressed copy must save at least this fraction of the resource, or
+// it's not worth inflating it.
+const int kMinSavingPercent = 20;
+
+const char* const kTextExtensions[] = {
+  ".css", ".htm", ".html", ".js", ".json", ".svg", ".txt", ".xml",
+};
+
+bool IsTextResource(const base::FilePath& path) {
+  std::string extension = StringToLowerASCII(path.Extension());
+  for (size_t i = 0; i < arraysize(kTextExtensions); ++i) {
+    if (extension == kTextExtensions[i])
+      return true;
+  }
+  return false;
+}
+
+}  // namespace
+
+bool GzipCompress(const std::string& data, std::string* compressed) {
+  z_stream stream;
+  memset(&stream, 0, sizeof(stream));
+  // The window bits are offset by 16 for a gzip header and trailer.
+  if (deflateInit2(&stream, Z_BEST_COMPRESSION, Z_DEFLATED, MAX_WBITS + 16,
+                   8, Z_DEFAULT_STRATEGY) != Z_OK)
+    return false;
+
+  compressed->resize(deflateBound(&stream, data.size()));
+  stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+  stream.avail_in = data.size();
+  stream.next_out = reinterpret_cast<Bytef*>(&(*compressed)[0]);
+  stream.avail_out = compressed->size();
+  int result = deflate(&stream, Z_FINISH);
+  compressed->resize(stream.total_out);
+  deflateEnd(&stream);
+  return result == Z_STREAM_END;
+}
+
+int PrecompressResources(const base::FilePath& application_dir) {
+  int count = 0;
+  // One relative path per line.
+  std::string list;
+  base::FileEnumerator files(application_dir, true,
+                             base::FileEnumerator::FILES);
+  for (base::FilePath path = files.Next(); !path.empty();
+       path = files.Next()) {
+    int64 size = files.GetInfo().GetSize();
+    if (size < kMinResourceSize || size > kMaxResourceSize ||
+        !IsTextResource(path))
+      continue;
+
+    const base::FilePath compressed_path =
+        path.AddExtension(kGzipResourceExtension);
+    if (base::PathExists(compressed_path))
+      continue;
+
+    std::string data;
+    std::string compressed;
+    if (!base::ReadFileToString(path, &data) ||
+        !GzipCompress(data, &compressed)) {
+      LOG(WARNING) << "Can't compress " << path.AsUTF8Unsafe();
+      continue;
+    }
+    if (compressed.size() * 100 > data.size() * (100 - kMinSavingPercent))
+      continue;
+
+    if (file_util::WriteFile(compressed_path, compressed.data(),
+                             compressed.size()) !=
+        static_cast<int>(compressed.size())) {
+      LOG(WARNING) << "Can't write " << compressed_path.AsUTF8Unsafe();
+      base::DeleteFile(compressed_path, false);
+      continue;
+    }
+
+    base::FilePath relative_path;
+    application_dir.AppendRelativePath(path, &relative_path);
+    list += relative_path.AsUTF8Unsafe() + "\n";
+    ++count;
+  }
+
+  // The copies aren't used without the list.
+  const base::FilePath list_path =
+      application_dir.Append(kPrecompressedResourcesFilename);
+  if (count && file_util::WriteFile(list_path, list.data(), list.size()) !=
+      static_cast<int>(list.size())) {
+    LOG(WARNING) << "Can't write " << list_path.AsUTF8Unsafe();
+    base::DeleteFile(list_path, false);
+    return 0;
+  }
+  return count;
+}
+
+bool ReadPrecompressedResources(const base::FilePath& application_dir,
+                                std::set<base::FilePath>* relative_paths) {
+  std::string list;
+  if (!base::ReadFileToString(
+          application_dir.Append(kPrecompressedResourcesFilename), &list))
+    return false;
+
+  std::vector<std::string> lines;
+  base::SplitString(list, '\n', &lines);
+  for (size_t i = 0; i < lines.size(); ++i) {
+    if (!lines[i].empty())
+      relative_paths->insert(base::FilePath::FromUTF8Unsafe(lines[i]));
+  }
+  return !relative_paths->empty();
+}
+
+}  // namespace application
+}  // namespace xwalk
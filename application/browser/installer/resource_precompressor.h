@@ -0,0 +1,40 @@
+// Copyright (c) 2013 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef XWALK_APPLICATION_BROWSER_INSTALLER_RESOURCE_PRECOMPRESSOR_H_
+#define XWALK_APPLICATION_BROWSER_INSTALLER_RESOURCE_PRECOMPRESSOR_H_
+
+#include <set>
+#include <string>
+
+#include "base/files/file_path.h"
+
+namespace xwalk {
+namespace application {
+
+// Writes a gzip compressed copy next to the text resources of the application
+// installed in |application_dir| that are big enough to gain from it, named
+// after them with kGzipResourceExtension appended, and lists them in the
+// kPrecompressedResourcesFilename file. The app:// protocol reads the listed
+// copies instead of the resources, which is faster where I/O is slow.
+//
+// Resources that don't compress well are left alone, as are those which
+// already have a compressed copy shipped in their package: the shipped copies
+// aren't listed, so they're never served in place of the resources. Returns
+// the number of copies written. Does blocking I/O.
+int PrecompressResources(const base::FilePath& application_dir);
+
+// Reads the resources of the application in |application_dir| whose copy was
+// written by PrecompressResources(), as paths relative to |application_dir|.
+// Returns false if there are none. Does blocking I/O.
+bool ReadPrecompressedResources(const base::FilePath& application_dir,
+                                std::set<base::FilePath>* relative_paths);
+
+// Compresses |data| in the gzip format.
+bool GzipCompress(const std::string& data, std::string* compressed);
+
+}  // namespace application
+}  // namespace xwalk
+
+#endif  // XWALK_APPLICATION_BROWSER_INSTALLER_RESOURCE_PRECOMPRESSOR_H_
@@ -0,0 +1,120 @@
+// Copyright (c) 2013 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "xwalk/application/browser/installer/resource_precompressor.h"
+
+#include <string.h>
+#include <set>
+#include <string>
+
+#include "base/file_util.h"
+#include "base/files/scoped_temp_dir.h"
+#include "base/rand_util.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "third_party/zlib/zlib.h"
+
+namespace xwalk {
+namespace application {
+
+namespace {
+
+std::string GzipUncompress(const std::string& data) {
+  z_stream stream;
+  memset(&stream, 0, sizeof(stream));
+  EXPECT_EQ(Z_OK, inflateInit2(&stream, MAX_WBITS + 16));
+  stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+  stream.avail_in = data.size();
+
+  std::string uncompressed;
+  char buffer[4096];
+  int result;
+  do {
+    stream.next_out = reinterpret_cast<Bytef*>(buffer);
+    stream.avail_out = sizeof(buffer);
+    result = inflate(&stream, Z_NO_FLUSH);
+    uncompressed.append(buffer, sizeof(buffer) - stream.avail_out);
+  } while (result == Z_OK);
+  EXPECT_EQ(Z_STREAM_END, result);
+  inflateEnd(&stream);
+  return uncompressed;
+}
+
+}  // namespace
+
+class ResourcePrecompressorTest : public testing::Test {
+ public:
+  virtual void SetUp() OVERRIDE {
+    ASSERT_TRUE(temp_dir_.CreateUniqueTempDir());
+    ASSERT_TRUE(file_util::CreateDirectory(temp_dir_.path().AppendASCII("js")));
+  }
+
+  base::FilePath WriteFile(const std::string& relative_path,
+                           const std::string& data) {
+    base::FilePath path =
+        temp_dir_.path().AppendASCII(relative_path);
+    EXPECT_EQ(static_cast<int>(data.size()),
+              file_util::WriteFile(path, data.data(), data.size()));
+    return path;
+  }
+
+  std::string ReadFile(const base::FilePath& path) {
+    std::string data;
+    EXPECT_TRUE(base::ReadFileToString(path, &data));
+    return data;
+  }
+
+ protected:
+  base::ScopedTempDir temp_dir_;
+};
+
+TEST_F(ResourcePrecompressorTest, CompressTextResources) {
+  std::string script;
+  for (int i = 0; i < 2000; ++i)
+    script += "function f" + std::string(1, 'a' + i % 26) + "() {}\n";
+  base::FilePath script_path = WriteFile("js/bundle.js", script);
+  base::FilePath small_path = WriteFile("index.html", "<html></html>");
+  base::FilePath image_path =
+      WriteFile("image.png", std::string(100000, 'x'));
+  base::FilePath random_path =
+      WriteFile("data.json", base::RandBytesAsString(100000));
+
+  EXPECT_EQ(1, PrecompressResources(temp_dir_.path()));
+
+  base::FilePath compressed_path =
+      script_path.AddExtension(FILE_PATH_LITERAL(".gz"));
+  std::string compressed = ReadFile(compressed_path);
+  EXPECT_LT(compressed.size(), script.size() / 3);
+  EXPECT_EQ(script, GzipUncompress(compressed));
+
+  // Too small, not text, or not compressible.
+  EXPECT_FALSE(base::PathExists(
+      small_path.AddExtension(FILE_PATH_LITERAL(".gz"))));
+  EXPECT_FALSE(base::PathExists(
+      image_path.AddExtension(FILE_PATH_LITERAL(".gz"))));
+  EXPECT_FALSE(base::PathExists(
+      random_path.AddExtension(FILE_PATH_LITERAL(".gz"))));
+
+  std::set<base::FilePath> precompressed;
+  ASSERT_TRUE(ReadPrecompressedResources(temp_dir_.path(), &precompressed));
+  ASSERT_EQ(1u, precompressed.size());
+  EXPECT_EQ(base::FilePath(FILE_PATH_LITERAL("js")).AppendASCII("bundle.js"),
+            *precompressed.begin());
+}
+
+TEST_F(ResourcePrecompressorTest, KeepShippedCopies) {
+  WriteFile("main.css", std::string(100000, 'a'));
+  std::string shipped;
+  ASSERT_TRUE(GzipCompress(std::string(100000, 'a'), &shipped));
+  base::FilePath shipped_path = WriteFile("main.css.gz", shipped);
+
+  EXPECT_EQ(0, PrecompressResources(temp_dir_.path()));
+  EXPECT_EQ(shipped, ReadFile(shipped_path));
+
+  // Not written by the installer, so never served.
+  std::set<base::FilePath> precompressed;
+  EXPECT_FALSE(ReadPrecompressedResources(temp_dir_.path(), &precompressed));
+}
+
+}  // namespace application
+}  // namespace xwalk
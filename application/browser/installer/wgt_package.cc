@@ -21,6 +21,7 @@ WGTPackage::WGTPackage(const base::FilePath& path)
         new ScopedStdioHandle(file_util::OpenFile(path, "rb")));
 
   file_ = file.Pass();
+  is_valid_ = file_->get() != NULL;
 }
 
 }  // namespace application
@@ -5,7 +5,6 @@
 #include "xwalk/application/browser/installer/xpk_package.h"
 
 #include "base/file_util.h"
-#include "crypto/signature_verifier.h"
 #include "xwalk/application/common/id_util.h"
 
 namespace xwalk {
@@ -40,7 +39,7 @@ XPKPackage::XPKPackage(const base::FilePath& path)
       header_.signature_size > 0 &&
       header_.signature_size <= XPKPackage::kMaxSignatureKeySize) {
       is_valid_ = true;
-      zip_addr_ = sizeof(header_) + header_.key_size + header_.signature_size;
+      zip_offset_ = sizeof(header_) + header_.key_size + header_.signature_size;
         fseek(file_->get(), sizeof(header_), SEEK_SET);
         key_.resize(header_.key_size);
         size_t len = fread(
@@ -56,9 +55,6 @@ XPKPackage::XPKPackage(const base::FilePath& path)
         if (len < header_.signature_size)
           is_valid_ = false;
 
-        if (!VerifySignature())
-          is_valid_ = false;
-
         std::string public_key =
             std::string(reinterpret_cast<char*>(&key_.front()), key_.size());
         id_ = GenerateId(public_key);
@@ -66,26 +62,23 @@ XPKPackage::XPKPackage(const base::FilePath& path)
   return;
 }
 
-bool XPKPackage::VerifySignature() {
-// Set the file read position to the beginning of compressed resource file,
-// which is behind the magic header, public key and signature key.
-  fseek(file_->get(), zip_addr_, SEEK_SET);
-  crypto::SignatureVerifier verifier;
-  if (!verifier.VerifyInit(kSignatureAlgorithm,
-                           sizeof(kSignatureAlgorithm),
-                           &signature_.front(),
-                           signature_.size(),
-                           &key_.front(),
-                           key_.size()))
-    return false;
-  unsigned char buf[1 << 12];
-  size_t len = 0;
-  while ((len = fread(buf, 1, sizeof(buf), file_->get())) > 0)
-    verifier.VerifyUpdate(buf, len);
-  if (!verifier.VerifyFinal())
-    return false;
+bool XPKPackage::BeginVerification() {
+  verifier_.reset(new crypto::SignatureVerifier);
+  return verifier_->VerifyInit(kSignatureAlgorithm,
+                               sizeof(kSignatureAlgorithm),
+                               &signature_.front(),
+                               signature_.size(),
+                               &key_.front(),
+                               key_.size());
+}
+
+void XPKPackage::UpdateVerification(const char* data, size_t size) {
+  verifier_->VerifyUpdate(reinterpret_cast<const uint8*>(data), size);
+}
 
-  return true;
+bool XPKPackage::FinishVerification() {
+  scoped_ptr<crypto::SignatureVerifier> verifier(verifier_.Pass());
+  return verifier->VerifyFinal();
 }
 
 }  // namespace application
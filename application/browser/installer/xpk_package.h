@@ -11,6 +11,7 @@
 #include "base/files/file_path.h"
 #include "base/memory/scoped_handle.h"
 #include "base/memory/scoped_ptr.h"
+#include "crypto/signature_verifier.h"
 #include "xwalk/application/browser/installer/package.h"
 
 namespace xwalk {
@@ -31,15 +32,17 @@ class XPKPackage : public Package {
   virtual ~XPKPackage();
   explicit XPKPackage(const base::FilePath& path);
 
- private:
-  // verify the signature in the xpk package
-  virtual bool VerifySignature();
+ protected:
+  // The signature of the xpk package is verified while it's extracted.
+  virtual bool BeginVerification() OVERRIDE;
+  virtual void UpdateVerification(const char* data, size_t size) OVERRIDE;
+  virtual bool FinishVerification() OVERRIDE;
 
+ private:
   Header header_;
   std::vector<uint8> signature_;
   std::vector<uint8> key_;
-  // It's the beginning address of the zip file
-  int zip_addr_;
+  scoped_ptr<crypto::SignatureVerifier> verifier_;
 };
 
 }  // namespace application
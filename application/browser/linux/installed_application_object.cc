@@ -6,7 +6,6 @@
 
 #include "dbus/bus.h"
 #include "dbus/message.h"
-#include "xwalk/application/common/application_data.h"
 
 namespace xwalk {
 namespace application {
@@ -32,14 +31,15 @@ const char kInstalledApplicationDBusError[] =
 
 InstalledApplicationObject::InstalledApplicationObject(
     scoped_refptr<dbus::Bus> bus, const dbus::ObjectPath& path,
-    const ApplicationData* app)
+    const std::string& app_id, const std::string& name)
     : dbus::ManagedObject(bus, path),
-      app_id_(app->ID()) {
-  scoped_ptr<base::Value> app_id(base::Value::CreateStringValue(app->ID()));
-  properties()->Set(kInstalledApplicationDBusInterface, "AppID", app_id.Pass());
-
-  scoped_ptr<base::Value> name(base::Value::CreateStringValue(app->Name()));
-  properties()->Set(kInstalledApplicationDBusInterface, "Name", name.Pass());
+      app_id_(app_id) {
+  properties()->Set(kInstalledApplicationDBusInterface, "AppID",
+                    scoped_ptr<base::Value>(
+                        base::Value::CreateStringValue(app_id)));
+  properties()->Set(kInstalledApplicationDBusInterface, "Name",
+                    scoped_ptr<base::Value>(
+                        base::Value::CreateStringValue(name)));
 }
 
 void InstalledApplicationObject::ExportUninstallMethod(
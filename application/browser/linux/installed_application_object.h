@@ -12,8 +12,6 @@
 namespace xwalk {
 namespace application {
 
-class ApplicationData;
-
 extern const char kInstalledApplicationDBusInterface[];
 extern const char kInstalledApplicationDBusError[];
 
@@ -24,7 +22,7 @@ class InstalledApplicationObject : public dbus::ManagedObject {
  public:
   InstalledApplicationObject(
       scoped_refptr<dbus::Bus> bus, const dbus::ObjectPath& path,
-      const ApplicationData* app);
+      const std::string& app_id, const std::string& name);
 
   // Set the callback used when the Uninstall() method is called in an
   // ApplicationObject.
@@ -62,7 +62,11 @@ InstalledApplicationsManager::~InstalledApplicationsManager() {
 
 void InstalledApplicationsManager::OnApplicationInstalled(
     const std::string& app_id) {
-  AddObject(application_service_->GetApplicationByID(app_id));
+  const InstalledApplicationInfoMap& apps =
+      application_service_->GetInstalledApplications();
+  InstalledApplicationInfoMap::const_iterator it = apps.find(app_id);
+  if (it != apps.end())
+    AddObject(it->second);
 }
 
 void InstalledApplicationsManager::OnApplicationUninstalled(
@@ -71,18 +75,21 @@ void InstalledApplicationsManager::OnApplicationUninstalled(
 }
 
 void InstalledApplicationsManager::AddInitialObjects() {
-  const ApplicationData::ApplicationDataMap& apps =
+  // Only the list of the applications is needed, they aren't created. The
+  // adaptor isn't exported yet, so adding them emits no signal.
+  const InstalledApplicationInfoMap& apps =
       application_service_->GetInstalledApplications();
-  ApplicationData::ApplicationDataMap::const_iterator it;
+  InstalledApplicationInfoMap::const_iterator it;
   for (it = apps.begin(); it != apps.end(); ++it)
     AddObject(it->second);
 }
 
 void InstalledApplicationsManager::AddObject(
-    scoped_refptr<const ApplicationData> app) {
+    const InstalledApplicationInfo& info) {
   scoped_ptr<InstalledApplicationObject> object(
       new InstalledApplicationObject(
-          adaptor_.bus(), GetInstalledPathForAppID(app->ID()), app));
+          adaptor_.bus(), GetInstalledPathForAppID(info.id), info.id,
+          info.name));
 
   // See comment in InstalledApplicationsManager::OnUninstall().
   object->ExportUninstallMethod(
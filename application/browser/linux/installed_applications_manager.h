@@ -35,7 +35,7 @@ class InstalledApplicationsManager : public ApplicationService::Observer {
   void OnApplicationUninstalled(const std::string& app_id);
 
   void AddInitialObjects();
-  void AddObject(scoped_refptr<const ApplicationData> app);
+  void AddObject(const InstalledApplicationInfo& info);
 
   void OnInstall(
       dbus::MethodCall* method_call,
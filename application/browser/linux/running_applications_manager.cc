@@ -6,9 +6,10 @@
 
 #include <string>
 #include "base/bind.h"
+#include "base/message_loop/message_loop.h"
+#include "base/stl_util.h"
 #include "dbus/bus.h"
 #include "dbus/message.h"
-#include "xwalk/runtime/browser/runtime_registry.h"
 
 namespace {
 
@@ -17,7 +18,8 @@ namespace {
 // Methods:
 //
 //   Launch(string app_id) -> ObjectPath
-//     Launches the application with 'app_id'.
+//     Launches the application with 'app_id'. Returns the path of its object
+//     right away, the launch progress is reported by its State property.
 const char kRunningManagerDBusInterface[] =
     "org.crosswalkproject.Running.Manager1";
 
@@ -38,6 +40,12 @@ const dbus::ObjectPath kRunningManagerDBusPath("/running1");
 // Properties:
 //
 //   readonly string AppID
+//   readonly string State
+//     "Launching", "Loaded" once its document is loaded, "Visible" once its
+//     window is painted, or "Suspended" once its main document is closed.
+//     Changes are signaled by PropertiesChanged.
+//   readonly int32 TimeToVisible
+//     Milliseconds from Launch() to the "Visible" state. Set once visible.
 const char kRunningApplicationDBusInterface[] =
     "org.crosswalkproject.Running.Application1";
 
@@ -48,6 +56,13 @@ dbus::ObjectPath GetRunningPathForAppID(const std::string& app_id) {
   return dbus::ObjectPath(kRunningManagerDBusPath.value() + "/" + app_id);
 }
 
+const char* const kStateNames[] = {
+  "Launching",
+  "Loaded",
+  "Visible",
+  "Suspended",
+};
+
 }  // namespace
 
 namespace xwalk {
@@ -64,9 +79,55 @@ RunningApplicationsManager::RunningApplicationsManager(
                  weak_factory_.GetWeakPtr()),
       base::Bind(&RunningApplicationsManager::OnExported,
                  weak_factory_.GetWeakPtr()));
+  application_service_->AddObserver(this);
+}
+
+RunningApplicationsManager::~RunningApplicationsManager() {
+  application_service_->RemoveObserver(this);
+}
+
+void RunningApplicationsManager::OnApplicationLoaded(
+    const std::string& app_id) {
+  LaunchInfoMap::iterator it = launches_.find(app_id);
+  if (it != launches_.end() && it->second.state == STATE_LAUNCHING)
+    SetState(app_id, STATE_LOADED);
 }
 
-RunningApplicationsManager::~RunningApplicationsManager() {}
+void RunningApplicationsManager::OnApplicationVisible(
+    const std::string& app_id) {
+  LaunchInfoMap::iterator it = launches_.find(app_id);
+  if (it == launches_.end() || it->second.state == STATE_VISIBLE)
+    return;
+
+  dbus::ManagedObject* object =
+      adaptor_.GetManagedObject(GetRunningPathForAppID(app_id));
+  if (!it->second.launch_time.is_null()) {
+    const base::TimeDelta time_to_visible =
+        base::TimeTicks::Now() - it->second.launch_time;
+    it->second.launch_time = base::TimeTicks();
+    object->properties()->Set(
+        kRunningApplicationDBusInterface, "TimeToVisible",
+        scoped_ptr<base::Value>(base::Value::CreateIntegerValue(
+            static_cast<int>(time_to_visible.InMilliseconds()))));
+  }
+  SetState(app_id, STATE_VISIBLE);
+}
+
+void RunningApplicationsManager::OnApplicationSuspended(
+    const std::string& app_id) {
+  if (ContainsKey(launches_, app_id))
+    SetState(app_id, STATE_SUSPENDED);
+}
+
+void RunningApplicationsManager::OnApplicationTerminated(
+    const std::string& app_id) {
+  // The application may have been terminated by closing its windows, rather
+  // than from D-Bus.
+  launches_.erase(app_id);
+  const dbus::ObjectPath path = GetRunningPathForAppID(app_id);
+  if (adaptor_.GetManagedObject(path))
+    adaptor_.RemoveManagedObject(path);
+}
 
 namespace {
 
@@ -94,7 +155,8 @@ void RunningApplicationsManager::OnLaunch(
     return;
   }
 
-  if (!application_service_->Launch(app_id)) {
+  if (!ContainsKey(application_service_->GetInstalledApplications(),
+                   app_id)) {
     scoped_ptr<dbus::Response> response =
         CreateError(method_call,
                     "Error launching application with id " + app_id);
@@ -102,11 +164,16 @@ void RunningApplicationsManager::OnLaunch(
     return;
   }
 
-  // FIXME(cmarcelo): ApplicationService should tell us when new applications
-  // appear and we create new managed objects in D-Bus based on that. See
-  // InstalledApplicationManager for an example. We also have to store the
-  // response_sender associated with that app_id.
-  AddObject(app_id);
+  if (!adaptor_.GetManagedObject(GetRunningPathForAppID(app_id))) {
+    AddObject(app_id);
+    LaunchInfo& launch = launches_[app_id];
+    launch.state = STATE_LAUNCHING;
+    launch.launch_time = base::TimeTicks::Now();
+    base::MessageLoop::current()->PostTask(
+        FROM_HERE,
+        base::Bind(&RunningApplicationsManager::DoLaunch,
+                   weak_factory_.GetWeakPtr(), app_id));
+  }
 
   scoped_ptr<dbus::Response> response =
       dbus::Response::FromMethodCall(method_call);
@@ -115,15 +182,34 @@ void RunningApplicationsManager::OnLaunch(
   response_sender.Run(response.Pass());
 }
 
-void RunningApplicationsManager::OnTerminate(
-    dbus::ManagedObject* object, dbus::MethodCall* method_call,
-    dbus::ExportedObject::ResponseSender response_sender) {
+void RunningApplicationsManager::DoLaunch(const std::string& app_id) {
+  // Terminated before it was launched.
+  if (!ContainsKey(launches_, app_id))
+    return;
+
+  const bool was_running =
+      application_service_->GetRunningApplication(app_id) != NULL;
+  if (!application_service_->Launch(app_id)) {
+    LOG(ERROR) << "Error launching application with id " << app_id;
+    launches_.erase(app_id);
+    adaptor_.RemoveManagedObject(GetRunningPathForAppID(app_id));
+    return;
+  }
 
-  // FIXME(cmarcelo): While there's still no notion of Running Application yet,
-  // we'll simply close all the windows of the current one.
-  RuntimeRegistry::Get()->CloseAll();
+  // Already running from the command line or in the background, nothing
+  // more will be loaded.
+  if (was_running && launches_[app_id].state == STATE_LAUNCHING)
+    SetState(app_id, STATE_LOADED);
+}
 
-  adaptor_.RemoveManagedObject(object->path());
+void RunningApplicationsManager::OnTerminate(
+    const std::string& app_id, dbus::MethodCall* method_call,
+    dbus::ExportedObject::ResponseSender response_sender) {
+  // The object is removed once the application is terminated, see
+  // OnApplicationTerminated(). An application not launched yet is simply
+  // forgotten.
+  if (!application_service_->Terminate(app_id))
+    OnApplicationTerminated(app_id);
 
   scoped_ptr<dbus::Response> response =
       dbus::Response::FromMethodCall(method_call);
@@ -147,18 +233,33 @@ void RunningApplicationsManager::AddObject(const std::string& app_id) {
   object->dbus_object()->ExportMethod(
       kRunningApplicationDBusInterface, "Terminate",
       base::Bind(&RunningApplicationsManager::OnTerminate,
-                 weak_factory_.GetWeakPtr(),
-                 base::Unretained(object.get())),
+                 weak_factory_.GetWeakPtr(), app_id),
       base::Bind(&RunningApplicationsManager::OnExported,
                  weak_factory_.GetWeakPtr()));
 
   object->properties()->Set(
       kRunningApplicationDBusInterface, "AppID",
       scoped_ptr<base::Value>(base::Value::CreateStringValue(app_id)));
+  object->properties()->Set(
+      kRunningApplicationDBusInterface, "State",
+      scoped_ptr<base::Value>(
+          base::Value::CreateStringValue(kStateNames[STATE_LAUNCHING])));
   dbus::ObjectPath path = object->path();
   adaptor_.AddManagedObject(object.Pass());
 }
 
+void RunningApplicationsManager::SetState(const std::string& app_id,
+                                          State state) {
+  DCHECK(ContainsKey(launches_, app_id));
+  launches_[app_id].state = state;
+  dbus::ManagedObject* object =
+      adaptor_.GetManagedObject(GetRunningPathForAppID(app_id));
+  object->properties()->Set(
+      kRunningApplicationDBusInterface, "State",
+      scoped_ptr<base::Value>(base::Value::CreateStringValue(
+          kStateNames[state])));
+}
+
 }  // namespace application
 }  // namespace xwalk
 
@@ -5,10 +5,12 @@
 #ifndef XWALK_APPLICATION_BROWSER_LINUX_RUNNING_APPLICATIONS_MANAGER_H_
 #define XWALK_APPLICATION_BROWSER_LINUX_RUNNING_APPLICATIONS_MANAGER_H_
 
+#include <map>
 #include <string>
 #include "base/memory/ref_counted.h"
 #include "base/memory/scoped_vector.h"
 #include "base/memory/weak_ptr.h"
+#include "base/time/time.h"
 #include "xwalk/application/browser/application_service.h"
 #include "xwalk/dbus/object_manager_adaptor.h"
 
@@ -22,19 +24,40 @@ namespace application {
 // The exported object implements org.freedesktop.DBus.ObjectManager, and the
 // interface org.crosswalkproject.Installed.Manager1 (see .cc file for
 // description).
-class RunningApplicationsManager {
+class RunningApplicationsManager : public ApplicationService::Observer {
  public:
   RunningApplicationsManager(scoped_refptr<dbus::Bus> bus,
                              ApplicationService* service);
-  ~RunningApplicationsManager();
+  virtual ~RunningApplicationsManager();
 
  private:
+  // The states of a running application, exposed as its State property.
+  enum State {
+    STATE_LAUNCHING,
+    STATE_LOADED,
+    STATE_VISIBLE,
+    STATE_SUSPENDED,
+  };
+
+  struct LaunchInfo {
+    State state;
+    // When Launch() was called, until the application is visible.
+    base::TimeTicks launch_time;
+  };
+  typedef std::map<std::string, LaunchInfo> LaunchInfoMap;
+
+  // ApplicationService::Observer implementation.
+  virtual void OnApplicationLoaded(const std::string& app_id) OVERRIDE;
+  virtual void OnApplicationVisible(const std::string& app_id) OVERRIDE;
+  virtual void OnApplicationSuspended(const std::string& app_id) OVERRIDE;
+  virtual void OnApplicationTerminated(const std::string& app_id) OVERRIDE;
+
   // org.crosswalkproject.Running.Manager1 interface.
   void OnLaunch(dbus::MethodCall* method_call,
                 dbus::ExportedObject::ResponseSender response_sender);
 
   // org.crosswalkproject.Running.Application1 interface.
-  void OnTerminate(dbus::ManagedObject* object,
+  void OnTerminate(const std::string& app_id,
                    dbus::MethodCall* method_call,
                    dbus::ExportedObject::ResponseSender response_sender);
 
@@ -42,11 +65,17 @@ class RunningApplicationsManager {
                   const std::string& method_name,
                   bool success);
 
+  // Launches |app_id| after Launch() has replied, so that the launches
+  // requested together don't wait for each other.
+  void DoLaunch(const std::string& app_id);
+
   void AddObject(const std::string& app_id);
+  void SetState(const std::string& app_id, State state);
 
   base::WeakPtrFactory<RunningApplicationsManager> weak_factory_;
   ApplicationService* application_service_;
   dbus::ObjectManagerAdaptor adaptor_;
+  LaunchInfoMap launches_;
 };
 
 }  // namespace application
@@ -0,0 +1,144 @@
+// Copyright (c) 2013 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "xwalk/application/browser/renderer_pool.h"
+
+#include <algorithm>
+
+#include "base/auto_reset.h"
+#include "base/bind.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/message_loop/message_loop.h"
+#include "base/process/process_metrics.h"
+#include "content/public/browser/notification_service.h"
+#include "content/public/browser/notification_source.h"
+#include "content/public/browser/notification_types.h"
+#include "content/public/browser/render_process_host.h"
+#include "content/public/browser/site_instance.h"
+
+namespace xwalk {
+namespace application {
+
+namespace {
+
+// How long after a process is taken the pool is filled again.
+const int kRefillDelayMs = 2000;
+
+// The least memory a render process waiting in the pool is counted for: an
+// empty renderer with its extensions loaded uses about that much once it's
+// initialized, which takes a while after it's launched.
+const size_t kMinProcessMemory = 20 * 1024 * 1024;
+
+}  // namespace
+
+RendererPool::RendererPool(content::BrowserContext* browser_context,
+                           size_t size,
+                           size_t memory_budget)
+    : browser_context_(browser_context),
+      max_size_(size),
+      memory_budget_(memory_budget),
+      filling_(false),
+      weak_factory_(this) {
+  registrar_.Add(this, content::NOTIFICATION_RENDERER_PROCESS_CREATED,
+                 content::NotificationService::AllBrowserContextsAndSources());
+  registrar_.Add(this, content::NOTIFICATION_RENDERER_PROCESS_TERMINATED,
+                 content::NotificationService::AllBrowserContextsAndSources());
+  registrar_.Add(this, content::NOTIFICATION_RENDERER_PROCESS_CLOSED,
+                 content::NotificationService::AllBrowserContextsAndSources());
+}
+
+RendererPool::~RendererPool() {
+}
+
+void RendererPool::Fill() {
+  while (site_instances_.size() < max_size_ &&
+         GetMemoryUsage() < memory_budget_) {
+    scoped_refptr<content::SiteInstance> site_instance =
+        content::SiteInstance::Create(browser_context_);
+    {
+      base::AutoReset<bool> filling(&filling_, true);
+      if (!site_instance->GetProcess()->Init()) {
+        LOG(WARNING) << "Unable to start a render process ahead of time.";
+        return;
+      }
+    }
+    site_instances_.push_back(site_instance);
+  }
+}
+
+scoped_refptr<content::SiteInstance> RendererPool::Take() {
+  scoped_refptr<content::SiteInstance> site_instance;
+  if (site_instances_.empty())
+    return site_instance;
+
+  site_instance = site_instances_.front();
+  site_instances_.pop_front();
+  base::MessageLoop::current()->PostDelayedTask(
+      FROM_HERE,
+      base::Bind(&RendererPool::Fill, weak_factory_.GetWeakPtr()),
+      base::TimeDelta::FromMilliseconds(kRefillDelayMs));
+  return site_instance;
+}
+
+bool RendererPool::Contains(const content::RenderProcessHost* host) const {
+  if (filling_)
+    return true;
+  for (size_t i = 0; i < site_instances_.size(); ++i) {
+    if (site_instances_[i]->GetProcess() == host)
+      return true;
+  }
+  return false;
+}
+
+void RendererPool::Observe(int type,
+                           const content::NotificationSource& source,
+                           const content::NotificationDetails& details) {
+  content::RenderProcessHost* host =
+      content::Source<content::RenderProcessHost>(source).ptr();
+  // The memory a process uses is only known once it's launched.
+  if (type == content::NOTIFICATION_RENDERER_PROCESS_CREATED) {
+    if (Contains(host) && !filling_)
+      Trim();
+    return;
+  }
+
+  // Processes that died while waiting are replaced.
+  for (size_t i = 0; i < site_instances_.size(); ++i) {
+    if (site_instances_[i]->GetProcess() == host) {
+      site_instances_.erase(site_instances_.begin() + i);
+      base::MessageLoop::current()->PostDelayedTask(
+          FROM_HERE,
+          base::Bind(&RendererPool::Fill, weak_factory_.GetWeakPtr()),
+          base::TimeDelta::FromMilliseconds(kRefillDelayMs));
+      return;
+    }
+  }
+}
+
+size_t RendererPool::GetMemoryUsage() const {
+  size_t usage = 0;
+  for (size_t i = 0; i < site_instances_.size(); ++i) {
+    base::ProcessHandle handle = site_instances_[i]->GetProcess()->GetHandle();
+    size_t process_usage = 0;
+    if (handle != base::kNullProcessHandle) {
+      scoped_ptr<base::ProcessMetrics> metrics(
+          base::ProcessMetrics::CreateProcessMetrics(handle));
+      process_usage = metrics->GetWorkingSetSize();
+    }
+    usage += std::max(process_usage, kMinProcessMemory);
+  }
+  return usage;
+}
+
+void RendererPool::Trim() {
+  while (site_instances_.size() > 1 && GetMemoryUsage() > memory_budget_) {
+    content::RenderProcessHost* host = site_instances_.back()->GetProcess();
+    site_instances_.pop_back();
+    // Nothing else uses the process.
+    host->Cleanup();
+  }
+}
+
+}  // namespace application
+}  // namespace xwalk
@@ -0,0 +1,81 @@
+// Copyright (c) 2013 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef XWALK_APPLICATION_BROWSER_RENDERER_POOL_H_
+#define XWALK_APPLICATION_BROWSER_RENDERER_POOL_H_
+
+#include <deque>
+
+#include "base/basictypes.h"
+#include "base/compiler_specific.h"
+#include "base/memory/ref_counted.h"
+#include "base/memory/weak_ptr.h"
+#include "content/public/browser/notification_observer.h"
+#include "content/public/browser/notification_registrar.h"
+
+namespace content {
+class BrowserContext;
+class RenderProcessHost;
+class SiteInstance;
+}
+
+namespace xwalk {
+namespace application {
+
+// Render processes started ahead of time, so that the applications launched
+// don't wait for a renderer and its extensions to start. Each process is
+// handed to a single application, in a site instance that isn't bound to any
+// site yet: the first URL loaded in it binds it to its application.
+class RendererPool : public content::NotificationObserver {
+ public:
+  // Keeps up to |size| processes, as long as they use less than
+  // |memory_budget| bytes together.
+  RendererPool(content::BrowserContext* browser_context,
+               size_t size,
+               size_t memory_budget);
+  virtual ~RendererPool();
+
+  // Starts processes until the pool is full.
+  void Fill();
+
+  // Returns a site instance whose process is started, or NULL if the pool is
+  // empty. The pool is filled again a bit later, not to slow down the
+  // application launched.
+  scoped_refptr<content::SiteInstance> Take();
+
+  // Returns true if |host| is a process of the pool not handed out yet.
+  bool Contains(const content::RenderProcessHost* host) const;
+
+  size_t size() const { return site_instances_.size(); }
+
+  // content::NotificationObserver implementation.
+  virtual void Observe(int type,
+                       const content::NotificationSource& source,
+                       const content::NotificationDetails& details) OVERRIDE;
+
+ private:
+  // The memory used by the processes of the pool, in bytes. Processes still
+  // starting count as much as a started one is expected to use.
+  size_t GetMemoryUsage() const;
+  // Stops the last processes started while the pool uses more than its
+  // budget, keeping at least one.
+  void Trim();
+
+  content::BrowserContext* browser_context_;
+  const size_t max_size_;
+  const size_t memory_budget_;
+  std::deque<scoped_refptr<content::SiteInstance> > site_instances_;
+  // Set while Fill() starts a process, which is told apart from the others
+  // before it's in |site_instances_|.
+  bool filling_;
+  content::NotificationRegistrar registrar_;
+  base::WeakPtrFactory<RendererPool> weak_factory_;
+
+  DISALLOW_COPY_AND_ASSIGN(RendererPool);
+};
+
+}  // namespace application
+}  // namespace xwalk
+
+#endif  // XWALK_APPLICATION_BROWSER_RENDERER_POOL_H_
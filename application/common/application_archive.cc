@@ -0,0 +1,299 @@
+// Copyright (c) 2013 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "xwalk/application/common/application_archive.h"
+
+#include <string.h>
+#include <algorithm>
+
+#include "base/file_util.h"
+#include "base/logging.h"
+#include "base/pickle.h"
+#include "base/platform_file.h"
+
+namespace xwalk {
+namespace application {
+
+namespace {
+
+const uint32 kLocalFileHeaderSignature = 0x04034b50;
+const uint32 kCentralDirectorySignature = 0x02014b50;
+const uint32 kEndOfCentralDirectorySignature = 0x06054b50;
+const size_t kLocalFileHeaderSize = 30;
+const size_t kCentralDirectoryHeaderSize = 46;
+const size_t kEndOfCentralDirectorySize = 22;
+// The end of central directory record is followed by a comment of at most
+// this size.
+const size_t kMaxCommentSize = 0xFFFF;
+
+const uint16 kEncryptedFlag = 1 << 0;
+const uint16 kStoredMethod = 0;
+const uint16 kDeflatedMethod = 8;
+const uint32 kZip64Size = 0xFFFFFFFF;
+
+// Bump when the format of the index changes.
+const int kIndexVersion = 1;
+
+uint16 ReadUInt16(const uint8* data) {
+  return data[0] | (data[1] << 8);
+}
+
+uint32 ReadUInt32(const uint8* data) {
+  return data[0] | (data[1] << 8) | (data[2] << 16) |
+      (static_cast<uint32>(data[3]) << 24);
+}
+
+std::string EntryName(const base::FilePath& relative_path) {
+  std::string name = relative_path.AsUTF8Unsafe();
+#if defined(FILE_PATH_USES_WIN_SEPARATORS)
+  std::replace(name.begin(), name.end(), '\\', '/');
+#endif
+  return name;
+}
+
+}  // namespace
+
+ApplicationArchive::EntryReader::EntryReader(ApplicationArchive* archive,
+                                             const Entry& entry)
+    : archive_(archive),
+      entry_(entry),
+      position_(0),
+      stream_initialized_(false),
+      stream_end_(false) {
+  if (entry_.compressed) {
+    memset(&stream_, 0, sizeof(stream_));
+    stream_.next_in = const_cast<Bytef*>(archive_->data() + entry_.offset);
+    stream_.avail_in = entry_.compressed_size;
+    // Zip entries hold raw deflate data, without zlib header.
+    stream_initialized_ = inflateInit2(&stream_, -MAX_WBITS) == Z_OK;
+  }
+}
+
+ApplicationArchive::EntryReader::~EntryReader() {
+  if (stream_initialized_)
+    inflateEnd(&stream_);
+}
+
+int ApplicationArchive::EntryReader::Read(char* buffer, int size) {
+  if (!entry_.compressed) {
+    size_t length = std::min(static_cast<size_t>(size),
+                             entry_.size - position_);
+    memcpy(buffer, archive_->data() + entry_.offset + position_, length);
+    position_ += length;
+    return length;
+  }
+
+  if (!stream_initialized_)
+    return -1;
+  if (stream_end_ || !size)
+    return 0;
+
+  stream_.next_out = reinterpret_cast<Bytef*>(buffer);
+  stream_.avail_out = size;
+  int result = inflate(&stream_, Z_NO_FLUSH);
+  if (result == Z_STREAM_END)
+    stream_end_ = true;
+  else if (result != Z_OK)
+    return -1;
+
+  int length = size - stream_.avail_out;
+  position_ += length;
+  if (position_ > entry_.size || (stream_end_ && position_ != entry_.size))
+    return -1;
+  return length;
+}
+
+bool ApplicationArchive::EntryReader::Skip(size_t size) {
+  if (size > entry_.size - position_)
+    return false;
+  if (!entry_.compressed) {
+    position_ += size;
+    return true;
+  }
+
+  char buffer[4096];
+  while (size) {
+    int length = Read(buffer, std::min(size, sizeof(buffer)));
+    if (length <= 0)
+      return false;
+    size -= length;
+  }
+  return true;
+}
+
+ApplicationArchive::ApplicationArchive() {
+}
+
+ApplicationArchive::~ApplicationArchive() {
+}
+
+// static
+scoped_refptr<ApplicationArchive> ApplicationArchive::Open(
+    const base::FilePath& archive_path,
+    const base::FilePath& index_path) {
+  scoped_refptr<ApplicationArchive> archive(new ApplicationArchive);
+  base::PlatformFileInfo info;
+  if (!file_util::GetFileInfo(archive_path, &info) ||
+      !archive->file_.Initialize(archive_path))
+    return NULL;
+  archive->last_modified_ = info.last_modified;
+
+  if (!archive->ReadIndex(index_path) && !archive->ReadCentralDirectory()) {
+    LOG(ERROR) << "Can't run the application from its archive: "
+               << archive_path.AsUTF8Unsafe();
+    return NULL;
+  }
+  return archive;
+}
+
+bool ApplicationArchive::WriteIndex(const base::FilePath& index_path) const {
+  Pickle pickle;
+  pickle.WriteInt(kIndexVersion);
+  pickle.WriteUInt64(length());
+  pickle.WriteUInt64(entries_.size());
+  for (EntryMap::const_iterator it = entries_.begin();
+       it != entries_.end(); ++it) {
+    pickle.WriteString(it->first);
+    pickle.WriteUInt64(it->second.offset);
+    pickle.WriteUInt32(it->second.compressed_size);
+    pickle.WriteUInt32(it->second.size);
+    pickle.WriteBool(it->second.compressed);
+  }
+
+  int size = pickle.size();
+  return file_util::WriteFile(index_path,
+      static_cast<const char*>(pickle.data()), size) == size;
+}
+
+const ApplicationArchive::Entry* ApplicationArchive::FindEntry(
+    const base::FilePath& relative_path) const {
+  EntryMap::const_iterator it = entries_.find(EntryName(relative_path));
+  return it == entries_.end() ? NULL : &it->second;
+}
+
+bool ApplicationArchive::ReadIndex(const base::FilePath& index_path) {
+  std::string contents;
+  if (!base::ReadFileToString(index_path, &contents))
+    return false;
+
+  Pickle pickle(contents.data(), contents.size());
+  PickleIterator iter(pickle);
+  int version;
+  uint64 archive_length;
+  uint64 count;
+  if (!pickle.ReadInt(&iter, &version) || version != kIndexVersion ||
+      !pickle.ReadUInt64(&iter, &archive_length) ||
+      archive_length != length() ||
+      !pickle.ReadUInt64(&iter, &count)) {
+    LOG(WARNING) << "Ignoring invalid application archive index: "
+                 << index_path.AsUTF8Unsafe();
+    return false;
+  }
+
+  for (uint64 i = 0; i < count; ++i) {
+    std::string name;
+    uint64 offset;
+    Entry entry;
+    if (!pickle.ReadString(&iter, &name) ||
+        !pickle.ReadUInt64(&iter, &offset) ||
+        !pickle.ReadUInt32(&iter, &entry.compressed_size) ||
+        !pickle.ReadUInt32(&iter, &entry.size) ||
+        !pickle.ReadBool(&iter, &entry.compressed)) {
+      entries_.clear();
+      return false;
+    }
+    entry.offset = offset;
+    if (!IsValidEntry(entry)) {
+      entries_.clear();
+      return false;
+    }
+    entries_[name] = entry;
+  }
+  return true;
+}
+
+bool ApplicationArchive::ReadCentralDirectory() {
+  if (length() < kEndOfCentralDirectorySize)
+    return false;
+
+  // The end of central directory record is looked for backwards, as it's
+  // followed by a comment.
+  const uint8* end = data() + length() - kEndOfCentralDirectorySize;
+  const uint8* lower_bound = data() + length() -
+      std::min(length(), kEndOfCentralDirectorySize + kMaxCommentSize);
+  const uint8* record = end;
+  while (ReadUInt32(record) != kEndOfCentralDirectorySignature) {
+    if (record == lower_bound)
+      return false;
+    --record;
+  }
+
+  uint16 count = ReadUInt16(record + 10);
+  size_t directory_size = ReadUInt32(record + 12);
+  size_t directory_offset = ReadUInt32(record + 16);
+  if (directory_size > static_cast<size_t>(record - data()))
+    return false;
+  // The archive may be preceded by other data, as XPK packages are.
+  const uint8* directory = record - directory_size;
+  if (directory_offset > static_cast<size_t>(directory - data()))
+    return false;
+  const uint8* archive = directory - directory_offset;
+
+  const uint8* header = directory;
+  for (uint16 i = 0; i < count; ++i) {
+    if (header + kCentralDirectoryHeaderSize > record ||
+        ReadUInt32(header) != kCentralDirectorySignature)
+      return false;
+
+    uint16 flags = ReadUInt16(header + 8);
+    uint16 method = ReadUInt16(header + 10);
+    Entry entry;
+    entry.compressed_size = ReadUInt32(header + 20);
+    entry.size = ReadUInt32(header + 24);
+    entry.compressed = method == kDeflatedMethod;
+    size_t name_length = ReadUInt16(header + 28);
+    size_t extra_length = ReadUInt16(header + 30);
+    size_t comment_length = ReadUInt16(header + 32);
+    size_t local_header_offset = ReadUInt32(header + 42);
+    const uint8* name = header + kCentralDirectoryHeaderSize;
+    header = name + name_length + extra_length + comment_length;
+    if (header > record)
+      return false;
+
+    if ((flags & kEncryptedFlag) ||
+        (method != kStoredMethod && method != kDeflatedMethod) ||
+        entry.compressed_size == kZip64Size || entry.size == kZip64Size ||
+        local_header_offset == kZip64Size)
+      return false;
+
+    // Directories are not served.
+    if (!name_length || name[name_length - 1] == '/')
+      continue;
+
+    // The data follows the local header, that may have a different extra
+    // field than the central directory one.
+    const uint8* local_header = archive + local_header_offset;
+    if (local_header + kLocalFileHeaderSize > directory ||
+        ReadUInt32(local_header) != kLocalFileHeaderSignature)
+      return false;
+    entry.offset = local_header - data() + kLocalFileHeaderSize +
+        ReadUInt16(local_header + 26) + ReadUInt16(local_header + 28);
+    if (!IsValidEntry(entry))
+      return false;
+
+    entries_[std::string(reinterpret_cast<const char*>(name), name_length)] =
+        entry;
+  }
+  return true;
+}
+
+bool ApplicationArchive::IsValidEntry(const Entry& entry) const {
+  if (entry.offset > length() ||
+      entry.compressed_size > length() - entry.offset)
+    return false;
+  return entry.compressed || entry.compressed_size == entry.size;
+}
+
+}  // namespace application
+}  // namespace xwalk
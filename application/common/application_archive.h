@@ -0,0 +1,112 @@
+// Copyright (c) 2013 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef XWALK_APPLICATION_COMMON_APPLICATION_ARCHIVE_H_
+#define XWALK_APPLICATION_COMMON_APPLICATION_ARCHIVE_H_
+
+#include <string>
+
+#include "base/basictypes.h"
+#include "base/containers/hash_tables.h"
+#include "base/files/file_path.h"
+#include "base/files/memory_mapped_file.h"
+#include "base/memory/ref_counted.h"
+#include "base/time/time.h"
+#include "third_party/zlib/zlib.h"
+
+namespace xwalk {
+namespace application {
+
+// The zip archive of an application installed without being extracted. The
+// archive is memory mapped and its resources are read from it directly, or
+// inflated while being read when they are compressed.
+//
+// The entries are looked up in an index, written next to the archive when
+// the application is installed so that it's not rebuilt from the central
+// directory each time the application runs.
+//
+// It's immutable once opened, so it can be shared between threads.
+class ApplicationArchive
+    : public base::RefCountedThreadSafe<ApplicationArchive> {
+ public:
+  struct Entry {
+    // Where the data of the entry starts in the archive.
+    size_t offset;
+    uint32 compressed_size;
+    uint32 size;
+    bool compressed;
+  };
+
+  // Reads an entry from the start, inflating it if needed.
+  class EntryReader {
+   public:
+    EntryReader(ApplicationArchive* archive, const Entry& entry);
+    ~EntryReader();
+
+    // Copies the next bytes of the entry into |buffer| and returns how many,
+    // 0 once the whole entry has been read or -1 if it's corrupted.
+    int Read(char* buffer, int size);
+
+    // Moves past the next |size| bytes of the entry, for reading a range of
+    // it. Compressed entries are inflated up to there. Returns false if the
+    // entry is shorter or corrupted.
+    bool Skip(size_t size);
+
+   private:
+    scoped_refptr<ApplicationArchive> archive_;
+    Entry entry_;
+    size_t position_;
+    z_stream stream_;
+    bool stream_initialized_;
+    bool stream_end_;
+
+    DISALLOW_COPY_AND_ASSIGN(EntryReader);
+  };
+
+  // Opens the archive at |archive_path|, looking its entries up in the index
+  // at |index_path| if it's there and matches the archive. Returns NULL if
+  // the archive can't be mapped or uses zip features that prevent reading
+  // its entries in place, like encryption. Does blocking I/O.
+  static scoped_refptr<ApplicationArchive> Open(
+      const base::FilePath& archive_path,
+      const base::FilePath& index_path);
+
+  // Writes the index used by Open(). Does blocking I/O.
+  bool WriteIndex(const base::FilePath& index_path) const;
+
+  // Returns NULL if there's no file at |relative_path| in the archive.
+  const Entry* FindEntry(const base::FilePath& relative_path) const;
+
+  size_t entry_count() const { return entries_.size(); }
+
+  // When the archive was written, that is when the application was
+  // installed.
+  base::Time last_modified() const { return last_modified_; }
+
+ private:
+  friend class base::RefCountedThreadSafe<ApplicationArchive>;
+  typedef base::hash_map<std::string, Entry> EntryMap;
+
+  ApplicationArchive();
+  ~ApplicationArchive();
+
+  bool ReadIndex(const base::FilePath& index_path);
+  bool ReadCentralDirectory();
+  bool IsValidEntry(const Entry& entry) const;
+
+  const uint8* data() const { return file_.data(); }
+  size_t length() const { return file_.length(); }
+
+  base::MemoryMappedFile file_;
+  base::Time last_modified_;
+  // Entries by their path in the archive, with '/' separators.
+  EntryMap entries_;
+
+  DISALLOW_COPY_AND_ASSIGN(ApplicationArchive);
+};
+
+}  // namespace application
+}  // namespace xwalk
+
+#endif  // XWALK_APPLICATION_COMMON_APPLICATION_ARCHIVE_H_
@@ -0,0 +1,147 @@
+// Copyright (c) 2013 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "xwalk/application/common/application_archive.h"
+
+#include <string>
+
+#include "base/file_util.h"
+#include "base/files/scoped_temp_dir.h"
+#include "base/rand_util.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "third_party/zlib/google/zip.h"
+
+namespace xwalk {
+namespace application {
+
+namespace {
+
+std::string ReadEntry(ApplicationArchive* archive,
+                      const ApplicationArchive::Entry& entry) {
+  ApplicationArchive::EntryReader reader(archive, entry);
+  std::string data;
+  char buffer[1000];
+  int length;
+  while ((length = reader.Read(buffer, sizeof(buffer))) > 0)
+    data.append(buffer, length);
+  EXPECT_EQ(0, length);
+  return data;
+}
+
+}  // namespace
+
+class ApplicationArchiveTest : public testing::Test {
+ public:
+  virtual void SetUp() OVERRIDE {
+    ASSERT_TRUE(temp_dir_.CreateUniqueTempDir());
+    base::FilePath content_dir = temp_dir_.path().AppendASCII("content");
+    ASSERT_TRUE(file_util::CreateDirectory(content_dir.AppendASCII("js")));
+
+    text_ = std::string(100000, 'a') + "end";
+    random_ = base::RandBytesAsString(50000);
+    WriteFile(content_dir.AppendASCII("index.html"), text_);
+    WriteFile(content_dir.AppendASCII("js").AppendASCII("random.js"),
+              random_);
+    WriteFile(content_dir.AppendASCII("empty.css"), std::string());
+
+    archive_path_ = temp_dir_.path().AppendASCII("archive");
+    index_path_ = temp_dir_.path().AppendASCII("index");
+    ASSERT_TRUE(zip::Zip(content_dir, archive_path_, true));
+  }
+
+  void WriteFile(const base::FilePath& path, const std::string& data) {
+    ASSERT_EQ(static_cast<int>(data.size()),
+              file_util::WriteFile(path, data.data(), data.size()));
+  }
+
+  void ExpectContent(ApplicationArchive* archive) {
+    EXPECT_EQ(3u, archive->entry_count());
+    const ApplicationArchive::Entry* entry =
+        archive->FindEntry(base::FilePath(FILE_PATH_LITERAL("index.html")));
+    ASSERT_TRUE(entry);
+    EXPECT_EQ(text_, ReadEntry(archive, *entry));
+
+    entry = archive->FindEntry(
+        base::FilePath(FILE_PATH_LITERAL("js")).AppendASCII("random.js"));
+    ASSERT_TRUE(entry);
+    EXPECT_EQ(random_, ReadEntry(archive, *entry));
+
+    entry = archive->FindEntry(base::FilePath(FILE_PATH_LITERAL("empty.css")));
+    ASSERT_TRUE(entry);
+    EXPECT_EQ(std::string(), ReadEntry(archive, *entry));
+
+    EXPECT_FALSE(archive->FindEntry(base::FilePath(FILE_PATH_LITERAL("js"))));
+    EXPECT_FALSE(
+        archive->FindEntry(base::FilePath(FILE_PATH_LITERAL("missing.js"))));
+  }
+
+ protected:
+  base::ScopedTempDir temp_dir_;
+  base::FilePath archive_path_;
+  base::FilePath index_path_;
+  std::string text_;
+  std::string random_;
+};
+
+TEST_F(ApplicationArchiveTest, ReadFromCentralDirectory) {
+  scoped_refptr<ApplicationArchive> archive =
+      ApplicationArchive::Open(archive_path_, index_path_);
+  ASSERT_TRUE(archive);
+  ExpectContent(archive.get());
+}
+
+TEST_F(ApplicationArchiveTest, ReadFromIndex) {
+  scoped_refptr<ApplicationArchive> archive =
+      ApplicationArchive::Open(archive_path_, base::FilePath());
+  ASSERT_TRUE(archive);
+  ASSERT_TRUE(archive->WriteIndex(index_path_));
+  archive = NULL;
+
+  // Corrupt the central directory, the index must be used instead.
+  std::string data;
+  ASSERT_TRUE(base::ReadFileToString(archive_path_, &data));
+  data.replace(data.size() - 22, 4, "XXXX");
+  WriteFile(archive_path_, data);
+  archive = ApplicationArchive::Open(archive_path_, index_path_);
+  ASSERT_TRUE(archive);
+  ExpectContent(archive.get());
+}
+
+TEST_F(ApplicationArchiveTest, ReadRange) {
+  scoped_refptr<ApplicationArchive> archive =
+      ApplicationArchive::Open(archive_path_, base::FilePath());
+  ASSERT_TRUE(archive);
+  EXPECT_FALSE(archive->last_modified().is_null());
+
+  const ApplicationArchive::Entry* entry =
+      archive->FindEntry(base::FilePath(FILE_PATH_LITERAL("index.html")));
+  ASSERT_TRUE(entry);
+  {
+    ApplicationArchive::EntryReader reader(archive.get(), *entry);
+    ASSERT_TRUE(reader.Skip(text_.size() - 3));
+    char buffer[10];
+    ASSERT_EQ(3, reader.Read(buffer, sizeof(buffer)));
+    EXPECT_EQ("end", std::string(buffer, 3));
+    EXPECT_EQ(0, reader.Read(buffer, sizeof(buffer)));
+  }
+  {
+    ApplicationArchive::EntryReader reader(archive.get(), *entry);
+    EXPECT_FALSE(reader.Skip(text_.size() + 1));
+  }
+}
+
+TEST_F(ApplicationArchiveTest, RejectStaleIndexAndBadArchive) {
+  scoped_refptr<ApplicationArchive> archive =
+      ApplicationArchive::Open(archive_path_, base::FilePath());
+  ASSERT_TRUE(archive);
+  ASSERT_TRUE(archive->WriteIndex(index_path_));
+  archive = NULL;
+
+  // The index doesn't match the archive once its size changed.
+  WriteFile(archive_path_, "not a zip archive");
+  EXPECT_FALSE(ApplicationArchive::Open(archive_path_, index_path_));
+}
+
+}  // namespace application
+}  // namespace xwalk
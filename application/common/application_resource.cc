@@ -60,6 +60,15 @@ base::FilePath ApplicationResource::GetFilePath(
   if (clean_application_root.empty())
     return base::FilePath();
 
+  return GetFilePathFromAbsoluteRoot(clean_application_root, relative_path,
+                                     symlink_policy);
+}
+
+// static
+base::FilePath ApplicationResource::GetFilePathFromAbsoluteRoot(
+    const base::FilePath& clean_application_root,
+    const base::FilePath& relative_path,
+    SymlinkPolicy symlink_policy) {
   base::FilePath full_path = clean_application_root.Append(relative_path);
 
   // If we are allowing the file to be a symlink outside of the root, then the
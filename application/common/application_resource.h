@@ -55,6 +55,13 @@ class ApplicationResource {
                                     const base::FilePath& relative_path,
                                     SymlinkPolicy symlink_policy);
 
+  // Same as GetFilePath(), with |clean_application_root| already made absolute
+  // by base::MakeAbsoluteFilePath(), for callers resolving many resources.
+  static base::FilePath GetFilePathFromAbsoluteRoot(
+      const base::FilePath& clean_application_root,
+      const base::FilePath& relative_path,
+      SymlinkPolicy symlink_policy);
+
   // Getters
   const std::string& application_id() const { return application_id_; }
   const base::FilePath& application_root() const { return application_root_; }
@@ -16,7 +16,10 @@ const char kCreateAppTableOp[] =
     "id TEXT NOT NULL UNIQUE PRIMARY KEY,"
     "manifest TEXT NOT NULL,"
     "path TEXT NOT NULL,"
-    "install_time REAL)";
+    "install_time REAL,"
+    "name TEXT,"
+    "version TEXT,"
+    "binary_manifest BLOB)";
 
 const char kCreateEventTableOp[] =
     "CREATE TABLE registered_events ("
@@ -27,14 +30,25 @@ const char kCreateEventTableOp[] =
     "ON DELETE CASCADE)";
 
 const char kGetAllRowsFromAppEventTableOp[] =
-    "SELECT A.id, A.manifest, A.path, A.install_time, B.event_names "
+    "SELECT A.id, A.manifest, A.path, A.install_time, B.event_names, "
+    "A.name, A.version, A.binary_manifest "
     "FROM applications as A "
     "LEFT JOIN registered_events as B "
     "ON A.id = B.id";
 
+const char kGetAllApplicationInfosOp[] =
+    "SELECT A.id, A.path, A.install_time, B.event_names, A.name, A.version "
+    "FROM applications as A "
+    "LEFT JOIN registered_events as B "
+    "ON A.id = B.id";
+
+const char kGetManifestsWithBindOp[] =
+    "SELECT binary_manifest, manifest FROM applications WHERE id = ?";
+
 const char kSetApplicationWithBindOp[] =
-    "INSERT INTO applications (manifest, path, install_time, id) "
-    "VALUES (?,?,?,?)";
+    "INSERT INTO applications "
+    "(manifest, path, install_time, name, version, binary_manifest, id) "
+    "VALUES (?,?,?,?,?,?,?)";
 
 const char kUpdateApplicationWithBindOp[] =
     "UPDATE applications SET manifest = ?, path = ?,"
@@ -53,5 +67,35 @@ const char kUpdateEventsWithBindOp[] =
 const char kDeleteEventsWithBindOp[] =
     "DELETE FROM registered_events WHERE id = ?";
 
+const char kUpdateManifestWithBindOp[] =
+    "UPDATE applications SET manifest = ?, name = ?, version = ?, "
+    "binary_manifest = ? WHERE id = ?";
+
+const char kUpdatePathWithBindOp[] =
+    "UPDATE applications SET path = ? WHERE id = ?";
+
+const char kUpdateInstallTimeWithBindOp[] =
+    "UPDATE applications SET install_time = ? WHERE id = ?";
+
+const char kAddNameColumnOp[] =
+    "ALTER TABLE applications ADD COLUMN name TEXT";
+
+const char kAddVersionColumnOp[] =
+    "ALTER TABLE applications ADD COLUMN version TEXT";
+
+const char kGetAllManifestsOp[] =
+    "SELECT id, manifest FROM applications";
+
+const char kAddBinaryManifestColumnOp[] =
+    "ALTER TABLE applications ADD COLUMN binary_manifest BLOB";
+
+const char kUpdateNameVersionAndBinaryManifestWithBindOp[] =
+    "UPDATE applications SET name = ?, version = ?, binary_manifest = ? "
+    "WHERE id = ?";
+
+const char kSetEventsWithBindOp[] =
+    "INSERT OR REPLACE INTO registered_events (event_names, id) "
+    "VALUES(?,?)";
+
 }  // namespace application_storage_constants
 }  // namespace xwalk
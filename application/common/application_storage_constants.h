@@ -16,12 +16,23 @@ namespace application_storage_constants {
   extern const char kCreateAppTableOp[];
   extern const char kCreateEventTableOp[];
   extern const char kGetAllRowsFromAppEventTableOp[];
+  extern const char kGetAllApplicationInfosOp[];
+  extern const char kGetManifestsWithBindOp[];
   extern const char kSetApplicationWithBindOp[];
   extern const char kUpdateApplicationWithBindOp[];
   extern const char kDeleteApplicationWithBindOp[];
   extern const char kInsertEventsWithBindOp[];
   extern const char kUpdateEventsWithBindOp[];
   extern const char kDeleteEventsWithBindOp[];
+  extern const char kUpdateManifestWithBindOp[];
+  extern const char kUpdatePathWithBindOp[];
+  extern const char kUpdateInstallTimeWithBindOp[];
+  extern const char kAddNameColumnOp[];
+  extern const char kAddVersionColumnOp[];
+  extern const char kGetAllManifestsOp[];
+  extern const char kAddBinaryManifestColumnOp[];
+  extern const char kUpdateNameVersionAndBinaryManifestWithBindOp[];
+  extern const char kSetEventsWithBindOp[];
 
 }  // namespace application_storage_constants
 }  // namespace xwalk
@@ -16,6 +16,8 @@
 #include "sql/statement.h"
 #include "sql/transaction.h"
 #include "xwalk/application/browser/application_storage.h"
+#include "xwalk/application/common/application_manifest_constants.h"
+#include "xwalk/application/common/binary_manifest.h"
 #include "xwalk/application/common/application_storage_constants.h"
 
 namespace db_fields = xwalk::application_storage_constants;
@@ -29,7 +31,12 @@ const char kEventSeparator = ';';
 
 // Switching the JSON format DB(version 0) to SQLite backend version 1,
 // should migrate all data from JSON DB to SQLite applications table.
-static const int kVersionNumber = 1;
+// Version 2 lists the name and version of the applications in their own
+// columns, so that they're known without parsing the manifests.
+// Version 3 stores the manifests encoded by EncodeManifest() too, so that
+// they're not parsed as JSON when the applications are launched.
+static const int kVersionNumber = 3;
+static const int kCompatibleVersionNumber = 1;
 
 namespace {
 
@@ -59,15 +66,48 @@ bool InitEventsTable(sql::Connection* db) {
   return transaction.Commit();
 }
 
-bool Insert(scoped_refptr<ApplicationData> application,
-            ApplicationData::ApplicationDataMap& applications) {
-  return applications.insert(
-      std::pair<std::string, scoped_refptr<ApplicationData> >(
-          application->ID(), application)).second;
+// The JSON manifest is still written, for the versions of the database that
+// don't know the binary one.
+bool SerializeManifest(const ApplicationData* application,
+                       std::string* manifest,
+                       std::string* binary_manifest) {
+  const base::DictionaryValue& value = *application->GetManifest()->value();
+  JSONStringValueSerializer serializer(manifest);
+  if (!serializer.Serialize(value)) {
+    LOG(ERROR) << "An error occured when serializing the manifest value.";
+    return false;
+  }
+  EncodeManifest(value, binary_manifest);
+  return true;
 }
 
 }  // namespace
 
+InstalledApplicationInfo::InstalledApplicationInfo() {
+}
+
+InstalledApplicationInfo::~InstalledApplicationInfo() {
+}
+
+StoredManifests::StoredManifests() {
+}
+
+StoredManifests::~StoredManifests() {
+}
+
+ApplicationChange::ApplicationChange()
+    : type(ADD) {
+}
+
+ApplicationChange::~ApplicationChange() {
+}
+
+ApplicationStorageImpl::StoredApplication::StoredApplication() {
+}
+
+ApplicationStorageImpl::StoredApplication::~StoredApplication() {
+}
+
 ApplicationStorageImpl::ApplicationStorageImpl(const base::FilePath& path)
     : data_path_(path),
       db_initialized_(false) {
@@ -89,6 +129,7 @@ bool ApplicationStorageImpl::UpgradeToVersion1(const base::FilePath& v0_file) {
     return false;
   }
 
+  ApplicationChangeList changes;
   scoped_ptr<base::DictionaryValue> value;
   for (base::DictionaryValue::Iterator it(
            *static_cast<base::DictionaryValue*>(old_db));
@@ -112,29 +153,71 @@ bool ApplicationStorageImpl::UpgradeToVersion1(const base::FilePath& v0_file) {
 
     double install_time;
     value->GetDouble("install_time", &install_time);
-    if (!AddApplication(application, base::Time::FromDoubleT(install_time)))
+    changes.push_back(MakeAddition(application.get(),
+                                   base::Time::FromDoubleT(install_time)));
+  }
+  return ApplyChanges(changes);
+}
+
+bool ApplicationStorageImpl::UpgradeToVersion3(int from_version) {
+  sql::Transaction transaction(sqlite_db_.get());
+  if (!transaction.Begin())
+    return false;
+  if (from_version < 2 &&
+      (!sqlite_db_->Execute(db_fields::kAddNameColumnOp) ||
+       !sqlite_db_->Execute(db_fields::kAddVersionColumnOp)))
+    return false;
+  if (!sqlite_db_->Execute(db_fields::kAddBinaryManifestColumnOp))
+    return false;
+
+  // The manifests are parsed once more, to fill the new columns.
+  sql::Statement smt(sqlite_db_->GetUniqueStatement(
+      db_fields::kGetAllManifestsOp));
+  sql::Statement update(sqlite_db_->GetUniqueStatement(
+      db_fields::kUpdateNameVersionAndBinaryManifestWithBindOp));
+  while (smt.Step()) {
+    std::string manifest_str = smt.ColumnString(1);
+    JSONStringValueSerializer serializer(&manifest_str);
+    scoped_ptr<base::Value> value(serializer.Deserialize(NULL, NULL));
+    base::DictionaryValue* manifest;
+    if (!value || !value->GetAsDictionary(&manifest))
+      return false;
+
+    std::string name;
+    std::string version;
+    std::string binary_manifest;
+    manifest->GetString(application_manifest_keys::kNameKey, &name);
+    manifest->GetString(application_manifest_keys::kVersionKey, &version);
+    EncodeManifest(*manifest, &binary_manifest);
+    update.Reset(true);
+    update.BindString(0, name);
+    update.BindString(1, version);
+    update.BindBlob(2, binary_manifest.data(), binary_manifest.size());
+    update.BindString(3, smt.ColumnString(0));
+    if (!update.Run())
       return false;
   }
-  meta_table_.SetVersionNumber(1);
+  if (!smt.Succeeded())
+    return false;
 
-  return true;
+  meta_table_.SetVersionNumber(kVersionNumber);
+  return transaction.Commit();
 }
 
 ApplicationStorageImpl::~ApplicationStorageImpl() {
 }
 
-bool ApplicationStorageImpl::Init(
-    ApplicationData::ApplicationDataMap& applications) {
+bool ApplicationStorageImpl::Init(InstalledApplicationInfoMap& applications) {
   bool does_db_exist = base::PathExists(GetDBPath(data_path_));
   scoped_ptr<sql::Connection> sqlite_db(new sql::Connection);
   if (!sqlite_db->Open(GetDBPath(data_path_))) {
     LOG(ERROR) << "Unable to open applications DB.";
     return false;
   }
-  sqlite_db->Preload();
 
-  if (!meta_table_.Init(sqlite_db.get(), kVersionNumber, kVersionNumber) ||
-      meta_table_.GetVersionNumber() != kVersionNumber) {
+  if (!meta_table_.Init(sqlite_db.get(), kVersionNumber,
+                        kCompatibleVersionNumber) ||
+      meta_table_.GetCompatibleVersionNumber() > kVersionNumber) {
     LOG(ERROR) << "Unable to init the META table.";
     return false;
   }
@@ -158,6 +241,12 @@ bool ApplicationStorageImpl::Init(
 
   db_initialized_ = (sqlite_db_ && sqlite_db_->is_open());
 
+  const int version = meta_table_.GetVersionNumber();
+  if (version < kVersionNumber && !UpgradeToVersion3(version)) {
+    LOG(ERROR) << "Unable to upgrade applications DB to version 3.";
+    return false;
+  }
+
   base::FilePath v0_file = data_path_.Append(
       FILE_PATH_LITERAL("applications_db"));
   if (base::PathExists(v0_file) &&
@@ -174,102 +263,206 @@ bool ApplicationStorageImpl::Init(
     }
   }
 
-  db_initialized_ = GetInstalledApplications(applications);
+  db_initialized_ = GetInstalledApplicationInfos(applications);
 
   return db_initialized_;
 }
 
-bool ApplicationStorageImpl::GetInstalledApplications(
-    ApplicationData::ApplicationDataMap& applications) {
+bool ApplicationStorageImpl::GetInstalledApplicationInfos(
+    InstalledApplicationInfoMap& applications) {
   if (!db_initialized_) {
     LOG(ERROR) << "The database haven't initilized.";
     return false;
   }
 
+  // The manifests are only read when the applications are created.
   sql::Statement smt(sqlite_db_->GetUniqueStatement(
-      db_fields::kGetAllRowsFromAppEventTableOp));
+      db_fields::kGetAllApplicationInfosOp));
   if (!smt.is_valid())
     return false;
 
-  std::string error_msg;
+  stored_applications_.clear();
   while (smt.Step()) {
     std::string id = smt.ColumnString(0);
-
-    int error_code;
-    std::string manifest_str = smt.ColumnString(1);
-    JSONStringValueSerializer serializer(&manifest_str);
-    base::Value* manifest = serializer.Deserialize(&error_code, &error_msg);
-    if (manifest == NULL) {
-      LOG(ERROR) << "An error occured when deserializing the manifest, "
-                    "the error message is: "
-                 << error_msg;
-      return false;
-    }
-    std::string path = smt.ColumnString(2);
-    double install_time = smt.ColumnDouble(3);
+    InstalledApplicationInfo& info = applications[id];
+    info.id = id;
+    std::string path = smt.ColumnString(1);
+    info.path = base::FilePath::FromUTF8Unsafe(path);
+    info.install_time = base::Time::FromDoubleT(smt.ColumnDouble(2));
     std::vector<std::string> events;
-    base::SplitString(smt.ColumnString(4), kEventSeparator, &events);
+    base::SplitString(smt.ColumnString(3), kEventSeparator, &events);
+    info.events = std::set<std::string>(events.begin(), events.end());
+    info.name = smt.ColumnString(4);
+    info.version = smt.ColumnString(5);
+
+    StoredApplication& stored = stored_applications_[id];
+    stored.path = path;
+    stored.install_time = info.install_time;
+    stored.events = info.events;
+  }
 
-    std::string error;
-    scoped_refptr<ApplicationData> application =
-        ApplicationData::Create(
-            base::FilePath::FromUTF8Unsafe(path),
-            Manifest::INTERNAL,
-            *(static_cast<base::DictionaryValue*>(manifest)),
-            id,
-            &error);
-    if (!application) {
-      LOG(ERROR) << "Load appliation error: " << error;
-      return false;
-    }
+  return smt.Succeeded();
+}
 
-    application->install_time_ = base::Time::FromDoubleT(install_time);
+bool ApplicationStorageImpl::ReadManifests(const std::string& id,
+                                           StoredManifests* manifests) {
+  if (!db_initialized_) {
+    LOG(ERROR) << "The database haven't initialized.";
+    return false;
+  }
 
-    if (!events.empty()) {
-      application->events_ =
-          std::set<std::string>(events.begin(), events.end());
-    }
+  sql::Statement smt(sqlite_db_->GetCachedStatement(
+      SQL_FROM_HERE, db_fields::kGetManifestsWithBindOp));
+  smt.BindString(0, id);
+  if (!smt.Step()) {
+    LOG(ERROR) << "Unable to read the manifests of application " << id;
+    return false;
+  }
+  smt.ColumnBlobAsString(0, &manifests->binary_manifest);
+  manifests->manifest = smt.ColumnString(1);
+  return true;
+}
 
-    if (!Insert(application, applications)) {
+bool ApplicationStorageImpl::CreateApplications(
+    const InstalledApplicationInfoMap& infos,
+    ApplicationData::ApplicationDataMap& applications) {
+  ApplicationChangeList outdated_manifests;
+  for (InstalledApplicationInfoMap::const_iterator it = infos.begin();
+       it != infos.end(); ++it) {
+    StoredManifests manifests;
+    if (!ReadManifests(it->first, &manifests))
+      return false;
+    bool outdated = false;
+    std::string error;
+    scoped_refptr<ApplicationData> application =
+        CreateApplication(it->second, manifests, &outdated, &error);
+    if (!application)
+      return false;
+    if (!applications.insert(
+            std::pair<std::string, scoped_refptr<ApplicationData> >(
+                application->ID(), application)).second) {
       LOG(ERROR) << "An error occurred while"
                     "initializing the application cache data.";
       return false;
     }
+    if (outdated) {
+      outdated_manifests.push_back(
+          MakeUpdate(application.get(), it->second.install_time));
+    }
   }
 
+  // The applications are usable anyway, writing them is tried again at the
+  // next start.
+  if (!outdated_manifests.empty() && !ApplyChanges(outdated_manifests))
+    LOG(WARNING) << "Couldn't write the outdated manifests again.";
   return true;
 }
 
-bool ApplicationStorageImpl::AddApplication(const ApplicationData* application,
-                                            const base::Time& install_time) {
-  if (!db_initialized_) {
-    LOG(ERROR) << "The database haven't initialized.";
-    return false;
-  }
+bool ApplicationStorageImpl::Init(
+    ApplicationData::ApplicationDataMap& applications) {
+  InstalledApplicationInfoMap infos;
+  return Init(infos) && CreateApplications(infos, applications);
+}
 
-  return (SetApplicationValue(
-      application, install_time, db_fields::kSetApplicationWithBindOp) &&
-          SetEvents(application->ID(), application->GetEvents()));
+bool ApplicationStorageImpl::GetInstalledApplications(
+    ApplicationData::ApplicationDataMap& applications) {
+  InstalledApplicationInfoMap infos;
+  return GetInstalledApplicationInfos(infos) &&
+      CreateApplications(infos, applications);
 }
 
-bool ApplicationStorageImpl::UpdateApplication(
-    ApplicationData* application, const base::Time& install_time) {
-  if (!db_initialized_) {
-    LOG(ERROR) << "The database haven't initialized.";
-    return false;
+// static
+InstalledApplicationInfo ApplicationStorageImpl::MakeInfo(
+    const ApplicationData* application) {
+  InstalledApplicationInfo info;
+  info.id = application->ID();
+  info.name = application->Name();
+  info.version = application->VersionString();
+  info.path = application->Path();
+  info.install_time = application->install_time_;
+  info.events = application->GetEvents();
+  return info;
+}
+
+// static
+scoped_refptr<ApplicationData> ApplicationStorageImpl::CreateApplication(
+    const InstalledApplicationInfo& info, const StoredManifests& manifests,
+    bool* outdated, std::string* error) {
+  scoped_ptr<base::DictionaryValue> manifest;
+  if (!manifests.binary_manifest.empty())
+    manifest = DecodeManifest(manifests.binary_manifest);
+  *outdated = !manifest;
+  if (!manifest) {
+    if (!manifests.binary_manifest.empty())
+      LOG(WARNING) << "The binary manifest of " << info.id
+                   << " can't be decoded, parsing the JSON one.";
+    std::string manifest_str = manifests.manifest;
+    JSONStringValueSerializer serializer(&manifest_str);
+    int error_code;
+    scoped_ptr<base::Value> value(serializer.Deserialize(&error_code, error));
+    if (!value || !value->IsType(base::Value::TYPE_DICTIONARY)) {
+      LOG(ERROR) << "An error occured when deserializing the manifest, "
+                    "the error message is: "
+                 << *error;
+      return NULL;
+    }
+    manifest.reset(static_cast<base::DictionaryValue*>(value.release()));
   }
 
-  if (SetApplicationValue(
-          application, install_time, db_fields::kUpdateApplicationWithBindOp) &&
-      UpdateEvents(application->ID(), application->GetEvents())) {
-    application->is_dirty_ = false;
-    return true;
+  scoped_refptr<ApplicationData> application =
+      ApplicationData::Create(info.path,
+                              Manifest::INTERNAL,
+                              *manifest,
+                              info.id,
+                              error);
+  if (!application) {
+    LOG(ERROR) << "Load appliation error: " << *error;
+    return NULL;
   }
 
-  return false;
+  application->install_time_ = info.install_time;
+  application->events_ = info.events;
+  return application;
 }
 
-bool ApplicationStorageImpl::RemoveApplication(const std::string& id) {
+// static
+ApplicationChange ApplicationStorageImpl::MakeAddition(
+    const ApplicationData* application, const base::Time& install_time) {
+  ApplicationChange change;
+  change.type = ApplicationChange::ADD;
+  change.id = application->ID();
+  change.application = application;
+  change.name = application->Name();
+  change.version = application->VersionString();
+  change.path = application->Path().AsUTF8Unsafe();
+  change.install_time = install_time;
+  change.events = application->GetEvents();
+  return change;
+}
+
+// static
+ApplicationChange ApplicationStorageImpl::MakeUpdate(
+    const ApplicationData* application, const base::Time& install_time) {
+  ApplicationChange change = MakeAddition(application, install_time);
+  change.type = ApplicationChange::UPDATE;
+  return change;
+}
+
+// static
+void ApplicationStorageImpl::MarkStored(ApplicationData* application) {
+  application->is_dirty_ = false;
+}
+
+// static
+ApplicationChange ApplicationStorageImpl::MakeRemoval(const std::string& id) {
+  ApplicationChange change;
+  change.type = ApplicationChange::REMOVE;
+  change.id = id;
+  return change;
+}
+
+bool ApplicationStorageImpl::ApplyChanges(
+    const ApplicationChangeList& changes) {
   if (!db_initialized_) {
     LOG(ERROR) << "The database haven't initialized.";
     return false;
@@ -279,112 +472,183 @@ bool ApplicationStorageImpl::RemoveApplication(const std::string& id) {
   if (!transaction.Begin())
     return false;
 
-  sql::Statement smt(sqlite_db_->GetUniqueStatement(
-      db_fields::kDeleteApplicationWithBindOp));
-  smt.BindString(0, id);
-  if (!smt.Run()) {
-    LOG(ERROR) << "Could not delete application "
-                  "information from DB.";
-    return false;
-  }
+  bool succeeded = true;
+  for (size_t i = 0; succeeded && i < changes.size(); ++i)
+    succeeded = WriteChange(changes[i]);
+  if (succeeded && transaction.Commit())
+    return true;
 
-  return transaction.Commit();
+  // The transaction is rolled back, the applications it changed are written
+  // whole next time.
+  for (size_t i = 0; i < changes.size(); ++i)
+    stored_applications_.erase(changes[i].id);
+  return false;
 }
 
-bool ApplicationStorageImpl::SetApplicationValue(
-    const ApplicationData* application,
-    const base::Time& install_time,
-    const std::string& operation) {
-  if (!application) {
-    LOG(ERROR) << "A value is needed when inserting/updating in DB.";
-    return false;
-  }
+bool ApplicationStorageImpl::AddApplication(const ApplicationData* application,
+                                            const base::Time& install_time) {
+  return ApplyChanges(
+      ApplicationChangeList(1, MakeAddition(application, install_time)));
+}
 
-  std::string manifest;
-  JSONStringValueSerializer serializer(&manifest);
-  if (!serializer.Serialize(*(application->GetManifest()->value()))) {
-    LOG(ERROR) << "An error occured when serializing the manifest value.";
+bool ApplicationStorageImpl::UpdateApplication(
+    ApplicationData* application, const base::Time& install_time) {
+  if (!ApplyChanges(
+          ApplicationChangeList(1, MakeUpdate(application, install_time))))
     return false;
+  MarkStored(application);
+  return true;
+}
+
+bool ApplicationStorageImpl::RemoveApplication(const std::string& id) {
+  return ApplyChanges(ApplicationChangeList(1, MakeRemoval(id)));
+}
+
+bool ApplicationStorageImpl::WriteChange(const ApplicationChange& change) {
+  bool succeeded = false;
+  switch (change.type) {
+    case ApplicationChange::ADD:
+      succeeded = InsertApplication(change);
+      break;
+    case ApplicationChange::UPDATE: {
+      StoredApplicationMap::const_iterator it =
+          stored_applications_.find(change.id);
+      succeeded = UpdateApplicationColumns(change,
+          it != stored_applications_.end() ? &it->second : NULL);
+      break;
+    }
+    case ApplicationChange::REMOVE:
+      succeeded = DeleteApplication(change.id);
+      break;
   }
 
-  sql::Transaction transaction(sqlite_db_.get());
-  if (!transaction.Begin())
-    return false;
+  if (succeeded)
+    Store(change);
+  return succeeded;
+}
 
-  sql::Statement smt(sqlite_db_->GetUniqueStatement(operation.c_str()));
-  if (!smt.is_valid()) {
-    LOG(ERROR) << "Unable to insert/update application info in DB.";
+bool ApplicationStorageImpl::InsertApplication(
+    const ApplicationChange& change) {
+  std::string manifest;
+  std::string binary_manifest;
+  if (!SerializeManifest(change.application.get(), &manifest,
+                         &binary_manifest))
     return false;
-  }
+
+  sql::Statement smt(sqlite_db_->GetCachedStatement(
+      SQL_FROM_HERE, db_fields::kSetApplicationWithBindOp));
   smt.BindString(0, manifest);
-  smt.BindString(1, application->Path().AsUTF8Unsafe());
-  smt.BindDouble(2, install_time.ToDoubleT());
-  smt.BindString(3, application->ID());
+  smt.BindString(1, change.path);
+  smt.BindDouble(2, change.install_time.ToDoubleT());
+  smt.BindString(3, change.name);
+  smt.BindString(4, change.version);
+  smt.BindBlob(5, binary_manifest.data(), binary_manifest.size());
+  smt.BindString(6, change.id);
   if (!smt.Run()) {
-    LOG(ERROR) << "An error occured when inserting/updating "
+    LOG(ERROR) << "An error occured when inserting "
                   "application info in DB.";
     return false;
   }
 
-  return transaction.Commit();
+  return WriteEvents(change.id, change.events);
 }
 
-bool ApplicationStorageImpl::SetEvents(const std::string& id,
-                                       const std::set<std::string>& events) {
-  if (!db_initialized_)
-    return false;
-  return SetEventsValue(id, events, db_fields::kInsertEventsWithBindOp);
-}
+bool ApplicationStorageImpl::UpdateApplicationColumns(
+    const ApplicationChange& change, const StoredApplication* stored) {
+  // All the columns are written when what's stored isn't known.
+  const bool write_all = !stored;
+
+  if (write_all || !stored->application ||
+      change.application->GetManifest() !=
+      stored->application->GetManifest()) {
+    std::string manifest;
+    std::string binary_manifest;
+    if (!SerializeManifest(change.application.get(), &manifest,
+                           &binary_manifest))
+      return false;
+    sql::Statement smt(sqlite_db_->GetCachedStatement(
+        SQL_FROM_HERE, db_fields::kUpdateManifestWithBindOp));
+    smt.BindString(0, manifest);
+    smt.BindString(1, change.name);
+    smt.BindString(2, change.version);
+    smt.BindBlob(3, binary_manifest.data(), binary_manifest.size());
+    smt.BindString(4, change.id);
+    if (!smt.Run())
+      return false;
+  }
 
-bool ApplicationStorageImpl::UpdateEvents(
-    const std::string &id, const std::set<std::string>& events) {
-  if (!db_initialized_)
-    return false;
+  if (write_all || change.path != stored->path) {
+    sql::Statement smt(sqlite_db_->GetCachedStatement(
+        SQL_FROM_HERE, db_fields::kUpdatePathWithBindOp));
+    smt.BindString(0, change.path);
+    smt.BindString(1, change.id);
+    if (!smt.Run())
+      return false;
+  }
 
-  if (events.empty())
-    return DeleteEvents(id);
+  if (write_all || change.install_time != stored->install_time) {
+    sql::Statement smt(sqlite_db_->GetCachedStatement(
+        SQL_FROM_HERE, db_fields::kUpdateInstallTimeWithBindOp));
+    smt.BindDouble(0, change.install_time.ToDoubleT());
+    smt.BindString(1, change.id);
+    if (!smt.Run())
+      return false;
+  }
 
-  return SetEventsValue(id, events, db_fields::kUpdateEventsWithBindOp);
+  if (write_all || change.events != stored->events)
+    return WriteEvents(change.id, change.events);
+  return true;
 }
 
-bool ApplicationStorageImpl::DeleteEvents(const std::string& id) {
-  sql::Transaction transaction(sqlite_db_.get());
-  if (!transaction.Begin())
-    return false;
-
-  sql::Statement smt(sqlite_db_->GetUniqueStatement(
-      db_fields::kDeleteEventsWithBindOp));
+bool ApplicationStorageImpl::DeleteApplication(const std::string& id) {
+  sql::Statement smt(sqlite_db_->GetCachedStatement(
+      SQL_FROM_HERE, db_fields::kDeleteApplicationWithBindOp));
   smt.BindString(0, id);
-
   if (!smt.Run()) {
-    LOG(ERROR) << "An error occured when deleting event information from DB.";
+    LOG(ERROR) << "Could not delete application "
+                  "information from DB.";
     return false;
   }
-
-  return transaction.Commit();
+  return true;
 }
 
-bool ApplicationStorageImpl::SetEventsValue(
-    const std::string& id,
-    const std::set<std::string>& events,
-    const std::string& operation) {
-  sql::Transaction transaction(sqlite_db_.get());
-  std::string events_list(JoinString(
-      std::vector<std::string>(events.begin(), events.end()), kEventSeparator));
-
-  if (!transaction.Begin())
-    return false;
+bool ApplicationStorageImpl::WriteEvents(
+    const std::string& id, const std::set<std::string>& events) {
+  if (events.empty()) {
+    sql::Statement smt(sqlite_db_->GetCachedStatement(
+        SQL_FROM_HERE, db_fields::kDeleteEventsWithBindOp));
+    smt.BindString(0, id);
+    if (!smt.Run()) {
+      LOG(ERROR) << "An error occured when deleting event information "
+                    "from DB.";
+      return false;
+    }
+    return true;
+  }
 
-  sql::Statement smt(sqlite_db_->GetUniqueStatement(
-      operation.c_str()));
-  smt.BindString(0, events_list);
+  sql::Statement smt(sqlite_db_->GetCachedStatement(
+      SQL_FROM_HERE, db_fields::kSetEventsWithBindOp));
+  smt.BindString(0, JoinString(
+      std::vector<std::string>(events.begin(), events.end()), kEventSeparator));
   smt.BindString(1, id);
   if (!smt.Run()) {
     LOG(ERROR) << "An error occured when inserting event information into DB.";
     return false;
   }
+  return true;
+}
 
-  return transaction.Commit();
+void ApplicationStorageImpl::Store(const ApplicationChange& change) {
+  if (change.type == ApplicationChange::REMOVE) {
+    stored_applications_.erase(change.id);
+    return;
+  }
+
+  StoredApplication& stored = stored_applications_[change.id];
+  stored.application = change.application;
+  stored.path = change.path;
+  stored.install_time = change.install_time;
+  stored.events = change.events;
 }
 
 }  // namespace application
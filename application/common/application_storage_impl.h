@@ -5,11 +5,15 @@
 #ifndef XWALK_APPLICATION_COMMON_APPLICATION_STORAGE_IMPL_H_
 #define XWALK_APPLICATION_COMMON_APPLICATION_STORAGE_IMPL_H_
 
+#include <map>
 #include <set>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "base/files/file_path.h"
+#include "base/memory/ref_counted.h"
+#include "base/time/time.h"
 #include "sql/connection.h"
 #include "sql/meta_table.h"
 #include "xwalk/application/common/application_data.h"
@@ -17,41 +21,155 @@
 namespace xwalk {
 namespace application {
 
+// An installed application as listed in the database, read without parsing
+// its manifest. The application itself is only created from it when needed,
+// see ApplicationStorageImpl::CreateApplication().
+struct InstalledApplicationInfo {
+  InstalledApplicationInfo();
+  ~InstalledApplicationInfo();
+
+  std::string id;
+  std::string name;
+  std::string version;
+  base::FilePath path;
+  base::Time install_time;
+  std::set<std::string> events;
+};
+
+// The manifests of an application, only read from the database to create
+// it. The manifest encoded by EncodeManifest() is empty for applications
+// stored before it existed, the JSON one is used when it can't be decoded
+// (e.g. written by another version of the encoding).
+struct StoredManifests {
+  StoredManifests();
+  ~StoredManifests();
+
+  std::string binary_manifest;
+  std::string manifest;
+};
+
+typedef std::map<std::string, InstalledApplicationInfo>
+    InstalledApplicationInfoMap;
+
+// A change to the stored information of an application, taken from it on the
+// thread that owns it so that it can be written from another.
+struct ApplicationChange {
+  enum Type {
+    ADD,
+    UPDATE,
+    REMOVE,
+  };
+
+  ApplicationChange();
+  ~ApplicationChange();
+
+  Type type;
+  std::string id;
+  // The manifest of an application never changes, so the application is kept
+  // only to serialize it. Not set for REMOVE.
+  scoped_refptr<const ApplicationData> application;
+  std::string name;
+  std::string version;
+  std::string path;
+  base::Time install_time;
+  std::set<std::string> events;
+};
+
+typedef std::vector<ApplicationChange> ApplicationChangeList;
+
 // The Sqlite backend implementation of ApplicationStorage.
+//
+// It remembers what it wrote for each application, so that an update only
+// writes the columns that changed. Once initialized, it may be used from
+// another thread than the one that initialized it, one at a time.
 class ApplicationStorageImpl {
  public:
   static const base::FilePath::CharType kDBFileName[];
   explicit ApplicationStorageImpl(const base::FilePath& path);
   ~ApplicationStorageImpl();
 
+  // Returns the change that adds or updates |application|, installed at
+  // |install_time|.
+  static ApplicationChange MakeAddition(const ApplicationData* application,
+                                        const base::Time& install_time);
+  static ApplicationChange MakeUpdate(const ApplicationData* application,
+                                      const base::Time& install_time);
+  static ApplicationChange MakeRemoval(const std::string& id);
+
+  // Clears the dirty flag of |application|, once its changes are written.
+  static void MarkStored(ApplicationData* application);
+
+  // Returns the information listed for |application|.
+  static InstalledApplicationInfo MakeInfo(const ApplicationData* application);
+
+  // Decodes the |manifests| of the application described by |info| and
+  // creates the application. Returns NULL on error. |outdated| is set when
+  // the JSON manifest had to be parsed instead of the binary one, which
+  // should then be written again, see MakeUpdate().
+  static scoped_refptr<ApplicationData> CreateApplication(
+      const InstalledApplicationInfo& info, const StoredManifests& manifests,
+      bool* outdated, std::string* error);
+
+  // Reads the manifests of the installed application |id|.
+  bool ReadManifests(const std::string& id, StoredManifests* manifests);
+
+  // Writes all of |changes| in a single transaction.
+  bool ApplyChanges(const ApplicationChangeList& changes);
+
   bool AddApplication(const ApplicationData* application,
                       const base::Time& install_time);
   bool RemoveApplication(const std::string& key);
   bool UpdateApplication(ApplicationData* application,
                          const base::Time& install_time);
+  // Opens the database and lists the installed applications, without
+  // reading their manifests.
+  bool Init(InstalledApplicationInfoMap& applications);
+  bool GetInstalledApplicationInfos(InstalledApplicationInfoMap& applications);
+
+  // Same, but creates all the applications.
   bool Init(ApplicationData::ApplicationDataMap& applications);
   bool GetInstalledApplications(
       ApplicationData::ApplicationDataMap& applications);
 
  private:
+  // What's in the database for an application.
+  struct StoredApplication {
+    StoredApplication();
+    ~StoredApplication();
+
+    // Keeps the manifest alive, so that the change of an application with
+    // the same manifest is found by comparing pointers. NULL until the first
+    // change of applications listed by Init().
+    scoped_refptr<const ApplicationData> application;
+    std::string path;
+    base::Time install_time;
+    std::set<std::string> events;
+  };
+  typedef std::map<std::string, StoredApplication> StoredApplicationMap;
+
+  // Creates the applications of |infos|, and writes again the manifests that
+  // couldn't be decoded.
+  bool CreateApplications(const InstalledApplicationInfoMap& infos,
+                          ApplicationData::ApplicationDataMap& applications);
+
   bool UpgradeToVersion1(const base::FilePath& v0_file);
-  bool SetApplicationValue(const ApplicationData* application,
-                           const base::Time& install_time,
-                           const std::string& operation);
-
-  bool SetEventsValue(const std::string& id,
-                      const std::set<std::string>& events,
-                      const std::string& operation);
-  bool SetEvents(const std::string& id,
-                 const std::set<std::string>& events);
-  bool UpdateEvents(const std::string& id,
-                    const std::set<std::string>& events);
-  bool DeleteEvents(const std::string& id);
+  bool UpgradeToVersion3(int from_version);
+
+  bool WriteChange(const ApplicationChange& change);
+  bool InsertApplication(const ApplicationChange& change);
+  bool UpdateApplicationColumns(const ApplicationChange& change,
+                                const StoredApplication* stored);
+  bool DeleteApplication(const std::string& id);
+  bool WriteEvents(const std::string& id,
+                   const std::set<std::string>& events);
+
+  void Store(const ApplicationChange& change);
 
   scoped_ptr<sql::Connection> sqlite_db_;
   sql::MetaTable meta_table_;
   base::FilePath data_path_;
   bool db_initialized_;
+  StoredApplicationMap stored_applications_;
 };
 
 }  // namespace application
@@ -4,12 +4,20 @@
 
 #include "xwalk/application/common/application_storage_impl.h"
 
+#include "base/bind.h"
 #include "base/file_util.h"
 #include "base/files/scoped_temp_dir.h"
 #include "base/json/json_file_value_serializer.h"
 #include "base/logging.h"
+#include "base/message_loop/message_loop.h"
 #include "base/path_service.h"
+#include "base/run_loop.h"
+#include "base/strings/stringprintf.h"
+#include "base/threading/thread.h"
+#include "sql/connection.h"
+#include "sql/test/scoped_error_ignorer.h"
 #include "testing/gtest/include/gtest/gtest.h"
+#include "third_party/sqlite/sqlite3.h"
 #include "xwalk/application/browser/application_storage.h"
 #include "xwalk/application/common/application_manifest_constants.h"
 
@@ -29,6 +37,17 @@ class ApplicationStorageImplTest : public testing::Test {
     ASSERT_TRUE(app_storage_impl_->Init(applications));
   }
 
+  scoped_refptr<ApplicationData> CreateApplication(const std::string& id) {
+    base::DictionaryValue manifest;
+    manifest.SetString(keys::kNameKey, "no name");
+    manifest.SetString(keys::kVersionKey, "0");
+    std::string error;
+    scoped_refptr<ApplicationData> application = ApplicationData::Create(
+        base::FilePath(), Manifest::INTERNAL, manifest, id, &error);
+    EXPECT_TRUE(error.empty());
+    return application;
+  }
+
  protected:
   base::ScopedTempDir temp_dir_;
   scoped_ptr<ApplicationStorageImpl> app_storage_impl_;
@@ -163,5 +182,307 @@ TEST_F(ApplicationStorageImplTest, DBUpdate) {
       new_application->GetManifest()->value()));
 }
 
+TEST_F(ApplicationStorageImplTest, DBApplyChanges) {
+  TestInit();
+  scoped_refptr<ApplicationData> kept = CreateApplication("kept_id");
+  scoped_refptr<ApplicationData> removed = CreateApplication("removed_id");
+  ASSERT_TRUE(kept);
+  ASSERT_TRUE(removed);
+
+  ApplicationChangeList changes;
+  changes.push_back(ApplicationStorageImpl::MakeAddition(
+      kept.get(), base::Time::FromDoubleT(0)));
+  changes.push_back(ApplicationStorageImpl::MakeAddition(
+      removed.get(), base::Time::FromDoubleT(0)));
+  std::set<std::string> events;
+  events.insert("test_event");
+  kept->SetEvents(events);
+  changes.push_back(ApplicationStorageImpl::MakeUpdate(
+      kept.get(), base::Time::FromDoubleT(10)));
+  changes.push_back(ApplicationStorageImpl::MakeRemoval("removed_id"));
+  ASSERT_TRUE(app_storage_impl_->ApplyChanges(changes));
+
+  // Only the events change, then nothing. The application is dirty until
+  // written.
+  events.insert("other_event");
+  kept->SetEvents(events);
+  EXPECT_TRUE(kept->IsDirty());
+  EXPECT_TRUE(app_storage_impl_->UpdateApplication(
+      kept.get(), base::Time::FromDoubleT(10)));
+  EXPECT_FALSE(kept->IsDirty());
+  EXPECT_TRUE(app_storage_impl_->UpdateApplication(
+      kept.get(), base::Time::FromDoubleT(10)));
+
+  ApplicationData::ApplicationDataMap applications;
+  ASSERT_TRUE(app_storage_impl_->GetInstalledApplications(applications));
+  ASSERT_EQ(1u, applications.size());
+  scoped_refptr<ApplicationData> saved_application = applications["kept_id"];
+  ASSERT_TRUE(saved_application);
+  EXPECT_EQ(events, saved_application->GetEvents());
+  EXPECT_EQ(10, saved_application->install_time().ToDoubleT());
+  EXPECT_TRUE(saved_application->GetManifest()->value()->Equals(
+      kept->GetManifest()->value()));
+}
+
+TEST_F(ApplicationStorageImplTest, WriteBehind) {
+  base::FilePath tmp;
+  ASSERT_TRUE(PathService::Get(base::DIR_TEMP, &tmp));
+  ASSERT_TRUE(temp_dir_.CreateUniqueTempDirUnderPath(tmp));
+  base::MessageLoop message_loop;
+  base::Thread db_thread("ApplicationStorageTestDB");
+  ASSERT_TRUE(db_thread.Start());
+
+  const int kApplicationCount = 100;
+  {
+    ApplicationStorage storage(temp_dir_.path(),
+                               db_thread.message_loop_proxy());
+    for (int i = 0; i < kApplicationCount; ++i) {
+      scoped_refptr<ApplicationData> application =
+          CreateApplication(base::StringPrintf("test_id_%d", i));
+      ASSERT_TRUE(application);
+      EXPECT_TRUE(storage.AddApplication(application));
+    }
+    EXPECT_TRUE(storage.RemoveApplication("test_id_0"));
+    // The changes are seen before being written.
+    EXPECT_EQ(static_cast<size_t>(kApplicationCount - 1),
+              storage.GetInstalledApplications().size());
+  }
+  // The storage writes what's left when destroyed.
+  db_thread.Stop();
+
+  app_storage_impl_.reset(new ApplicationStorageImpl(temp_dir_.path()));
+  ApplicationData::ApplicationDataMap applications;
+  ASSERT_TRUE(app_storage_impl_->Init(applications));
+  EXPECT_EQ(static_cast<size_t>(kApplicationCount - 1), applications.size());
+  EXPECT_FALSE(applications.count("test_id_0"));
+}
+
+namespace {
+
+void DoNothing() {}
+
+// Waits for the tasks posted to |db_thread| so far, and for the replies they
+// posted back to the current loop.
+void WaitForDatabase(base::Thread* db_thread) {
+  base::RunLoop run_loop;
+  db_thread->message_loop_proxy()->PostTaskAndReply(
+      FROM_HERE, base::Bind(&DoNothing), run_loop.QuitClosure());
+  run_loop.Run();
+}
+
+}  // namespace
+
+TEST_F(ApplicationStorageImplTest, WriteAfterFailedTransaction) {
+  base::FilePath tmp;
+  ASSERT_TRUE(PathService::Get(base::DIR_TEMP, &tmp));
+  ASSERT_TRUE(temp_dir_.CreateUniqueTempDirUnderPath(tmp));
+  const base::FilePath db_path =
+      temp_dir_.path().Append(ApplicationStorageImpl::kDBFileName);
+  base::MessageLoop message_loop;
+  base::Thread db_thread("ApplicationStorageTestDB");
+  ASSERT_TRUE(db_thread.Start());
+
+  ApplicationStorage storage(temp_dir_.path(), db_thread.message_loop_proxy());
+  scoped_refptr<ApplicationData> first = CreateApplication("first_id");
+  ASSERT_TRUE(first);
+  ASSERT_TRUE(storage.AddApplication(first));
+  storage.Flush();
+  WaitForDatabase(&db_thread);
+
+  // Another connection holds the database, so the update can't be written.
+  sql::ScopedErrorIgnorer ignore_errors;
+  ignore_errors.IgnoreError(SQLITE_BUSY);
+  sql::Connection lock;
+  ASSERT_TRUE(lock.Open(db_path));
+  ASSERT_TRUE(lock.Execute("BEGIN EXCLUSIVE"));
+
+  std::set<std::string> events;
+  events.insert("test_event");
+  first->SetEvents(events);
+  ASSERT_TRUE(storage.UpdateApplication(first));
+  storage.Flush();
+  WaitForDatabase(&db_thread);
+
+  ASSERT_TRUE(lock.Execute("COMMIT"));
+  lock.Close();
+  EXPECT_TRUE(ignore_errors.CheckIgnoredErrors());
+
+  // A later change is written by the delayed flush, with the failed update,
+  // while the storage is still alive.
+  scoped_refptr<ApplicationData> second = CreateApplication("second_id");
+  ASSERT_TRUE(second);
+  ASSERT_TRUE(storage.AddApplication(second));
+  base::RunLoop run_loop;
+  message_loop.PostDelayedTask(FROM_HERE, run_loop.QuitClosure(),
+                               base::TimeDelta::FromMilliseconds(500));
+  run_loop.Run();
+  WaitForDatabase(&db_thread);
+
+  ApplicationStorageImpl reader(temp_dir_.path());
+  InstalledApplicationInfoMap infos;
+  ASSERT_TRUE(reader.Init(infos));
+  EXPECT_EQ(2u, infos.size());
+  EXPECT_EQ(events, infos["first_id"].events);
+  EXPECT_TRUE(infos.count("second_id"));
+}
+
+// Applications listed at startup are created when asked for, from their
+// manifest read on the database sequence.
+TEST_F(ApplicationStorageImplTest, CreateListedApplication) {
+  TestInit();
+  scoped_refptr<ApplicationData> application = CreateApplication("listed_id");
+  ASSERT_TRUE(application);
+  ASSERT_TRUE(app_storage_impl_->AddApplication(application.get(),
+                                                base::Time::FromDoubleT(5)));
+  app_storage_impl_.reset();
+
+  base::MessageLoop message_loop;
+  base::Thread db_thread("ApplicationStorageTestDB");
+  ASSERT_TRUE(db_thread.Start());
+  ApplicationStorage storage(temp_dir_.path(), db_thread.message_loop_proxy());
+  EXPECT_EQ(1u, storage.GetInstalledApplications().size());
+
+  scoped_refptr<ApplicationData> created =
+      storage.GetApplicationData("listed_id");
+  ASSERT_TRUE(created);
+  EXPECT_EQ(5, created->install_time().ToDoubleT());
+  EXPECT_TRUE(created->GetManifest()->value()->Equals(
+      application->GetManifest()->value()));
+  // Created only once.
+  EXPECT_EQ(created, storage.GetApplicationData("listed_id"));
+  EXPECT_FALSE(storage.GetApplicationData("unknown_id"));
+}
+
+TEST_F(ApplicationStorageImplTest, LazyApplicationIndex) {
+  TestInit();
+  scoped_refptr<ApplicationData> application = CreateApplication("lazy_id");
+  ASSERT_TRUE(application);
+  std::set<std::string> events;
+  events.insert("test_event");
+  application->SetEvents(events);
+  ASSERT_TRUE(app_storage_impl_->AddApplication(application.get(),
+                                                base::Time::FromDoubleT(5)));
+
+  app_storage_impl_.reset(new ApplicationStorageImpl(temp_dir_.path()));
+  InstalledApplicationInfoMap infos;
+  ASSERT_TRUE(app_storage_impl_->Init(infos));
+  ASSERT_EQ(1u, infos.size());
+  const InstalledApplicationInfo& info = infos["lazy_id"];
+  EXPECT_EQ("no name", info.name);
+  EXPECT_EQ("0", info.version);
+  EXPECT_EQ(5, info.install_time.ToDoubleT());
+  EXPECT_EQ(events, info.events);
+
+  // The manifest is decoded without parsing JSON.
+  StoredManifests manifests;
+  ASSERT_TRUE(app_storage_impl_->ReadManifests("lazy_id", &manifests));
+  EXPECT_FALSE(manifests.binary_manifest.empty());
+  bool outdated = true;
+  std::string error;
+  scoped_refptr<ApplicationData> created =
+      ApplicationStorageImpl::CreateApplication(info, manifests, &outdated,
+                                                &error);
+  ASSERT_TRUE(created);
+  EXPECT_FALSE(outdated);
+  EXPECT_EQ("lazy_id", created->ID());
+  EXPECT_EQ(events, created->GetEvents());
+  EXPECT_TRUE(created->GetManifest()->value()->Equals(
+      application->GetManifest()->value()));
+}
+
+TEST_F(ApplicationStorageImplTest, UndecodableBinaryManifest) {
+  TestInit();
+  scoped_refptr<ApplicationData> application = CreateApplication("json_id");
+  ASSERT_TRUE(application);
+  ASSERT_TRUE(app_storage_impl_->AddApplication(application.get(),
+                                                base::Time::FromDoubleT(5)));
+  app_storage_impl_.reset();
+
+  // As if written by another version of the encoding.
+  {
+    sql::Connection db;
+    ASSERT_TRUE(db.Open(
+        temp_dir_.path().Append(ApplicationStorageImpl::kDBFileName)));
+    ASSERT_TRUE(db.Execute(
+        "UPDATE applications SET binary_manifest = x'00'"));
+  }
+
+  app_storage_impl_.reset(new ApplicationStorageImpl(temp_dir_.path()));
+  InstalledApplicationInfoMap infos;
+  ASSERT_TRUE(app_storage_impl_->Init(infos));
+  StoredManifests manifests;
+  ASSERT_TRUE(app_storage_impl_->ReadManifests("json_id", &manifests));
+  bool outdated = false;
+  std::string error;
+  scoped_refptr<ApplicationData> created =
+      ApplicationStorageImpl::CreateApplication(infos["json_id"], manifests,
+                                                &outdated, &error);
+  ASSERT_TRUE(created);
+  EXPECT_TRUE(outdated);
+  EXPECT_TRUE(created->GetManifest()->value()->Equals(
+      application->GetManifest()->value()));
+
+  // Creating the applications writes the binary manifest again.
+  ApplicationData::ApplicationDataMap applications;
+  ASSERT_TRUE(app_storage_impl_->GetInstalledApplications(applications));
+  ASSERT_EQ(1u, applications.size());
+
+  app_storage_impl_.reset(new ApplicationStorageImpl(temp_dir_.path()));
+  infos.clear();
+  ASSERT_TRUE(app_storage_impl_->Init(infos));
+  ASSERT_TRUE(app_storage_impl_->ReadManifests("json_id", &manifests));
+  created = ApplicationStorageImpl::CreateApplication(infos["json_id"],
+                                                      manifests, &outdated,
+                                                      &error);
+  ASSERT_TRUE(created);
+  EXPECT_FALSE(outdated);
+}
+
+// Listing the installed applications at startup doesn't read their
+// manifests, even broken ones don't get in the way.
+TEST_F(ApplicationStorageImplTest, ListWithoutReadingManifests) {
+  const int kApplicationCount = 100;
+  TestInit();
+  ApplicationChangeList changes;
+  for (int i = 0; i < kApplicationCount; ++i) {
+    base::DictionaryValue manifest;
+    manifest.SetString(keys::kNameKey, base::StringPrintf("app %d", i));
+    manifest.SetString(keys::kVersionKey, "1.0.0");
+    manifest.SetString(keys::kLaunchLocalPathKey, "index.html");
+    std::string error;
+    scoped_refptr<ApplicationData> application = ApplicationData::Create(
+        base::FilePath(), Manifest::INTERNAL, manifest,
+        base::StringPrintf("startup_test_%d", i), &error);
+    ASSERT_TRUE(application) << error;
+    changes.push_back(ApplicationStorageImpl::MakeAddition(
+        application.get(), base::Time::Now()));
+  }
+  ASSERT_TRUE(app_storage_impl_->ApplyChanges(changes));
+  app_storage_impl_.reset();
+
+  {
+    sql::Connection db;
+    ASSERT_TRUE(db.Open(
+        temp_dir_.path().Append(ApplicationStorageImpl::kDBFileName)));
+    ASSERT_TRUE(db.Execute(
+        "UPDATE applications SET binary_manifest = x'00', manifest = '{'"));
+  }
+
+  app_storage_impl_.reset(new ApplicationStorageImpl(temp_dir_.path()));
+  InstalledApplicationInfoMap infos;
+  ASSERT_TRUE(app_storage_impl_->Init(infos));
+  ASSERT_EQ(static_cast<size_t>(kApplicationCount), infos.size());
+  EXPECT_EQ("app 7", infos["startup_test_7"].name);
+  EXPECT_EQ("1.0.0", infos["startup_test_7"].version);
+
+  // Only creating an application reads its manifests.
+  StoredManifests manifests;
+  ASSERT_TRUE(app_storage_impl_->ReadManifests("startup_test_7", &manifests));
+  bool outdated = false;
+  std::string error;
+  EXPECT_FALSE(ApplicationStorageImpl::CreateApplication(
+      infos["startup_test_7"], manifests, &outdated, &error));
+}
+
 }  // namespace application
 }  // namespace xwalk
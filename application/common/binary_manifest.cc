@@ -0,0 +1,33 @@
+// Copyright (c) 2013 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "xwalk/application/common/binary_manifest.h"
+
+#include "xwalk/extensions/common/xwalk_serialized_value.h"
+
+using xwalk::extensions::XWalkSerializedValueReader;
+using xwalk::extensions::XWalkSerializedValueWriter;
+
+namespace xwalk {
+namespace application {
+
+void EncodeManifest(const base::DictionaryValue& manifest, std::string* data) {
+  XWalkSerializedValueWriter writer;
+  writer.WriteValue(manifest);
+  data->assign(writer.data());
+}
+
+scoped_ptr<base::DictionaryValue> DecodeManifest(const std::string& data) {
+  XWalkSerializedValueReader reader(data);
+  scoped_ptr<base::Value> value = reader.ReadValue();
+  base::Value::Type type;
+  // Nothing may follow the manifest.
+  if (!value || !value->IsType(base::Value::TYPE_DICTIONARY) ||
+      reader.PeekType(&type))
+    return scoped_ptr<base::DictionaryValue>();
+  return make_scoped_ptr(static_cast<base::DictionaryValue*>(value.release()));
+}
+
+}  // namespace application
+}  // namespace xwalk
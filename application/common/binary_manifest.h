@@ -0,0 +1,33 @@
+// Copyright (c) 2013 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef XWALK_APPLICATION_COMMON_BINARY_MANIFEST_H_
+#define XWALK_APPLICATION_COMMON_BINARY_MANIFEST_H_
+
+#include <string>
+
+#include "base/memory/scoped_ptr.h"
+#include "base/values.h"
+
+namespace xwalk {
+namespace application {
+
+// Compact binary encoding of the manifest of an installed application,
+// written when the application is installed so that it's not parsed as JSON
+// each time the application is launched. It is the serialization of the
+// extension messages, see xwalk_serialized_value.h. Data written by another
+// version of it isn't decoded, the manifest must be encoded again from its
+// JSON source.
+
+// Encodes |manifest| into |data|.
+void EncodeManifest(const base::DictionaryValue& manifest, std::string* data);
+
+// Returns NULL if |data| isn't a manifest encoded by EncodeManifest() with
+// the current version of the encoding.
+scoped_ptr<base::DictionaryValue> DecodeManifest(const std::string& data);
+
+}  // namespace application
+}  // namespace xwalk
+
+#endif  // XWALK_APPLICATION_COMMON_BINARY_MANIFEST_H_
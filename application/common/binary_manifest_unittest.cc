@@ -0,0 +1,66 @@
+// Copyright (c) 2013 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "xwalk/application/common/binary_manifest.h"
+
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace xwalk {
+namespace application {
+
+namespace {
+
+scoped_ptr<base::DictionaryValue> CreateManifest() {
+  scoped_ptr<base::DictionaryValue> manifest(new base::DictionaryValue);
+  manifest->SetString("name", "test");
+  manifest->SetString("version", "1.0.0");
+  manifest->SetInteger("manifest_version", 1);
+  manifest->SetDouble("scale", 1.5);
+  manifest->SetBoolean("enabled", true);
+  manifest->Set("nothing", base::Value::CreateNullValue());
+  manifest->SetString("app.launch.local_path", "index.html");
+  // Keys with dots aren't paths.
+  manifest->SetStringWithoutPathExpansion("dotted.key", "value");
+  base::ListValue* permissions = new base::ListValue;
+  permissions->AppendString("contacts");
+  permissions->AppendString("messaging");
+  manifest->Set("permissions", permissions);
+  return manifest.Pass();
+}
+
+}  // namespace
+
+TEST(BinaryManifestTest, RoundTrip) {
+  scoped_ptr<base::DictionaryValue> manifest = CreateManifest();
+  std::string data;
+  EncodeManifest(*manifest, &data);
+  scoped_ptr<base::DictionaryValue> decoded = DecodeManifest(data);
+  ASSERT_TRUE(decoded);
+  EXPECT_TRUE(decoded->Equals(manifest.get()));
+
+  std::string value;
+  EXPECT_TRUE(decoded->GetStringWithoutPathExpansion("dotted.key", &value));
+  EXPECT_EQ("value", value);
+}
+
+TEST(BinaryManifestTest, RejectInvalidData) {
+  std::string data;
+  EncodeManifest(*CreateManifest(), &data);
+
+  EXPECT_FALSE(DecodeManifest(std::string()));
+  EXPECT_FALSE(DecodeManifest("{\"name\": \"test\"}"));
+  for (size_t size = 0; size < data.size(); size += 7)
+    EXPECT_FALSE(DecodeManifest(data.substr(0, size))) << size;
+
+  // Data of another version of the encoding, its first byte.
+  std::string other_version = data;
+  ++other_version[0];
+  EXPECT_FALSE(DecodeManifest(other_version));
+
+  // Only a manifest, nothing after it.
+  EXPECT_FALSE(DecodeManifest(data + data.substr(1)));
+}
+
+}  // namespace application
+}  // namespace xwalk
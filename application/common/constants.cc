@@ -15,6 +15,21 @@ const base::FilePath::CharType kMessagesFilename[] =
     FILE_PATH_LITERAL("messages.json");
 const char kGeneratedMainDocumentFilename[] =
     "_generated_main_document.html";
+// Applications installed as archives keep their package in these files of
+// their directory, next to their manifest.
+const base::FilePath::CharType kPackageArchiveFilename[] =
+    FILE_PATH_LITERAL(".package_archive");
+const base::FilePath::CharType kPackageArchiveIndexFilename[] =
+    FILE_PATH_LITERAL(".package_archive_index");
+
+// A resource with this extension appended to its path is its gzip compressed
+// copy. It's served instead of the resource only when it's listed in the
+// kPrecompressedResourcesFilename file of the application, written by the
+// installer.
+const base::FilePath::CharType kGzipResourceExtension[] =
+    FILE_PATH_LITERAL(".gz");
+const base::FilePath::CharType kPrecompressedResourcesFilename[] =
+    FILE_PATH_LITERAL(".precompressed_resources");
 
 }  // namespace application
 }  // namespace xwalk
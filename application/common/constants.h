@@ -22,6 +22,14 @@ extern const base::FilePath::CharType kMessagesFilename[];
 // The filename to use for main document generated from app.main.scripts.
 extern const char kGeneratedMainDocumentFilename[];
 
+extern const base::FilePath::CharType kPackageArchiveFilename[];
+
+extern const base::FilePath::CharType kPackageArchiveIndexFilename[];
+
+extern const base::FilePath::CharType kGzipResourceExtension[];
+
+extern const base::FilePath::CharType kPrecompressedResourcesFilename[];
+
 }  // namespace application
 }  // namespace xwalk
 
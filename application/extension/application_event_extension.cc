@@ -24,29 +24,26 @@ namespace xwalk {
 namespace application {
 
 ApplicationEventExtension::ApplicationEventExtension(
-    ApplicationSystem* system)
-  : application_system_(system) {
+    ApplicationSystem* system, content::RenderProcessHost* host)
+  : application_system_(system),
+    host_(host) {
   set_name("xwalk.app.events");
   set_javascript_api(ResourceBundle::GetSharedInstance().GetRawDataResource(
       IDR_XWALK_APPLICATION_EVENT_API).as_string());
 }
 
 XWalkExtensionInstance* ApplicationEventExtension::CreateInstance() {
-  ApplicationService* service = application_system_->application_service();
+  // See ApplicationRuntimeExtension::CreateInstance().
+  ApplicationProcessManager* pm = application_system_->process_manager();
+  const std::string app_id = pm->GetApplicationIDForProcess(host_);
 
   int main_routing_id = MSG_ROUTING_NONE;
-  ApplicationProcessManager* pm = application_system_->process_manager();
-  const Runtime* runtime = pm->GetMainDocumentRuntime();
+  const Runtime* runtime = pm->GetMainDocumentRuntime(app_id);
   if (runtime)
     main_routing_id = runtime->web_contents()->GetRoutingID();
 
-  // FIXME: return corresponding application info after shared runtime process
-  // model is enabled.
-  const ApplicationData* app = service->GetRunningApplication();
-  CHECK(app);
   return new AppEventExtensionInstance(
-      application_system_,
-      app->ID(), main_routing_id);
+      application_system_, app_id, main_routing_id);
 }
 
 AppEventExtensionInstance::AppEventExtensionInstance(
@@ -109,6 +106,7 @@ void AppEventExtensionInstance::OnRegisterEvent(
     events.insert(event_name);
     app_data->SetEvents(events);
     app_store->UpdateApplication(app_data);
+    event_manager_->SetApplicationEvents(app_id_, events);
   }
 }
 
@@ -142,6 +140,7 @@ void AppEventExtensionInstance::OnUnregisterEvent(
     events.erase(event_name);
     app_data->SetEvents(events);
     app_store->UpdateApplication(app_data);
+    event_manager_->SetApplicationEvents(app_id_, events);
   }
 }
 
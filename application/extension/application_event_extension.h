@@ -12,6 +12,10 @@
 #include "xwalk/extensions/browser/xwalk_extension_function_handler.h"
 #include "xwalk/extensions/common/xwalk_extension.h"
 
+namespace content {
+class RenderProcessHost;
+}
+
 namespace xwalk {
 namespace application {
 class ApplicationEventManager;
@@ -24,15 +28,18 @@ using extensions::XWalkExtensionFunctionHandler;
 using extensions::XWalkExtensionFunctionInfo;
 using extensions::XWalkExtensionInstance;
 
+// The events API of the application rendered by |host|.
 class ApplicationEventExtension : public XWalkExtension {
  public:
-  explicit ApplicationEventExtension(ApplicationSystem* system);
+  ApplicationEventExtension(ApplicationSystem* system,
+                            content::RenderProcessHost* host);
 
   // XWalkExtension implementation.
   virtual XWalkExtensionInstance* CreateInstance() OVERRIDE;
 
  private:
   ApplicationSystem* application_system_;
+  content::RenderProcessHost* host_;
 };
 
 class AppEventExtensionInstance : public XWalkExtensionInstance,
@@ -22,20 +22,26 @@ namespace xwalk {
 namespace application {
 
 ApplicationRuntimeExtension::ApplicationRuntimeExtension(
-    ApplicationSystem* application_system)
-  : application_system_(application_system) {
+    ApplicationSystem* application_system, content::RenderProcessHost* host)
+  : application_system_(application_system),
+    host_(host) {
   set_name("xwalk.app.runtime");
   set_javascript_api(ResourceBundle::GetSharedInstance().GetRawDataResource(
       IDR_XWALK_APPLICATION_RUNTIME_API).as_string());
 }
 
 XWalkExtensionInstance* ApplicationRuntimeExtension::CreateInstance() {
-  return new AppRuntimeExtensionInstance(application_system_);
+  // Instances are created once a document of the application is loaded,
+  // even in a process started before it was known.
+  return new AppRuntimeExtensionInstance(application_system_,
+      application_system_->process_manager()->GetApplicationIDForProcess(
+          host_));
 }
 
 AppRuntimeExtensionInstance::AppRuntimeExtensionInstance(
-    ApplicationSystem* application_system)
+    ApplicationSystem* application_system, const std::string& app_id)
   : application_system_(application_system),
+    app_id_(app_id),
     handler_(this) {
   handler_.Register(
       "getManifest",
@@ -57,7 +63,7 @@ void AppRuntimeExtensionInstance::OnGetManifest(
   base::DictionaryValue* manifest_data = NULL;
   const ApplicationService* service =
     application_system_->application_service();
-  const ApplicationData* app = service->GetRunningApplication();
+  const ApplicationData* app = service->GetRunningApplication(app_id_);
   if (app)
     manifest_data = app->GetManifest()->value()->DeepCopy();
 
@@ -76,7 +82,7 @@ void AppRuntimeExtensionInstance::OnGetMainDocumentID(
   int main_routing_id = MSG_ROUTING_NONE;
   const ApplicationProcessManager* pm =
     application_system_->process_manager();
-  const Runtime* runtime = pm->GetMainDocumentRuntime();
+  const Runtime* runtime = pm->GetMainDocumentRuntime(app_id_);
   if (runtime)
     main_routing_id = runtime->web_contents()->GetRoutingID();
 
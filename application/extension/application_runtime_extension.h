@@ -10,6 +10,10 @@
 #include "xwalk/extensions/browser/xwalk_extension_function_handler.h"
 #include "xwalk/extensions/common/xwalk_extension.h"
 
+namespace content {
+class RenderProcessHost;
+}
+
 namespace xwalk {
 namespace application {
 class ApplicationSystem;
@@ -19,22 +23,24 @@ using extensions::XWalkExtensionFunctionHandler;
 using extensions::XWalkExtensionFunctionInfo;
 using extensions::XWalkExtensionInstance;
 
+// The runtime API of the application rendered by |host|.
 class ApplicationRuntimeExtension : public XWalkExtension {
  public:
-  explicit ApplicationRuntimeExtension(
-      ApplicationSystem* application_system);
+  ApplicationRuntimeExtension(ApplicationSystem* application_system,
+                              content::RenderProcessHost* host);
 
   // XWalkExtension implementation.
   virtual XWalkExtensionInstance* CreateInstance() OVERRIDE;
 
  private:
   ApplicationSystem* application_system_;
+  content::RenderProcessHost* host_;
 };
 
 class AppRuntimeExtensionInstance : public XWalkExtensionInstance {
  public:
-  explicit AppRuntimeExtensionInstance(
-      ApplicationSystem* application_system);
+  AppRuntimeExtensionInstance(ApplicationSystem* application_system,
+                              const std::string& app_id);
 
   virtual void HandleMessage(scoped_ptr<base::Value> msg) OVERRIDE;
 
@@ -43,6 +49,7 @@ class AppRuntimeExtensionInstance : public XWalkExtensionInstance {
   void OnGetManifest(scoped_ptr<XWalkExtensionFunctionInfo> info);
 
   ApplicationSystem* application_system_;
+  std::string app_id_;
 
   XWalkExtensionFunctionHandler handler_;
 };
@@ -0,0 +1,169 @@
+// Copyright (c) 2013 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <string>
+#include <vector>
+
+#include "base/file_util.h"
+#include "base/files/scoped_temp_dir.h"
+#include "base/run_loop.h"
+#include "base/stl_util.h"
+#include "base/strings/stringprintf.h"
+#include "content/public/browser/render_process_host.h"
+#include "content/public/test/test_utils.h"
+#include "xwalk/application/browser/application_event_manager.h"
+#include "xwalk/application/browser/application_process_manager.h"
+#include "xwalk/application/browser/application_service.h"
+#include "xwalk/application/browser/application_system.h"
+#include "xwalk/application/test/application_browsertest.h"
+#include "xwalk/runtime/browser/runtime.h"
+#include "xwalk/runtime/browser/runtime_context.h"
+#include "xwalk/runtime/browser/runtime_registry.h"
+
+using xwalk::application::ApplicationService;
+using xwalk::application::ApplicationSystem;
+using xwalk::application::Event;
+
+namespace {
+
+const char kManifest[] =
+    "{\n"
+    "  \"name\": \"event_page_%d\",\n"
+    "  \"manifest_version\": 1,\n"
+    "  \"version\": \"1.0\",\n"
+    "  \"app\": {\n"
+    "    \"main\": {\n"
+    "      \"scripts\": [\"main.js\"]\n"
+    "    }\n"
+    "  }\n"
+    "}\n";
+
+const char kMainScript[] =
+    "var onPing = new xwalk.app.events.Event(\"onPing\");\n"
+    "onPing.addListener(function() {});\n";
+
+const char kPingEvent[] = "onPing";
+
+const int kApplicationCount = 50;
+
+class TerminationWaiter : public ApplicationService::Observer {
+ public:
+  TerminationWaiter(ApplicationService* service, const std::string& app_id)
+      : service_(service),
+        app_id_(app_id) {
+    service_->AddObserver(this);
+  }
+
+  ~TerminationWaiter() {
+    service_->RemoveObserver(this);
+  }
+
+  void Wait() {
+    if (service_->GetRunningApplication(app_id_))
+      run_loop_.Run();
+  }
+
+  virtual void OnApplicationTerminated(const std::string& app_id) OVERRIDE {
+    if (app_id == app_id_)
+      run_loop_.Quit();
+  }
+
+ private:
+  ApplicationService* service_;
+  std::string app_id_;
+  base::RunLoop run_loop_;
+};
+
+// Returns the number of render processes running.
+int CountRenderProcesses() {
+  int count = 0;
+  for (content::RenderProcessHost::iterator it =
+           content::RenderProcessHost::AllHostsIterator();
+       !it.IsAtEnd(); it.Advance()) {
+    if (it.GetCurrentValue()->GetHandle() != base::kNullProcessHandle)
+      ++count;
+  }
+  return count;
+}
+
+}  // namespace
+
+// Applications whose main document only handles events run when one of them
+// is sent, and use no memory otherwise.
+class ApplicationEventPageBrowserTest : public ApplicationBrowserTest {
+ public:
+  virtual void SetUpOnMainThread() OVERRIDE {
+    ApplicationBrowserTest::SetUpOnMainThread();
+    system_ = xwalk::RuntimeRegistry::Get()->runtimes()[0]->
+        runtime_context()->GetApplicationSystem();
+    system_->process_manager()->set_background_idle_timeout(
+        base::TimeDelta::FromMilliseconds(200));
+  }
+
+ protected:
+  // Installs an application, and waits for its main document to register
+  // its events and be suspended.
+  std::string InstallApplication(const base::FilePath& dir, int index) {
+    EXPECT_TRUE(file_util::CreateDirectory(dir));
+    const std::string manifest = base::StringPrintf(kManifest, index);
+    EXPECT_EQ(static_cast<int>(manifest.size()),
+              file_util::WriteFile(dir.AppendASCII("manifest.json"),
+                                   manifest.data(), manifest.size()));
+    EXPECT_EQ(static_cast<int>(strlen(kMainScript)),
+              file_util::WriteFile(dir.AppendASCII("main.js"),
+                                   kMainScript, strlen(kMainScript)));
+
+    ApplicationService* service = system_->application_service();
+    std::string app_id;
+    EXPECT_TRUE(service->Install(dir, &app_id));
+    TerminationWaiter(service, app_id).Wait();
+    return app_id;
+  }
+
+  ApplicationSystem* system_;
+};
+
+IN_PROC_BROWSER_TEST_F(ApplicationEventPageBrowserTest, WakeUpOnEvent) {
+  base::ScopedTempDir temp_dir;
+  ASSERT_TRUE(temp_dir.CreateUniqueTempDir());
+  ApplicationService* service = system_->application_service();
+
+  std::vector<std::string> app_ids;
+  for (int i = 0; i < kApplicationCount; ++i) {
+    app_ids.push_back(InstallApplication(
+        temp_dir.path().AppendASCII(base::StringPrintf("app_%d", i)), i));
+    EXPECT_TRUE(ContainsKey(
+        service->GetApplicationByID(app_ids.back())->GetEvents(),
+        kPingEvent));
+  }
+  EXPECT_TRUE(service->GetRunningApplications().empty());
+
+  // The event wakes the application up, which is suspended again after it.
+  const std::string& app_id = app_ids[kApplicationCount / 2];
+  system_->event_manager()->SendEvent(app_id, Event::CreateEvent(
+      kPingEvent, scoped_ptr<base::ListValue>(new base::ListValue())));
+  ASSERT_TRUE(service->GetRunningApplication(app_id));
+  EXPECT_EQ(1u, service->GetRunningApplications().size());
+  TerminationWaiter(service, app_id).Wait();
+  EXPECT_TRUE(service->GetRunningApplications().empty());
+}
+
+// Once suspended, the installed applications keep no render process.
+IN_PROC_BROWSER_TEST_F(ApplicationEventPageBrowserTest, NoProcessWhenIdle) {
+  base::ScopedTempDir temp_dir;
+  ASSERT_TRUE(temp_dir.CreateUniqueTempDir());
+
+  content::RunAllPendingInMessageLoop();
+  const int initial_count = CountRenderProcesses();
+
+  for (int i = 0; i < kApplicationCount; ++i) {
+    InstallApplication(
+        temp_dir.path().AppendASCII(base::StringPrintf("app_%d", i)), i);
+  }
+
+  content::RunAllPendingInMessageLoop();
+  EXPECT_TRUE(system_->application_service()->GetRunningApplications()
+                  .empty());
+  EXPECT_EQ(initial_count, CountRenderProcesses());
+}
@@ -42,9 +42,11 @@ class ApplicationEventApiTest : public ApplicationApiTest {
     xwalk::RuntimeContext* runtime_context = main_runtime->runtime_context();
     xwalk::application::ApplicationSystem* system =
       runtime_context->GetApplicationSystem();
-    DCHECK(system->application_service()->GetRunningApplication());
+    const xwalk::application::ApplicationService::RunningApplicationMap&
+        running = system->application_service()->GetRunningApplications();
+    DCHECK_EQ(1u, running.size());
 
-    app_id_ = system->application_service()->GetRunningApplication()->ID();
+    app_id_ = running.begin()->first;
     event_manager_ = system->event_manager();
     event_finish_observer_.reset(
         new MockFinishObserver(event_manager_, app_id_));
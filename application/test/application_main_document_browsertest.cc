@@ -40,7 +40,9 @@ IN_PROC_BROWSER_TEST_F(ApplicationMainDocumentBrowserTest, MainDocument) {
   xwalk::RuntimeContext* runtime_context = main_runtime->runtime_context();
   xwalk::application::ApplicationService* service =
     runtime_context->GetApplicationSystem()->application_service();
-  const ApplicationData* app = service->GetRunningApplication();
+  ASSERT_EQ(1u, service->GetRunningApplications().size());
+  const ApplicationData* app =
+      service->GetRunningApplications().begin()->second.get();
   GURL generated_url =
     app->GetResourceURL(xwalk::application::kGeneratedMainDocumentFilename);
   // Check main document URL.
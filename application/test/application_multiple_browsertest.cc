@@ -0,0 +1,123 @@
+// Copyright (c) 2013 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <string>
+
+#include "base/file_util.h"
+#include "base/files/scoped_temp_dir.h"
+#include "base/strings/stringprintf.h"
+#include "base/strings/utf_string_conversions.h"
+#include "content/public/browser/web_contents.h"
+#include "content/public/test/browser_test_utils.h"
+#include "content/public/test/test_utils.h"
+#include "net/base/net_util.h"
+#include "xwalk/application/browser/application_process_manager.h"
+#include "xwalk/application/browser/application_service.h"
+#include "xwalk/application/browser/application_system.h"
+#include "xwalk/application/test/application_browsertest.h"
+#include "xwalk/runtime/browser/runtime.h"
+#include "xwalk/runtime/browser/runtime_context.h"
+#include "xwalk/runtime/browser/runtime_registry.h"
+
+using xwalk::application::ApplicationService;
+using xwalk::application::ApplicationSystem;
+
+namespace {
+
+const char kManifest[] =
+    "{\n"
+    "  \"name\": \"%s\",\n"
+    "  \"manifest_version\": 1,\n"
+    "  \"version\": \"1.0\",\n"
+    "  \"app\": {\n"
+    "    \"launch\": {\n"
+    "      \"local_path\": \"index.html\"\n"
+    "    }\n"
+    "  }\n"
+    "}\n";
+
+// The title is set by a script, so that it's only set once the resources of
+// the application are served.
+const char kIndex[] =
+    "<html><head><script src=\"title.js\"></script></head></html>";
+
+// Writes an application named |name| that sets its title to its name.
+void WriteApplication(const base::FilePath& dir, const std::string& name) {
+  const std::string files[][2] = {
+    { "manifest.json", base::StringPrintf(kManifest, name.c_str()) },
+    { "index.html", kIndex },
+    { "title.js", "document.title = '" + name + "';" },
+  };
+  for (size_t i = 0; i < arraysize(files); ++i) {
+    const std::string& data = files[i][1];
+    ASSERT_EQ(static_cast<int>(data.size()),
+              file_util::WriteFile(dir.AppendASCII(files[i][0]),
+                                   data.data(), data.size()));
+  }
+}
+
+}  // namespace
+
+// Runs two applications in the same browser process.
+class ApplicationMultipleBrowserTest : public ApplicationBrowserTest {
+ public:
+  virtual void SetUpCommandLine(CommandLine* command_line) OVERRIDE {
+    ApplicationBrowserTest::SetUpCommandLine(command_line);
+    ASSERT_TRUE(first_dir_.CreateUniqueTempDir());
+    ASSERT_TRUE(second_dir_.CreateUniqueTempDir());
+    WriteApplication(first_dir_.path(), "first");
+    WriteApplication(second_dir_.path(), "second");
+    command_line->AppendArg(net::FilePathToFileURL(first_dir_.path()).spec());
+  }
+
+ protected:
+  ApplicationSystem* system() {
+    return xwalk::RuntimeRegistry::Get()->runtimes()[0]->runtime_context()->
+        GetApplicationSystem();
+  }
+
+  base::ScopedTempDir first_dir_;
+  base::ScopedTempDir second_dir_;
+};
+
+IN_PROC_BROWSER_TEST_F(ApplicationMultipleBrowserTest, RunConcurrently) {
+  WaitForRuntimes(1);
+  xwalk::Runtime* first_runtime = xwalk::RuntimeRegistry::Get()->runtimes()[0];
+  content::WaitForLoadStop(first_runtime->web_contents());
+  EXPECT_EQ(ASCIIToUTF16("first"), first_runtime->web_contents()->GetTitle());
+
+  ApplicationService* service = system()->application_service();
+  ASSERT_EQ(1u, service->GetRunningApplications().size());
+  const std::string first_id = service->GetRunningApplications().begin()->first;
+
+  std::string second_id;
+  ASSERT_TRUE(service->Launch(second_dir_.path(), &second_id));
+  EXPECT_NE(first_id, second_id);
+  WaitForRuntimes(2);
+  xwalk::Runtime* second_runtime = xwalk::RuntimeRegistry::Get()->runtimes()[1];
+  content::TitleWatcher title_watcher(second_runtime->web_contents(),
+                                      ASCIIToUTF16("second"));
+  EXPECT_EQ(ASCIIToUTF16("second"), title_watcher.WaitAndGetTitle());
+
+  // Each application has its own runtimes and serves its own resources.
+  EXPECT_EQ(2u, service->GetRunningApplications().size());
+  xwalk::application::ApplicationProcessManager* process_manager =
+      system()->process_manager();
+  EXPECT_EQ(first_id, process_manager->GetApplicationID(first_runtime));
+  EXPECT_EQ(second_id, process_manager->GetApplicationID(second_runtime));
+  EXPECT_EQ(second_id, second_runtime->web_contents()->GetURL().host());
+
+  // Launching an application running already doesn't open another window.
+  std::string id;
+  EXPECT_TRUE(service->Launch(second_dir_.path(), &id));
+  content::RunAllPendingInMessageLoop();
+  EXPECT_EQ(2, GetRuntimeNumber());
+
+  // Terminating an application leaves the other one running.
+  EXPECT_TRUE(service->Terminate(second_id));
+  WaitForRuntimes(1);
+  EXPECT_FALSE(service->GetRunningApplication(second_id));
+  EXPECT_TRUE(service->GetRunningApplication(first_id));
+  EXPECT_EQ(first_runtime, xwalk::RuntimeRegistry::Get()->runtimes()[0]);
+}
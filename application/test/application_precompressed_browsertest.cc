@@ -0,0 +1,120 @@
+// Copyright (c) 2013 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <string>
+
+#include "base/file_util.h"
+#include "base/files/scoped_temp_dir.h"
+#include "base/strings/stringprintf.h"
+#include "base/strings/utf_string_conversions.h"
+#include "base/time/time.h"
+#include "content/public/browser/web_contents.h"
+#include "content/public/test/browser_test_utils.h"
+#include "content/public/test/test_utils.h"
+#include "net/base/net_util.h"
+#include "xwalk/application/browser/installer/resource_precompressor.h"
+#include "xwalk/application/test/application_browsertest.h"
+#include "xwalk/runtime/browser/runtime.h"
+#include "xwalk/runtime/browser/runtime_registry.h"
+
+namespace {
+
+const char kManifest[] =
+    "{\n"
+    "  \"name\": \"precompressed_test\",\n"
+    "  \"manifest_version\": 1,\n"
+    "  \"version\": \"1.0\",\n"
+    "  \"app\": {\n"
+    "    \"launch\": {\n"
+    "      \"local_path\": \"index.html\"\n"
+    "    }\n"
+    "  }\n"
+    "}\n";
+
+const char kIndex[] =
+    "<html><head><script src=\"bundle.js\"></script></head></html>";
+
+// A script of a few megabytes, the size of the bundles of big applications,
+// which sets the title of the document once it has run.
+std::string MakeBundle() {
+  std::string bundle;
+  for (int i = 0; i < 50000; ++i) {
+    bundle += base::StringPrintf(
+        "function handler%d(event) { return event.target.id + '%d'; }\n",
+        i, i);
+  }
+  bundle += "document.title = 'Pass';\n";
+  return bundle;
+}
+
+}  // namespace
+
+// Loads an application with a big script, read as is or from the compressed
+// copy written when the application was installed.
+class ApplicationPrecompressedBrowserTest : public ApplicationBrowserTest {
+ public:
+  virtual void SetUpCommandLine(CommandLine* command_line) OVERRIDE {
+    ApplicationBrowserTest::SetUpCommandLine(command_line);
+    ASSERT_TRUE(app_dir_.CreateUniqueTempDir());
+    WriteFile("manifest.json", kManifest);
+    WriteFile("index.html", kIndex);
+    const std::string bundle = MakeBundle();
+    WriteFile("bundle.js", bundle);
+    if (ShouldPrecompress()) {
+      ASSERT_EQ(1, xwalk::application::PrecompressResources(app_dir_.path()));
+      // Only the compressed copy makes the page pass. The script keeps its
+      // size, which the response reports, and is made older than its copy,
+      // which would be ignored otherwise.
+      std::string failing_bundle = "document.title = 'Fail';\n";
+      failing_bundle.resize(bundle.size(), ' ');
+      WriteFile("bundle.js", failing_bundle);
+      const base::Time past =
+          base::Time::Now() - base::TimeDelta::FromDays(1);
+      ASSERT_TRUE(file_util::TouchFile(app_dir_.path().AppendASCII("bundle.js"),
+                                       past, past));
+    }
+
+    command_line->AppendArg(net::FilePathToFileURL(app_dir_.path()).spec());
+  }
+
+ protected:
+  virtual bool ShouldPrecompress() const = 0;
+
+  void WriteFile(const std::string& name, const std::string& data) {
+    ASSERT_EQ(static_cast<int>(data.size()),
+              file_util::WriteFile(app_dir_.path().AppendASCII(name),
+                                   data.data(), data.size()));
+  }
+
+  // Waits for the application to be loaded. The page checks that the script
+  // it loaded is complete.
+  void WaitForApplication() {
+    WaitForRuntimes(1);
+    content::WebContents* web_contents =
+        xwalk::RuntimeRegistry::Get()->runtimes()[0]->web_contents();
+    content::WaitForLoadStop(web_contents);
+    EXPECT_EQ(ASCIIToUTF16("Pass"), web_contents->GetTitle());
+  }
+
+  base::ScopedTempDir app_dir_;
+};
+
+class ApplicationUncompressedBrowserTest
+    : public ApplicationPrecompressedBrowserTest {
+ protected:
+  virtual bool ShouldPrecompress() const OVERRIDE { return false; }
+};
+
+class ApplicationGzipBrowserTest : public ApplicationPrecompressedBrowserTest {
+ protected:
+  virtual bool ShouldPrecompress() const OVERRIDE { return true; }
+};
+
+IN_PROC_BROWSER_TEST_F(ApplicationGzipBrowserTest, LoadCompressedCopy) {
+  WaitForApplication();
+}
+
+IN_PROC_BROWSER_TEST_F(ApplicationUncompressedBrowserTest, LoadResource) {
+  WaitForApplication();
+}
@@ -0,0 +1,184 @@
+// Copyright (c) 2013 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <string>
+
+#include "base/file_util.h"
+#include "base/files/scoped_temp_dir.h"
+#include "base/run_loop.h"
+#include "content/public/browser/notification_observer.h"
+#include "content/public/browser/notification_registrar.h"
+#include "content/public/browser/notification_service.h"
+#include "content/public/browser/notification_source.h"
+#include "content/public/browser/notification_types.h"
+#include "content/public/browser/render_process_host.h"
+#include "content/public/browser/web_contents.h"
+#include "content/public/browser/web_contents_observer.h"
+#include "content/public/test/test_utils.h"
+#include "xwalk/application/browser/application_process_manager.h"
+#include "xwalk/application/browser/application_service.h"
+#include "xwalk/application/browser/application_system.h"
+#include "xwalk/application/test/application_browsertest.h"
+#include "xwalk/runtime/browser/runtime.h"
+#include "xwalk/runtime/browser/runtime_context.h"
+#include "xwalk/runtime/browser/runtime_registry.h"
+#include "xwalk/runtime/common/xwalk_switches.h"
+
+using xwalk::application::ApplicationSystem;
+
+namespace {
+
+const char kManifest[] =
+    "{\n"
+    "  \"name\": \"prelaunch_test\",\n"
+    "  \"manifest_version\": 1,\n"
+    "  \"version\": \"1.0\",\n"
+    "  \"app\": {\n"
+    "    \"launch\": {\n"
+    "      \"local_path\": \"index.html\"\n"
+    "    }\n"
+    "  }\n"
+    "}\n";
+
+const char kIndex[] = "<html><body><h1>Launched</h1></body></html>";
+
+// The number of launches in a row.
+const int kLaunches = 3;
+
+class FirstPaintObserver : public content::WebContentsObserver {
+ public:
+  explicit FirstPaintObserver(content::WebContents* web_contents)
+      : content::WebContentsObserver(web_contents) {
+  }
+
+  void Wait() { run_loop_.Run(); }
+
+  virtual void DidFirstVisuallyNonEmptyPaint(int32 page_id) OVERRIDE {
+    run_loop_.Quit();
+  }
+
+ private:
+  base::RunLoop run_loop_;
+};
+
+// Counts the render processes created while it's alive.
+class ProcessCreationCounter : public content::NotificationObserver {
+ public:
+  ProcessCreationCounter() : count_(0) {
+    registrar_.Add(this, content::NOTIFICATION_RENDERER_PROCESS_CREATED,
+                   content::NotificationService::AllSources());
+  }
+
+  virtual void Observe(int type,
+                       const content::NotificationSource& source,
+                       const content::NotificationDetails& details) OVERRIDE {
+    ++count_;
+  }
+
+  int count() const { return count_; }
+
+ private:
+  content::NotificationRegistrar registrar_;
+  int count_;
+};
+
+}  // namespace
+
+// Launches an application with or without render processes started ahead of
+// time.
+class ApplicationPrelaunchBrowserTest : public ApplicationBrowserTest {
+ public:
+  virtual void SetUpCommandLine(CommandLine* command_line) OVERRIDE {
+    ApplicationBrowserTest::SetUpCommandLine(command_line);
+    ASSERT_TRUE(app_dir_.CreateUniqueTempDir());
+    WriteFile("manifest.json", kManifest);
+    WriteFile("index.html", kIndex);
+    if (ShouldPrelaunch())
+      command_line->AppendSwitchASCII(switches::kPrelaunchRenderers, "1");
+  }
+
+ protected:
+  virtual bool ShouldPrelaunch() const = 0;
+
+  void WriteFile(const std::string& name, const std::string& data) {
+    ASSERT_EQ(static_cast<int>(data.size()),
+              file_util::WriteFile(app_dir_.path().AppendASCII(name),
+                                   data.data(), data.size()));
+  }
+
+  base::ScopedTempDir app_dir_;
+};
+
+class ApplicationColdLaunchBrowserTest
+    : public ApplicationPrelaunchBrowserTest {
+ protected:
+  virtual bool ShouldPrelaunch() const OVERRIDE { return false; }
+};
+
+class ApplicationWarmLaunchBrowserTest
+    : public ApplicationPrelaunchBrowserTest {
+ protected:
+  virtual bool ShouldPrelaunch() const OVERRIDE { return true; }
+};
+
+IN_PROC_BROWSER_TEST_F(ApplicationWarmLaunchBrowserTest,
+                       LaunchInPrelaunchedProcess) {
+  ApplicationSystem* system = xwalk::RuntimeRegistry::Get()->runtimes()[0]->
+      runtime_context()->GetApplicationSystem();
+  scoped_ptr<content::WindowedNotificationObserver> process_started(
+      new content::WindowedNotificationObserver(
+          content::NOTIFICATION_RENDERER_PROCESS_CREATED,
+          content::NotificationService::AllSources()));
+  system->process_manager()->PrelaunchRenderers();
+
+  // The pool starts the next process once one is taken, each launch gets
+  // one.
+  for (int i = 0; i < kLaunches; ++i) {
+    process_started->Wait();
+    content::RenderProcessHost* prelaunched =
+        content::Source<content::RenderProcessHost>(
+            process_started->source()).ptr();
+    EXPECT_TRUE(system->process_manager()->IsPrelaunchedProcess(prelaunched));
+    process_started.reset(new content::WindowedNotificationObserver(
+        content::NOTIFICATION_RENDERER_PROCESS_CREATED,
+        content::NotificationService::AllSources()));
+
+    std::string app_id;
+    ASSERT_TRUE(system->application_service()->Launch(app_dir_.path(),
+                                                      &app_id));
+    content::WebContents* web_contents =
+        xwalk::RuntimeRegistry::Get()->runtimes().back()->web_contents();
+    EXPECT_EQ(prelaunched, web_contents->GetRenderProcessHost());
+    EXPECT_FALSE(
+        system->process_manager()->IsPrelaunchedProcess(prelaunched));
+    FirstPaintObserver first_paint(web_contents);
+    first_paint.Wait();
+
+    EXPECT_TRUE(system->application_service()->Terminate(app_id));
+    content::RunAllPendingInMessageLoop();
+  }
+}
+
+// Without the switch no process is started ahead of time, the application
+// gets a new one.
+IN_PROC_BROWSER_TEST_F(ApplicationColdLaunchBrowserTest,
+                       LaunchInNewProcess) {
+  ApplicationSystem* system = xwalk::RuntimeRegistry::Get()->runtimes()[0]->
+      runtime_context()->GetApplicationSystem();
+  ProcessCreationCounter counter;
+  system->process_manager()->PrelaunchRenderers();
+  content::RunAllPendingInMessageLoop();
+  EXPECT_EQ(0, counter.count());
+
+  std::string app_id;
+  ASSERT_TRUE(system->application_service()->Launch(app_dir_.path(),
+                                                    &app_id));
+  content::WebContents* web_contents =
+      xwalk::RuntimeRegistry::Get()->runtimes().back()->web_contents();
+  FirstPaintObserver first_paint(web_contents);
+  first_paint.Wait();
+  EXPECT_EQ(1, counter.count());
+  EXPECT_FALSE(system->process_manager()->IsPrelaunchedProcess(
+      web_contents->GetRenderProcessHost()));
+}
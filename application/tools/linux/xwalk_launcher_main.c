@@ -60,12 +60,13 @@ static void on_app_properties_changed(GDBusProxy* proxy,
   g_variant_get(changed_properties, "a{sv}", &iter);
 
   while (g_variant_iter_loop(iter, "{&sv}", &key, &value)) {
-    if (g_strcmp0(key, "State"))
-      continue;
-
-    const gchar* state = g_variant_get_string(value, NULL);
-
-    fprintf(stderr, "Application state %s\n", state);
+    if (!g_strcmp0(key, "State")) {
+      const gchar* state = g_variant_get_string(value, NULL);
+      fprintf(stderr, "Application state %s\n", state);
+    } else if (!g_strcmp0(key, "TimeToVisible")) {
+      fprintf(stderr, "Application visible after %d ms\n",
+              g_variant_get_int32(value));
+    }
   }
 }
 
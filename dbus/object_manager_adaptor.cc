@@ -6,6 +6,7 @@
 
 #include <vector>
 #include "base/bind.h"
+#include "base/stl_util.h"
 #include "dbus/bus.h"
 #include "dbus/message.h"
 
@@ -23,7 +24,8 @@ ObjectManagerAdaptor::ObjectManagerAdaptor(scoped_refptr<Bus> bus,
       manager_path_(manager_path),
       manager_object_(bus->GetExportedObject(manager_path)),
       bus_(bus),
-      is_exported_(false) {
+      is_exported_(false),
+      batch_depth_(0) {
   manager_object_->ExportMethod(
       kDBusObjectManagerInterface, "GetManagedObjects",
       base::Bind(&ObjectManagerAdaptor::OnGetManagedObjects,
@@ -38,48 +40,50 @@ ObjectManagerAdaptor::~ObjectManagerAdaptor() {
 }
 
 void ObjectManagerAdaptor::AddManagedObject(scoped_ptr<ManagedObject> object) {
-  EmitInterfacesAdded(object.get());
-  managed_objects_.push_back(object.release());
-}
-
-namespace {
-
-struct MatchObjectPath {
- public:
-  explicit MatchObjectPath(const ObjectPath& path) : path_(path) {}
-  bool operator()(const ManagedObject* object) {
-    return path_ == object->path();
+  const ObjectPath path = object->path();
+  ManagedObject*& managed_object = managed_objects_[path];
+  if (managed_object) {
+    LOG(WARNING) << "Error adding object already managed with path: "
+                 << path.value();
+    return;
   }
-  const ObjectPath path_;
-};
+  managed_object = object.release();
 
-}  // namespace
+  if (batch_depth_ > 0)
+    batch_added_.insert(path);
+  else
+    EmitInterfacesAdded(managed_object);
+}
 
 void ObjectManagerAdaptor::RemoveManagedObject(const ObjectPath& path) {
-  ScopedVector<ManagedObject>::iterator it = std::find_if(
-      managed_objects_.begin(), managed_objects_.end(), MatchObjectPath(path));
+  ManagedObjectMap::iterator it = managed_objects_.find(path);
   if (it == managed_objects_.end()) {
     LOG(WARNING) << "Error removing unmanaged object with path: "
                  << path.value();
     return;
   }
 
-  EmitInterfacesRemoved(*it);
+  if (batch_depth_ > 0) {
+    // An object added during the batch was never announced.
+    if (!batch_added_.erase(path))
+      batch_removed_.insert(std::make_pair(path, it->second->interfaces()));
+  } else {
+    EmitInterfacesRemoved(path, it->second->interfaces());
+  }
 
   // We need to explicitly unregister the exported object, otherwise the Bus
   // would keep it alive.
   bus_->UnregisterExportedObject(path);
 
-  // Since this is a ScopedVector, erasing will actually destroy the value.
+  delete it->second;
   managed_objects_.erase(it);
 }
 
 ManagedObject* ObjectManagerAdaptor::GetManagedObject(const ObjectPath& path) {
-  ScopedVector<ManagedObject>::iterator it = std::find_if(
-      managed_objects_.begin(), managed_objects_.end(), MatchObjectPath(path));
+  ManagedObjectMap::iterator it = managed_objects_.find(path);
   if (it == managed_objects_.end())
     return NULL;
-  return *it;
+  return it->second;
 }
 
 void ObjectManagerAdaptor::OnGetManagedObjects(
@@ -92,9 +96,9 @@ void ObjectManagerAdaptor::OnGetManagedObjects(
   MessageWriter dict_writer(NULL);
   writer.OpenArray("{oa{sa{sv}}}", &dict_writer);
 
-  ScopedVector<ManagedObject>::const_iterator it;
+  ManagedObjectMap::const_iterator it;
   for (it = managed_objects_.begin(); it != managed_objects_.end(); ++it) {
-    ManagedObject* object = *it;
+    ManagedObject* object = it->second;
     MessageWriter entry_writer(NULL);
 
     dict_writer.OpenDictEntry(&entry_writer);
@@ -121,14 +125,13 @@ void ObjectManagerAdaptor::OnExported(const std::string& interface_name,
 }
 
 void ObjectManagerAdaptor::RemoveAllManagedObjects() {
-  ScopedVector<ManagedObject>::iterator it = managed_objects_.begin();
+  ManagedObjectMap::iterator it = managed_objects_.begin();
   for (; it != managed_objects_.end(); ++it) {
-    EmitInterfacesRemoved(*it);
-    bus_->UnregisterExportedObject((*it)->path());
+    EmitInterfacesRemoved(it->first, it->second->interfaces());
+    bus_->UnregisterExportedObject(it->first);
   }
 
-  // Since this is a ScopedVector, clearing will destroy all values.
-  managed_objects_.clear();
+  STLDeleteValues(&managed_objects_);
 }
 
 void ObjectManagerAdaptor::EmitInterfacesAdded(const ManagedObject* object) {
@@ -146,7 +149,8 @@ void ObjectManagerAdaptor::EmitInterfacesAdded(const ManagedObject* object) {
   manager_object_->SendSignal(&interfaces_added);
 }
 
-void ObjectManagerAdaptor::EmitInterfacesRemoved(const ManagedObject* object) {
+void ObjectManagerAdaptor::EmitInterfacesRemoved(
+    const ObjectPath& path, const std::vector<std::string>& interfaces) {
   // See comment in EmitInterfacesAdded().
   if (!is_exported_)
     return;
@@ -154,11 +158,38 @@ void ObjectManagerAdaptor::EmitInterfacesRemoved(const ManagedObject* object) {
   Signal interfaces_removed(kDBusObjectManagerInterface, "InterfacesRemoved");
   MessageWriter writer(&interfaces_removed);
 
-  writer.AppendObjectPath(object->path());
-  object->AppendInterfacesToWriter(&writer);
+  writer.AppendObjectPath(path);
+  writer.AppendArrayOfStrings(interfaces);
   manager_object_->SendSignal(&interfaces_removed);
 }
 
+void ObjectManagerAdaptor::EndBatch() {
+  DCHECK_GT(batch_depth_, 0);
+  if (--batch_depth_ > 0)
+    return;
+
+  // Removals first, an object removed then added again is announced last.
+  std::map<ObjectPath, std::vector<std::string> >::const_iterator
+      removed_it = batch_removed_.begin();
+  for (; removed_it != batch_removed_.end(); ++removed_it)
+    EmitInterfacesRemoved(removed_it->first, removed_it->second);
+  batch_removed_.clear();
+
+  std::set<ObjectPath>::const_iterator added_it = batch_added_.begin();
+  for (; added_it != batch_added_.end(); ++added_it)
+    EmitInterfacesAdded(managed_objects_[*added_it]);
+  batch_added_.clear();
+}
+
+ObjectManagerAdaptor::ScopedBatch::ScopedBatch(ObjectManagerAdaptor* adaptor)
+    : adaptor_(adaptor) {
+  ++adaptor_->batch_depth_;
+}
+
+ObjectManagerAdaptor::ScopedBatch::~ScopedBatch() {
+  adaptor_->EndBatch();
+}
+
 ManagedObject::ManagedObject(scoped_refptr<Bus> bus, const ObjectPath& path)
     : dbus_object_(bus->GetExportedObject(path)),
       path_(path),
@@ -186,8 +217,8 @@ void ManagedObject::AppendAllPropertiesToWriter(MessageWriter* writer) const {
   writer->CloseContainer(&interfaces_writer);
 }
 
-void ManagedObject::AppendInterfacesToWriter(MessageWriter* writer) const {
-  writer->AppendArrayOfStrings(properties_.interfaces());
+std::vector<std::string> ManagedObject::interfaces() const {
+  return properties_.interfaces();
 }
 
 }  // namespace dbus
@@ -5,9 +5,11 @@
 #ifndef XWALK_DBUS_OBJECT_MANAGER_ADAPTOR_H_
 #define XWALK_DBUS_OBJECT_MANAGER_ADAPTOR_H_
 
+#include <map>
+#include <set>
 #include <string>
+#include <vector>
 #include "base/memory/ref_counted.h"
-#include "base/memory/scoped_vector.h"
 #include "base/memory/weak_ptr.h"
 #include "dbus/exported_object.h"
 #include "xwalk/dbus/property_exporter.h"
@@ -24,6 +26,20 @@ class ManagedObject;
 // exported at that path, use manager_object().
 class ObjectManagerAdaptor {
  public:
+  // Holds back the InterfacesAdded and InterfacesRemoved signals while alive,
+  // for bulk operations: they are emitted when the last batch ends, and none
+  // is emitted for an object both added and removed during the batch.
+  class ScopedBatch {
+   public:
+    explicit ScopedBatch(ObjectManagerAdaptor* adaptor);
+    ~ScopedBatch();
+
+   private:
+    ObjectManagerAdaptor* adaptor_;
+
+    DISALLOW_COPY_AND_ASSIGN(ScopedBatch);
+  };
+
   ObjectManagerAdaptor(scoped_refptr<Bus> bus, const ObjectPath& manager_path);
   virtual ~ObjectManagerAdaptor();
 
@@ -44,7 +60,9 @@ class ObjectManagerAdaptor {
 
   void RemoveAllManagedObjects();
   void EmitInterfacesAdded(const ManagedObject* object);
-  void EmitInterfacesRemoved(const ManagedObject* object);
+  void EmitInterfacesRemoved(const ObjectPath& path,
+                             const std::vector<std::string>& interfaces);
+  void EndBatch();
 
   base::WeakPtrFactory<ObjectManagerAdaptor> weak_factory_;
 
@@ -54,9 +72,16 @@ class ObjectManagerAdaptor {
   ExportedObject* manager_object_;
   scoped_refptr<Bus> bus_;
 
-  ScopedVector<ManagedObject> managed_objects_;
+  typedef std::map<ObjectPath, ManagedObject*> ManagedObjectMap;
+  ManagedObjectMap managed_objects_;
   bool is_exported_;
 
+  // Number of ScopedBatch alive, and the signals they hold back. The
+  // interfaces of the removed objects are kept since they are destroyed.
+  int batch_depth_;
+  std::set<ObjectPath> batch_added_;
+  std::map<ObjectPath, std::vector<std::string> > batch_removed_;
+
   DISALLOW_COPY_AND_ASSIGN(ObjectManagerAdaptor);
 };
 
@@ -69,7 +94,7 @@ class ManagedObject {
 
   ObjectPath path() const;
   void AppendAllPropertiesToWriter(MessageWriter* writer) const;
-  void AppendInterfacesToWriter(MessageWriter* writer) const;
+  std::vector<std::string> interfaces() const;
 
   ExportedObject* dbus_object() { return dbus_object_; }
   PropertyExporter* properties() { return &properties_; }
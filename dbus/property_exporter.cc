@@ -6,6 +6,7 @@
 
 #include <string>
 #include "base/bind.h"
+#include "base/message_loop/message_loop.h"
 #include "base/stl_util.h"
 #include "base/values.h"
 #include "dbus/message.h"
@@ -15,13 +16,46 @@ namespace {
 
 const char kErrorName[] = "org.freedesktop.DBus.Properties.Error";
 
+bool IsSupportedValue(const base::Value& value) {
+  switch (value.GetType()) {
+    case base::Value::TYPE_BOOLEAN:
+    case base::Value::TYPE_INTEGER:
+    case base::Value::TYPE_DOUBLE:
+    case base::Value::TYPE_STRING:
+      return true;
+    case base::Value::TYPE_LIST: {
+      const base::ListValue* list;
+      value.GetAsList(&list);
+      for (base::ListValue::const_iterator it = list->begin();
+           it != list->end(); ++it) {
+        if (!IsSupportedValue(**it))
+          return false;
+      }
+      return true;
+    }
+    case base::Value::TYPE_DICTIONARY: {
+      const base::DictionaryValue* dict;
+      value.GetAsDictionary(&dict);
+      for (base::DictionaryValue::Iterator it(*dict); !it.IsAtEnd();
+           it.Advance()) {
+        if (!IsSupportedValue(it.value()))
+          return false;
+      }
+      return true;
+    }
+    default:
+      return false;
+  }
+}
+
 }  // namespace
 
 namespace dbus {
 
 PropertyExporter::PropertyExporter(ExportedObject* object,
                                    const ObjectPath& path)
-    : path_(path),
+    : object_(object),
+      path_(path),
       weak_factory_(this) {
   CHECK(object);
   object->ExportMethod(
@@ -41,42 +75,132 @@ PropertyExporter::~PropertyExporter() {
 void PropertyExporter::Set(const std::string& interface,
                            const std::string& property,
                            scoped_ptr<base::Value> value) {
-  // TODO(cmarcelo): Support more types as we need to use them.
-  if (!value->IsType(base::Value::TYPE_STRING)
-      && !value->IsType(base::Value::TYPE_INTEGER)) {
-    LOG(ERROR) << "PropertyExporter can only can "
-               << "export String and Integer properties";
+  if (!IsSupportedValue(*value)) {
+    LOG(ERROR) << "PropertyExporter can't export null or binary values, "
+               << "property '" << property << "' ignored.";
     return;
   }
 
   InterfacesMap::iterator it = interfaces_.find(interface);
-  base::DictionaryValue* dict;
-  if (it != interfaces_.end()) {
-    dict = it->second;
-  } else {
-    dict = new DictionaryValue;
+  if (it == interfaces_.end()) {
+    // A new interface is announced with all its properties by other means,
+    // like the InterfacesAdded signal of ObjectManagerAdaptor.
+    DictionaryValue* dict = new DictionaryValue;
+    dict->SetWithoutPathExpansion(property, value.release());
     interfaces_[interface] = dict;
+    return;
   }
 
-  dict->Set(property, value.release());
+  const base::Value* old_value = NULL;
+  if (it->second->GetWithoutPathExpansion(property, &old_value) &&
+      old_value->Equals(value.get()))
+    return;
+  it->second->SetWithoutPathExpansion(property, value.release());
+
+  // The signals are sent once the current task is done.
+  if (changed_properties_.empty()) {
+    base::MessageLoop::current()->PostTask(
+        FROM_HERE,
+        base::Bind(&PropertyExporter::EmitPropertiesChanged,
+                   weak_factory_.GetWeakPtr()));
+  }
+  changed_properties_[interface].insert(property);
+}
 
-  // TODO(cmarcelo): Emit PropertyChanged signal.
+// static
+std::string PropertyExporter::GetSignature(const base::Value& value) {
+  switch (value.GetType()) {
+    case base::Value::TYPE_BOOLEAN:
+      return "b";
+    case base::Value::TYPE_INTEGER:
+      return "i";
+    case base::Value::TYPE_DOUBLE:
+      return "d";
+    case base::Value::TYPE_STRING:
+      return "s";
+    case base::Value::TYPE_LIST: {
+      const base::ListValue* list;
+      value.GetAsList(&list);
+      if (list->empty())
+        return "av";
+      const std::string element_signature = GetSignature(**list->begin());
+      for (base::ListValue::const_iterator it = list->begin() + 1;
+           it != list->end(); ++it) {
+        if (GetSignature(**it) != element_signature)
+          return "av";
+      }
+      return "a" + element_signature;
+    }
+    case base::Value::TYPE_DICTIONARY:
+      return "a{sv}";
+    default:
+      NOTREACHED();
+      return std::string();
+  }
 }
 
 namespace {
 
-void AppendVariantOfValue(MessageWriter* writer, const base::Value& value) {
+void AppendVariantOfValue(MessageWriter* writer, const base::Value& value);
+
+void AppendValue(MessageWriter* writer, const base::Value& value) {
   switch (value.GetType()) {
-    case base::Value::TYPE_STRING: {
-      std::string s;
-      value.GetAsString(&s);
-      writer->AppendVariantOfString(s);
+    case base::Value::TYPE_BOOLEAN: {
+      bool b;
+      value.GetAsBoolean(&b);
+      writer->AppendBool(b);
       break;
     }
     case base::Value::TYPE_INTEGER: {
       int n;
       value.GetAsInteger(&n);
-      writer->AppendVariantOfInt32(n);
+      writer->AppendInt32(n);
+      break;
+    }
+    case base::Value::TYPE_DOUBLE: {
+      double d;
+      value.GetAsDouble(&d);
+      writer->AppendDouble(d);
+      break;
+    }
+    case base::Value::TYPE_STRING: {
+      std::string s;
+      value.GetAsString(&s);
+      writer->AppendString(s);
+      break;
+    }
+    case base::Value::TYPE_LIST: {
+      const base::ListValue* list;
+      value.GetAsList(&list);
+      // Drop the leading 'a' to get the signature of the elements.
+      const std::string element_signature =
+          PropertyExporter::GetSignature(value).substr(1);
+      MessageWriter array_writer(NULL);
+      writer->OpenArray(element_signature, &array_writer);
+      for (base::ListValue::const_iterator it = list->begin();
+           it != list->end(); ++it) {
+        if (element_signature == "v")
+          AppendVariantOfValue(&array_writer, **it);
+        else
+          AppendValue(&array_writer, **it);
+      }
+      writer->CloseContainer(&array_writer);
+      break;
+    }
+    case base::Value::TYPE_DICTIONARY: {
+      const base::DictionaryValue* dict;
+      value.GetAsDictionary(&dict);
+      MessageWriter dict_writer(NULL);
+      writer->OpenArray("{sv}", &dict_writer);
+      for (base::DictionaryValue::Iterator it(*dict); !it.IsAtEnd();
+           it.Advance()) {
+        MessageWriter entry_writer(NULL);
+        dict_writer.OpenDictEntry(&entry_writer);
+        entry_writer.AppendString(it.key());
+        AppendVariantOfValue(&entry_writer, it.value());
+        dict_writer.CloseContainer(&entry_writer);
+      }
+      writer->CloseContainer(&dict_writer);
       break;
     }
     default:
@@ -84,6 +208,13 @@ void AppendVariantOfValue(MessageWriter* writer, const base::Value& value) {
   }
 }
 
+void AppendVariantOfValue(MessageWriter* writer, const base::Value& value) {
+  MessageWriter variant_writer(NULL);
+  writer->OpenVariant(PropertyExporter::GetSignature(value), &variant_writer);
+  AppendValue(&variant_writer, value);
+  writer->CloseContainer(&variant_writer);
+}
+
 scoped_ptr<Response> CreateParseError(MethodCall* method_call) {
   scoped_ptr<ErrorResponse> error_response = ErrorResponse::FromMethodCall(
       method_call, kErrorName, "Error parsing arguments.");
@@ -156,7 +287,7 @@ void PropertyExporter::OnGet(
 
   const DictionaryValue* dict = it->second;
   const base::Value* value = NULL;
-  if (!dict->Get(property, &value)) {
+  if (!dict->GetWithoutPathExpansion(property, &value)) {
     scoped_ptr<ErrorResponse> error_response = ErrorResponse::FromMethodCall(
         method_call, kErrorName,
         "Property '" + property + "' of interface '" + interface
@@ -195,6 +326,40 @@ void PropertyExporter::OnGetAll(
   response_sender.Run(response.Pass());
 }
 
+void PropertyExporter::EmitPropertiesChanged() {
+  ChangedPropertiesMap changed_properties;
+  changed_properties.swap(changed_properties_);
+
+  ChangedPropertiesMap::const_iterator it = changed_properties.begin();
+  for (; it != changed_properties.end(); ++it) {
+    const base::DictionaryValue* dict = interfaces_[it->first];
+    Signal signal(kPropertiesInterface, kPropertiesChanged);
+    MessageWriter writer(&signal);
+    writer.AppendString(it->first);
+
+    MessageWriter dict_writer(NULL);
+    writer.OpenArray("{sv}", &dict_writer);
+    std::set<std::string>::const_iterator property_it = it->second.begin();
+    for (; property_it != it->second.end(); ++property_it) {
+      const base::Value* value = NULL;
+      dict->GetWithoutPathExpansion(*property_it, &value);
+      MessageWriter entry_writer(NULL);
+      dict_writer.OpenDictEntry(&entry_writer);
+      entry_writer.AppendString(*property_it);
+      AppendVariantOfValue(&entry_writer, *value);
+      dict_writer.CloseContainer(&entry_writer);
+    }
+    writer.CloseContainer(&dict_writer);
+
+    // No property is invalidated without its new value.
+    MessageWriter invalidated_writer(NULL);
+    writer.OpenArray("s", &invalidated_writer);
+    writer.CloseContainer(&invalidated_writer);
+
+    object_->SendSignal(&signal);
+  }
+}
+
 void PropertyExporter::OnExported(const std::string& interface_name,
                                   const std::string& method_name,
                                   bool success) {
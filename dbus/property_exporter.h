@@ -6,6 +6,7 @@
 #define XWALK_DBUS_PROPERTY_EXPORTER_H_
 
 #include <map>
+#include <set>
 #include <string>
 #include <vector>
 #include "base/memory/scoped_ptr.h"
@@ -24,7 +25,13 @@ class MessageWriter;
 
 // Exports org.freedesktop.DBus.Properties interface for the given
 // ExportedObject. Properties should be set directly into the exporter object
-// using the function Set().
+// using the function Set(), which emits the PropertiesChanged signal when an
+// interface already exported changes. The changes made during one task are
+// sent together, in one signal per interface.
+//
+// Values of any base::Value type but null and binary are exported: lists are
+// arrays of their elements' type when they all have the same, of variants
+// otherwise, and dictionaries are a{sv}.
 class PropertyExporter {
  public:
   PropertyExporter(dbus::ExportedObject* object, const dbus::ObjectPath& path);
@@ -34,6 +41,9 @@ class PropertyExporter {
            const std::string& property,
            scoped_ptr<base::Value>);
 
+  // Returns the D-Bus signature used to export |value|.
+  static std::string GetSignature(const base::Value& value);
+
   // TODO(cmarcelo): We need some callback to indicate when all the methods
   // were exported.
 
@@ -50,10 +60,17 @@ class PropertyExporter {
   void OnExported(const std::string& interface_name,
                   const std::string& method_name,
                   bool success);
+  void EmitPropertiesChanged();
 
   typedef std::map<std::string, base::DictionaryValue*> InterfacesMap;
   InterfacesMap interfaces_;
 
+  // The properties changed since the last PropertiesChanged signals, by
+  // interface.
+  typedef std::map<std::string, std::set<std::string> > ChangedPropertiesMap;
+  ChangedPropertiesMap changed_properties_;
+
+  dbus::ExportedObject* object_;
   dbus::ObjectPath path_;
   base::WeakPtrFactory<PropertyExporter> weak_factory_;
 };
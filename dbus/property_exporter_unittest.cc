@@ -8,6 +8,8 @@
 #include "base/run_loop.h"
 #include "base/values.h"
 #include "dbus/bus.h"
+#include "dbus/message.h"
+#include "dbus/object_proxy.h"
 #include "dbus/property.h"
 #include "testing/gtest/include/gtest/gtest.h"
 #include "xwalk/dbus/dbus_manager.h"
@@ -41,6 +43,10 @@ class ExportObjectWithPropertiesService {
     properties_->Set(kTestInterface, property, v.Pass());
   }
 
+  void SetProperty(const std::string& property, base::Value* value) {
+    properties_->Set(kTestInterface, property, make_scoped_ptr(value));
+  }
+
  private:
   void OnOwnershipCallback(const std::string& service_name, bool success) {
     ASSERT_TRUE(success)
@@ -99,6 +105,109 @@ class GetPropertyClient : public dbus::TestClient {
   int update_count_;
 };
 
+// Reads properties of other types than string.
+class GetTypedPropertiesClient : public dbus::TestClient {
+ public:
+  struct Properties : public dbus::PropertySet {
+    dbus::Property<bool> bool_property;
+    dbus::Property<double> double_property;
+    dbus::Property<std::vector<std::string> > list_property;
+    Properties(dbus::ObjectProxy* object_proxy,
+               const PropertyChangedCallback callback)
+        : dbus::PropertySet(object_proxy, kTestInterface, callback) {
+      RegisterProperty("BoolProperty", &bool_property);
+      RegisterProperty("DoubleProperty", &double_property);
+      RegisterProperty("ListProperty", &list_property);
+    }
+  };
+
+  explicit GetTypedPropertiesClient(base::MessageLoop* message_loop)
+      : message_loop_(message_loop),
+        update_count_(0) {
+    dbus::ObjectProxy* object_proxy =
+        bus_->GetObjectProxy(kTestServiceName, kTestObjectPath);
+    properties_.reset(
+        new Properties(object_proxy,
+                       base::Bind(&GetTypedPropertiesClient::OnPropertyChanged,
+                                  base::Unretained(this))));
+  }
+
+  void WaitForUpdates(int count) {
+    while (update_count_ < count)
+      message_loop_->Run();
+    update_count_ -= count;
+  }
+
+  Properties* properties() { return properties_.get(); }
+
+ private:
+  void OnPropertyChanged(const std::string& property_name) {
+    update_count_++;
+    message_loop_->Quit();
+  }
+
+  scoped_ptr<Properties> properties_;
+  base::MessageLoop* message_loop_;
+  int update_count_;
+};
+
+// Counts the PropertiesChanged signals, and the properties they carry.
+class PropertiesChangedCounter : public dbus::TestClient {
+ public:
+  explicit PropertiesChangedCounter(base::MessageLoop* message_loop)
+      : message_loop_(message_loop),
+        signal_count_(0),
+        last_property_count_(0) {
+    // Not the proxy of GetPropertyClient, which has its own signal handler.
+    dbus::ObjectProxy* object_proxy = bus_->GetObjectProxyWithOptions(
+        kTestServiceName, kTestObjectPath,
+        dbus::ObjectProxy::IGNORE_SERVICE_UNKNOWN_ERRORS);
+    object_proxy->ConnectToSignal(
+        dbus::kPropertiesInterface, dbus::kPropertiesChanged,
+        base::Bind(&PropertiesChangedCounter::OnPropertiesChanged,
+                   base::Unretained(this)),
+        base::Bind(&PropertiesChangedCounter::OnConnected,
+                   base::Unretained(this)));
+    message_loop_->Run();
+  }
+
+  void WaitForSignals(int count) {
+    while (signal_count_ < count)
+      message_loop_->Run();
+  }
+
+  // Number of properties changed in the last signal received.
+  int last_property_count() const { return last_property_count_; }
+
+ private:
+  void OnPropertiesChanged(dbus::Signal* signal) {
+    dbus::MessageReader reader(signal);
+    std::string interface;
+    dbus::MessageReader dict_reader(NULL);
+    ASSERT_TRUE(reader.PopString(&interface));
+    ASSERT_TRUE(reader.PopArray(&dict_reader));
+    last_property_count_ = 0;
+    while (dict_reader.HasMoreData()) {
+      dbus::MessageReader entry_reader(NULL);
+      ASSERT_TRUE(dict_reader.PopDictEntry(&entry_reader));
+      last_property_count_++;
+    }
+    signal_count_++;
+    message_loop_->Quit();
+  }
+
+  void OnConnected(const std::string& interface_name,
+                   const std::string& signal_name,
+                   bool success) {
+    ASSERT_TRUE(success);
+    message_loop_->Quit();
+  }
+
+  base::MessageLoop* message_loop_;
+  int signal_count_;
+  int last_property_count_;
+};
+
 void CheckSuccessCallback(bool success) {
   ASSERT_TRUE(success);
 }
@@ -205,3 +314,104 @@ TEST(PropertyExporterTest, GetAll) {
   ASSERT_EQ(test_client.properties()->property.value(), "Pass");
   ASSERT_EQ(test_client.properties()->other_property.value(), "Pass");
 }
+
+// Change a property in the service, the client is notified of its new value
+// by the PropertiesChanged signal.
+TEST(PropertyExporterTest, PropertiesChanged) {
+  base::MessageLoop message_loop;
+  ExportObjectWithPropertiesService test_service;
+  GetPropertyClient test_client(&message_loop);
+
+  // Will run message loop until service is initialized.
+  test_service.Initialize(base::Bind(&base::MessageLoop::Quit,
+                                     base::Unretained(&message_loop)));
+  message_loop.Run();
+
+  test_service.SetStringProperty("Property", "Pass 1");
+  test_client.properties()->property.Get(base::Bind(&CheckSuccessCallback));
+  test_client.WaitForUpdates(1);
+  ASSERT_EQ(test_client.properties()->property.value(), "Pass 1");
+
+  // No Get this time.
+  test_service.SetStringProperty("Property", "Pass 2");
+  test_client.WaitForUpdates(1);
+  ASSERT_EQ(test_client.properties()->property.value(), "Pass 2");
+}
+
+// Change two properties in the same task, a single PropertiesChanged signal
+// carries both.
+TEST(PropertyExporterTest, PropertiesChangedCoalesced) {
+  base::MessageLoop message_loop;
+  ExportObjectWithPropertiesService test_service;
+  GetPropertyClient test_client(&message_loop);
+
+  // Will run message loop until service is initialized.
+  test_service.Initialize(base::Bind(&base::MessageLoop::Quit,
+                                     base::Unretained(&message_loop)));
+  message_loop.Run();
+  PropertiesChangedCounter counter(&message_loop);
+
+  test_service.SetStringProperty("Property", "Pass 1");
+  test_service.SetStringProperty("OtherProperty", "Pass 1");
+  test_client.properties()->GetAll();
+  test_client.WaitForUpdates(2);
+
+  test_service.SetStringProperty("Property", "Pass 2");
+  test_service.SetStringProperty("OtherProperty", "Pass 2");
+  test_client.WaitForUpdates(2);
+  ASSERT_EQ(test_client.properties()->property.value(), "Pass 2");
+  ASSERT_EQ(test_client.properties()->other_property.value(), "Pass 2");
+  counter.WaitForSignals(1);
+  ASSERT_EQ(2, counter.last_property_count());
+}
+
+// Get properties of types other than string.
+TEST(PropertyExporterTest, GetTypes) {
+  base::MessageLoop message_loop;
+  ExportObjectWithPropertiesService test_service;
+  GetTypedPropertiesClient test_client(&message_loop);
+
+  // Will run message loop until service is initialized.
+  test_service.Initialize(base::Bind(&base::MessageLoop::Quit,
+                                     base::Unretained(&message_loop)));
+  message_loop.Run();
+
+  base::ListValue* list = new base::ListValue;
+  list->AppendString("first");
+  list->AppendString("second");
+  test_service.SetProperty("BoolProperty",
+                           base::Value::CreateBooleanValue(true));
+  test_service.SetProperty("DoubleProperty",
+                           base::Value::CreateDoubleValue(0.5));
+  test_service.SetProperty("ListProperty", list);
+
+  test_client.properties()->GetAll();
+  test_client.WaitForUpdates(3);
+
+  ASSERT_TRUE(test_client.properties()->bool_property.value());
+  ASSERT_EQ(0.5, test_client.properties()->double_property.value());
+  ASSERT_EQ(2u, test_client.properties()->list_property.value().size());
+  ASSERT_EQ("second", test_client.properties()->list_property.value()[1]);
+}
+
+TEST(PropertyExporterTest, GetSignature) {
+  scoped_ptr<base::Value> value(base::Value::CreateBooleanValue(false));
+  EXPECT_EQ("b", dbus::PropertyExporter::GetSignature(*value));
+  value.reset(base::Value::CreateDoubleValue(1.5));
+  EXPECT_EQ("d", dbus::PropertyExporter::GetSignature(*value));
+
+  base::ListValue list;
+  EXPECT_EQ("av", dbus::PropertyExporter::GetSignature(list));
+  list.AppendInteger(1);
+  list.AppendInteger(2);
+  EXPECT_EQ("ai", dbus::PropertyExporter::GetSignature(list));
+  list.AppendString("three");
+  EXPECT_EQ("av", dbus::PropertyExporter::GetSignature(list));
+
+  base::DictionaryValue dict;
+  dict.SetString("key", "value");
+  EXPECT_EQ("a{sv}", dbus::PropertyExporter::GetSignature(dict));
+  base::ListValue dicts;
+  dicts.Append(dict.DeepCopy());
+  EXPECT_EQ("aa{sv}", dbus::PropertyExporter::GetSignature(dicts));
+}
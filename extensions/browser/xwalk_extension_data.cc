@@ -4,6 +4,7 @@
 
 #include "xwalk/extensions/browser/xwalk_extension_data.h"
 
+#include "base/sequenced_task_runner.h"
 #include "content/public/browser/browser_thread.h"
 #include "xwalk/extensions/browser/xwalk_extension_process_host.h"
 #include "xwalk/extensions/common/xwalk_extension_server.h"
@@ -29,6 +30,16 @@ XWalkExtensionData::~XWalkExtensionData() {
   extension_thread_->message_loop()->DeleteSoon(
       FROM_HERE, in_process_extension_thread_server_.release());
 
+  DCHECK_EQ(in_process_concurrent_servers_.size(),
+            in_process_concurrent_runners_.size());
+  std::vector<XWalkExtensionServer*> servers(
+      in_process_concurrent_servers_.get());
+  in_process_concurrent_servers_.weak_clear();
+  for (size_t i = 0; i < servers.size(); ++i) {
+    servers[i]->Invalidate();
+    in_process_concurrent_runners_[i]->DeleteSoon(FROM_HERE, servers[i]);
+  }
+
   if (extension_process_host_) {
     BrowserThread::DeleteSoon(
         BrowserThread::IO, FROM_HERE, extension_process_host_.release());
@@ -5,9 +5,13 @@
 #ifndef XWALK_EXTENSIONS_BROWSER_XWALK_EXTENSION_DATA_H_
 #define XWALK_EXTENSIONS_BROWSER_XWALK_EXTENSION_DATA_H_
 
+#include <vector>
+#include "base/memory/ref_counted.h"
 #include "base/memory/scoped_ptr.h"
+#include "base/memory/scoped_vector.h"
 
 namespace base {
+class SequencedTaskRunner;
 class Thread;
 }
 
@@ -57,6 +61,15 @@ class XWalkExtensionData {
     in_process_ui_thread_server_.reset(server.release());
   }
 
+  // Takes the ownership of the servers, each one is deleted using the task
+  // runner of the same index.
+  void set_in_process_concurrent_servers(
+      ScopedVector<XWalkExtensionServer>* servers,
+      const std::vector<scoped_refptr<base::SequencedTaskRunner> >& runners) {
+    in_process_concurrent_servers_.swap(*servers);
+    in_process_concurrent_runners_ = runners;
+  }
+
   // We don't take the ownership of the filter because filters are owned by
   // the IPC Channel they are filtering.
   void set_in_process_message_filter(ExtensionServerMessageFilter* filter) {
@@ -80,6 +93,11 @@ class XWalkExtensionData {
   scoped_ptr<XWalkExtensionServer> in_process_extension_thread_server_;
   scoped_ptr<XWalkExtensionServer> in_process_ui_thread_server_;
 
+  // Servers of concurrent extensions, each one living in its own sequence.
+  ScopedVector<XWalkExtensionServer> in_process_concurrent_servers_;
+  std::vector<scoped_refptr<base::SequencedTaskRunner> >
+      in_process_concurrent_runners_;
+
   // This object lives on the IO-thread.
   ExtensionServerMessageFilter* in_process_message_filter_;
 
@@ -5,6 +5,7 @@
 #include "xwalk/extensions/browser/xwalk_extension_function_handler.h"
 
 #include "base/location.h"
+#include "base/message_loop/message_loop_proxy.h"
 #include "xwalk/extensions/common/xwalk_external_instance.h"
 
 namespace xwalk {
@@ -57,13 +58,23 @@ void XWalkExtensionFunctionHandler::HandleMessage(scoped_ptr<base::Value> msg) {
   args->Remove(0, NULL);
   args->Remove(0, NULL);
 
+  // Results are dispatched on the thread handling the message, which is not
+  // always the instance's one (e.g. instances forwarding messages to the UI
+  // thread). The sequences of concurrent extensions have no message loop, so
+  // those use the sequence of the instance.
+  scoped_refptr<base::SequencedTaskRunner> client_task_runner =
+      base::MessageLoopProxy::current();
+  if (!client_task_runner)
+    client_task_runner = instance_->task_runner();
+  DCHECK(client_task_runner);
+
   scoped_ptr<XWalkExtensionFunctionInfo> info(
       new XWalkExtensionFunctionInfo(
           function_name,
           make_scoped_ptr(static_cast<base::ListValue*>(msg.release())),
           base::Bind(&XWalkExtensionFunctionHandler::DispatchResult,
                      weak_factory_.GetWeakPtr(),
-                     base::MessageLoopProxy::current(),
+                     client_task_runner,
                      callback_id)));
 
   if (!HandleFunction(info.Pass())) {
@@ -86,12 +97,12 @@ bool XWalkExtensionFunctionHandler::HandleFunction(
 // static
 void XWalkExtensionFunctionHandler::DispatchResult(
     const base::WeakPtr<XWalkExtensionFunctionHandler>& handler,
-    scoped_refptr<base::MessageLoopProxy> client_task_runner,
+    scoped_refptr<base::SequencedTaskRunner> client_task_runner,
     const std::string& callback_id,
     scoped_ptr<base::ListValue> result) {
   DCHECK(result);
 
-  if (client_task_runner != base::MessageLoopProxy::current()) {
+  if (!client_task_runner->RunsTasksOnCurrentThread()) {
     client_task_runner->PostTask(FROM_HERE,
         base::Bind(&XWalkExtensionFunctionHandler::DispatchResult,
                    handler,
@@ -5,10 +5,12 @@
 #include "xwalk/extensions/browser/xwalk_extension_process_host.h"
 
 #include <string>
+#include <vector>
 
 #include "base/command_line.h"
 #include "base/logging.h"
 #include "base/files/file_path.h"
+#include "base/stl_util.h"
 #include "content/public/browser/browser_child_process_host.h"
 #include "content/public/browser/browser_thread.h"
 #include "content/public/browser/render_process_host.h"
@@ -28,50 +30,92 @@ using content::BrowserThread;
 namespace xwalk {
 namespace extensions {
 
-// This filter is used by ExtensionProcessHost to intercept when Render Process
-// ask for the Extension Channel handle (that is created by extension process).
-class XWalkExtensionProcessHost::RenderProcessMessageFilter
-    : public IPC::ChannelProxy::MessageFilter {
- public:
-  explicit RenderProcessMessageFilter(XWalkExtensionProcessHost* eph)
-      : eph_(eph) {}
-
-  // This exists to fulfill the requirement for delayed reply handling, since it
-  // needs to send a message back if the parameters couldn't be correctly read
-  // from the original message received. See DispatchDealyReplyWithSendParams().
-  bool Send(IPC::Message* message) {
-    if (eph_)
-      return eph_->render_process_host_->Send(message);
-    delete message;
-    return false;
-  }
+typedef XWalkExtensionProcessHost::RenderProcessMessageFilter
+    RenderProcessMessageFilter;
+
+RenderProcessMessageFilter::RenderProcessMessageFilter(
+    content::RenderProcessHost* rph)
+    : rph_(rph),
+      render_process_id_(rph->GetID()),
+      eph_(NULL) {}
+
+RenderProcessMessageFilter::~RenderProcessMessageFilter() {}
+
+// This exists to fulfill the requirement for delayed reply handling, since it
+// needs to send a message back if the parameters couldn't be correctly read
+// from the original message received. See DispatchDealyReplyWithSendParams().
+bool RenderProcessMessageFilter::Send(IPC::Message* message) {
+  if (rph_)
+    return rph_->Send(message);
+  delete message;
+  return false;
+}
 
-  void Invalidate() {
-    eph_ = NULL;
+void RenderProcessMessageFilter::Attach(XWalkExtensionProcessHost* eph) {
+  eph_ = eph;
+  if (pending_reply_) {
+    eph_->OnGetExtensionProcessChannel(render_process_id_,
+                                       pending_reply_.Pass());
   }
+}
 
- private:
-  // IPC::ChannelProxy::MessageFilter implementation.
-  virtual bool OnMessageReceived(const IPC::Message& message) OVERRIDE {
-    bool handled = true;
-    IPC_BEGIN_MESSAGE_MAP(RenderProcessMessageFilter, message)
-      IPC_MESSAGE_HANDLER_DELAY_REPLY(
-          XWalkExtensionProcessHostMsg_GetExtensionProcessChannel,
-          OnGetExtensionProcessChannel)
-      IPC_MESSAGE_UNHANDLED(handled = false)
-    IPC_END_MESSAGE_MAP()
-    return handled;
-  }
+void RenderProcessMessageFilter::Invalidate() {
+  eph_ = NULL;
+  rph_ = NULL;
+  pending_reply_.reset();
+}
+
+bool RenderProcessMessageFilter::OnMessageReceived(
+    const IPC::Message& message) {
+  bool handled = true;
+  IPC_BEGIN_MESSAGE_MAP(RenderProcessMessageFilter, message)
+    IPC_MESSAGE_HANDLER_DELAY_REPLY(
+        XWalkExtensionProcessHostMsg_GetExtensionProcessChannel,
+        OnGetExtensionProcessChannel)
+    IPC_MESSAGE_UNHANDLED(handled = false)
+  IPC_END_MESSAGE_MAP()
+  return handled;
+}
+
+void RenderProcessMessageFilter::OnFilterRemoved() {
+  OnRenderProcessGone();
+}
+
+void RenderProcessMessageFilter::OnChannelClosing() {
+  OnRenderProcessGone();
+}
 
-  void OnGetExtensionProcessChannel(IPC::Message* reply) {
-    scoped_ptr<IPC::Message> scoped_reply(reply);
-    if (eph_)
-      eph_->OnGetExtensionProcessChannel(scoped_reply.Pass());
+void RenderProcessMessageFilter::OnChannelError() {
+  OnRenderProcessGone();
+}
+
+void RenderProcessMessageFilter::OnGetExtensionProcessChannel(
+    IPC::Message* reply) {
+  scoped_ptr<IPC::Message> scoped_reply(reply);
+  if (eph_) {
+    eph_->OnGetExtensionProcessChannel(render_process_id_,
+                                       scoped_reply.Pass());
+  } else if (rph_) {
+    pending_reply_ = scoped_reply.Pass();
   }
+}
+
+// The extension process host stops serving the render process once its
+// channel is gone.
+void RenderProcessMessageFilter::OnRenderProcessGone() {
+  XWalkExtensionProcessHost* eph = eph_;
+  Invalidate();
+  if (eph)
+    eph->RemoveRenderProcess(render_process_id_);
+}
 
-  virtual ~RenderProcessMessageFilter() {}
+struct XWalkExtensionProcessHost::RenderProcessData {
+  RenderProcessData() : is_extension_process_channel_ready(false) {}
 
-  XWalkExtensionProcessHost* eph_;
+  scoped_refptr<RenderProcessMessageFilter> filter;
+  IPC::ChannelHandle ep_rp_channel_handle;
+  scoped_ptr<IPC::Message> pending_reply_for_render_process;
+  bool is_extension_process_channel_ready;
 };
 
 #if defined(OS_WIN)
@@ -94,24 +138,79 @@ XWalkExtensionProcessHost::XWalkExtensionProcessHost(
     content::RenderProcessHost* render_process_host,
     const base::FilePath& external_extensions_path,
     XWalkExtensionProcessHost::Delegate* delegate)
-    : ep_rp_channel_handle_(""),
-      render_process_host_(render_process_host),
-      render_process_message_filter_(new RenderProcessMessageFilter(this)),
-      external_extensions_path_(external_extensions_path),
-      is_extension_process_channel_ready_(false),
+    : external_extensions_path_(external_extensions_path),
       delegate_(delegate) {
-  render_process_host_->GetChannel()->AddFilter(render_process_message_filter_);
+  scoped_refptr<RenderProcessMessageFilter> filter =
+      CreateRenderProcessMessageFilter(render_process_host);
   BrowserThread::PostTask(BrowserThread::IO, FROM_HERE,
       base::Bind(&XWalkExtensionProcessHost::StartProcess,
       base::Unretained(this)));
+  BrowserThread::PostTask(BrowserThread::IO, FROM_HERE,
+      base::Bind(&XWalkExtensionProcessHost::AddRenderProcess,
+      base::Unretained(this), filter));
+}
+
+XWalkExtensionProcessHost::XWalkExtensionProcessHost(
+    const base::FilePath& external_extensions_path,
+    XWalkExtensionProcessHost::Delegate* delegate)
+    : external_extensions_path_(external_extensions_path),
+      delegate_(delegate) {
+  StartProcess();
 }
 
 XWalkExtensionProcessHost::~XWalkExtensionProcessHost() {
   DCHECK(BrowserThread::CurrentlyOn(BrowserThread::IO));
-  render_process_message_filter_->Invalidate();
+  RenderProcessDataMap::iterator it = render_processes_.begin();
+  for (; it != render_processes_.end(); ++it)
+    it->second->filter->Invalidate();
   StopProcess();
 }
 
+// static
+scoped_refptr<XWalkExtensionProcessHost::RenderProcessMessageFilter>
+XWalkExtensionProcessHost::CreateRenderProcessMessageFilter(
+    content::RenderProcessHost* render_process_host) {
+  DCHECK(BrowserThread::CurrentlyOn(BrowserThread::UI));
+  scoped_refptr<RenderProcessMessageFilter> filter(
+      new RenderProcessMessageFilter(render_process_host));
+  render_process_host->GetChannel()->AddFilter(filter);
+  return filter;
+}
+
+void XWalkExtensionProcessHost::AddRenderProcess(
+    scoped_refptr<RenderProcessMessageFilter> filter) {
+  CHECK(BrowserThread::CurrentlyOn(BrowserThread::IO));
+
+  // The render process may have gone before reaching here.
+  if (!filter->render_process_host())
+    return;
+
+  int render_process_id = filter->render_process_id();
+  DCHECK(!ContainsKey(render_processes_, render_process_id));
+
+  linked_ptr<RenderProcessData> data(new RenderProcessData);
+  data->filter = filter;
+  render_processes_[render_process_id] = data;
+
+  process_->GetHost()->Send(
+      new XWalkExtensionProcessMsg_CreateRenderProcessChannel(
+          render_process_id));
+
+  filter->Attach(this);
+}
+
+void XWalkExtensionProcessHost::RemoveRenderProcess(int render_process_id) {
+  CHECK(BrowserThread::CurrentlyOn(BrowserThread::IO));
+  if (!render_processes_.erase(render_process_id))
+    return;
+
+  if (process_) {
+    process_->GetHost()->Send(
+        new XWalkExtensionProcessMsg_CloseRenderProcessChannel(
+            render_process_id));
+  }
+}
+
 void XWalkExtensionProcessHost::StartProcess() {
   CHECK(BrowserThread::CurrentlyOn(BrowserThread::IO));
   CHECK(!process_);
@@ -146,9 +245,14 @@ void XWalkExtensionProcessHost::StopProcess() {
 }
 
 void XWalkExtensionProcessHost::OnGetExtensionProcessChannel(
-    scoped_ptr<IPC::Message> reply) {
-  pending_reply_for_render_process_ = reply.Pass();
-  ReplyChannelHandleToRenderProcess();
+    int render_process_id, scoped_ptr<IPC::Message> reply) {
+  RenderProcessDataMap::iterator it = render_processes_.find(render_process_id);
+  if (it == render_processes_.end())
+    return;
+
+  RenderProcessData* data = it->second.get();
+  data->pending_reply_for_render_process = reply.Pass();
+  ReplyChannelHandleToRenderProcess(data);
 }
 
 bool XWalkExtensionProcessHost::OnMessageReceived(const IPC::Message& message) {
@@ -170,10 +274,21 @@ void XWalkExtensionProcessHost::OnChannelError() {
   // is about to delete its delegate, which is us!
   // We should alert our XWalkExtensionProcessHost::Delegate, since it will
   // most likely have a pointer to us that needs to be invalidated.
+  //
+  // A shared extension process takes all its render processes with it.
 
   VLOG(1) << "\n\nExtensionProcess crashed";
-  if (delegate_)
-    delegate_->OnExtensionProcessDied(this, render_process_host_->GetID());
+  std::vector<int> render_process_ids;
+  RenderProcessDataMap::iterator it = render_processes_.begin();
+  for (; it != render_processes_.end(); ++it)
+    render_process_ids.push_back(it->first);
+
+  if (!delegate_)
+    return;
+
+  for (size_t i = 0; i < render_process_ids.size(); ++i)
+    delegate_->OnExtensionProcessDied(this, render_process_ids[i]);
+  delegate_->OnExtensionProcessHostGone(this);
 }
 
 void XWalkExtensionProcessHost::OnProcessLaunched() {
@@ -181,30 +296,36 @@ void XWalkExtensionProcessHost::OnProcessLaunched() {
 }
 
 void XWalkExtensionProcessHost::OnRenderChannelCreated(
-    const IPC::ChannelHandle& handle) {
-  is_extension_process_channel_ready_ = true;
-  ep_rp_channel_handle_ = handle;
-  ReplyChannelHandleToRenderProcess();
+    int render_process_id, const IPC::ChannelHandle& handle) {
+  RenderProcessDataMap::iterator it = render_processes_.find(render_process_id);
+  if (it == render_processes_.end())
+    return;
+
+  RenderProcessData* data = it->second.get();
+  data->is_extension_process_channel_ready = true;
+  data->ep_rp_channel_handle = handle;
+  ReplyChannelHandleToRenderProcess(data);
 }
 
-void XWalkExtensionProcessHost::ReplyChannelHandleToRenderProcess() {
+void XWalkExtensionProcessHost::ReplyChannelHandleToRenderProcess(
+    RenderProcessData* data) {
   // Replying the channel handle to RP depends on two events:
   // - EP already notified EPH that new channel was created (for RP<->EP).
   // - RP already asked for the channel handle.
   //
   // The order for this events is not determined, so we call this function from
   // both, and the second execution will send the reply.
-  if (!is_extension_process_channel_ready_
-      || !pending_reply_for_render_process_)
+  if (!data->is_extension_process_channel_ready
+      || !data->pending_reply_for_render_process)
     return;
 
   XWalkExtensionProcessHostMsg_GetExtensionProcessChannel::WriteReplyParams(
-      pending_reply_for_render_process_.get(), ep_rp_channel_handle_);
+      data->pending_reply_for_render_process.get(),
+      data->ep_rp_channel_handle);
 
-  render_process_host_->Send(pending_reply_for_render_process_.release());
+  data->filter->Send(data->pending_reply_for_render_process.release());
 }
 
 
 }  // namespace extensions
 }  // namespace xwalk
-
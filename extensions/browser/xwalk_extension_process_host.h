@@ -5,7 +5,10 @@
 #ifndef XWALK_EXTENSIONS_BROWSER_XWALK_EXTENSION_PROCESS_HOST_H_
 #define XWALK_EXTENSIONS_BROWSER_XWALK_EXTENSION_PROCESS_HOST_H_
 
+#include <map>
+
 #include "base/files/file_path.h"
+#include "base/memory/linked_ptr.h"
 #include "base/memory/ref_counted.h"
 #include "base/memory/scoped_ptr.h"
 #include "content/public/browser/browser_child_process_host_delegate.h"
@@ -23,6 +26,10 @@ namespace extensions {
 // This class represents the browser side of the browser <-> extension process
 // communication channel. It has to run some operations in IO thread for
 // creating the extra process.
+//
+// By default there's one extension process for each render process. When
+// shared, a single extension process serves all the render processes added
+// to it, each one using its own channel and instances.
 class XWalkExtensionProcessHost
     : public content::BrowserChildProcessHostDelegate {
  public:
@@ -30,25 +37,83 @@ class XWalkExtensionProcessHost
    public:
     virtual void OnExtensionProcessDied(XWalkExtensionProcessHost* eph,
       int render_process_id) {}
+    // Called once the extension process died, after OnExtensionProcessDied()
+    // for each of its render processes if any. |eph| is deleted by content
+    // right after.
+    virtual void OnExtensionProcessHostGone(XWalkExtensionProcessHost* eph) {}
 
    protected:
     ~Delegate() {}
   };
 
+  // This filter is used to intercept when Render Process ask for the
+  // Extension Channel handle (that is created by extension process). Besides
+  // the constructor, all its methods run in the IO thread.
+  class RenderProcessMessageFilter : public IPC::ChannelProxy::MessageFilter {
+   public:
+    explicit RenderProcessMessageFilter(content::RenderProcessHost* rph);
+
+    content::RenderProcessHost* render_process_host() const { return rph_; }
+    int render_process_id() const { return render_process_id_; }
+
+    bool Send(IPC::Message* message);
+
+    // A request received before the filter is attached is kept until then.
+    void Attach(XWalkExtensionProcessHost* eph);
+    void Invalidate();
+
+   private:
+    virtual ~RenderProcessMessageFilter();
+
+    // IPC::ChannelProxy::MessageFilter implementation.
+    virtual bool OnMessageReceived(const IPC::Message& message) OVERRIDE;
+    virtual void OnFilterRemoved() OVERRIDE;
+    virtual void OnChannelClosing() OVERRIDE;
+    virtual void OnChannelError() OVERRIDE;
+
+    void OnGetExtensionProcessChannel(IPC::Message* reply);
+    void OnRenderProcessGone();
+
+    content::RenderProcessHost* rph_;
+    int render_process_id_;
+    XWalkExtensionProcessHost* eph_;
+    scoped_ptr<IPC::Message> pending_reply_;
+  };
+
   XWalkExtensionProcessHost(content::RenderProcessHost* render_process_host,
                             const base::FilePath& external_extensions_path,
                             XWalkExtensionProcessHost::Delegate* delegate);
+
+  // Creates a host without render processes, they should be added later
+  // using AddRenderProcess(). Must be called in the IO thread.
+  XWalkExtensionProcessHost(const base::FilePath& external_extensions_path,
+                            XWalkExtensionProcessHost::Delegate* delegate);
   virtual ~XWalkExtensionProcessHost();
 
+  // Must be called in the UI thread when the render process is created, so
+  // the request for the extension process channel is not missed. The request
+  // will be replied once the filter is added to a host.
+  static scoped_refptr<RenderProcessMessageFilter>
+      CreateRenderProcessMessageFilter(
+          content::RenderProcessHost* render_process_host);
+
+  // Starts serving the render process of |filter|, must be called in the IO
+  // thread. The render process is removed when its channel is closed.
+  void AddRenderProcess(scoped_refptr<RenderProcessMessageFilter> filter);
+
  private:
-  class RenderProcessMessageFilter;
+  struct RenderProcessData;
 
   void StartProcess();
   void StopProcess();
 
+  // Called by the filter when the render process channel goes away.
+  void RemoveRenderProcess(int render_process_id);
+
   // Handler for message from Render Process host, it is a synchronous message,
   // that will be replied only when the extension process channel is created.
-  void OnGetExtensionProcessChannel(scoped_ptr<IPC::Message> reply);
+  void OnGetExtensionProcessChannel(int render_process_id,
+                                    scoped_ptr<IPC::Message> reply);
 
   // content::BrowserChildProcessHostDelegate implementation.
   virtual bool OnMessageReceived(const IPC::Message& message) OVERRIDE;
@@ -56,26 +121,19 @@ class XWalkExtensionProcessHost
   virtual void OnProcessLaunched() OVERRIDE;
 
   // Message Handlers.
-  void OnRenderChannelCreated(const IPC::ChannelHandle& channel_id);
+  void OnRenderChannelCreated(int render_process_id,
+                              const IPC::ChannelHandle& channel_id);
 
-  void ReplyChannelHandleToRenderProcess();
+  void ReplyChannelHandleToRenderProcess(RenderProcessData* data);
 
   scoped_ptr<content::BrowserChildProcessHost> process_;
-  IPC::ChannelHandle ep_rp_channel_handle_;
-  content::RenderProcessHost* render_process_host_;
-  scoped_ptr<IPC::Message> pending_reply_for_render_process_;
-
-  // We use this filter to know when RP asked for the extension process channel.
-  // We keep the reference to invalidate the filter once we don't need it
-  // anymore.
-  //
-  // TODO(cmarcelo): Avoid having an extra filter, see if we can embed this
-  // handling in the existing filter we have in ExtensionData struct.
-  scoped_refptr<RenderProcessMessageFilter> render_process_message_filter_;
 
-  base::FilePath external_extensions_path_;
+  // Render processes served by this extension process, indexed by their ID.
+  // Only accessed in the IO thread.
+  typedef std::map<int, linked_ptr<RenderProcessData> > RenderProcessDataMap;
+  RenderProcessDataMap render_processes_;
 
-  bool is_extension_process_channel_ready_;
+  base::FilePath external_extensions_path_;
 
   XWalkExtensionProcessHost::Delegate* delegate_;
 };
@@ -4,6 +4,7 @@
 
 #include "xwalk/extensions/browser/xwalk_extension_service.h"
 
+#include <map>
 #include <set>
 #include <vector>
 #include "base/callback.h"
@@ -11,6 +12,7 @@
 #include "base/pickle.h"
 #include "base/scoped_native_library.h"
 #include "base/synchronization/lock.h"
+#include "base/sys_info.h"
 #include "content/public/browser/browser_thread.h"
 #include "content/public/browser/notification_types.h"
 #include "content/public/browser/notification_service.h"
@@ -19,7 +21,9 @@
 #include "xwalk/extensions/browser/xwalk_extension_data.h"
 #include "xwalk/extensions/browser/xwalk_extension_process_host.h"
 #include "xwalk/extensions/common/xwalk_extension.h"
+#include "xwalk/extensions/common/xwalk_extension_message_batch.h"
 #include "xwalk/extensions/common/xwalk_extension_messages.h"
+#include "xwalk/extensions/common/xwalk_extension_registry.h"
 #include "xwalk/extensions/common/xwalk_extension_server.h"
 #include "xwalk/extensions/common/xwalk_extension_switches.h"
 
@@ -44,26 +48,40 @@ base::FilePath g_external_extensions_path_for_testing_;
 // dispatch them to its task runner. A message loop proxy of a thread is a
 // task runner. Like other filters, this filter will run in the IO-thread.
 //
-// In the case of in process extensions, we will pass the task runner of the
-// extension thread.
+// In the case of in process extensions, there's one server for the UI
+// thread, one for the extension thread and one for each concurrent extension,
+// which lives in its own sequence of the extension worker pool. Messages for
+// an instance are always dispatched to the same task runner, so they keep
+// their ordering.
 class ExtensionServerMessageFilter : public IPC::ChannelProxy::MessageFilter,
                                      public IPC::Sender {
  public:
-  ExtensionServerMessageFilter(
-      scoped_refptr<base::SequencedTaskRunner> task_runner,
-      XWalkExtensionServer* extension_thread_server,
-      XWalkExtensionServer* ui_thread_server)
+  ExtensionServerMessageFilter()
       : sender_(NULL),
-        task_runner_(task_runner),
-        extension_thread_server_(extension_thread_server),
-        ui_thread_server_(ui_thread_server) {}
+        ui_thread_server_(NULL) {}
+
+  // Servers must be added before the filter is added to the channel. The
+  // first server containing the extension will get its instances, the UI
+  // thread server is used as fallback.
+  void AddServer(XWalkExtensionServer* server,
+                 scoped_refptr<base::SequencedTaskRunner> task_runner) {
+    ServerEntry entry;
+    entry.server = server;
+    entry.task_runner = task_runner;
+    servers_.push_back(entry);
+  }
+
+  void SetUIThreadServer(XWalkExtensionServer* server) {
+    ui_thread_server_ = server;
+    AddServer(server,
+              BrowserThread::GetMessageLoopProxyForThread(BrowserThread::UI));
+  }
 
   // Tells the filter to stop dispatching messages to the server.
   void Invalidate() {
     base::AutoLock l(lock_);
     sender_ = NULL;
-    task_runner_ = NULL;
-    extension_thread_server_ = NULL;
+    servers_.clear();
     ui_thread_server_ = NULL;
   }
 
@@ -78,6 +96,11 @@ class ExtensionServerMessageFilter : public IPC::ChannelProxy::MessageFilter,
   }
 
  private:
+  struct ServerEntry {
+    XWalkExtensionServer* server;
+    scoped_refptr<base::SequencedTaskRunner> task_runner;
+  };
+
   virtual ~ExtensionServerMessageFilter() {}
 
   int64_t GetInstanceIDFromMessage(const IPC::Message& message) {
@@ -95,58 +118,121 @@ class ExtensionServerMessageFilter : public IPC::ChannelProxy::MessageFilter,
     return instance_id;
   }
 
+  // Returns the index in |servers_| of the server handling the instance.
+  size_t GetServerIndexForInstance(int64_t instance_id) {
+    std::map<int64_t, size_t>::const_iterator it =
+        instance_servers_.find(instance_id);
+    if (it != instance_servers_.end())
+      return it->second;
+    return GetServerIndex(ui_thread_server_);
+  }
+
+  size_t GetServerIndex(XWalkExtensionServer* server) {
+    for (size_t i = 0; i < servers_.size(); ++i) {
+      if (servers_[i].server == server)
+        return i;
+    }
+    NOTREACHED();
+    return 0;
+  }
+
   void RouteMessageToServer(const IPC::Message& message) {
     int64_t id = GetInstanceIDFromMessage(message);
     DCHECK_NE(id, -1);
 
-    XWalkExtensionServer* server;
-    base::TaskRunner* task_runner;
-    scoped_refptr<base::TaskRunner> task_runner_ref;
-
-    if (ContainsKey(extension_thread_instances_ids_, id)) {
-      server = extension_thread_server_;
-      task_runner = task_runner_;
-    } else {
-      server = ui_thread_server_;
-      task_runner_ref =
-          BrowserThread::GetMessageLoopProxyForThread(BrowserThread::UI);
-      task_runner = task_runner_ref.get();
-    }
+    PostMessageToServer(message, GetServerIndexForInstance(id));
+  }
 
+  void PostMessageToServer(const IPC::Message& message, size_t index) {
+    const ServerEntry& entry = servers_[index];
     base::Closure closure = base::Bind(
         base::IgnoreResult(&XWalkExtensionServer::OnMessageReceived),
-        base::Unretained(server), message);
+        base::Unretained(entry.server), message);
+
+    entry.task_runner->PostTask(FROM_HERE, closure);
+  }
+
+  // A batch may contain messages for instances living in different servers.
+  // In the common case all of them go to the same server and the message is
+  // routed as is, otherwise it is split in one batch per server keeping the
+  // order.
+  void OnPostMessagesToNative(const IPC::Message& message,
+                              const std::vector<int64_t>& instance_ids,
+                              const base::ListValue& contents) {
+    if (instance_ids.empty() || instance_ids.size() != contents.GetSize())
+      return;
+
+    std::vector<size_t> indexes(instance_ids.size());
+    bool single_server = true;
+    for (size_t i = 0; i < instance_ids.size(); ++i) {
+      indexes[i] = GetServerIndexForInstance(instance_ids[i]);
+      single_server &= indexes[i] == indexes[0];
+    }
 
-    task_runner->PostTask(FROM_HERE, closure);
+    if (single_server) {
+      PostMessageToServer(message, indexes[0]);
+      return;
+    }
+
+    ScopedVector<base::Value> messages;
+    TakeBatchedMessages(contents, &messages);
+
+    ScopedVector<XWalkExtensionMessageBatch> batches;
+    batches.resize(servers_.size());
+    for (size_t i = 0; i < instance_ids.size(); ++i) {
+      scoped_ptr<base::Value> value(messages[i]);
+      messages[i] = NULL;
+      if (!batches[indexes[i]])
+        batches[indexes[i]] = new XWalkExtensionMessageBatch;
+      batches[indexes[i]]->Append(instance_ids[i], value.Pass());
+    }
+
+    for (size_t i = 0; i < batches.size(); ++i) {
+      if (!batches[i])
+        continue;
+      scoped_ptr<IPC::Message> batch_message(
+          batches[i]->Release<XWalkExtensionServerMsg_PostMessagesToNative>());
+      PostMessageToServer(*batch_message, i);
+    }
   }
 
   void OnCreateInstance(int64_t instance_id, std::string name) {
-    XWalkExtensionServer* server;
-    base::TaskRunner* task_runner;
-    scoped_refptr<base::TaskRunner> task_runner_ref;
-
-    if (extension_thread_server_->ContainsExtension(name)) {
-      extension_thread_instances_ids_.insert(instance_id);
-      server = extension_thread_server_;
-      task_runner = task_runner_;
-    } else {
-      server = ui_thread_server_;
-      task_runner_ref =
-          BrowserThread::GetMessageLoopProxyForThread(BrowserThread::UI);
-      task_runner = task_runner_ref.get();
+    size_t index = GetServerIndex(ui_thread_server_);
+    for (size_t i = 0; i < servers_.size(); ++i) {
+      if (servers_[i].server->ContainsExtension(name)) {
+        index = i;
+        break;
+      }
     }
 
+    instance_servers_[instance_id] = index;
+
+    const ServerEntry& entry = servers_[index];
     base::Closure closure = base::Bind(
         base::IgnoreResult(&XWalkExtensionServer::OnCreateInstance),
-        base::Unretained(server), instance_id, name);
+        base::Unretained(entry.server), instance_id, name);
 
-    task_runner->PostTask(FROM_HERE, closure);
+    entry.task_runner->PostTask(FROM_HERE, closure);
   }
 
-  void OnGetExtensions(
-      std::vector<XWalkExtensionServerMsg_ExtensionRegisterParams>* reply) {
-    extension_thread_server_->OnGetExtensions(reply);
-    ui_thread_server_->OnGetExtensions(reply);
+  void OnDestroyInstance(const IPC::Message& message, int64_t instance_id) {
+    PostMessageToServer(message, GetServerIndexForInstance(instance_id));
+    instance_servers_.erase(instance_id);
+  }
+
+  // The extensions of all the servers are merged in a single registry, built
+  // once for this render process.
+  void OnGetExtensionRegistry(base::SharedMemoryHandle* handle,
+                              uint32_t* size,
+                              std::string* contents) {
+    if (!registry_) {
+      XWalkExtensionRegistry::Builder builder;
+      std::vector<ServerEntry>::const_iterator it = servers_.begin();
+      for (; it != servers_.end(); ++it)
+        it->server->AddExtensionsToRegistry(&builder);
+      registry_ = builder.Build();
+    }
+    GetExtensionRegistryReply(registry_.get(), handle, size, contents);
   }
 
   // IPC::ChannelProxy::MessageFilter implementation.
@@ -172,15 +258,27 @@ class ExtensionServerMessageFilter : public IPC::ChannelProxy::MessageFilter,
 
     base::AutoLock l(lock_);
 
-    if (!extension_thread_server_ || !ui_thread_server_)
+    if (servers_.empty() || !ui_thread_server_)
       return false;
 
+    if (message.type() == XWalkExtensionServerMsg_PostMessagesToNative::ID) {
+      XWalkExtensionServerMsg_PostMessagesToNative::Param params;
+      if (XWalkExtensionServerMsg_PostMessagesToNative::Read(&message, &params))
+        OnPostMessagesToNative(message, params.a, params.b);
+      return true;
+    }
+
+    if (message.type() == XWalkExtensionServerMsg_DestroyInstance::ID) {
+      OnDestroyInstance(message, GetInstanceIDFromMessage(message));
+      return true;
+    }
+
     bool handled = true;
     IPC_BEGIN_MESSAGE_MAP(ExtensionServerMessageFilter, message)
       IPC_MESSAGE_HANDLER(XWalkExtensionServerMsg_CreateInstance,
                           OnCreateInstance)
-      IPC_MESSAGE_HANDLER(XWalkExtensionServerMsg_GetExtensions,
-                          OnGetExtensions)
+      IPC_MESSAGE_HANDLER(XWalkExtensionServerMsg_GetExtensionRegistry,
+                          OnGetExtensionRegistry)
       IPC_MESSAGE_UNHANDLED(handled = false)
     IPC_END_MESSAGE_MAP()
 
@@ -194,10 +292,13 @@ class ExtensionServerMessageFilter : public IPC::ChannelProxy::MessageFilter,
   base::Lock lock_;
 
   IPC::Sender* sender_;
-  scoped_refptr<base::SequencedTaskRunner> task_runner_;
-  XWalkExtensionServer* extension_thread_server_;
+  std::vector<ServerEntry> servers_;
   XWalkExtensionServer* ui_thread_server_;
-  std::set<int64_t> extension_thread_instances_ids_;
+
+  // Maps each instance to the index of its server in |servers_|.
+  std::map<int64_t, size_t> instance_servers_;
+
+  scoped_refptr<XWalkExtensionRegistry> registry_;
 };
 
 XWalkExtensionService::XWalkExtensionService()
@@ -210,6 +311,9 @@ XWalkExtensionService::XWalkExtensionService()
   // IO main loop is needed by extensions watching file descriptors events.
   base::Thread::Options options(base::MessageLoop::TYPE_IO, 0);
   extension_thread_.StartWithOptions(options);
+
+  worker_pool_ = new base::SequencedWorkerPool(
+      base::SysInfo::NumberOfProcessors(), "XWalkExtensionWorker");
 }
 
 XWalkExtensionService::~XWalkExtensionService() {
@@ -217,11 +321,46 @@ XWalkExtensionService::~XWalkExtensionService() {
   // extension thread.
   if (!extension_data_map_.empty())
     VLOG(1) << "The ExtensionData map is not empty!";
+
+  if (shared_extension_process_host_) {
+    BrowserThread::DeleteSoon(BrowserThread::IO, FROM_HERE,
+                              shared_extension_process_host_.release());
+  }
+
+  worker_pool_->Shutdown();
 }
 
 void XWalkExtensionService::RegisterExternalExtensionsForPath(
     const base::FilePath& path) {
   external_extensions_path_ = path;
+
+  // Load the extensions before the first render process needs them.
+  if (IsExtensionProcessShared()) {
+    BrowserThread::PostTask(BrowserThread::IO, FROM_HERE,
+        base::Bind(&XWalkExtensionService::StartSharedExtensionProcess,
+                   base::Unretained(this)));
+  }
+}
+
+bool XWalkExtensionService::IsExtensionProcessShared() const {
+  CommandLine* cmd_line = CommandLine::ForCurrentProcess();
+  return cmd_line->HasSwitch(switches::kXWalkSharedExtensionProcess) &&
+      !cmd_line->HasSwitch(switches::kXWalkDisableExtensionProcess);
+}
+
+void XWalkExtensionService::StartSharedExtensionProcess() {
+  DCHECK(BrowserThread::CurrentlyOn(BrowserThread::IO));
+  if (shared_extension_process_host_)
+    return;
+  shared_extension_process_host_.reset(
+      new XWalkExtensionProcessHost(external_extensions_path_, this));
+}
+
+void XWalkExtensionService::AddRenderProcessToSharedExtensionProcess(
+    scoped_refptr<XWalkExtensionProcessHost::RenderProcessMessageFilter>
+        filter) {
+  StartSharedExtensionProcess();
+  shared_extension_process_host_->AddRenderProcess(filter);
 }
 
 void XWalkExtensionService::OnRenderProcessHostCreated(
@@ -328,6 +467,37 @@ void RegisterExtensionsIntoServer(XWalkExtensionVector* extensions,
 }  // namespace
 
 
+void XWalkExtensionService::CreateConcurrentExtensionServers(
+    IPC::ChannelProxy* channel,
+    XWalkExtensionVector* extensions,
+    ScopedVector<XWalkExtensionServer>* servers,
+    std::vector<scoped_refptr<base::SequencedTaskRunner> >* task_runners) {
+  XWalkExtensionVector remaining;
+  XWalkExtensionVector::iterator it = extensions->begin();
+  for (; it != extensions->end(); ++it) {
+    if (!(*it)->is_concurrent()) {
+      remaining.push_back(*it);
+      continue;
+    }
+
+    scoped_refptr<base::SequencedTaskRunner> task_runner =
+        worker_pool_->GetSequencedTaskRunnerWithShutdownBehavior(
+            worker_pool_->GetSequenceToken(),
+            base::SequencedWorkerPool::SKIP_ON_SHUTDOWN);
+
+    scoped_ptr<XWalkExtensionServer> server(new XWalkExtensionServer);
+    server->Initialize(channel);
+    server->SetTaskRunner(task_runner);
+
+    XWalkExtensionVector concurrent_extension(1, *it);
+    RegisterExtensionsIntoServer(&concurrent_extension, server.get());
+
+    servers->push_back(server.release());
+    task_runners->push_back(task_runner);
+  }
+  extensions->swap(remaining);
+}
+
 void XWalkExtensionService::CreateInProcessExtensionServers(
     content::RenderProcessHost* host, XWalkExtensionData* data,
     XWalkExtensionVector* ui_thread_extensions,
@@ -342,6 +512,11 @@ void XWalkExtensionService::CreateInProcessExtensionServers(
   extension_thread_server->Initialize(channel);
   ui_thread_server->Initialize(channel);
 
+  ScopedVector<XWalkExtensionServer> concurrent_servers;
+  std::vector<scoped_refptr<base::SequencedTaskRunner> > concurrent_runners;
+
+  CreateConcurrentExtensionServers(channel, extension_thread_extensions,
+                                   &concurrent_servers, &concurrent_runners);
   RegisterExtensionsIntoServer(extension_thread_extensions,
                                extension_thread_server.get());
   RegisterExtensionsIntoServer(ui_thread_extensions, ui_thread_server.get());
@@ -355,13 +530,31 @@ void XWalkExtensionService::CreateInProcessExtensionServers(
   if (!g_create_extension_thread_extensions_callback.is_null()) {
     XWalkExtensionVector extensions;
     g_create_extension_thread_extensions_callback.Run(&extensions);
+    CreateConcurrentExtensionServers(channel, &extensions,
+                                     &concurrent_servers, &concurrent_runners);
     RegisterExtensionsIntoServer(&extensions, extension_thread_server.get());
   }
 
+  base::TimeDelta batch_delay;
+  if (GetMessageBatchingDelay(&batch_delay)) {
+    extension_thread_server->EnableMessageBatching(
+        extension_thread_.message_loop_proxy(), batch_delay);
+    ui_thread_server->EnableMessageBatching(
+        BrowserThread::GetMessageLoopProxyForThread(BrowserThread::UI),
+        batch_delay);
+    for (size_t i = 0; i < concurrent_servers.size(); ++i) {
+      concurrent_servers[i]->EnableMessageBatching(concurrent_runners[i],
+                                                   batch_delay);
+    }
+  }
+
   ExtensionServerMessageFilter* message_filter =
-      new ExtensionServerMessageFilter(extension_thread_.message_loop_proxy(),
-                                       extension_thread_server.get(),
-                                       ui_thread_server.get());
+      new ExtensionServerMessageFilter;
+  for (size_t i = 0; i < concurrent_servers.size(); ++i)
+    message_filter->AddServer(concurrent_servers[i], concurrent_runners[i]);
+  message_filter->AddServer(extension_thread_server.get(),
+                            extension_thread_.message_loop_proxy());
+  message_filter->SetUIThreadServer(ui_thread_server.get());
 
   // The filter is owned by the IPC channel but we keep a reference to remove
   // it from the Channel later during a RenderProcess shutdown.
@@ -370,12 +563,22 @@ void XWalkExtensionService::CreateInProcessExtensionServers(
 
   data->set_in_process_extension_thread_server(extension_thread_server.Pass());
   data->set_in_process_ui_thread_server(ui_thread_server.Pass());
+  data->set_in_process_concurrent_servers(&concurrent_servers,
+                                          concurrent_runners);
 
   data->set_extension_thread(&extension_thread_);
 }
 
 void XWalkExtensionService::CreateExtensionProcessHost(
     content::RenderProcessHost* host, XWalkExtensionData* data) {
+  if (IsExtensionProcessShared()) {
+    BrowserThread::PostTask(BrowserThread::IO, FROM_HERE, base::Bind(
+        &XWalkExtensionService::AddRenderProcessToSharedExtensionProcess,
+        base::Unretained(this),
+        XWalkExtensionProcessHost::CreateRenderProcessMessageFilter(host)));
+    return;
+  }
+
   data->set_extension_process_host(make_scoped_ptr(
       new XWalkExtensionProcessHost(host, external_extensions_path_, this)));
 }
@@ -386,7 +589,6 @@ void XWalkExtensionService::OnExtensionProcessDied(
   // to be deleted. We should invalidate our reference to it so we avoid a
   // segfault when trying to delete it within
   // XWalkExtensionService::OnRenderProcessHostClosed();
-
   RenderProcessToExtensionDataMap::iterator it =
       extension_data_map_.find(render_process_id);
 
@@ -395,9 +597,11 @@ void XWalkExtensionService::OnExtensionProcessDied(
 
   XWalkExtensionData* data = it->second;
 
+  // The shared extension process is not owned by the render process data.
   XWalkExtensionProcessHost* stored_eph =
       data->extension_process_host().release();
-  CHECK_EQ(stored_eph, eph);
+  if (stored_eph)
+    CHECK_EQ(stored_eph, eph);
 
   content::RenderProcessHost* rph = data->render_process_host();
   if (rph) {
@@ -410,6 +614,14 @@ void XWalkExtensionService::OnExtensionProcessDied(
   delete data;
 }
 
+void XWalkExtensionService::OnExtensionProcessHostGone(
+    XWalkExtensionProcessHost* eph) {
+  // Called whether or not the shared extension process was serving render
+  // processes. It will be started again by the next render process.
+  if (eph == shared_extension_process_host_.get())
+    ignore_result(shared_extension_process_host_.release());
+}
+
 void XWalkExtensionService::OnRenderProcessDied(
     content::RenderProcessHost* host) {
   RenderProcessToExtensionDataMap::iterator it =
@@ -12,13 +12,21 @@
 #include "base/callback_forward.h"
 #include "base/containers/scoped_ptr_hash_map.h"
 #include "base/files/file_path.h"
+#include "base/memory/scoped_vector.h"
+#include "base/sequenced_task_runner.h"
+#include "base/memory/ref_counted.h"
 #include "base/memory/scoped_ptr.h"
+#include "base/threading/sequenced_worker_pool.h"
 #include "base/threading/thread.h"
 #include "content/public/browser/notification_observer.h"
 #include "content/public/browser/notification_registrar.h"
 #include "xwalk/extensions/browser/xwalk_extension_process_host.h"
 #include "xwalk/extensions/common/xwalk_extension_vector.h"
 
+namespace IPC {
+class ChannelProxy;
+}
+
 namespace content {
 class RenderProcessHost;
 class WebContents;
@@ -29,6 +37,7 @@ namespace extensions {
 
 class XWalkExtension;
 class XWalkExtensionData;
+class XWalkExtensionServer;
 
 // This is the entry point for Crosswalk extensions. Its responsible for keeping
 // track of the extensions, and enable them on WebContents once they are
@@ -72,6 +81,8 @@ class XWalkExtensionService : public content::NotificationObserver,
   // XWalkExtensionProcessHost::Delegate implementation.
   virtual void OnExtensionProcessDied(XWalkExtensionProcessHost* eph,
       int render_process_id) OVERRIDE;
+  virtual void OnExtensionProcessHostGone(
+      XWalkExtensionProcessHost* eph) OVERRIDE;
 
   // NotificationObserver implementation.
   virtual void Observe(int type, const content::NotificationSource& source,
@@ -88,12 +99,37 @@ class XWalkExtensionService : public content::NotificationObserver,
   void CreateExtensionProcessHost(content::RenderProcessHost* host,
       XWalkExtensionData* data);
 
+  // When the shared extension process is enabled, a single extension process
+  // loads the external extensions once and serves all the render processes.
+  bool IsExtensionProcessShared() const;
+  void StartSharedExtensionProcess();
+  void AddRenderProcessToSharedExtensionProcess(
+      scoped_refptr<XWalkExtensionProcessHost::RenderProcessMessageFilter>
+          filter);
+
+  // Moves each concurrent extension from |extensions| to its own server,
+  // running in a new sequence of the worker pool.
+  void CreateConcurrentExtensionServers(
+      IPC::ChannelProxy* channel,
+      XWalkExtensionVector* extensions,
+      ScopedVector<XWalkExtensionServer>* servers,
+      std::vector<scoped_refptr<base::SequencedTaskRunner> >* task_runners);
+
   // The server that handles in process extensions will live in the
   // extension_thread_.
   base::Thread extension_thread_;
 
+  // Concurrent extensions have their servers running in this pool, see
+  // XWalkExtension::is_concurrent().
+  scoped_refptr<base::SequencedWorkerPool> worker_pool_;
+
   content::NotificationRegistrar registrar_;
 
+  // Only accessed in the IO thread, where it's deleted. When the extension
+  // process dies it's deleted by content instead, see
+  // OnExtensionProcessHostGone().
+  scoped_ptr<XWalkExtensionProcessHost> shared_extension_process_host_;
+
   base::FilePath external_extensions_path_;
 
   typedef std::map<int, XWalkExtensionData*> RenderProcessToExtensionDataMap;
@@ -5,11 +5,12 @@
 #include "xwalk/extensions/common/xwalk_extension.h"
 
 #include "base/logging.h"
+#include "xwalk/extensions/common/xwalk_serialized_value.h"
 
 namespace xwalk {
 namespace extensions {
 
-XWalkExtension::XWalkExtension() {}
+XWalkExtension::XWalkExtension() : is_concurrent_(false) {}
 
 XWalkExtension::~XWalkExtension() {}
 
@@ -31,10 +32,48 @@ void XWalkExtensionInstance::SetSendSyncReplyCallback(
   send_sync_reply_ = callback;
 }
 
+void XWalkExtensionInstance::SetPostBinaryMessageCallback(
+    const PostBinaryMessageCallback& callback) {
+  post_binary_message_ = callback;
+}
+
+void XWalkExtensionInstance::SetSendResponseCallback(
+    const SendResponseCallback& callback) {
+  send_response_ = callback;
+}
+
+void XWalkExtensionInstance::SetTaskRunner(
+    scoped_refptr<base::SequencedTaskRunner> task_runner) {
+  task_runner_ = task_runner;
+}
+
 void XWalkExtensionInstance::HandleSyncMessage(
     scoped_ptr<base::Value> msg) {
   LOG(FATAL) << "Sending sync message to extension which doesn't support it!";
 }
 
+void XWalkExtensionInstance::HandleBinaryMessage(const uint8_t* data,
+                                                 size_t size) {
+  LOG(WARNING) << "Ignoring binary message sent to extension which doesn't "
+               << "support it.";
+}
+
+void XWalkExtensionInstance::HandleSerializedMessage(
+    XWalkSerializedValueReader* reader) {
+  scoped_ptr<base::Value> msg = reader->ReadValue();
+  if (!msg) {
+    LOG(WARNING) << "Ignoring malformed message sent to extension.";
+    return;
+  }
+  HandleMessage(msg.Pass());
+}
+
+void XWalkExtensionInstance::HandleRequest(int request_id,
+                                           scoped_ptr<base::Value> msg) {
+  LOG(WARNING) << "Failing request sent to extension which doesn't "
+               << "support it.";
+  SendResponseToJS(request_id, scoped_ptr<base::Value>());
+}
+
 }  // namespace extensions
 }  // namespace xwalk
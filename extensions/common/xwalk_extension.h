@@ -5,9 +5,13 @@
 #ifndef XWALK_EXTENSIONS_COMMON_XWALK_EXTENSION_H_
 #define XWALK_EXTENSIONS_COMMON_XWALK_EXTENSION_H_
 
+#include <stdint.h>
+#include <stddef.h>
 #include <string>
 #include <vector>
 #include "base/callback.h"
+#include "base/memory/ref_counted.h"
+#include "base/sequenced_task_runner.h"
 #include "base/values.h"
 
 namespace xwalk {
@@ -25,6 +29,7 @@ namespace extensions {
 // API.
 
 class XWalkExtensionInstance;
+class XWalkSerializedValueReader;
 
 // XWalkExtension is a factory class to be implemented by each extension, and
 // used to create extension instance objects. It also holds information valid
@@ -44,6 +49,13 @@ class XWalkExtension {
   // objects outside the namespace that is implicitly created using its name.
   virtual const base::ListValue& entry_points() const;
 
+  // Concurrent extensions get their own sequence in the extension worker
+  // pool instead of sharing the extension thread with the other in process
+  // extensions, so a slow extension doesn't delay messages of the others.
+  // Their instances must not rely on the extension thread message loop (e.g.
+  // watching file descriptors), see XWalkExtensionInstance::task_runner().
+  bool is_concurrent() const { return is_concurrent_; }
+
  protected:
   XWalkExtension();
   void set_name(const std::string& name) { name_ = name; }
@@ -53,6 +65,7 @@ class XWalkExtension {
   void set_entry_points(const std::vector<std::string>& entry_points) {
     entry_points_.AppendStrings(entry_points);
   }
+  void set_concurrent(bool concurrent) { is_concurrent_ = concurrent; }
 
  private:
   // Name of extension, used for dispatching messages.
@@ -67,6 +80,8 @@ class XWalkExtension {
   // extra conversions later on.
   base::ListValue entry_points_;
 
+  bool is_concurrent_;
+
   DISALLOW_COPY_AND_ASSIGN(XWalkExtension);
 };
 
@@ -84,20 +99,53 @@ class XWalkExtensionInstance {
   // process.
   virtual void HandleMessage(scoped_ptr<base::Value> msg) = 0;
 
+  // Messages sent from JavaScript arrive serialized, see
+  // xwalk_serialized_value.h. Instances that handle big messages can read
+  // them from |reader| without building a base::Value tree. The data is only
+  // valid during this call. By default the message is converted and passed
+  // to HandleMessage().
+  virtual void HandleSerializedMessage(XWalkSerializedValueReader* reader);
+
   // Allow to handle synchronous messages sent from JavaScript code. Renderer
   // will block until SendSyncReplyToJS() is called with the reply. The reply
   // can be sent after HandleSyncMessage() function returns.
   virtual void HandleSyncMessage(scoped_ptr<base::Value> msg);
 
+  // Allow to handle binary messages (ArrayBuffers) sent from JavaScript
+  // code. The data is owned by the caller and is only valid during this
+  // call.
+  virtual void HandleBinaryMessage(const uint8_t* data, size_t size);
+
+  // Allow to handle requests sent from JavaScript code. Unlike sync messages
+  // the renderer doesn't block waiting for the response, so many requests can
+  // be pending at the same time. Each one must be answered by calling
+  // SendResponseToJS() with its |request_id|, in any order.
+  virtual void HandleRequest(int request_id, scoped_ptr<base::Value> msg);
+
   // Callbacks used by extension instance to communicate back to JS. These are
   // set by the extension system. Callbacks will take the ownership of the
   // message.
   typedef base::Callback<void(scoped_ptr<base::Value> msg)> PostMessageCallback;
   typedef base::Callback<void(scoped_ptr<base::Value> msg)>
       SendSyncReplyCallback;
+  typedef base::Callback<void(const uint8_t* data, size_t size)>
+      PostBinaryMessageCallback;
+  typedef base::Callback<void(int request_id,
+                              scoped_ptr<base::Value> response)>
+      SendResponseCallback;
 
   void SetPostMessageCallback(const PostMessageCallback& callback);
   void SetSendSyncReplyCallback(const SendSyncReplyCallback& callback);
+  void SetPostBinaryMessageCallback(const PostBinaryMessageCallback& callback);
+  void SetSendResponseCallback(const SendResponseCallback& callback);
+
+  // The sequence this instance lives on, set by the extension system. Unlike
+  // MessageLoopProxy::current() it is also valid for concurrent extensions
+  // running in the extension worker pool.
+  void SetTaskRunner(scoped_refptr<base::SequencedTaskRunner> task_runner);
+  scoped_refptr<base::SequencedTaskRunner> task_runner() const {
+    return task_runner_;
+  }
 
   // Function to be used by extensions Instances to post messages back to
   // JavaScript in the renderer process. This function will take the ownership
@@ -106,6 +154,18 @@ class XWalkExtensionInstance {
     post_message_.Run(msg.Pass());
   }
 
+  // Post binary data back to JavaScript, it will be received as an
+  // ArrayBuffer. The data is copied, so caller keeps the ownership of it.
+  void PostBinaryMessageToJS(const uint8_t* data, size_t size) {
+    post_binary_message_.Run(data, size);
+  }
+
+  // Completes the request identified by |request_id|. A NULL |response|
+  // makes the request fail in JavaScript. Can be called from any thread.
+  void SendResponseToJS(int request_id, scoped_ptr<base::Value> response) {
+    send_response_.Run(request_id, response.Pass());
+  }
+
  protected:
   XWalkExtensionInstance();
 
@@ -117,6 +177,9 @@ class XWalkExtensionInstance {
  private:
   PostMessageCallback post_message_;
   SendSyncReplyCallback send_sync_reply_;
+  PostBinaryMessageCallback post_binary_message_;
+  SendResponseCallback send_response_;
+  scoped_refptr<base::SequencedTaskRunner> task_runner_;
 
   DISALLOW_COPY_AND_ASSIGN(XWalkExtensionInstance);
 };
@@ -0,0 +1,120 @@
+// Copyright (c) 2013 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "xwalk/extensions/common/xwalk_extension_binary_message.h"
+
+#include <string.h>
+#include <limits>
+#include <vector>
+#include "base/logging.h"
+#include "base/memory/shared_memory.h"
+#include "base/process/process_handle.h"
+#include "xwalk/extensions/common/xwalk_extension_messages.h"
+
+#if defined(OS_ANDROID)
+#include "third_party/ashmem/ashmem.h"
+#elif defined(OS_POSIX)
+#include <sys/stat.h>
+#endif
+
+namespace xwalk {
+namespace extensions {
+
+const size_t kBinaryMessageSharedMemoryThreshold = 64 * 1024;
+
+namespace {
+
+// On POSIX the shared memory handle is a file descriptor that is duplicated
+// by the IPC layer when the message is sent, so the target process handle is
+// not needed. Other platforms would need the handle of the peer process to
+// duplicate the segment, which we don't have here, so there we always copy
+// the contents into the message.
+bool CopyToSharedMemory(const uint8_t* data, size_t size,
+                        base::SharedMemoryHandle* handle) {
+#if defined(OS_POSIX)
+  base::SharedMemory shared_memory;
+  if (!shared_memory.CreateAndMapAnonymous(size)) {
+    LOG(WARNING) << "Couldn't allocate shared memory for binary message of "
+                 << size << " bytes.";
+    return false;
+  }
+  memcpy(shared_memory.memory(), data, size);
+  return shared_memory.GiveToProcess(base::GetCurrentProcessHandle(), handle);
+#else
+  return false;
+#endif
+}
+
+bool GetSharedMemorySize(const base::SharedMemory& shared_memory,
+                         size_t* size) {
+#if defined(OS_ANDROID)
+  // Ashmem regions have no size for fstat().
+  int region_size = ashmem_get_size_region(shared_memory.handle().fd);
+  if (region_size < 0)
+    return false;
+  *size = region_size;
+  return true;
+#elif defined(OS_POSIX)
+  struct stat st;
+  if (fstat(shared_memory.handle().fd, &st) != 0 || st.st_size < 0 ||
+      static_cast<uint64_t>(st.st_size) > std::numeric_limits<size_t>::max())
+    return false;
+  *size = st.st_size;
+  return true;
+#else
+  return false;
+#endif
+}
+
+// The size of a shared binary message is sent as uint32_t, bigger payloads
+// are copied into the message.
+template <typename InlineMessage, typename SharedMessage>
+IPC::Message* CreateBinaryMessage(int64_t instance_id,
+                                  const uint8_t* data, size_t size) {
+  if (size >= kBinaryMessageSharedMemoryThreshold &&
+      size <= std::numeric_limits<uint32_t>::max()) {
+    base::SharedMemoryHandle handle;
+    if (CopyToSharedMemory(data, size, &handle))
+      return new SharedMessage(instance_id, handle,
+                               static_cast<uint32_t>(size));
+  }
+
+  return new InlineMessage(instance_id,
+                           std::vector<uint8_t>(data, data + size));
+}
+
+}  // namespace
+
+IPC::Message* CreateBinaryMessageToJS(int64_t instance_id,
+                                      const uint8_t* data, size_t size) {
+  return CreateBinaryMessage<
+      XWalkExtensionClientMsg_PostBinaryMessageToJS,
+      XWalkExtensionClientMsg_PostSharedBinaryMessageToJS>(
+          instance_id, data, size);
+}
+
+IPC::Message* CreateBinaryMessageToNative(int64_t instance_id,
+                                          const uint8_t* data, size_t size) {
+  return CreateBinaryMessage<
+      XWalkExtensionServerMsg_PostBinaryMessageToNative,
+      XWalkExtensionServerMsg_PostSharedBinaryMessageToNative>(
+          instance_id, data, size);
+}
+
+bool MapReceivedSharedMemory(base::SharedMemory* shared_memory, size_t size) {
+  size_t segment_size;
+  if (!GetSharedMemorySize(*shared_memory, &segment_size)) {
+    LOG(WARNING) << "Couldn't get the size of a received shared memory.";
+    return false;
+  }
+  if (segment_size != size) {
+    LOG(WARNING) << "Received shared memory has " << segment_size
+                 << " bytes instead of " << size << ".";
+    return false;
+  }
+  return shared_memory->Map(size);
+}
+
+}  // namespace extensions
+}  // namespace xwalk
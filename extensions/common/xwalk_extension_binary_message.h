@@ -0,0 +1,43 @@
+// Copyright (c) 2013 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef XWALK_EXTENSIONS_COMMON_XWALK_EXTENSION_BINARY_MESSAGE_H_
+#define XWALK_EXTENSIONS_COMMON_XWALK_EXTENSION_BINARY_MESSAGE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace base {
+class SharedMemory;
+}
+
+namespace IPC {
+class Message;
+}
+
+namespace xwalk {
+namespace extensions {
+
+// Binary messages with payloads of this size or bigger are transferred using
+// a shared memory segment instead of being copied into the IPC message.
+extern const size_t kBinaryMessageSharedMemoryThreshold;
+
+// Create the IPC message used to send |size| bytes of |data| to the
+// instance identified by |instance_id|. The data is copied, either into the
+// message itself or into a shared memory segment, so the caller keeps the
+// ownership of |data|.
+IPC::Message* CreateBinaryMessageToJS(int64_t instance_id,
+                                      const uint8_t* data, size_t size);
+IPC::Message* CreateBinaryMessageToNative(int64_t instance_id,
+                                          const uint8_t* data, size_t size);
+
+// Maps |size| bytes of a segment received from another process, which can't
+// be trusted: mapping beyond the end of the segment would crash this process
+// when reading it. Fails unless the segment has exactly |size| bytes.
+bool MapReceivedSharedMemory(base::SharedMemory* shared_memory, size_t size);
+
+}  // namespace extensions
+}  // namespace xwalk
+
+#endif  // XWALK_EXTENSIONS_COMMON_XWALK_EXTENSION_BINARY_MESSAGE_H_
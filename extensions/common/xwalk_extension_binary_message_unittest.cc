@@ -0,0 +1,52 @@
+// Copyright (c) 2013 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "xwalk/extensions/common/xwalk_extension_binary_message.h"
+
+#include <string.h>
+#include "base/memory/shared_memory.h"
+#include "base/process/process_handle.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+using xwalk::extensions::MapReceivedSharedMemory;
+
+// Shared binary messages are only sent on POSIX.
+#if defined(OS_POSIX)
+
+namespace {
+
+const size_t kSegmentSize = 4096;
+
+// Returns a duplicate of a segment of |kSegmentSize| bytes, as received from
+// another process.
+base::SharedMemoryHandle CreateReceivedHandle() {
+  base::SharedMemory shared_memory;
+  EXPECT_TRUE(shared_memory.CreateAndMapAnonymous(kSegmentSize));
+  memset(shared_memory.memory(), 'x', kSegmentSize);
+  base::SharedMemoryHandle handle;
+  EXPECT_TRUE(shared_memory.ShareToProcess(base::GetCurrentProcessHandle(),
+                                           &handle));
+  return handle;
+}
+
+}  // namespace
+
+TEST(XWalkExtensionBinaryMessageTest, MapsSegmentOfTheSentSize) {
+  base::SharedMemory shared_memory(CreateReceivedHandle(), true);
+  ASSERT_TRUE(MapReceivedSharedMemory(&shared_memory, kSegmentSize));
+  EXPECT_EQ('x', static_cast<const char*>(shared_memory.memory())[0]);
+}
+
+TEST(XWalkExtensionBinaryMessageTest, RejectsSizeBiggerThanSegment) {
+  base::SharedMemory shared_memory(CreateReceivedHandle(), true);
+  EXPECT_FALSE(MapReceivedSharedMemory(&shared_memory, kSegmentSize * 16));
+  EXPECT_FALSE(shared_memory.memory());
+}
+
+TEST(XWalkExtensionBinaryMessageTest, RejectsSizeSmallerThanSegment) {
+  base::SharedMemory shared_memory(CreateReceivedHandle(), true);
+  EXPECT_FALSE(MapReceivedSharedMemory(&shared_memory, kSegmentSize / 2));
+}
+
+#endif  // defined(OS_POSIX)
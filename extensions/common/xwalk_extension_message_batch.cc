@@ -0,0 +1,63 @@
+// Copyright (c) 2013 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "xwalk/extensions/common/xwalk_extension_message_batch.h"
+
+#include <string>
+#include "base/command_line.h"
+#include "base/logging.h"
+#include "base/strings/string_number_conversions.h"
+#include "xwalk/extensions/common/xwalk_extension_switches.h"
+
+namespace xwalk {
+namespace extensions {
+
+const size_t XWalkExtensionMessageBatch::kMaxMessages;
+
+XWalkExtensionMessageBatch::XWalkExtensionMessageBatch() {}
+
+XWalkExtensionMessageBatch::~XWalkExtensionMessageBatch() {}
+
+void XWalkExtensionMessageBatch::Append(int64_t instance_id,
+                                        scoped_ptr<base::Value> msg) {
+  instance_ids_.push_back(instance_id);
+  contents_.Append(msg.release());
+}
+
+bool GetMessageBatchingDelay(base::TimeDelta* delay) {
+  CommandLine* cmd_line = CommandLine::ForCurrentProcess();
+  if (!cmd_line->HasSwitch(switches::kXWalkExtensionMessageBatching))
+    return false;
+
+  std::string value = cmd_line->GetSwitchValueASCII(
+      switches::kXWalkExtensionMessageBatching);
+  int milliseconds = 0;
+  if (!value.empty() &&
+      (!base::StringToInt(value, &milliseconds) || milliseconds < 0)) {
+    LOG(WARNING) << "Invalid value for --"
+                 << switches::kXWalkExtensionMessageBatching << ": " << value;
+    milliseconds = 0;
+  }
+
+  *delay = base::TimeDelta::FromMilliseconds(milliseconds);
+  return true;
+}
+
+void TakeBatchedMessages(const base::ListValue& contents,
+                         ScopedVector<base::Value>* messages) {
+  base::ListValue* list = const_cast<base::ListValue*>(&contents);
+  size_t size = list->GetSize();
+  messages->resize(size);
+
+  // Remove from the back so each removal doesn't shift the remaining
+  // elements of the list.
+  for (size_t i = size; i > 0; --i) {
+    scoped_ptr<base::Value> value;
+    list->Remove(i - 1, &value);
+    (*messages)[i - 1] = value.release();
+  }
+}
+
+}  // namespace extensions
+}  // namespace xwalk
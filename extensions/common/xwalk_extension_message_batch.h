@@ -0,0 +1,77 @@
+// Copyright (c) 2013 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef XWALK_EXTENSIONS_COMMON_XWALK_EXTENSION_MESSAGE_BATCH_H_
+#define XWALK_EXTENSIONS_COMMON_XWALK_EXTENSION_MESSAGE_BATCH_H_
+
+#include <stdint.h>
+#include <vector>
+#include "base/memory/scoped_ptr.h"
+#include "base/memory/scoped_vector.h"
+#include "base/time/time.h"
+#include "base/values.h"
+
+namespace IPC {
+class Message;
+}
+
+namespace xwalk {
+namespace extensions {
+
+// Accumulates messages posted to extension instances over the same channel,
+// so they can be delivered using a single IPC message. Messages are kept in
+// the order they were posted, see XWalkExtensionServerMsg_PostMessagesToNative
+// and XWalkExtensionClientMsg_PostMessagesToJS.
+//
+// This class is not thread-safe, users are expected to protect it with the
+// same lock protecting their IPC::Sender.
+class XWalkExtensionMessageBatch {
+ public:
+  // A batch is flushed right away once it reaches this number of messages,
+  // regardless of the time window.
+  static const size_t kMaxMessages = 256;
+
+  XWalkExtensionMessageBatch();
+  ~XWalkExtensionMessageBatch();
+
+  // Callers schedule a single flush for the messages appended, and flush
+  // right away once the batch is full. A scheduled flush is kept when the
+  // batch is sent earlier, it sends the messages appended since.
+  void Append(int64_t instance_id, scoped_ptr<base::Value> msg);
+
+  bool empty() const { return instance_ids_.empty(); }
+  bool is_full() const { return instance_ids_.size() >= kMaxMessages; }
+
+  // Moves the accumulated messages into a new IPC message. The batch will be
+  // empty after this call.
+  template <typename MessageType>
+  IPC::Message* Release() {
+    IPC::Message* message = new MessageType(instance_ids_, contents_);
+    instance_ids_.clear();
+    contents_.Clear();
+    return message;
+  }
+
+ private:
+  std::vector<int64_t> instance_ids_;
+  base::ListValue contents_;
+
+  DISALLOW_COPY_AND_ASSIGN(XWalkExtensionMessageBatch);
+};
+
+// Reads the delay used to coalesce messages from the command line. Returns
+// false if message batching is not enabled. A zero delay means that messages
+// posted during the same task are batched together.
+bool GetMessageBatchingDelay(base::TimeDelta* delay);
+
+// Takes the ownership of the messages from a batch received through IPC. The
+// const_cast is safe for the same reasons explained in
+// XWalkExtensionServer::OnPostMessageToNative().
+void TakeBatchedMessages(const base::ListValue& contents,
+                         ScopedVector<base::Value>* messages);
+
+}  // namespace extensions
+}  // namespace xwalk
+
+#endif  // XWALK_EXTENSIONS_COMMON_XWALK_EXTENSION_MESSAGE_BATCH_H_
@@ -5,6 +5,7 @@
 #include <stdint.h>
 #include <string>
 #include <vector>
+#include "base/memory/shared_memory.h"
 #include "base/values.h"
 #include "ipc/ipc_channel_handle.h"
 #include "ipc/ipc_message_macros.h"
@@ -27,9 +28,19 @@ enum {
 IPC_MESSAGE_CONTROL1(XWalkExtensionProcessMsg_RegisterExtensions,  // NOLINT(*)
                      base::FilePath /* extensions path */)
 
+// Asks the Extension Process for a new channel to a Render Process. Each
+// channel has its own set of instances, so a single Extension Process can
+// serve many Render Processes.
+IPC_MESSAGE_CONTROL1(XWalkExtensionProcessMsg_CreateRenderProcessChannel,  // NOLINT(*)
+                     int /* render process id */)
+
+IPC_MESSAGE_CONTROL1(XWalkExtensionProcessMsg_CloseRenderProcessChannel,  // NOLINT(*)
+                     int /* render process id */)
+
 // This implies that extensions are all loaded and Extension Process
 // is ready to be used.
-IPC_MESSAGE_CONTROL1(XWalkExtensionProcessHostMsg_RenderProcessChannelCreated, // NOLINT(*)
+IPC_MESSAGE_CONTROL2(XWalkExtensionProcessHostMsg_RenderProcessChannelCreated, // NOLINT(*)
+                     int /* render process id */,
                      IPC::ChannelHandle /* channel id */)
 
 // Message from Render Process to Browser Process. This message needs
@@ -44,12 +55,6 @@ IPC_SYNC_MESSAGE_CONTROL0_1(XWalkExtensionProcessHostMsg_GetExtensionProcessChan
 #undef IPC_MESSAGE_START
 #define IPC_MESSAGE_START XWalkExtensionClientServerMsgStart
 
-IPC_STRUCT_BEGIN(XWalkExtensionServerMsg_ExtensionRegisterParams)
-  IPC_STRUCT_MEMBER(std::string, name)
-  IPC_STRUCT_MEMBER(std::string, js_api)
-  IPC_STRUCT_MEMBER(std::vector<std::string>, entry_points)
-IPC_STRUCT_END()
-
 IPC_MESSAGE_CONTROL2(XWalkExtensionServerMsg_CreateInstance,  // NOLINT(*)
                      int64_t /* instance id */,
                      std::string /* extension name */)
@@ -58,17 +63,71 @@ IPC_MESSAGE_CONTROL2(XWalkExtensionServerMsg_PostMessageToNative,  // NOLINT(*)
                      int64_t /* instance id */,
                      base::ListValue /* contents */)
 
+// Same as PostMessageToNative, but the contents are written by
+// XWalkSerializedValueWriter instead of wrapped in a base::ListValue.
+IPC_MESSAGE_CONTROL2(XWalkExtensionServerMsg_PostSerializedMessageToNative,  // NOLINT(*)
+                     int64_t /* instance id */,
+                     std::string /* serialized contents */)
+
 IPC_MESSAGE_CONTROL2(XWalkExtensionClientMsg_PostMessageToJS,  // NOLINT(*)
                      int64_t /* instance id */,
                      base::ListValue /* contents */)
 
+// Messages coalesced by XWalkExtensionMessageBatch when batching is enabled.
+// Each element of the contents is delivered to the instance with the same
+// index in the instance ids vector, in order.
+IPC_MESSAGE_CONTROL2(XWalkExtensionServerMsg_PostMessagesToNative,  // NOLINT(*)
+                     std::vector<int64_t> /* instance ids */,
+                     base::ListValue /* contents */)
+
+IPC_MESSAGE_CONTROL2(XWalkExtensionClientMsg_PostMessagesToJS,  // NOLINT(*)
+                     std::vector<int64_t> /* instance ids */,
+                     base::ListValue /* contents */)
+
+// Binary messages are sent inline when small, and through a shared memory
+// segment otherwise. See xwalk_extension_binary_message.h.
+IPC_MESSAGE_CONTROL2(XWalkExtensionServerMsg_PostBinaryMessageToNative,  // NOLINT(*)
+                     int64_t /* instance id */,
+                     std::vector<uint8_t> /* contents */)
+
+IPC_MESSAGE_CONTROL3(XWalkExtensionServerMsg_PostSharedBinaryMessageToNative,  // NOLINT(*)
+                     int64_t /* instance id */,
+                     base::SharedMemoryHandle /* contents */,
+                     uint32_t /* size */)
+
+IPC_MESSAGE_CONTROL2(XWalkExtensionClientMsg_PostBinaryMessageToJS,  // NOLINT(*)
+                     int64_t /* instance id */,
+                     std::vector<uint8_t> /* contents */)
+
+IPC_MESSAGE_CONTROL3(XWalkExtensionClientMsg_PostSharedBinaryMessageToJS,  // NOLINT(*)
+                     int64_t /* instance id */,
+                     base::SharedMemoryHandle /* contents */,
+                     uint32_t /* size */)
+
+// Requests are answered asynchronously with a response carrying the same
+// request id. An empty response list means the request failed.
+IPC_MESSAGE_CONTROL3(XWalkExtensionServerMsg_PostRequestToNative,  // NOLINT(*)
+                     int64_t /* instance id */,
+                     int /* request id */,
+                     base::ListValue /* contents */)
+
+IPC_MESSAGE_CONTROL3(XWalkExtensionClientMsg_PostResponseToJS,  // NOLINT(*)
+                     int64_t /* instance id */,
+                     int /* request id */,
+                     base::ListValue /* response */)
+
 IPC_SYNC_MESSAGE_CONTROL2_1(XWalkExtensionServerMsg_SendSyncMessageToNative,  // NOLINT(*)
                             int64_t /* instance id */,
                             base::ListValue /* input contents */,
                             base::ListValue /* output contents */)
 
-IPC_SYNC_MESSAGE_CONTROL0_1(XWalkExtensionServerMsg_GetExtensions,  // NOLINT(*)
-                            std::vector<XWalkExtensionServerMsg_ExtensionRegisterParams> /* output contents */) // NOLINT(*)
+// The registry is a read-only shared memory segment, see
+// XWalkExtensionRegistry. If the system can't provide one, the handle is
+// invalid and the contents are copied into the reply instead.
+IPC_SYNC_MESSAGE_CONTROL0_3(XWalkExtensionServerMsg_GetExtensionRegistry,  // NOLINT(*)
+                            base::SharedMemoryHandle /* registry handle */,
+                            uint32_t /* registry size */,
+                            std::string /* registry contents */)
 
 IPC_MESSAGE_CONTROL1(XWalkExtensionServerMsg_DestroyInstance,  // NOLINT(*)
                      int64_t /* instance id */)
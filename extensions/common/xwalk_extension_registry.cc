@@ -0,0 +1,279 @@
+// Copyright (c) 2013 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "xwalk/extensions/common/xwalk_extension_registry.h"
+
+#include <string.h>
+#include <map>
+#include "base/file_util.h"
+#include "base/lazy_instance.h"
+#include "base/logging.h"
+#include "base/pickle.h"
+#include "base/process/process_handle.h"
+#include "base/sha1.h"
+#include "base/synchronization/lock.h"
+#include "base/values.h"
+#include "xwalk/extensions/common/xwalk_extension.h"
+#include "xwalk/extensions/common/xwalk_extension_binary_message.h"
+
+#if defined(OS_POSIX)
+#include <unistd.h>
+#include "base/posix/eintr_wrapper.h"
+#endif
+
+#if defined(OS_ANDROID)
+#include <sys/mman.h>
+#include "third_party/ashmem/ashmem.h"
+#elif defined(OS_LINUX)
+#include <fcntl.h>
+#include <sys/stat.h>
+#include "base/strings/stringprintf.h"
+#endif
+
+namespace xwalk {
+namespace extensions {
+
+namespace {
+
+// Bump when the serialization format changes.
+const int kRegistryVersion = 1;
+
+// Registries already created, indexed by the hash of their contents. They are
+// kept for the whole session, there are usually very few of them.
+struct RegistryCache {
+  base::Lock lock;
+  std::map<std::string, scoped_refptr<XWalkExtensionRegistry> > registries;
+};
+
+base::LazyInstance<RegistryCache>::Leaky g_registry_cache =
+    LAZY_INSTANCE_INITIALIZER;
+
+// Reads a string written by Pickle::WriteString() without copying it.
+bool ReadStringPiece(const Pickle& pickle, PickleIterator* iter,
+                     base::StringPiece* result) {
+  int length;
+  const char* data;
+  if (!pickle.ReadInt(iter, &length) || length < 0 ||
+      !pickle.ReadBytes(iter, &data, length))
+    return false;
+  result->set(data, length);
+  return true;
+}
+
+// Returns a read-only descriptor of the segment of |shared_memory|, whose
+// mappings are all gone, or -1 if it can't be done on this system. Mapping
+// it for writing fails, in this process and in those it's shared with.
+int MakeReadOnlyDescriptor(base::SharedMemory* shared_memory) {
+#if defined(OS_ANDROID)
+  // Ashmem regions keep the protection for every descriptor of the region.
+  const int fd = shared_memory->handle().fd;
+  if (ashmem_set_prot_region(fd, PROT_READ) < 0)
+    return -1;
+  return HANDLE_EINTR(dup(fd));
+#elif defined(OS_LINUX)
+  // The segment is an unlinked file, it's opened again read-only through
+  // procfs. It can't be opened for writing anymore, by its owner either.
+  const int fd = shared_memory->handle().fd;
+  if (HANDLE_EINTR(fchmod(fd, S_IRUSR)) < 0)
+    return -1;
+  return HANDLE_EINTR(open(base::StringPrintf("/proc/self/fd/%d", fd).c_str(),
+                           O_RDONLY));
+#else
+  return -1;
+#endif
+}
+
+// Returns a segment holding a copy of |data| that can't be written anymore,
+// by this process nor by those it is shared with, or NULL if the system
+// doesn't allow that. A writable segment must never be shared, since the
+// registry is shared by all the Render Processes.
+scoped_ptr<base::SharedMemory> CreateReadOnlySharedMemory(const void* data,
+                                                          size_t size) {
+#if defined(OS_POSIX)
+  base::SharedMemory writable;
+  if (!writable.CreateAndMapAnonymous(size))
+    return scoped_ptr<base::SharedMemory>();
+  memcpy(writable.memory(), data, size);
+  writable.Unmap();
+
+  const int read_only_fd = MakeReadOnlyDescriptor(&writable);
+  // The writable descriptor is closed here.
+  writable.Close();
+  if (read_only_fd < 0)
+    return scoped_ptr<base::SharedMemory>();
+
+  scoped_ptr<base::SharedMemory> shared_memory(new base::SharedMemory(
+      base::FileDescriptor(read_only_fd, true), true /* read_only */));
+  if (!shared_memory->Map(size))
+    return scoped_ptr<base::SharedMemory>();
+  return shared_memory.Pass();
+#else
+  return scoped_ptr<base::SharedMemory>();
+#endif
+}
+
+}  // namespace
+
+XWalkExtensionRegistry::Builder::Builder() {}
+
+XWalkExtensionRegistry::Builder::~Builder() {}
+
+void XWalkExtensionRegistry::Builder::AddExtension(
+    const XWalkExtension* extension) {
+  extensions_.push_back(extension);
+}
+
+scoped_refptr<XWalkExtensionRegistry> XWalkExtensionRegistry::Builder::Build() {
+  Pickle pickle;
+  pickle.WriteInt(kRegistryVersion);
+  pickle.WriteUInt32(extensions_.size());
+
+  std::vector<const XWalkExtension*>::const_iterator it = extensions_.begin();
+  for (; it != extensions_.end(); ++it) {
+    const XWalkExtension* extension = *it;
+    pickle.WriteString(extension->name());
+    pickle.WriteString(extension->javascript_api());
+
+    const base::ListValue& entry_points = extension->entry_points();
+    pickle.WriteUInt32(entry_points.GetSize());
+    base::ListValue::const_iterator entry_it = entry_points.begin();
+    for (; entry_it != entry_points.end(); ++entry_it) {
+      std::string entry_point;
+      (*entry_it)->GetAsString(&entry_point);
+      pickle.WriteString(entry_point);
+    }
+  }
+
+  const std::string key = base::SHA1HashString(
+      std::string(static_cast<const char*>(pickle.data()), pickle.size()));
+
+  RegistryCache* cache = g_registry_cache.Pointer();
+  base::AutoLock lock(cache->lock);
+  scoped_refptr<XWalkExtensionRegistry>& registry = cache->registries[key];
+  if (registry)
+    return registry;
+
+  scoped_ptr<base::SharedMemory> shared_memory =
+      CreateReadOnlySharedMemory(pickle.data(), pickle.size());
+  if (shared_memory) {
+    registry = new XWalkExtensionRegistry(shared_memory.Pass(), pickle.size());
+  } else {
+    registry = new XWalkExtensionRegistry(
+        std::string(static_cast<const char*>(pickle.data()), pickle.size()));
+  }
+  return registry;
+}
+
+XWalkExtensionRegistry::Entry::Entry() {}
+
+XWalkExtensionRegistry::Entry::~Entry() {}
+
+// static
+bool XWalkExtensionRegistry::Parse(const void* data, size_t size,
+                                   std::vector<Entry>* entries) {
+  Pickle pickle(static_cast<const char*>(data), size);
+  PickleIterator iter(pickle);
+
+  int version;
+  uint32 count;
+  if (!pickle.ReadInt(&iter, &version) || version != kRegistryVersion ||
+      !pickle.ReadUInt32(&iter, &count))
+    return false;
+
+  entries->resize(count);
+  for (uint32 i = 0; i < count; ++i) {
+    Entry& entry = (*entries)[i];
+    uint32 entry_points_count;
+    if (!ReadStringPiece(pickle, &iter, &entry.name) ||
+        !ReadStringPiece(pickle, &iter, &entry.js_api) ||
+        !pickle.ReadUInt32(&iter, &entry_points_count)) {
+      entries->clear();
+      return false;
+    }
+
+    for (uint32 j = 0; j < entry_points_count; ++j) {
+      std::string entry_point;
+      if (!pickle.ReadString(&iter, &entry_point)) {
+        entries->clear();
+        return false;
+      }
+      entry.entry_points.push_back(entry_point);
+    }
+  }
+
+  return true;
+}
+
+XWalkExtensionRegistry::XWalkExtensionRegistry(
+    scoped_ptr<base::SharedMemory> shared_memory, size_t size)
+    : shared_memory_(shared_memory.Pass()),
+      size_(size) {}
+
+XWalkExtensionRegistry::XWalkExtensionRegistry(const std::string& contents)
+    : contents_(contents),
+      size_(contents.size()) {}
+
+XWalkExtensionRegistry::~XWalkExtensionRegistry() {}
+
+// On POSIX the handle is a file descriptor duplicated by the IPC layer, see
+// also xwalk_extension_binary_message.cc.
+bool XWalkExtensionRegistry::ShareToProcess(
+    base::SharedMemoryHandle* handle) const {
+#if defined(OS_POSIX)
+  if (!shared_memory_)
+    return false;
+  return shared_memory_->ShareToProcess(base::GetCurrentProcessHandle(),
+                                        handle);
+#else
+  return false;
+#endif
+}
+
+base::StringPiece XWalkExtensionRegistry::contents() const {
+  if (!shared_memory_)
+    return contents_;
+  return base::StringPiece(static_cast<const char*>(shared_memory_->memory()),
+                           size_);
+}
+
+void GetExtensionRegistryReply(const XWalkExtensionRegistry* registry,
+                               base::SharedMemoryHandle* handle,
+                               uint32_t* size,
+                               std::string* contents) {
+  *handle = base::SharedMemory::NULLHandle();
+  *size = 0;
+  if (!registry)
+    return;
+
+  *size = registry->size();
+  if (!registry->ShareToProcess(handle))
+    registry->contents().CopyToString(contents);
+}
+
+XWalkExtensionRegistryMapping::XWalkExtensionRegistryMapping() {}
+
+XWalkExtensionRegistryMapping::~XWalkExtensionRegistryMapping() {}
+
+bool XWalkExtensionRegistryMapping::Map(base::SharedMemoryHandle handle,
+                                        uint32_t size,
+                                        const std::string& contents) {
+  DCHECK(!shared_memory_ && contents_.empty());
+
+  if (!base::SharedMemory::IsHandleValid(handle)) {
+    contents_ = contents;
+    return XWalkExtensionRegistry::Parse(contents_.data(), contents_.size(),
+                                         &entries_);
+  }
+
+  shared_memory_.reset(new base::SharedMemory(handle, true /* read_only */));
+  if (!MapReceivedSharedMemory(shared_memory_.get(), size)) {
+    LOG(WARNING) << "Couldn't map the extensions registry.";
+    return false;
+  }
+  return XWalkExtensionRegistry::Parse(shared_memory_->memory(), size,
+                                       &entries_);
+}
+
+}  // namespace extensions
+}  // namespace xwalk
@@ -0,0 +1,123 @@
+// Copyright (c) 2013 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef XWALK_EXTENSIONS_COMMON_XWALK_EXTENSION_REGISTRY_H_
+#define XWALK_EXTENSIONS_COMMON_XWALK_EXTENSION_REGISTRY_H_
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "base/memory/ref_counted.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/memory/shared_memory.h"
+#include "base/strings/string_piece.h"
+
+namespace xwalk {
+namespace extensions {
+
+class XWalkExtension;
+
+// Serialized description of a set of extensions: their names, entry points
+// and JavaScript API code. It is written once into a read-only shared memory
+// segment that Render Processes map, instead of each of them receiving its
+// own copy of every extension's JavaScript API. Only read-only descriptors
+// of the segment are kept, so no process can modify it; where the system
+// can't provide them the registry is kept in private memory and copied to
+// each Render Process.
+//
+// Registries with the same contents are shared, so the usual case of every
+// Render Process getting the same set of extensions needs a single segment
+// for the whole session.
+class XWalkExtensionRegistry
+    : public base::RefCountedThreadSafe<XWalkExtensionRegistry> {
+ public:
+  // Collects the extensions to be serialized. The extensions must be alive
+  // until Build() is called.
+  class Builder {
+   public:
+    Builder();
+    ~Builder();
+
+    void AddExtension(const XWalkExtension* extension);
+
+    scoped_refptr<XWalkExtensionRegistry> Build();
+
+   private:
+    std::vector<const XWalkExtension*> extensions_;
+
+    DISALLOW_COPY_AND_ASSIGN(Builder);
+  };
+
+  // An extension as read from the serialized registry. The data points to
+  // the memory passed to Parse(), so it is only valid while that memory is.
+  struct Entry {
+    Entry();
+    ~Entry();
+    base::StringPiece name;
+    base::StringPiece js_api;
+    std::vector<std::string> entry_points;
+  };
+
+  static bool Parse(const void* data, size_t size,
+                    std::vector<Entry>* entries);
+
+  // Fills |handle| with a duplicate of the read-only segment to be sent through
+  // IPC. Returns false if there's no such segment, in that case contents()
+  // should be copied into the message instead.
+  bool ShareToProcess(base::SharedMemoryHandle* handle) const;
+
+  base::StringPiece contents() const;
+  size_t size() const { return size_; }
+
+ private:
+  friend class base::RefCountedThreadSafe<XWalkExtensionRegistry>;
+
+  XWalkExtensionRegistry(scoped_ptr<base::SharedMemory> shared_memory,
+                         size_t size);
+  explicit XWalkExtensionRegistry(const std::string& contents);
+  ~XWalkExtensionRegistry();
+
+  // Either the read-only segment, or |contents_| when it couldn't be created.
+  scoped_ptr<base::SharedMemory> shared_memory_;
+  std::string contents_;
+  size_t size_;
+
+  DISALLOW_COPY_AND_ASSIGN(XWalkExtensionRegistry);
+};
+
+// Fills the reply of XWalkExtensionServerMsg_GetExtensionRegistry. The
+// |registry| can be NULL, then the client will have no extensions.
+void GetExtensionRegistryReply(const XWalkExtensionRegistry* registry,
+                               base::SharedMemoryHandle* handle,
+                               uint32_t* size,
+                               std::string* contents);
+
+// Maps the registry received from an XWalkExtensionServer and keeps it
+// mapped, the entries point directly into the mapped memory.
+class XWalkExtensionRegistryMapping {
+ public:
+  XWalkExtensionRegistryMapping();
+  ~XWalkExtensionRegistryMapping();
+
+  // Takes the ownership of |handle|. If it isn't valid, the registry is read
+  // from |contents| instead.
+  bool Map(base::SharedMemoryHandle handle, uint32_t size,
+           const std::string& contents);
+
+  const std::vector<XWalkExtensionRegistry::Entry>& entries() const {
+    return entries_;
+  }
+
+ private:
+  scoped_ptr<base::SharedMemory> shared_memory_;
+  std::string contents_;
+  std::vector<XWalkExtensionRegistry::Entry> entries_;
+
+  DISALLOW_COPY_AND_ASSIGN(XWalkExtensionRegistryMapping);
+};
+
+}  // namespace extensions
+}  // namespace xwalk
+
+#endif  // XWALK_EXTENSIONS_COMMON_XWALK_EXTENSION_REGISTRY_H_
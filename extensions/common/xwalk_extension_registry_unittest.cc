@@ -0,0 +1,121 @@
+// Copyright (c) 2013 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "xwalk/extensions/common/xwalk_extension_registry.h"
+
+#include <string>
+#include <vector>
+#include "testing/gtest/include/gtest/gtest.h"
+#include "xwalk/extensions/common/xwalk_extension.h"
+
+using xwalk::extensions::GetExtensionRegistryReply;
+using xwalk::extensions::XWalkExtension;
+using xwalk::extensions::XWalkExtensionInstance;
+using xwalk::extensions::XWalkExtensionRegistry;
+using xwalk::extensions::XWalkExtensionRegistryMapping;
+
+namespace {
+
+class TestExtension : public XWalkExtension {
+ public:
+  TestExtension(const std::string& name, const std::string& api,
+                const std::vector<std::string>& entry_points) {
+    set_name(name);
+    set_javascript_api(api);
+    set_entry_points(entry_points);
+  }
+
+  virtual XWalkExtensionInstance* CreateInstance() OVERRIDE {
+    return NULL;
+  }
+};
+
+}  // namespace
+
+TEST(XWalkExtensionRegistryTest, SerializeAndMap) {
+  std::vector<std::string> entry_points;
+  TestExtension first("first", "exports.value = 1;", entry_points);
+  entry_points.push_back("SecondEntryPoint");
+  entry_points.push_back("window.secondEntryPoint");
+  TestExtension second("second", std::string(100000, ' '), entry_points);
+
+  XWalkExtensionRegistry::Builder builder;
+  builder.AddExtension(&first);
+  builder.AddExtension(&second);
+  scoped_refptr<XWalkExtensionRegistry> registry = builder.Build();
+  ASSERT_TRUE(registry);
+
+  base::SharedMemoryHandle handle;
+  uint32_t size;
+  std::string contents;
+  GetExtensionRegistryReply(registry.get(), &handle, &size, &contents);
+  EXPECT_EQ(registry->size(), size);
+
+  XWalkExtensionRegistryMapping mapping;
+  ASSERT_TRUE(mapping.Map(handle, size, contents));
+
+  const std::vector<XWalkExtensionRegistry::Entry>& entries =
+      mapping.entries();
+  ASSERT_EQ(2u, entries.size());
+  EXPECT_EQ("first", entries[0].name);
+  EXPECT_EQ("exports.value = 1;", entries[0].js_api);
+  EXPECT_TRUE(entries[0].entry_points.empty());
+  EXPECT_EQ("second", entries[1].name);
+  EXPECT_EQ(100000u, entries[1].js_api.size());
+  EXPECT_EQ(entry_points, entries[1].entry_points);
+}
+
+TEST(XWalkExtensionRegistryTest, SameContentsAreShared) {
+  std::vector<std::string> entry_points;
+  TestExtension extension("shared", "exports.value = 1;", entry_points);
+  TestExtension same_extension("shared", "exports.value = 1;", entry_points);
+  TestExtension other_extension("shared", "exports.value = 2;", entry_points);
+
+  XWalkExtensionRegistry::Builder builder;
+  builder.AddExtension(&extension);
+  scoped_refptr<XWalkExtensionRegistry> registry = builder.Build();
+
+  XWalkExtensionRegistry::Builder same_builder;
+  same_builder.AddExtension(&same_extension);
+  EXPECT_EQ(registry.get(), same_builder.Build().get());
+
+  XWalkExtensionRegistry::Builder other_builder;
+  other_builder.AddExtension(&other_extension);
+  EXPECT_NE(registry.get(), other_builder.Build().get());
+}
+
+TEST(XWalkExtensionRegistryTest, RejectInvalidContents) {
+  std::vector<XWalkExtensionRegistry::Entry> entries;
+  const std::string garbage(64, 'x');
+  EXPECT_FALSE(XWalkExtensionRegistry::Parse(garbage.data(), garbage.size(),
+                                             &entries));
+  EXPECT_TRUE(entries.empty());
+}
+
+// Every Render Process maps the same segment, none of them can be allowed to
+// write into it.
+TEST(XWalkExtensionRegistryTest, SharedSegmentIsReadOnly) {
+  std::vector<std::string> entry_points;
+  TestExtension extension("read_only", "exports.value = 1;", entry_points);
+
+  XWalkExtensionRegistry::Builder builder;
+  builder.AddExtension(&extension);
+  scoped_refptr<XWalkExtensionRegistry> registry = builder.Build();
+  ASSERT_TRUE(registry);
+
+  base::SharedMemoryHandle handle;
+#if defined(OS_LINUX) || defined(OS_ANDROID)
+  // Read-only segments are available on every supported kernel.
+  ASSERT_TRUE(registry->ShareToProcess(&handle));
+#else
+  if (!registry->ShareToProcess(&handle)) {
+    // Copied to each Render Process instead.
+    EXPECT_EQ(registry->size(), registry->contents().size());
+    return;
+  }
+#endif
+
+  base::SharedMemory writable(handle, false /* read_only */);
+  EXPECT_FALSE(writable.Map(registry->size()));
+}
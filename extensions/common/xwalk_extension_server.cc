@@ -7,24 +7,32 @@
 #include "base/file_util.h"
 #include "base/files/file_enumerator.h"
 #include "base/files/file_path.h"
+#include "base/message_loop/message_loop_proxy.h"
+#include "base/sequenced_task_runner.h"
 #include "base/strings/string16.h"
 #include "base/strings/utf_string_conversions.h"
 #include "base/stl_util.h"
 #include "content/public/browser/render_process_host.h"
 #include "ipc/ipc_sender.h"
 #include "xwalk/extensions/common/xwalk_extension.h"
+#include "xwalk/extensions/common/xwalk_extension_binary_message.h"
 #include "xwalk/extensions/common/xwalk_extension_messages.h"
 #include "xwalk/extensions/common/xwalk_external_extension.h"
+#include "xwalk/extensions/common/xwalk_serialized_value.h"
 
 namespace xwalk {
 namespace extensions {
 
 XWalkExtensionServer::XWalkExtensionServer()
-    : sender_(NULL) {}
+    : sender_(NULL),
+      is_flush_scheduled_(false),
+      owns_extensions_(true),
+      weak_factory_(this) {}
 
 XWalkExtensionServer::~XWalkExtensionServer() {
   DeleteInstanceMap();
-  STLDeleteValues(&extensions_);
+  if (owns_extensions_)
+    STLDeleteValues(&extensions_);
 }
 
 bool XWalkExtensionServer::OnMessageReceived(const IPC::Message& message) {
@@ -36,11 +44,22 @@ bool XWalkExtensionServer::OnMessageReceived(const IPC::Message& message) {
         OnDestroyInstance)
     IPC_MESSAGE_HANDLER(XWalkExtensionServerMsg_PostMessageToNative,
         OnPostMessageToNative)
+    IPC_MESSAGE_HANDLER(XWalkExtensionServerMsg_PostSerializedMessageToNative,
+        OnPostSerializedMessageToNative)
+    IPC_MESSAGE_HANDLER(XWalkExtensionServerMsg_PostMessagesToNative,
+        OnPostMessagesToNative)
+    IPC_MESSAGE_HANDLER(XWalkExtensionServerMsg_PostBinaryMessageToNative,
+        OnPostBinaryMessageToNative)
+    IPC_MESSAGE_HANDLER(
+        XWalkExtensionServerMsg_PostSharedBinaryMessageToNative,
+        OnPostSharedBinaryMessageToNative)
+    IPC_MESSAGE_HANDLER(XWalkExtensionServerMsg_PostRequestToNative,
+        OnPostRequestToNative)
     IPC_MESSAGE_HANDLER_DELAY_REPLY(
         XWalkExtensionServerMsg_SendSyncMessageToNative,
         OnSendSyncMessageToNative)
-    IPC_MESSAGE_HANDLER(XWalkExtensionServerMsg_GetExtensions,
-        OnGetExtensions)
+    IPC_MESSAGE_HANDLER(XWalkExtensionServerMsg_GetExtensionRegistry,
+        OnGetExtensionRegistry)
     IPC_MESSAGE_UNHANDLED(handled = false)
   IPC_END_MESSAGE_MAP()
 
@@ -66,6 +85,19 @@ void XWalkExtensionServer::OnCreateInstance(int64_t instance_id,
       base::Bind(&XWalkExtensionServer::SendSyncReplyToJSCallback,
                  base::Unretained(this), instance_id));
 
+  instance->SetPostBinaryMessageCallback(
+      base::Bind(&XWalkExtensionServer::PostBinaryMessageToJSCallback,
+                 base::Unretained(this), instance_id));
+
+  instance->SetSendResponseCallback(
+      base::Bind(&XWalkExtensionServer::SendResponseToJSCallback,
+                 base::Unretained(this), instance_id));
+
+  if (task_runner_)
+    instance->SetTaskRunner(task_runner_);
+  else
+    instance->SetTaskRunner(base::MessageLoopProxy::current());
+
   InstanceExecutionData data;
   data.instance = instance;
   data.pending_reply = NULL;
@@ -95,6 +127,97 @@ void XWalkExtensionServer::OnPostMessageToNative(int64_t instance_id,
   data.instance->HandleMessage(value.Pass());
 }
 
+void XWalkExtensionServer::OnPostSerializedMessageToNative(
+    int64_t instance_id, const std::string& msg) {
+  InstanceMap::const_iterator it = instances_.find(instance_id);
+  if (it == instances_.end()) {
+    LOG(WARNING) << "Can't PostMessage to invalid Extension instance id: "
+                 << instance_id;
+    return;
+  }
+
+  // The reader points directly into the IPC message contents.
+  XWalkSerializedValueReader reader(msg);
+  if (!reader.is_valid()) {
+    LOG(WARNING) << "Ignoring malformed message sent to Extension instance "
+                 << "id: " << instance_id;
+    return;
+  }
+  it->second.instance->HandleSerializedMessage(&reader);
+}
+
+void XWalkExtensionServer::OnPostMessagesToNative(
+    const std::vector<int64_t>& instance_ids, const base::ListValue& contents) {
+  if (instance_ids.size() != contents.GetSize()) {
+    LOG(WARNING) << "Ignoring malformed batch of messages.";
+    return;
+  }
+
+  ScopedVector<base::Value> messages;
+  TakeBatchedMessages(contents, &messages);
+
+  for (size_t i = 0; i < instance_ids.size(); ++i) {
+    XWalkExtensionInstance* instance = GetInstance(instance_ids[i]);
+    if (!instance)
+      continue;
+    scoped_ptr<base::Value> value(messages[i]);
+    messages[i] = NULL;
+    instance->HandleMessage(value.Pass());
+  }
+}
+
+void XWalkExtensionServer::OnPostBinaryMessageToNative(int64_t instance_id,
+    const std::vector<uint8_t>& data) {
+  XWalkExtensionInstance* instance = GetInstance(instance_id);
+  if (!instance)
+    return;
+
+  instance->HandleBinaryMessage(vector_as_array(&data), data.size());
+}
+
+void XWalkExtensionServer::OnPostSharedBinaryMessageToNative(
+    int64_t instance_id, base::SharedMemoryHandle handle, uint32_t size) {
+  // Take ownership of the handle first, so it is closed even if the
+  // instance is not valid anymore.
+  base::SharedMemory shared_memory(handle, true);
+
+  XWalkExtensionInstance* instance = GetInstance(instance_id);
+  if (!instance)
+    return;
+
+  if (!MapReceivedSharedMemory(&shared_memory, size)) {
+    LOG(WARNING) << "Couldn't map binary message of " << size
+                 << " bytes for Extension instance id: " << instance_id;
+    return;
+  }
+
+  instance->HandleBinaryMessage(
+      static_cast<const uint8_t*>(shared_memory.memory()), size);
+}
+
+void XWalkExtensionServer::OnPostRequestToNative(int64_t instance_id,
+    int request_id, const base::ListValue& msg) {
+  XWalkExtensionInstance* instance = GetInstance(instance_id);
+  if (!instance)
+    return;
+
+  // See comment in OnSendSyncMessageToNative() about the const_cast.
+  scoped_ptr<base::Value> value;
+  const_cast<base::ListValue*>(&msg)->Remove(0, &value);
+  instance->HandleRequest(request_id, value.Pass());
+}
+
+XWalkExtensionInstance* XWalkExtensionServer::GetInstance(
+    int64_t instance_id) {
+  InstanceMap::const_iterator it = instances_.find(instance_id);
+  if (it == instances_.end()) {
+    LOG(WARNING) << "Can't PostMessage to invalid Extension instance id: "
+                 << instance_id;
+    return NULL;
+  }
+  return it->second.instance;
+}
+
 void XWalkExtensionServer::Initialize(IPC::Sender* sender) {
   base::AutoLock l(sender_lock_);
   DCHECK(!sender_);
@@ -105,9 +228,37 @@ bool XWalkExtensionServer::Send(IPC::Message* msg) {
   base::AutoLock l(sender_lock_);
   if (!sender_)
     return false;
+
+  // Messages waiting in the batch were posted before this one, so they go
+  // first to keep the ordering.
+  SendMessageBatchLocked();
   return sender_->Send(msg);
 }
 
+void XWalkExtensionServer::EnableMessageBatching(
+    scoped_refptr<base::SequencedTaskRunner> task_runner,
+    base::TimeDelta delay) {
+  base::AutoLock l(sender_lock_);
+  DCHECK(!batch_task_runner_);
+  weak_this_ = weak_factory_.GetWeakPtr();
+  batch_task_runner_ = task_runner;
+  batch_delay_ = delay;
+}
+
+void XWalkExtensionServer::FlushMessageBatch() {
+  base::AutoLock l(sender_lock_);
+  is_flush_scheduled_ = false;
+  SendMessageBatchLocked();
+}
+
+void XWalkExtensionServer::SendMessageBatchLocked() {
+  sender_lock_.AssertAcquired();
+  if (!sender_ || message_batch_.empty())
+    return;
+  sender_->Send(
+      message_batch_.Release<XWalkExtensionClientMsg_PostMessagesToJS>());
+}
+
 namespace {
 
 bool ValidateExtensionIdentifier(const std::string& name) {
@@ -173,9 +324,19 @@ bool XWalkExtensionServer::RegisterExtension(
   std::string name = extension->name();
   extension_symbols_.insert(name);
   extensions_[name] = extension.release();
+  registry_ = NULL;
   return true;
 }
 
+void XWalkExtensionServer::ShareExtensionsFrom(
+    const XWalkExtensionServer& owner) {
+  DCHECK(extensions_.empty());
+  owns_extensions_ = false;
+  extensions_ = owner.extensions_;
+  extension_symbols_ = owner.extension_symbols_;
+  registry_ = owner.registry_;
+}
+
 bool XWalkExtensionServer::ContainsExtension(
     const std::string& extension_name) const {
   return ContainsKey(extensions_, extension_name);
@@ -183,11 +344,42 @@ bool XWalkExtensionServer::ContainsExtension(
 
 void XWalkExtensionServer::PostMessageToJSCallback(
     int64_t instance_id, scoped_ptr<base::Value> msg) {
+  {
+    base::AutoLock l(sender_lock_);
+    if (batch_task_runner_) {
+      message_batch_.Append(instance_id, msg.Pass());
+      if (message_batch_.is_full()) {
+        SendMessageBatchLocked();
+      } else if (!is_flush_scheduled_) {
+        is_flush_scheduled_ = true;
+        batch_task_runner_->PostDelayedTask(
+            FROM_HERE,
+            base::Bind(&XWalkExtensionServer::FlushMessageBatch, weak_this_),
+            batch_delay_);
+      }
+      return;
+    }
+  }
+
   base::ListValue wrapped_msg;
   wrapped_msg.Append(msg.release());
   Send(new XWalkExtensionClientMsg_PostMessageToJS(instance_id, wrapped_msg));
 }
 
+void XWalkExtensionServer::PostBinaryMessageToJSCallback(
+    int64_t instance_id, const uint8_t* data, size_t size) {
+  Send(CreateBinaryMessageToJS(instance_id, data, size));
+}
+
+void XWalkExtensionServer::SendResponseToJSCallback(
+    int64_t instance_id, int request_id, scoped_ptr<base::Value> response) {
+  base::ListValue wrapped_response;
+  if (response)
+    wrapped_response.Append(response.release());
+  Send(new XWalkExtensionClientMsg_PostResponseToJS(instance_id, request_id,
+                                                    wrapped_response));
+}
+
 void XWalkExtensionServer::SendSyncReplyToJSCallback(
     int64_t instance_id, scoped_ptr<base::Value> reply) {
 
@@ -307,26 +499,21 @@ void XWalkExtensionServer::OnDestroyInstance(int64_t instance_id) {
   Send(new XWalkExtensionClientMsg_InstanceDestroyed(instance_id));
 }
 
-void XWalkExtensionServer::OnGetExtensions(
-    std::vector<XWalkExtensionServerMsg_ExtensionRegisterParams>* reply) {
-  ExtensionMap::iterator it = extensions_.begin();
-  for (; it != extensions_.end(); ++it) {
-    XWalkExtensionServerMsg_ExtensionRegisterParams extension_parameters;
-    XWalkExtension* extension = it->second;
-
-    extension_parameters.name = extension->name();
-    extension_parameters.js_api = extension->javascript_api();
-
-    const base::ListValue& entry_points = extension->entry_points();
-    base::ListValue::const_iterator entry_it = entry_points.begin();
-    for (; entry_it != entry_points.end(); ++entry_it) {
-      std::string entry_point;
-      (*entry_it)->GetAsString(&entry_point);
-      extension_parameters.entry_points.push_back(entry_point);
-    }
+void XWalkExtensionServer::AddExtensionsToRegistry(
+    XWalkExtensionRegistry::Builder* builder) const {
+  ExtensionMap::const_iterator it = extensions_.begin();
+  for (; it != extensions_.end(); ++it)
+    builder->AddExtension(it->second);
+}
 
-    reply->push_back(extension_parameters);
+void XWalkExtensionServer::OnGetExtensionRegistry(
+    base::SharedMemoryHandle* handle, uint32_t* size, std::string* contents) {
+  if (!registry_) {
+    XWalkExtensionRegistry::Builder builder;
+    AddExtensionsToRegistry(&builder);
+    registry_ = builder.Build();
   }
+  GetExtensionRegistryReply(registry_.get(), handle, size, contents);
 }
 
 void XWalkExtensionServer::Invalidate() {
@@ -11,15 +11,20 @@
 #include <string>
 #include <vector>
 
+#include "base/memory/ref_counted.h"
+#include "base/memory/shared_memory.h"
+#include "base/memory/weak_ptr.h"
 #include "base/synchronization/lock.h"
+#include "base/time/time.h"
 #include "base/values.h"
 #include "ipc/ipc_channel_proxy.h"
 #include "ipc/ipc_listener.h"
-
-struct XWalkExtensionServerMsg_ExtensionRegisterParams;
+#include "xwalk/extensions/common/xwalk_extension_message_batch.h"
+#include "xwalk/extensions/common/xwalk_extension_registry.h"
 
 namespace base {
 class FilePath;
+class SequencedTaskRunner;
 }
 
 namespace content {
@@ -53,15 +58,36 @@ class XWalkExtensionServer : public IPC::Listener {
   bool Send(IPC::Message* msg);
 
   bool RegisterExtension(scoped_ptr<XWalkExtension> extension);
+
+  // Makes the extensions registered in |owner| available in this server
+  // without taking their ownership, so a process serving many clients loads
+  // them only once. Each server still keeps its own instances. |owner| must
+  // outlive this server.
+  void ShareExtensionsFrom(const XWalkExtensionServer& owner);
   bool ContainsExtension(const std::string& extension_name) const;
 
   void Invalidate();
 
+  // Messages posted to JavaScript will be coalesced and sent together after
+  // |delay|. The flush happens in |task_runner|, which should be the one this
+  // server lives on.
+  void EnableMessageBatching(
+      scoped_refptr<base::SequencedTaskRunner> task_runner,
+      base::TimeDelta delay);
+
+  // Sets the sequence this server lives on, it is given to the instances it
+  // creates. Servers running in a worker pool sequence must call it, others
+  // default to the message loop of their thread.
+  void SetTaskRunner(scoped_refptr<base::SequencedTaskRunner> task_runner) {
+    task_runner_ = task_runner;
+  }
+
   // These Message Handlers can be accessed by a message filter when
   // running on the browser process.
   void OnCreateInstance(int64_t instance_id, std::string name);
-  void OnGetExtensions(
-      std::vector<XWalkExtensionServerMsg_ExtensionRegisterParams>* reply);
+
+  // Used by message filters that merge the registries of many servers.
+  void AddExtensionsToRegistry(XWalkExtensionRegistry::Builder* builder) const;
 
  private:
   struct InstanceExecutionData {
@@ -72,8 +98,22 @@ class XWalkExtensionServer : public IPC::Listener {
   // Message Handlers
   void OnDestroyInstance(int64_t instance_id);
   void OnPostMessageToNative(int64_t instance_id, const base::ListValue& msg);
+  void OnPostSerializedMessageToNative(int64_t instance_id,
+                                       const std::string& msg);
+  void OnPostMessagesToNative(const std::vector<int64_t>& instance_ids,
+                              const base::ListValue& contents);
+  void OnPostBinaryMessageToNative(int64_t instance_id,
+                                   const std::vector<uint8_t>& data);
+  void OnPostSharedBinaryMessageToNative(int64_t instance_id,
+                                         base::SharedMemoryHandle handle,
+                                         uint32_t size);
+  void OnPostRequestToNative(int64_t instance_id, int request_id,
+                             const base::ListValue& msg);
   void OnSendSyncMessageToNative(int64_t instance_id,
       const base::ListValue& msg, IPC::Message* ipc_reply);
+  void OnGetExtensionRegistry(base::SharedMemoryHandle* handle,
+                              uint32_t* size,
+                              std::string* contents);
 
   void PostMessageToJSCallback(int64_t instance_id,
                                scoped_ptr<base::Value> msg);
@@ -81,6 +121,17 @@ class XWalkExtensionServer : public IPC::Listener {
   void SendSyncReplyToJSCallback(int64_t instance_id,
                                  scoped_ptr<base::Value> reply);
 
+  void PostBinaryMessageToJSCallback(int64_t instance_id,
+                                     const uint8_t* data, size_t size);
+
+  void SendResponseToJSCallback(int64_t instance_id, int request_id,
+                                scoped_ptr<base::Value> response);
+
+  XWalkExtensionInstance* GetInstance(int64_t instance_id);
+
+  void FlushMessageBatch();
+  void SendMessageBatchLocked();
+
   void DeleteInstanceMap();
 
   bool ValidateExtensionEntryPoints(const base::ListValue& entry_points);
@@ -88,15 +139,38 @@ class XWalkExtensionServer : public IPC::Listener {
   base::Lock sender_lock_;
   IPC::Sender* sender_;
 
+  // Pending messages to JavaScript when batching is enabled, protected by
+  // |sender_lock_| since instances can post from any thread.
+  XWalkExtensionMessageBatch message_batch_;
+  scoped_refptr<base::SequencedTaskRunner> batch_task_runner_;
+  base::TimeDelta batch_delay_;
+  // Whether a FlushMessageBatch() task is posted, it's reused by the
+  // messages appended after the batch was sent earlier.
+  bool is_flush_scheduled_;
+
   typedef std::map<std::string, XWalkExtension*> ExtensionMap;
   ExtensionMap extensions_;
 
+  // False when the extensions were shared by another server.
+  bool owns_extensions_;
+
+  // Built on the first request and shared with the servers using the same
+  // extensions, see ShareExtensionsFrom().
+  scoped_refptr<XWalkExtensionRegistry> registry_;
+
   typedef std::map<int64_t, InstanceExecutionData> InstanceMap;
   InstanceMap instances_;
 
+  scoped_refptr<base::SequencedTaskRunner> task_runner_;
+
   // The exported symbols for extensions already registered.
   typedef std::set<std::string> ExtensionSymbolsSet;
   ExtensionSymbolsSet extension_symbols_;
+
+  // Created when enabling message batching, so the pending flush task
+  // doesn't outlive the server.
+  base::WeakPtr<XWalkExtensionServer> weak_this_;
+  base::WeakPtrFactory<XWalkExtensionServer> weak_factory_;
 };
 
 std::vector<std::string> RegisterExternalExtensionsInDirectory(
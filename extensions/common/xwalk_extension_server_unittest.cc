@@ -5,9 +5,62 @@
 #include "xwalk/extensions/common/xwalk_extension_server.h"
 
 #include "base/basictypes.h"
+#include "base/test/test_simple_task_runner.h"
+#include "ipc/ipc_message.h"
+#include "ipc/ipc_sender.h"
 #include "testing/gtest/include/gtest/gtest.h"
+#include "xwalk/extensions/common/xwalk_extension.h"
 
 using xwalk::extensions::ValidateExtensionNameForTesting;
+using xwalk::extensions::XWalkExtension;
+using xwalk::extensions::XWalkExtensionInstance;
+using xwalk::extensions::XWalkExtensionMessageBatch;
+using xwalk::extensions::XWalkExtensionServer;
+
+namespace {
+
+class CountingSender : public IPC::Sender {
+ public:
+  CountingSender() : count_(0) {}
+
+  virtual bool Send(IPC::Message* message) OVERRIDE {
+    delete message;
+    count_++;
+    return true;
+  }
+
+  int count() const { return count_; }
+
+ private:
+  int count_;
+};
+
+XWalkExtensionInstance* g_batch_instance = NULL;
+
+class BatchInstance : public XWalkExtensionInstance {
+ public:
+  BatchInstance() { g_batch_instance = this; }
+  virtual ~BatchInstance() { g_batch_instance = NULL; }
+  virtual void HandleMessage(scoped_ptr<base::Value> msg) OVERRIDE {}
+};
+
+class BatchExtension : public XWalkExtension {
+ public:
+  BatchExtension() { set_name("batch"); }
+
+  virtual XWalkExtensionInstance* CreateInstance() OVERRIDE {
+    return new BatchInstance;
+  }
+};
+
+void PostMessages(int count) {
+  for (int i = 0; i < count; ++i) {
+    g_batch_instance->PostMessageToJS(
+        scoped_ptr<base::Value>(new base::FundamentalValue(i)));
+  }
+}
+
+}  // namespace
 
 TEST(XWalkExtensionServerTest, ValidateExtensionName) {
   const std::string valid_names[] = {
@@ -42,3 +95,40 @@ TEST(XWalkExtensionServerTest, ValidateExtensionName) {
         << "Extension name should be invalid: " << invalid_names[i];
   }
 }
+
+// A batch sent because it's full doesn't get a second flush task, the one
+// already posted sends the messages appended since.
+TEST(XWalkExtensionServerTest, FullBatchReusesScheduledFlush) {
+  scoped_refptr<base::TestSimpleTaskRunner> task_runner(
+      new base::TestSimpleTaskRunner);
+  CountingSender sender;
+  {
+    XWalkExtensionServer server;
+    server.Initialize(&sender);
+    server.SetTaskRunner(task_runner);
+    server.EnableMessageBatching(task_runner,
+                                 base::TimeDelta::FromMilliseconds(10));
+    ASSERT_TRUE(server.RegisterExtension(
+        scoped_ptr<XWalkExtension>(new BatchExtension)));
+    server.OnCreateInstance(1, "batch");
+    ASSERT_TRUE(g_batch_instance);
+
+    PostMessages(XWalkExtensionMessageBatch::kMaxMessages);
+    EXPECT_EQ(1, sender.count());
+    EXPECT_EQ(1u, task_runner->GetPendingTasks().size());
+
+    PostMessages(1);
+    EXPECT_EQ(1, sender.count());
+    EXPECT_EQ(1u, task_runner->GetPendingTasks().size());
+
+    task_runner->RunPendingTasks();
+    EXPECT_EQ(2, sender.count());
+
+    // The next message schedules a new flush.
+    PostMessages(1);
+    EXPECT_EQ(1u, task_runner->GetPendingTasks().size());
+    task_runner->RunPendingTasks();
+    EXPECT_EQ(3, sender.count());
+  }
+  EXPECT_FALSE(g_batch_instance);
+}
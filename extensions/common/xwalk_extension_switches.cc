@@ -19,4 +19,20 @@ const char kXWalkExtensionProcess[] = "xwalk-extension-process";
 // Specifies where XWalk will look for external extensions.
 const char kXWalkExternalExtensionsPath[] = "external-extensions-path";
 
+// Coalesces the messages exchanged between extensions and their JavaScript
+// code. The optional value is the time window in milliseconds during which
+// messages are accumulated, by default messages posted during the same task
+// are sent together.
+const char kXWalkExtensionMessageBatching[] = "extension-message-batching";
+
+const char kXWalkSharedExtensionProcess[] = "shared-extension-process";
+
+const char kXWalkDisableExtensionScriptCache[] =
+    "disable-extension-script-cache";
+
+// Sends the messages from JavaScript to extensions as base::Values instead of
+// serializing them directly from V8 values.
+const char kXWalkDisableExtensionValueSerialization[] =
+    "disable-extension-value-serialization";
+
 }  // namespace switches
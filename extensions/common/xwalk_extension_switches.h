@@ -11,6 +11,10 @@ namespace switches {
 extern const char kXWalkDisableExtensionProcess[];
 extern const char kXWalkExtensionProcess[];
 extern const char kXWalkExternalExtensionsPath[];
+extern const char kXWalkExtensionMessageBatching[];
+extern const char kXWalkSharedExtensionProcess[];
+extern const char kXWalkDisableExtensionScriptCache[];
+extern const char kXWalkDisableExtensionValueSerialization[];
 
 }  // namespace switches
 
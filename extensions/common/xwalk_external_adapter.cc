@@ -4,15 +4,13 @@
 
 #include "xwalk/extensions/common/xwalk_external_adapter.h"
 
+#include <string.h>
 #include "base/logging.h"
-#include "base/stl_util.h"
 
 namespace xwalk {
 namespace extensions {
 
-XWalkExternalAdapter::XWalkExternalAdapter()
-    : next_xw_extension_(1),
-      next_xw_instance_(1) {}
+XWalkExternalAdapter::XWalkExternalAdapter() {}
 
 XWalkExternalAdapter::~XWalkExternalAdapter() {}
 
@@ -20,42 +18,27 @@ XWalkExternalAdapter* XWalkExternalAdapter::GetInstance() {
   return Singleton<XWalkExternalAdapter>::get();
 }
 
-XW_Extension XWalkExternalAdapter::GetNextXWExtension() {
-  return next_xw_extension_++;
-}
-
-XW_Instance XWalkExternalAdapter::GetNextXWInstance() {
-  return next_xw_instance_++;
-}
-
-void XWalkExternalAdapter::RegisterExtension(
+XW_Extension XWalkExternalAdapter::RegisterExtension(
     XWalkExternalExtension* extension) {
-  XW_Extension xw_extension = extension->xw_extension_;
-  CHECK(IsValidXWExtension(xw_extension));
-  CHECK(!ContainsKey(extension_map_, xw_extension));
-  extension_map_[xw_extension] = extension;
+  XW_Extension xw_extension = extension_table_.Add(extension);
+  CHECK(xw_extension) << "Too many external extensions.";
+  return xw_extension;
 }
 
 void XWalkExternalAdapter::UnregisterExtension(
     XWalkExternalExtension* extension) {
-  XW_Extension xw_extension = extension->xw_extension_;
-  CHECK(IsValidXWExtension(xw_extension));
-  CHECK(ContainsKey(extension_map_, xw_extension));
-  extension_map_.erase(xw_extension);
+  extension_table_.Remove(extension->xw_extension_);
 }
 
-void XWalkExternalAdapter::RegisterInstance(XWalkExternalInstance* context) {
-  XW_Instance xw_instance = context->xw_instance_;
-  CHECK(IsValidXWInstance(xw_instance));
-  CHECK(!ContainsKey(instance_map_, xw_instance));
-  instance_map_[xw_instance] = context;
+XW_Instance XWalkExternalAdapter::RegisterInstance(
+    XWalkExternalInstance* context) {
+  XW_Instance xw_instance = instance_table_.Add(context);
+  CHECK(xw_instance) << "Too many external extension instances.";
+  return xw_instance;
 }
 
 void XWalkExternalAdapter::UnregisterInstance(XWalkExternalInstance* context) {
-  XW_Instance xw_instance = context->xw_instance_;
-  CHECK(IsValidXWInstance(xw_instance));
-  CHECK(ContainsKey(instance_map_, xw_instance));
-  instance_map_.erase(xw_instance);
+  instance_table_.Remove(context->xw_instance_);
 }
 
 const void* XWalkExternalAdapter::GetInterface(const char* name) {
@@ -88,6 +71,22 @@ const void* XWalkExternalAdapter::GetInterface(const char* name) {
     return &syncMessagingInterface1;
   }
 
+  if (!strcmp(name, XW_BINARY_MESSAGING_INTERFACE_1)) {
+    static const XW_BinaryMessagingInterface_1 binaryMessagingInterface1 = {
+      BinaryMessagingRegister,
+      BinaryMessagingPostMessage
+    };
+    return &binaryMessagingInterface1;
+  }
+
+  if (!strcmp(name, XW_REQUEST_INTERFACE_1)) {
+    static const XW_RequestInterface_1 requestInterface1 = {
+      RequestRegister,
+      RequestRespond
+    };
+    return &requestInterface1;
+  }
+
   if (!strcmp(name, XW_INTERNAL_ENTRY_POINTS_INTERFACE_1)) {
     static const XW_Internal_EntryPointsInterface_1 entryPointsInterface1 = {
       EntryPointsSetExtraJSEntryPoints
@@ -99,30 +98,16 @@ const void* XWalkExternalAdapter::GetInterface(const char* name) {
   return NULL;
 }
 
-bool XWalkExternalAdapter::IsValidXWExtension(XW_Extension xw_extension) {
-  return xw_extension > 0 && xw_extension < next_xw_extension_;
-}
-
-bool XWalkExternalAdapter::IsValidXWInstance(XW_Instance xw_instance) {
-  return xw_instance > 0 && xw_instance < next_xw_instance_;
-}
-
-XWalkExternalExtension* XWalkExternalAdapter::GetExtension(
-    XW_Extension xw_extension) {
-  XWalkExternalAdapter* adapter = XWalkExternalAdapter::GetInstance();
-  ExtensionMap::iterator it = adapter->extension_map_.find(xw_extension);
-  if (it == adapter->extension_map_.end())
-    return NULL;
-  return it->second;
+// static
+const XWalkExternalAdapter::ExtensionTable*
+XWalkExternalAdapter::GetExtensionTable() {
+  return &XWalkExternalAdapter::GetInstance()->extension_table_;
 }
 
-XWalkExternalInstance* XWalkExternalAdapter::GetInstance(
-    XW_Instance xw_instance) {
-  XWalkExternalAdapter* adapter = XWalkExternalAdapter::GetInstance();
-  InstanceMap::iterator it = adapter->instance_map_.find(xw_instance);
-  if (it == adapter->instance_map_.end())
-    return NULL;
-  return it->second;
+// static
+const XWalkExternalAdapter::InstanceTable*
+XWalkExternalAdapter::GetInstanceTable() {
+  return &XWalkExternalAdapter::GetInstance()->instance_table_;
 }
 
 // static
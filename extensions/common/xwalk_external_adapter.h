@@ -5,13 +5,15 @@
 #ifndef XWALK_EXTENSIONS_COMMON_XWALK_EXTERNAL_ADAPTER_H_
 #define XWALK_EXTENSIONS_COMMON_XWALK_EXTERNAL_ADAPTER_H_
 
-#include <map>
 #include "base/memory/singleton.h"
 #include "xwalk/extensions/public/XW_Extension.h"
 #include "xwalk/extensions/public/XW_Extension_SyncMessage.h"
+#include "xwalk/extensions/public/XW_Extension_BinaryMessage.h"
+#include "xwalk/extensions/public/XW_Extension_Request.h"
 #include "xwalk/extensions/public/XW_Extension_EntryPoints.h"
 #include "xwalk/extensions/common/xwalk_external_extension.h"
 #include "xwalk/extensions/common/xwalk_external_instance.h"
+#include "xwalk/extensions/common/xwalk_handle_table.h"
 
 // NOTE: Those macros define functions that are used in the structs by
 // GetInterface(). They dispatch the function to the appropriate
@@ -19,27 +21,27 @@
 
 #define DEFINE_FUNCTION_1(TYPE, INTERFACE, NAME, ARG1)          \
   static void INTERFACE ## NAME(XW_ ## TYPE xw, ARG1 arg1) {    \
-    XWalkExternal ## TYPE * ptr = Get ## TYPE(xw);              \
-    if (!ptr)                                                   \
+    TYPE ## Table::Lookup lookup(Get ## TYPE ## Table(), xw);   \
+    if (!lookup.get())                                          \
       LogInvalidCall(xw, #TYPE, #INTERFACE, #NAME);             \
     else                                                        \
-      ptr->INTERFACE ## NAME(arg1);                             \
+      lookup.get()->INTERFACE ## NAME(arg1);                    \
   }
 
 #define DEFINE_FUNCTION_2(TYPE, INTERFACE, NAME, ARG1, ARG2)             \
   static void INTERFACE ## NAME(XW_ ## TYPE xw, ARG1 arg1, ARG2 arg2) {  \
-    XWalkExternal ## TYPE * ptr = Get ## TYPE(xw);                       \
-    if (!ptr)                                                            \
+    TYPE ## Table::Lookup lookup(Get ## TYPE ## Table(), xw);            \
+    if (!lookup.get())                                                   \
       LogInvalidCall(xw, #TYPE, #INTERFACE, #NAME);                      \
     else                                                                 \
-      ptr->INTERFACE ## NAME(arg1, arg2);                                \
+      lookup.get()->INTERFACE ## NAME(arg1, arg2);                       \
   }
 
 #define DEFINE_RET_FUNCTION_0(TYPE, INTERFACE, NAME, RET_ARG)   \
   static RET_ARG INTERFACE ## NAME(XW_ ## TYPE xw) {            \
-    XWalkExternal ## TYPE * ptr = Get ## TYPE(xw);              \
-    if (ptr)                                                    \
-      return ptr->INTERFACE ## NAME();                          \
+    TYPE ## Table::Lookup lookup(Get ## TYPE ## Table(), xw);   \
+    if (lookup.get())                                           \
+      return lookup.get()->INTERFACE ## NAME();                 \
     LogInvalidCall(xw, #TYPE, #INTERFACE, #NAME);               \
     return NULL;                                                \
   }
@@ -56,21 +58,24 @@ class XWalkExternalInstance;
 // functions from external extension to their implementations in
 // XWalkExternalExtension and XWalkExternalInstance. We have only one
 // adapter per process.
+//
+// The C functions can be called from any thread. XW_Extension and XW_Instance
+// values are handles from XWalkHandleTable, resolved in constant time without
+// locking, and a stale value is detected even if its slot was reused.
 class XWalkExternalAdapter {
  public:
   static XWalkExternalAdapter* GetInstance();
 
-  XW_Extension GetNextXWExtension();
-  XW_Instance GetNextXWInstance();
-
-  // This adds the extension to the adapter's mapping, so C calls to
-  // its corresponding XW_Extension are correctly dispatched.
-  void RegisterExtension(XWalkExternalExtension* extension);
+  // This adds the extension to the adapter's mapping and returns the
+  // XW_Extension to be used for it, so C calls are correctly dispatched.
+  XW_Extension RegisterExtension(XWalkExternalExtension* extension);
+  // Once this returns no C call is using |extension| anymore.
   void UnregisterExtension(XWalkExternalExtension* extension);
 
-  // This adds the context to the adapter's mapping, so C calls to
-  // its corresponding XW_Instance are correctly dispatched.
-  void RegisterInstance(XWalkExternalInstance* context);
+  // This adds the context to the adapter's mapping and returns the
+  // XW_Instance to be used for it, so C calls are correctly dispatched.
+  XW_Instance RegisterInstance(XWalkExternalInstance* context);
+  // Once this returns no C call is using |context| anymore.
   void UnregisterInstance(XWalkExternalInstance* context);
 
   // Returns the correct struct according to interface asked. This is
@@ -83,13 +88,13 @@ class XWalkExternalAdapter {
   XWalkExternalAdapter();
   ~XWalkExternalAdapter();
 
-  bool IsValidXWExtension(XW_Extension xw_extension);
-  bool IsValidXWInstance(XW_Instance xw_instance);
+  typedef XWalkHandleTable<XWalkExternalExtension> ExtensionTable;
+  typedef XWalkHandleTable<XWalkExternalInstance> InstanceTable;
 
   // Used by the DEFINE_* macros to bridge the calls using C API identifiers
   // XW_Extension and XW_Instance to the right C++ object.
-  static XWalkExternalExtension* GetExtension(XW_Extension xw_extension);
-  static XWalkExternalInstance* GetInstance(XW_Instance xw_instance);
+  static const ExtensionTable* GetExtensionTable();
+  static const InstanceTable* GetInstanceTable();
   static void LogInvalidCall(int32_t value, const char* type,
                              const char* interface, const char* function);
 
@@ -114,14 +119,18 @@ class XWalkExternalAdapter {
                     XW_HandleSyncMessageCallback);
   DEFINE_FUNCTION_1(Instance, SyncMessaging, SetSyncReply, const char*);
 
-  typedef std::map<XW_Extension, XWalkExternalExtension*> ExtensionMap;
-  ExtensionMap extension_map_;
+  // XW_BinaryMessagingInterface_1 from XW_Extension_BinaryMessage.h.
+  DEFINE_FUNCTION_1(Extension, BinaryMessaging, Register,
+                    XW_HandleBinaryMessageCallback);
+  DEFINE_FUNCTION_2(Instance, BinaryMessaging, PostMessage,
+                    const uint8_t*, size_t);
 
-  typedef std::map<XW_Instance, XWalkExternalInstance*> InstanceMap;
-  InstanceMap instance_map_;
+  // XW_RequestInterface_1 from XW_Extension_Request.h.
+  DEFINE_FUNCTION_1(Extension, Request, Register, XW_HandleRequestCallback);
+  DEFINE_FUNCTION_2(Instance, Request, Respond, XW_Request, const char*);
 
-  XW_Extension next_xw_extension_;
-  XW_Instance next_xw_instance_;
+  ExtensionTable extension_table_;
+  InstanceTable instance_table_;
 
   DISALLOW_COPY_AND_ASSIGN(XWalkExternalAdapter);
 };
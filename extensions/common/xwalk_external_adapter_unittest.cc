@@ -0,0 +1,195 @@
+// Copyright (c) 2013 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "xwalk/extensions/common/xwalk_external_adapter.h"
+
+#include "base/atomicops.h"
+#include "base/bind.h"
+#include "base/files/file_path.h"
+#include "base/logging.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/memory/scoped_vector.h"
+#include "base/threading/platform_thread.h"
+#include "base/threading/simple_thread.h"
+#include "base/values.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+using base::subtle::Atomic32;
+using xwalk::extensions::XWalkExtension;
+using xwalk::extensions::XWalkExternalAdapter;
+using xwalk::extensions::XWalkExternalExtension;
+using xwalk::extensions::XWalkExternalInstance;
+
+namespace {
+
+const int kPosterThreads = 4;
+const int kInstancesCreated = 500;
+const int kLiveInstances = 16;
+
+// The library doesn't exist, the extension is only used to create instances
+// without any callback registered.
+const base::FilePath::CharType kNoLibrary[] =
+    FILE_PATH_LITERAL("no_such_extension.so");
+
+XWalkExternalInstance* CreateInstance(XWalkExternalExtension* extension) {
+  return static_cast<XWalkExternalInstance*>(
+      static_cast<XWalkExtension*>(extension)->CreateInstance());
+}
+
+const XW_CoreInterface* GetCoreInterface() {
+  return static_cast<const XW_CoreInterface*>(
+      XWalkExternalAdapter::GetInterface(XW_CORE_INTERFACE));
+}
+
+const XW_MessagingInterface* GetMessagingInterface() {
+  return static_cast<const XW_MessagingInterface*>(
+      XWalkExternalAdapter::GetInterface(XW_MESSAGING_INTERFACE));
+}
+
+struct InstanceState {
+  InstanceState() : alive(1), late_messages(0) {}
+  Atomic32 alive;
+  // Messages that reached the instance after it was destroyed.
+  Atomic32 late_messages;
+};
+
+void CountMessage(InstanceState* state, Atomic32* messages,
+                  scoped_ptr<base::Value> msg) {
+  if (!base::subtle::Acquire_Load(&state->alive))
+    base::subtle::NoBarrier_AtomicIncrement(&state->late_messages, 1);
+  base::subtle::NoBarrier_AtomicIncrement(messages, 1);
+}
+
+// Keeps posting to the instances published in |handles|, that are often
+// stale because the instances get destroyed concurrently.
+class Poster : public base::DelegateSimpleThread::Delegate {
+ public:
+  Poster(const Atomic32* handles, const Atomic32* done)
+      : handles_(handles),
+        done_(done) {}
+
+  virtual void Run() OVERRIDE {
+    const XW_CoreInterface* core = GetCoreInterface();
+    const XW_MessagingInterface* messaging = GetMessagingInterface();
+    for (int i = 0; !base::subtle::Acquire_Load(done_); ++i) {
+      XW_Instance instance =
+          base::subtle::Acquire_Load(&handles_[i % kLiveInstances]);
+      core->GetInstanceData(instance);
+      messaging->PostMessage(instance, "stress");
+    }
+  }
+
+ private:
+  const Atomic32* handles_;
+  const Atomic32* done_;
+};
+
+}  // namespace
+
+TEST(XWalkExternalAdapterTest, StaleHandlesAreRejected) {
+  XWalkExternalExtension extension((base::FilePath(kNoLibrary)));
+  const XW_CoreInterface* core = GetCoreInterface();
+
+  XWalkExternalInstance* instance = CreateInstance(&extension);
+  XW_Instance xw_instance = instance->xw_instance();
+  EXPECT_NE(0, xw_instance);
+
+  int data;
+  core->SetInstanceData(xw_instance, &data);
+  EXPECT_EQ(&data, core->GetInstanceData(xw_instance));
+
+  delete instance;
+  EXPECT_EQ(NULL, core->GetInstanceData(xw_instance));
+
+  // The new instance may reuse the slot, but not the handle.
+  scoped_ptr<XWalkExternalInstance> new_instance(CreateInstance(&extension));
+  EXPECT_NE(xw_instance, new_instance->xw_instance());
+  core->SetInstanceData(new_instance->xw_instance(), &data);
+  EXPECT_EQ(NULL, core->GetInstanceData(xw_instance));
+
+  EXPECT_EQ(NULL, core->GetInstanceData(0));
+  EXPECT_EQ(NULL, core->GetInstanceData(-1));
+}
+
+TEST(XWalkExternalAdapterTest, NoMessageAfterDestruction) {
+  // Calls with stale handles are logged as warnings.
+  int log_level = logging::GetMinLogLevel();
+  logging::SetMinLogLevel(logging::LOG_ERROR);
+
+  XWalkExternalExtension extension((base::FilePath(kNoLibrary)));
+  const XW_MessagingInterface* messaging = GetMessagingInterface();
+
+  InstanceState state;
+  Atomic32 messages = 0;
+  XWalkExternalInstance* instance = CreateInstance(&extension);
+  instance->SetPostMessageCallback(
+      base::Bind(&CountMessage, &state, &messages));
+  XW_Instance xw_instance = instance->xw_instance();
+  messaging->PostMessage(xw_instance, "live");
+  EXPECT_EQ(1, messages);
+
+  delete instance;
+  base::subtle::Release_Store(&state.alive, 0);
+  messaging->PostMessage(xw_instance, "stale");
+  EXPECT_EQ(1, messages);
+  EXPECT_EQ(0, state.late_messages);
+
+  logging::SetMinLogLevel(log_level);
+}
+
+// Stress test posting from many threads while instances are created and
+// destroyed. No message should reach an instance after it was destroyed.
+TEST(XWalkExternalAdapterTest, PostMessageFromManyThreads) {
+  // Calls with stale handles are logged as warnings.
+  int log_level = logging::GetMinLogLevel();
+  logging::SetMinLogLevel(logging::LOG_ERROR);
+
+  XWalkExternalExtension extension((base::FilePath(kNoLibrary)));
+
+  Atomic32 handles[kLiveInstances] = { 0 };
+  XWalkExternalInstance* instances[kLiveInstances] = { NULL };
+  InstanceState* live_states[kLiveInstances] = { NULL };
+  ScopedVector<InstanceState> states;
+  Atomic32 messages = 0;
+  Atomic32 done = 0;
+
+  Poster poster(handles, &done);
+  ScopedVector<base::DelegateSimpleThread> threads;
+  for (int i = 0; i < kPosterThreads; ++i) {
+    threads.push_back(new base::DelegateSimpleThread(&poster, "Poster"));
+    threads.back()->Start();
+  }
+
+  for (int i = 0; i < kInstancesCreated + kLiveInstances; ++i) {
+    int slot = i % kLiveInstances;
+    if (instances[slot]) {
+      delete instances[slot];
+      instances[slot] = NULL;
+      base::subtle::Release_Store(&live_states[slot]->alive, 0);
+    }
+
+    if (i >= kInstancesCreated)
+      continue;
+
+    InstanceState* state = new InstanceState;
+    states.push_back(state);
+    XWalkExternalInstance* instance = CreateInstance(&extension);
+    instance->SetPostMessageCallback(
+        base::Bind(&CountMessage, state, &messages));
+    instances[slot] = instance;
+    live_states[slot] = state;
+    base::subtle::Release_Store(&handles[slot], instance->xw_instance());
+    base::PlatformThread::YieldCurrentThread();
+  }
+
+  base::subtle::Release_Store(&done, 1);
+  for (int i = 0; i < kPosterThreads; ++i)
+    threads[i]->Join();
+
+  logging::SetMinLogLevel(log_level);
+
+  for (size_t i = 0; i < states.size(); ++i)
+    EXPECT_EQ(0, states[i]->late_messages) << "Instance " << i;
+  EXPECT_GT(base::subtle::NoBarrier_Load(&messages), 0);
+}
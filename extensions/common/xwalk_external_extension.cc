@@ -21,6 +21,8 @@ XWalkExternalExtension::XWalkExternalExtension(const base::FilePath& path)
       shutdown_callback_(NULL),
       handle_msg_callback_(NULL),
       handle_sync_msg_callback_(NULL),
+      handle_binary_msg_callback_(NULL),
+      handle_request_callback_(NULL),
       initialized_(false) {
   std::string error;
   base::ScopedNativeLibrary library(base::LoadNativeLibrary(path, &error));
@@ -38,9 +40,7 @@ XWalkExternalExtension::XWalkExternalExtension(const base::FilePath& path)
     return;
   }
 
-  XWalkExternalAdapter* external_adapter = XWalkExternalAdapter::GetInstance();
-  xw_extension_ = external_adapter->GetNextXWExtension();
-  external_adapter->RegisterExtension(this);
+  xw_extension_ = XWalkExternalAdapter::GetInstance()->RegisterExtension(this);
   int ret = initialize(xw_extension_, XWalkExternalAdapter::GetInterface);
   if (ret != XW_OK) {
     LOG(WARNING) << "Error loading extension '" << path.AsUTF8Unsafe() << "': "
@@ -53,12 +53,13 @@ XWalkExternalExtension::XWalkExternalExtension(const base::FilePath& path)
 }
 
 XWalkExternalExtension::~XWalkExternalExtension() {
-  if (!initialized_)
-    return;
-
-  if (shutdown_callback_)
+  if (initialized_ && shutdown_callback_)
     shutdown_callback_(xw_extension_);
-  XWalkExternalAdapter::GetInstance()->UnregisterExtension(this);
+
+  // Also registered when XW_Initialize fails, the handle was already given to
+  // the extension.
+  if (xw_extension_)
+    XWalkExternalAdapter::GetInstance()->UnregisterExtension(this);
 }
 
 bool XWalkExternalExtension::is_valid() {
@@ -66,9 +67,7 @@ bool XWalkExternalExtension::is_valid() {
 }
 
 XWalkExtensionInstance* XWalkExternalExtension::CreateInstance() {
-  XW_Instance xw_instance =
-      XWalkExternalAdapter::GetInstance()->GetNextXWInstance();
-  return new XWalkExternalInstance(this, xw_instance);
+  return new XWalkExternalInstance(this);
 }
 
 #define RETURN_IF_INITIALIZED(FUNCTION)                          \
@@ -115,6 +114,18 @@ void XWalkExternalExtension::SyncMessagingRegister(
   handle_sync_msg_callback_ = callback;
 }
 
+void XWalkExternalExtension::BinaryMessagingRegister(
+    XW_HandleBinaryMessageCallback callback) {
+  RETURN_IF_INITIALIZED("Register from BinaryMessagingInterface");
+  handle_binary_msg_callback_ = callback;
+}
+
+void XWalkExternalExtension::RequestRegister(
+    XW_HandleRequestCallback callback) {
+  RETURN_IF_INITIALIZED("Register from RequestInterface");
+  handle_request_callback_ = callback;
+}
+
 void XWalkExternalExtension::EntryPointsSetExtraJSEntryPoints(
     const char** entry_points) {
   RETURN_IF_INITIALIZED("SetExtraJSEntryPoints from EntryPoints");
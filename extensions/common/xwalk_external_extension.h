@@ -10,6 +10,8 @@
 #include "xwalk/extensions/common/xwalk_extension.h"
 #include "xwalk/extensions/public/XW_Extension.h"
 #include "xwalk/extensions/public/XW_Extension_SyncMessage.h"
+#include "xwalk/extensions/public/XW_Extension_BinaryMessage.h"
+#include "xwalk/extensions/public/XW_Extension_Request.h"
 
 namespace base {
 class FilePath;
@@ -58,6 +60,13 @@ class XWalkExternalExtension : public XWalkExtension {
   // XW_Internal_SyncMessagingInterface_1 (from XW_Extension.h) implementation.
   void SyncMessagingRegister(XW_HandleSyncMessageCallback callback);
 
+  // XW_BinaryMessagingInterface_1 (from XW_Extension_BinaryMessage.h)
+  // implementation.
+  void BinaryMessagingRegister(XW_HandleBinaryMessageCallback callback);
+
+  // XW_RequestInterface_1 (from XW_Extension_Request.h) implementation.
+  void RequestRegister(XW_HandleRequestCallback callback);
+
   base::ScopedNativeLibrary library_;
   XW_Extension xw_extension_;
 
@@ -66,6 +75,8 @@ class XWalkExternalExtension : public XWalkExtension {
   XW_ShutdownCallback shutdown_callback_;
   XW_HandleMessageCallback handle_msg_callback_;
   XW_HandleSyncMessageCallback handle_sync_msg_callback_;
+  XW_HandleBinaryMessageCallback handle_binary_msg_callback_;
+  XW_HandleRequestCallback handle_request_callback_;
 
   bool initialized_;
 
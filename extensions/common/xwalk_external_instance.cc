@@ -8,17 +8,18 @@
 #include "base/logging.h"
 #include "xwalk/extensions/common/xwalk_external_extension.h"
 #include "xwalk/extensions/common/xwalk_external_adapter.h"
+#include "xwalk/extensions/common/xwalk_serialized_value.h"
 
 namespace xwalk {
 namespace extensions {
 
 XWalkExternalInstance::XWalkExternalInstance(
-    XWalkExternalExtension* extension, XW_Instance xw_instance)
-    : xw_instance_(xw_instance),
+    XWalkExternalExtension* extension)
+    : xw_instance_(0),
       extension_(extension),
       instance_data_(NULL),
       is_handling_sync_msg_(false) {
-  XWalkExternalAdapter::GetInstance()->RegisterInstance(this);
+  xw_instance_ = XWalkExternalAdapter::GetInstance()->RegisterInstance(this);
   XW_CreatedInstanceCallback callback = extension_->created_instance_callback_;
   if (callback)
     callback(xw_instance_);
@@ -45,6 +46,26 @@ void XWalkExternalInstance::HandleMessage(scoped_ptr<base::Value> msg) {
   callback(xw_instance_, string_msg.c_str());
 }
 
+// External extensions get messages as strings, which are read directly from
+// the serialized message.
+void XWalkExternalInstance::HandleSerializedMessage(
+    XWalkSerializedValueReader* reader) {
+  base::StringPiece string_msg;
+  if (!reader->ReadString(&string_msg)) {
+    XWalkExtensionInstance::HandleSerializedMessage(reader);
+    return;
+  }
+
+  XW_HandleMessageCallback callback = extension_->handle_msg_callback_;
+  if (!callback) {
+    LOG(WARNING) << "Ignoring message sent for external extension '"
+                 << extension_->name() << "' which doesn't support it.";
+    return;
+  }
+
+  callback(xw_instance_, string_msg.as_string().c_str());
+}
+
 void XWalkExternalInstance::HandleSyncMessage(scoped_ptr<base::Value> msg) {
   XW_HandleSyncMessageCallback callback = extension_->handle_sync_msg_callback_;
   if (!callback) {
@@ -59,6 +80,32 @@ void XWalkExternalInstance::HandleSyncMessage(scoped_ptr<base::Value> msg) {
   callback(xw_instance_, string_msg.c_str());
 }
 
+void XWalkExternalInstance::HandleBinaryMessage(const uint8_t* data,
+                                                size_t size) {
+  XW_HandleBinaryMessageCallback callback =
+      extension_->handle_binary_msg_callback_;
+  if (!callback) {
+    LOG(WARNING) << "Ignoring binary message sent for external extension '"
+                 << extension_->name() << "' which doesn't support it.";
+    return;
+  }
+
+  callback(xw_instance_, data, size);
+}
+
+void XWalkExternalInstance::HandleRequest(int request_id,
+                                          scoped_ptr<base::Value> msg) {
+  XW_HandleRequestCallback callback = extension_->handle_request_callback_;
+  if (!callback) {
+    XWalkExtensionInstance::HandleRequest(request_id, msg.Pass());
+    return;
+  }
+
+  std::string string_msg;
+  msg->GetAsString(&string_msg);
+  callback(xw_instance_, request_id, string_msg.c_str());
+}
+
 void XWalkExternalInstance::CoreSetInstanceData(void* data) {
   instance_data_ = data;
 }
@@ -71,6 +118,17 @@ void XWalkExternalInstance::MessagingPostMessage(const char* msg) {
   PostMessageToJS(scoped_ptr<base::Value>(new base::StringValue(msg)));
 }
 
+void XWalkExternalInstance::BinaryMessagingPostMessage(const uint8_t* data,
+                                                       size_t size) {
+  PostBinaryMessageToJS(data, size);
+}
+
+void XWalkExternalInstance::RequestRespond(XW_Request request,
+                                           const char* response) {
+  SendResponseToJS(request,
+                   scoped_ptr<base::Value>(new base::StringValue(response)));
+}
+
 void XWalkExternalInstance::SyncMessagingSetSyncReply(const char* reply) {
   SendSyncReplyToJS(scoped_ptr<base::Value>(new base::StringValue(reply)));
 }
@@ -9,6 +9,8 @@
 #include "xwalk/extensions/common/xwalk_extension.h"
 #include "xwalk/extensions/public/XW_Extension.h"
 #include "xwalk/extensions/public/XW_Extension_SyncMessage.h"
+#include "xwalk/extensions/public/XW_Extension_BinaryMessage.h"
+#include "xwalk/extensions/public/XW_Extension_Request.h"
 
 namespace xwalk {
 namespace extensions {
@@ -25,16 +27,22 @@ class XWalkExternalExtension;
 // calling the shared library.
 class XWalkExternalInstance : public XWalkExtensionInstance {
  public:
-  XWalkExternalInstance(XWalkExternalExtension* extension,
-                        XW_Instance xw_instance);
+  explicit XWalkExternalInstance(XWalkExternalExtension* extension);
   virtual ~XWalkExternalInstance();
 
+  XW_Instance xw_instance() const { return xw_instance_; }
+
  private:
   friend class XWalkExternalAdapter;
 
   // XWalkExtensionInstance implementation.
   virtual void HandleMessage(scoped_ptr<base::Value> msg) OVERRIDE;
+  virtual void HandleSerializedMessage(
+      XWalkSerializedValueReader* reader) OVERRIDE;
   virtual void HandleSyncMessage(scoped_ptr<base::Value> msg) OVERRIDE;
+  virtual void HandleBinaryMessage(const uint8_t* data, size_t size) OVERRIDE;
+  virtual void HandleRequest(int request_id,
+                             scoped_ptr<base::Value> msg) OVERRIDE;
 
   // XW_CoreInterface_1 (from XW_Extension.h) implementation.
   void CoreSetInstanceData(void* data);
@@ -47,6 +55,13 @@ class XWalkExternalInstance : public XWalkExtensionInstance {
   // implementation.
   void SyncMessagingSetSyncReply(const char* reply);
 
+  // XW_BinaryMessagingInterface_1 (from XW_Extension_BinaryMessage.h)
+  // implementation.
+  void BinaryMessagingPostMessage(const uint8_t* data, size_t size);
+
+  // XW_RequestInterface_1 (from XW_Extension_Request.h) implementation.
+  void RequestRespond(XW_Request request, const char* response);
+
   XW_Instance xw_instance_;
   std::string sync_reply_;
   XWalkExternalExtension* extension_;
@@ -0,0 +1,180 @@
+// Copyright (c) 2013 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef XWALK_EXTENSIONS_COMMON_XWALK_HANDLE_TABLE_H_
+#define XWALK_EXTENSIONS_COMMON_XWALK_HANDLE_TABLE_H_
+
+#include <stdint.h>
+#include <string.h>
+#include "base/atomicops.h"
+#include "base/basictypes.h"
+#include "base/logging.h"
+#include "base/synchronization/lock.h"
+#include "base/threading/platform_thread.h"
+
+namespace xwalk {
+namespace extensions {
+
+// Maps the handles given to external extensions (XW_Extension and
+// XW_Instance) to the objects they refer to. Lookups are O(1) and don't take
+// any lock, so the C interfaces can be called from any thread.
+//
+// A handle is the index of a slot combined with the generation of that slot,
+// which is bumped every time the slot is freed. Stale handles are then
+// detected and never reach an object that reused their slot. Remove() waits
+// for the lookups in progress on the slot, so a looked up object stays alive
+// while its Lookup is in scope.
+template <typename T>
+class XWalkHandleTable {
+ public:
+  // Pins the object referred by a handle, get() is NULL if the handle isn't
+  // valid. Must not outlive the table and should be short lived, as removing
+  // the object blocks until the Lookup goes out of scope.
+  class Lookup {
+   public:
+    Lookup(const XWalkHandleTable* table, int32_t handle)
+        : slot_(table->GetSlot(handle)),
+          object_(NULL) {
+      if (!slot_)
+        return;
+
+      // The full barriers order the increment before reading the handle,
+      // pairing with the ones in Remove(). Either Remove() sees this reader
+      // or this reader sees the invalidated handle.
+      base::subtle::Barrier_AtomicIncrement(&slot_->readers, 1);
+      if (base::subtle::Acquire_Load(&slot_->handle) != handle) {
+        base::subtle::Barrier_AtomicIncrement(&slot_->readers, -1);
+        slot_ = NULL;
+        return;
+      }
+      object_ = reinterpret_cast<T*>(
+          base::subtle::NoBarrier_Load(&slot_->object));
+    }
+
+    ~Lookup() {
+      if (slot_)
+        base::subtle::Barrier_AtomicIncrement(&slot_->readers, -1);
+    }
+
+    T* get() const { return object_; }
+
+   private:
+    typename XWalkHandleTable::Slot* slot_;
+    T* object_;
+
+    DISALLOW_COPY_AND_ASSIGN(Lookup);
+  };
+
+  XWalkHandleTable()
+      : next_index_(1),
+        free_list_(0) {
+    memset(chunks_, 0, sizeof(chunks_));
+  }
+
+  ~XWalkHandleTable() {
+    for (int i = 0; i < kMaxChunks; ++i)
+      delete[] reinterpret_cast<Slot*>(chunks_[i]);
+  }
+
+  // Returns the handle for |object|, which is never 0. Returns 0 if the table
+  // is full.
+  int32_t Add(T* object) {
+    base::AutoLock lock(lock_);
+
+    int32_t index = free_list_;
+    Slot* slot;
+    if (index) {
+      slot = GetSlotByIndex(index);
+      free_list_ = slot->next_free;
+    } else {
+      if (next_index_ > kIndexMask)
+        return 0;
+      index = next_index_++;
+
+      base::subtle::AtomicWord* chunk = &chunks_[index / kSlotsPerChunk];
+      if (!*chunk) {
+        Slot* new_chunk = new Slot[kSlotsPerChunk]();
+        base::subtle::Release_Store(
+            chunk, reinterpret_cast<base::subtle::AtomicWord>(new_chunk));
+      }
+      slot = GetSlotByIndex(index);
+    }
+
+    base::subtle::NoBarrier_Store(
+        &slot->object, reinterpret_cast<base::subtle::AtomicWord>(object));
+    int32_t handle = (slot->generation << kIndexBits) | index;
+    base::subtle::Release_Store(&slot->handle, handle);
+    return handle;
+  }
+
+  // Invalidates |handle| and waits for the lookups in progress to finish, so
+  // the object can be destroyed once this returns.
+  void Remove(int32_t handle) {
+    Slot* slot = GetSlot(handle);
+    CHECK(slot && base::subtle::NoBarrier_Load(&slot->handle) == handle);
+
+    base::subtle::NoBarrier_Store(&slot->handle, 0);
+    base::subtle::MemoryBarrier();
+    while (base::subtle::Acquire_Load(&slot->readers))
+      base::PlatformThread::YieldCurrentThread();
+    base::subtle::NoBarrier_Store(&slot->object, 0);
+
+    base::AutoLock lock(lock_);
+    slot->generation = (slot->generation + 1) & kMaxGeneration;
+    slot->next_free = free_list_;
+    free_list_ = handle & kIndexMask;
+  }
+
+ private:
+  // Handles must stay positive, the generation gets the bits left by the
+  // index.
+  enum {
+    kIndexBits = 16,
+    kIndexMask = (1 << kIndexBits) - 1,
+    kMaxGeneration = (1 << (31 - kIndexBits)) - 1,
+    kSlotsPerChunk = 256,
+    kMaxChunks = (1 << kIndexBits) / kSlotsPerChunk
+  };
+
+  struct Slot {
+    // Current handle for the slot, 0 when the slot is free.
+    base::subtle::Atomic32 handle;
+    // Number of lookups in progress.
+    base::subtle::Atomic32 readers;
+    base::subtle::AtomicWord object;
+    // Protected by |lock_|.
+    int32_t generation;
+    int32_t next_free;
+  };
+
+  Slot* GetSlot(int32_t handle) const {
+    if (handle <= 0)
+      return NULL;
+    return GetSlotByIndex(handle & kIndexMask);
+  }
+
+  Slot* GetSlotByIndex(int32_t index) const {
+    Slot* chunk = reinterpret_cast<Slot*>(
+        base::subtle::Acquire_Load(&chunks_[index / kSlotsPerChunk]));
+    if (!chunk)
+      return NULL;
+    return &chunk[index % kSlotsPerChunk];
+  }
+
+  // Slots are allocated in chunks that are never moved or freed while the
+  // table is alive, so lookups can access them without locking.
+  base::subtle::AtomicWord chunks_[kMaxChunks];
+
+  base::Lock lock_;
+  // Index 0 is never used, so 0 is never a valid handle.
+  int32_t next_index_;
+  int32_t free_list_;
+
+  DISALLOW_COPY_AND_ASSIGN(XWalkHandleTable);
+};
+
+}  // namespace extensions
+}  // namespace xwalk
+
+#endif  // XWALK_EXTENSIONS_COMMON_XWALK_HANDLE_TABLE_H_
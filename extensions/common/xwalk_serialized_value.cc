@@ -0,0 +1,509 @@
+// Copyright (c) 2013 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "xwalk/extensions/common/xwalk_serialized_value.h"
+
+#include <string.h>
+#include "base/logging.h"
+
+namespace xwalk {
+namespace extensions {
+
+namespace {
+
+// Bump when the serialization format changes.
+const uint8_t kSerializedValueVersion = 1;
+
+// Most messages are small, avoid growing the buffer many times for them.
+const size_t kInitialCapacity = 256;
+
+// Deeper values are rejected by ReadValue(), the same limit used when
+// converting from V8 values.
+const int kMaxDepth = 100;
+
+enum Tag {
+  kNullTag = 0,
+  kFalseTag,
+  kTrueTag,
+  kIntegerTag,
+  kDoubleTag,
+  kStringTag,
+  kBinaryTag,
+  kListTag,
+  kDictionaryTag
+};
+
+// Number of elements and size in bytes.
+const size_t kContainerHeaderSize = 2 * sizeof(uint32_t);
+
+}  // namespace
+
+XWalkSerializedValueWriter::XWalkSerializedValueWriter() {
+  data_.reserve(kInitialCapacity);
+  data_.push_back(kSerializedValueVersion);
+}
+
+XWalkSerializedValueWriter::~XWalkSerializedValueWriter() {}
+
+void XWalkSerializedValueWriter::WriteNull() {
+  WriteTag(kNullTag);
+}
+
+void XWalkSerializedValueWriter::WriteBoolean(bool value) {
+  WriteTag(value ? kTrueTag : kFalseTag);
+}
+
+void XWalkSerializedValueWriter::WriteInteger(int value) {
+  WriteTag(kIntegerTag);
+  int32_t value32 = value;
+  memcpy(AppendBuffer(sizeof(value32)), &value32, sizeof(value32));
+}
+
+void XWalkSerializedValueWriter::WriteDouble(double value) {
+  WriteTag(kDoubleTag);
+  memcpy(AppendBuffer(sizeof(value)), &value, sizeof(value));
+}
+
+void XWalkSerializedValueWriter::WriteString(const base::StringPiece& value) {
+  value.copy(WriteStringBuffer(value.size()), value.size());
+}
+
+char* XWalkSerializedValueWriter::WriteStringBuffer(size_t length) {
+  WriteTag(kStringTag);
+  WriteUInt32(length);
+  return AppendBuffer(length);
+}
+
+void XWalkSerializedValueWriter::WriteBinary(const void* data, size_t size) {
+  WriteTag(kBinaryTag);
+  WriteUInt32(size);
+  memcpy(AppendBuffer(size), data, size);
+}
+
+size_t XWalkSerializedValueWriter::BeginList() {
+  WriteTag(kListTag);
+  size_t begin = data_.size();
+  AppendBuffer(kContainerHeaderSize);
+  return begin;
+}
+
+void XWalkSerializedValueWriter::EndList(size_t begin, size_t size) {
+  EndContainer(begin, size);
+}
+
+size_t XWalkSerializedValueWriter::BeginDictionary() {
+  WriteTag(kDictionaryTag);
+  size_t begin = data_.size();
+  AppendBuffer(kContainerHeaderSize);
+  return begin;
+}
+
+void XWalkSerializedValueWriter::EndDictionary(size_t begin, size_t size) {
+  EndContainer(begin, size);
+}
+
+void XWalkSerializedValueWriter::WriteKey(const base::StringPiece& key) {
+  key.copy(WriteKeyBuffer(key.size()), key.size());
+}
+
+char* XWalkSerializedValueWriter::WriteKeyBuffer(size_t length) {
+  WriteUInt32(length);
+  return AppendBuffer(length);
+}
+
+void XWalkSerializedValueWriter::WriteValue(const base::Value& value) {
+  switch (value.GetType()) {
+    case base::Value::TYPE_NULL:
+      WriteNull();
+      return;
+    case base::Value::TYPE_BOOLEAN: {
+      bool boolean_value = false;
+      value.GetAsBoolean(&boolean_value);
+      WriteBoolean(boolean_value);
+      return;
+    }
+    case base::Value::TYPE_INTEGER: {
+      int integer_value = 0;
+      value.GetAsInteger(&integer_value);
+      WriteInteger(integer_value);
+      return;
+    }
+    case base::Value::TYPE_DOUBLE: {
+      double double_value = 0;
+      value.GetAsDouble(&double_value);
+      WriteDouble(double_value);
+      return;
+    }
+    case base::Value::TYPE_STRING: {
+      std::string string_value;
+      value.GetAsString(&string_value);
+      WriteString(string_value);
+      return;
+    }
+    case base::Value::TYPE_BINARY: {
+      const base::BinaryValue& binary_value =
+          static_cast<const base::BinaryValue&>(value);
+      WriteBinary(binary_value.GetBuffer(), binary_value.GetSize());
+      return;
+    }
+    case base::Value::TYPE_LIST: {
+      const base::ListValue* list_value;
+      value.GetAsList(&list_value);
+      size_t begin = BeginList();
+      base::ListValue::const_iterator it = list_value->begin();
+      for (; it != list_value->end(); ++it)
+        WriteValue(**it);
+      EndList(begin, list_value->GetSize());
+      return;
+    }
+    case base::Value::TYPE_DICTIONARY: {
+      const base::DictionaryValue* dictionary_value;
+      value.GetAsDictionary(&dictionary_value);
+      size_t begin = BeginDictionary();
+      base::DictionaryValue::Iterator it(*dictionary_value);
+      for (; !it.IsAtEnd(); it.Advance()) {
+        WriteKey(it.key());
+        WriteValue(it.value());
+      }
+      EndDictionary(begin, dictionary_value->size());
+      return;
+    }
+  }
+  NOTREACHED();
+}
+
+void XWalkSerializedValueWriter::Rewind(size_t offset) {
+  DCHECK_LE(offset, data_.size());
+  DCHECK_GT(offset, 0u);
+  data_.resize(offset);
+}
+
+void XWalkSerializedValueWriter::WriteTag(uint8_t tag) {
+  data_.push_back(tag);
+}
+
+void XWalkSerializedValueWriter::WriteUInt32(uint32_t value) {
+  memcpy(AppendBuffer(sizeof(value)), &value, sizeof(value));
+}
+
+char* XWalkSerializedValueWriter::AppendBuffer(size_t length) {
+  size_t offset = data_.size();
+  data_.resize(offset + length);
+  return length ? &data_[offset] : NULL;
+}
+
+void XWalkSerializedValueWriter::EndContainer(size_t begin, size_t size) {
+  DCHECK_LE(begin + kContainerHeaderSize, data_.size());
+  uint32_t size32 = size;
+  uint32_t bytes = data_.size() - begin - kContainerHeaderSize;
+  memcpy(&data_[begin], &size32, sizeof(size32));
+  memcpy(&data_[begin + sizeof(size32)], &bytes, sizeof(bytes));
+}
+
+XWalkSerializedValueReader::XWalkSerializedValueReader(
+    const base::StringPiece& data)
+    : pos_(data.data()),
+      end_(data.data() + data.size()),
+      valid_(true) {
+  if (data.empty() ||
+      static_cast<uint8_t>(data[0]) != kSerializedValueVersion) {
+    Fail();
+    return;
+  }
+  ++pos_;
+}
+
+XWalkSerializedValueReader::~XWalkSerializedValueReader() {}
+
+bool XWalkSerializedValueReader::PeekType(base::Value::Type* type) const {
+  uint8_t tag;
+  if (!PeekTag(&tag))
+    return false;
+
+  switch (tag) {
+    case kNullTag:
+      *type = base::Value::TYPE_NULL;
+      break;
+    case kFalseTag:
+    case kTrueTag:
+      *type = base::Value::TYPE_BOOLEAN;
+      break;
+    case kIntegerTag:
+      *type = base::Value::TYPE_INTEGER;
+      break;
+    case kDoubleTag:
+      *type = base::Value::TYPE_DOUBLE;
+      break;
+    case kStringTag:
+      *type = base::Value::TYPE_STRING;
+      break;
+    case kBinaryTag:
+      *type = base::Value::TYPE_BINARY;
+      break;
+    case kListTag:
+      *type = base::Value::TYPE_LIST;
+      break;
+    case kDictionaryTag:
+      *type = base::Value::TYPE_DICTIONARY;
+      break;
+    default:
+      return false;
+  }
+  return true;
+}
+
+bool XWalkSerializedValueReader::ReadNull() {
+  return ReadTag(kNullTag);
+}
+
+bool XWalkSerializedValueReader::ReadBoolean(bool* value) {
+  if (ReadTag(kFalseTag)) {
+    *value = false;
+    return true;
+  }
+  if (ReadTag(kTrueTag)) {
+    *value = true;
+    return true;
+  }
+  return false;
+}
+
+bool XWalkSerializedValueReader::ReadInteger(int* value) {
+  uint8_t tag;
+  if (!PeekTag(&tag) || tag != kIntegerTag)
+    return false;
+
+  const char* bytes;
+  int32_t value32;
+  if (!ReadBytes(1 + sizeof(value32), &bytes))
+    return Fail();
+  memcpy(&value32, bytes + 1, sizeof(value32));
+  *value = value32;
+  return true;
+}
+
+bool XWalkSerializedValueReader::ReadDouble(double* value) {
+  int integer_value;
+  if (ReadInteger(&integer_value)) {
+    *value = integer_value;
+    return true;
+  }
+
+  uint8_t tag;
+  if (!PeekTag(&tag) || tag != kDoubleTag)
+    return false;
+
+  const char* bytes;
+  if (!ReadBytes(1 + sizeof(*value), &bytes))
+    return Fail();
+  memcpy(value, bytes + 1, sizeof(*value));
+  return true;
+}
+
+bool XWalkSerializedValueReader::ReadString(base::StringPiece* value) {
+  if (!ReadTag(kStringTag))
+    return false;
+  return ReadLengthAndBytes(value);
+}
+
+bool XWalkSerializedValueReader::ReadBinary(base::StringPiece* value) {
+  if (!ReadTag(kBinaryTag))
+    return false;
+  return ReadLengthAndBytes(value);
+}
+
+bool XWalkSerializedValueReader::ReadList(size_t* size) {
+  uint32_t size32;
+  uint32_t bytes;
+  if (!ReadTag(kListTag))
+    return false;
+  if (!ReadUInt32(&size32) || !ReadUInt32(&bytes))
+    return false;
+  if (bytes > static_cast<size_t>(end_ - pos_))
+    return Fail();
+  *size = size32;
+  return true;
+}
+
+bool XWalkSerializedValueReader::ReadDictionary(size_t* size) {
+  uint32_t size32;
+  uint32_t bytes;
+  if (!ReadTag(kDictionaryTag))
+    return false;
+  if (!ReadUInt32(&size32) || !ReadUInt32(&bytes))
+    return false;
+  if (bytes > static_cast<size_t>(end_ - pos_))
+    return Fail();
+  *size = size32;
+  return true;
+}
+
+bool XWalkSerializedValueReader::ReadKey(base::StringPiece* key) {
+  if (!valid_)
+    return false;
+  return ReadLengthAndBytes(key);
+}
+
+bool XWalkSerializedValueReader::Skip() {
+  uint8_t tag;
+  if (!PeekTag(&tag))
+    return false;
+  ++pos_;
+
+  const char* bytes;
+  uint32_t length;
+  switch (tag) {
+    case kNullTag:
+    case kFalseTag:
+    case kTrueTag:
+      return true;
+    case kIntegerTag:
+      return ReadBytes(sizeof(int32_t), &bytes);
+    case kDoubleTag:
+      return ReadBytes(sizeof(double), &bytes);
+    case kStringTag:
+    case kBinaryTag:
+      return ReadUInt32(&length) && ReadBytes(length, &bytes);
+    case kListTag:
+    case kDictionaryTag:
+      return ReadUInt32(&length) && ReadUInt32(&length) &&
+          ReadBytes(length, &bytes);
+  }
+  return Fail();
+}
+
+scoped_ptr<base::Value> XWalkSerializedValueReader::ReadValue() {
+  return ReadValueWithDepth(0);
+}
+
+bool XWalkSerializedValueReader::PeekTag(uint8_t* tag) const {
+  if (!valid_ || pos_ == end_)
+    return false;
+  *tag = static_cast<uint8_t>(*pos_);
+  return true;
+}
+
+bool XWalkSerializedValueReader::ReadTag(uint8_t expected_tag) {
+  uint8_t tag;
+  if (!PeekTag(&tag) || tag != expected_tag)
+    return false;
+  ++pos_;
+  return true;
+}
+
+bool XWalkSerializedValueReader::ReadUInt32(uint32_t* value) {
+  const char* bytes;
+  if (!ReadBytes(sizeof(*value), &bytes))
+    return false;
+  memcpy(value, bytes, sizeof(*value));
+  return true;
+}
+
+bool XWalkSerializedValueReader::ReadBytes(size_t length,
+                                           const char** bytes) {
+  if (!valid_)
+    return false;
+  if (length > static_cast<size_t>(end_ - pos_))
+    return Fail();
+  *bytes = pos_;
+  pos_ += length;
+  return true;
+}
+
+bool XWalkSerializedValueReader::ReadLengthAndBytes(
+    base::StringPiece* value) {
+  uint32_t length;
+  const char* bytes;
+  if (!ReadUInt32(&length) || !ReadBytes(length, &bytes))
+    return false;
+  value->set(bytes, length);
+  return true;
+}
+
+bool XWalkSerializedValueReader::Fail() {
+  valid_ = false;
+  return false;
+}
+
+scoped_ptr<base::Value> XWalkSerializedValueReader::ReadValueWithDepth(
+    int depth) {
+  base::Value::Type type;
+  if (depth > kMaxDepth || !PeekType(&type)) {
+    Fail();
+    return scoped_ptr<base::Value>();
+  }
+
+  switch (type) {
+    case base::Value::TYPE_NULL:
+      ReadNull();
+      return make_scoped_ptr(base::Value::CreateNullValue());
+    case base::Value::TYPE_BOOLEAN: {
+      bool value;
+      ReadBoolean(&value);
+      return scoped_ptr<base::Value>(new base::FundamentalValue(value));
+    }
+    case base::Value::TYPE_INTEGER: {
+      int value;
+      if (!ReadInteger(&value))
+        break;
+      return scoped_ptr<base::Value>(new base::FundamentalValue(value));
+    }
+    case base::Value::TYPE_DOUBLE: {
+      double value;
+      if (!ReadDouble(&value))
+        break;
+      return scoped_ptr<base::Value>(new base::FundamentalValue(value));
+    }
+    case base::Value::TYPE_STRING: {
+      base::StringPiece value;
+      if (!ReadString(&value))
+        break;
+      return scoped_ptr<base::Value>(new base::StringValue(value.as_string()));
+    }
+    case base::Value::TYPE_BINARY: {
+      base::StringPiece value;
+      if (!ReadBinary(&value))
+        break;
+      return scoped_ptr<base::Value>(
+          base::BinaryValue::CreateWithCopiedBuffer(value.data(),
+                                                    value.size()));
+    }
+    case base::Value::TYPE_LIST: {
+      size_t size;
+      if (!ReadList(&size))
+        break;
+      scoped_ptr<base::ListValue> list(new base::ListValue);
+      for (size_t i = 0; i < size; ++i) {
+        scoped_ptr<base::Value> element = ReadValueWithDepth(depth + 1);
+        if (!element)
+          return scoped_ptr<base::Value>();
+        list->Append(element.release());
+      }
+      return list.PassAs<base::Value>();
+    }
+    case base::Value::TYPE_DICTIONARY: {
+      size_t size;
+      if (!ReadDictionary(&size))
+        break;
+      scoped_ptr<base::DictionaryValue> dictionary(new base::DictionaryValue);
+      for (size_t i = 0; i < size; ++i) {
+        base::StringPiece key;
+        if (!ReadKey(&key))
+          return scoped_ptr<base::Value>();
+        scoped_ptr<base::Value> element = ReadValueWithDepth(depth + 1);
+        if (!element)
+          return scoped_ptr<base::Value>();
+        dictionary->SetWithoutPathExpansion(key.as_string(),
+                                            element.release());
+      }
+      return dictionary.PassAs<base::Value>();
+    }
+  }
+
+  Fail();
+  return scoped_ptr<base::Value>();
+}
+
+}  // namespace extensions
+}  // namespace xwalk
@@ -0,0 +1,131 @@
+// Copyright (c) 2013 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef XWALK_EXTENSIONS_COMMON_XWALK_SERIALIZED_VALUE_H_
+#define XWALK_EXTENSIONS_COMMON_XWALK_SERIALIZED_VALUE_H_
+
+#include <stdint.h>
+#include <string>
+#include "base/basictypes.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/strings/string_piece.h"
+#include "base/values.h"
+
+namespace xwalk {
+namespace extensions {
+
+// Compact binary serialization of the values exchanged between extensions
+// and their JavaScript code. The renderer writes JavaScript values directly
+// into it, without building a base::Value tree, and the native side reads
+// them with XWalkSerializedValueReader.
+//
+// Each value is a one byte tag followed by its payload. Lists and
+// dictionaries are prefixed with their number of elements and their size in
+// bytes, so they can be skipped without being parsed.
+class XWalkSerializedValueWriter {
+ public:
+  XWalkSerializedValueWriter();
+  ~XWalkSerializedValueWriter();
+
+  void WriteNull();
+  void WriteBoolean(bool value);
+  void WriteInteger(int value);
+  void WriteDouble(double value);
+  void WriteString(const base::StringPiece& value);
+  void WriteBinary(const void* data, size_t size);
+
+  // Writes the header of a string of |length| bytes and returns where to
+  // copy them, valid until the next call to the writer.
+  char* WriteStringBuffer(size_t length);
+
+  // Elements are written between BeginList() and EndList(), that takes the
+  // offset returned by BeginList() and the number of elements written.
+  size_t BeginList();
+  void EndList(size_t begin, size_t size);
+
+  // Like lists, but each element is a key followed by its value.
+  size_t BeginDictionary();
+  void EndDictionary(size_t begin, size_t size);
+  void WriteKey(const base::StringPiece& key);
+  char* WriteKeyBuffer(size_t length);
+
+  void WriteValue(const base::Value& value);
+
+  // Everything written after |offset|, as returned by offset(), can be
+  // discarded with Rewind(). Used to drop a key when its value turns out not
+  // to be serializable.
+  size_t offset() const { return data_.size(); }
+  void Rewind(size_t offset);
+
+  const std::string& data() const { return data_; }
+
+ private:
+  void WriteTag(uint8_t tag);
+  void WriteUInt32(uint32_t value);
+  char* AppendBuffer(size_t length);
+  void EndContainer(size_t begin, size_t size);
+
+  std::string data_;
+
+  DISALLOW_COPY_AND_ASSIGN(XWalkSerializedValueWriter);
+};
+
+// Cursor over a serialized value. It doesn't copy nor parse the data ahead,
+// the strings read point into it, so the data must outlive the reader and
+// the StringPieces obtained from it.
+//
+// Each Read*() function reads the next value if it has the expected type,
+// otherwise it returns false and the cursor doesn't move. Containers are read
+// by reading their header with ReadList() or ReadDictionary() and then each
+// of their elements, preceded by ReadKey() for dictionaries. Unwanted values
+// can be skipped in constant time with Skip().
+class XWalkSerializedValueReader {
+ public:
+  explicit XWalkSerializedValueReader(const base::StringPiece& data);
+  ~XWalkSerializedValueReader();
+
+  // False if the data is malformed, in that case all reads fail.
+  bool is_valid() const { return valid_; }
+
+  // Returns false if there's no more values to read.
+  bool PeekType(base::Value::Type* type) const;
+
+  bool ReadNull();
+  bool ReadBoolean(bool* value);
+  bool ReadInteger(int* value);
+  // Also reads integers.
+  bool ReadDouble(double* value);
+  bool ReadString(base::StringPiece* value);
+  bool ReadBinary(base::StringPiece* value);
+
+  bool ReadList(size_t* size);
+  bool ReadDictionary(size_t* size);
+  bool ReadKey(base::StringPiece* key);
+
+  bool Skip();
+
+  // Reads the next value into a base::Value tree, for code that still
+  // expects one. Returns NULL in case of failure.
+  scoped_ptr<base::Value> ReadValue();
+
+ private:
+  bool PeekTag(uint8_t* tag) const;
+  bool ReadTag(uint8_t expected_tag);
+  bool ReadUInt32(uint32_t* value);
+  bool ReadBytes(size_t length, const char** bytes);
+  bool ReadLengthAndBytes(base::StringPiece* value);
+  bool Fail();
+  scoped_ptr<base::Value> ReadValueWithDepth(int depth);
+
+  const char* pos_;
+  const char* end_;
+  bool valid_;
+
+  DISALLOW_COPY_AND_ASSIGN(XWalkSerializedValueReader);
+};
+
+}  // namespace extensions
+}  // namespace xwalk
+
+#endif  // XWALK_EXTENSIONS_COMMON_XWALK_SERIALIZED_VALUE_H_
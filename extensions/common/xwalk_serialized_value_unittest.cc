@@ -0,0 +1,133 @@
+// Copyright (c) 2013 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "xwalk/extensions/common/xwalk_serialized_value.h"
+
+#include <string>
+#include "base/json/json_reader.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/values.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+using xwalk::extensions::XWalkSerializedValueReader;
+using xwalk::extensions::XWalkSerializedValueWriter;
+
+TEST(XWalkSerializedValueTest, RoundTrip) {
+  const char kJSON[] =
+      "{\"contacts\": [{\"name\": \"Alice\", \"id\": 1, \"favorite\": true},"
+      "                {\"name\": \"Bob\", \"id\": 2.5, \"favorite\": false}],"
+      " \"nothing\": null, \"empty\": {}, \"list\": [[], [1, [2]], \"\"]}";
+  scoped_ptr<base::Value> value(base::JSONReader::Read(kJSON));
+  ASSERT_TRUE(value);
+
+  XWalkSerializedValueWriter writer;
+  writer.WriteValue(*value);
+
+  XWalkSerializedValueReader reader(writer.data());
+  ASSERT_TRUE(reader.is_valid());
+  scoped_ptr<base::Value> result(reader.ReadValue());
+  ASSERT_TRUE(result);
+  EXPECT_TRUE(value->Equals(result.get()));
+
+  base::Value::Type type;
+  EXPECT_FALSE(reader.PeekType(&type));
+  EXPECT_TRUE(reader.is_valid());
+}
+
+TEST(XWalkSerializedValueTest, BinaryRoundTrip) {
+  const char kData[] = "\0binary\0data";
+  XWalkSerializedValueWriter writer;
+  writer.WriteBinary(kData, sizeof(kData));
+
+  XWalkSerializedValueReader reader(writer.data());
+  base::StringPiece data;
+  ASSERT_TRUE(reader.ReadBinary(&data));
+  EXPECT_EQ(base::StringPiece(kData, sizeof(kData)), data);
+}
+
+TEST(XWalkSerializedValueTest, CursorReads) {
+  XWalkSerializedValueWriter writer;
+  size_t dictionary = writer.BeginDictionary();
+  writer.WriteKey("skipped");
+  size_t list = writer.BeginList();
+  for (int i = 0; i < 1000; ++i)
+    writer.WriteString("element");
+  writer.EndList(list, 1000);
+  writer.WriteKey("name");
+  writer.WriteString("value");
+  writer.WriteKey("count");
+  writer.WriteInteger(42);
+  writer.EndDictionary(dictionary, 3);
+
+  XWalkSerializedValueReader reader(writer.data());
+  size_t size;
+  base::StringPiece key;
+  ASSERT_TRUE(reader.ReadDictionary(&size));
+  EXPECT_EQ(3u, size);
+
+  ASSERT_TRUE(reader.ReadKey(&key));
+  EXPECT_EQ("skipped", key);
+  base::Value::Type type;
+  ASSERT_TRUE(reader.PeekType(&type));
+  EXPECT_EQ(base::Value::TYPE_LIST, type);
+  ASSERT_TRUE(reader.Skip());
+
+  ASSERT_TRUE(reader.ReadKey(&key));
+  EXPECT_EQ("name", key);
+  int integer;
+  base::StringPiece string;
+  EXPECT_FALSE(reader.ReadInteger(&integer));
+  ASSERT_TRUE(reader.ReadString(&string));
+  EXPECT_EQ("value", string);
+
+  ASSERT_TRUE(reader.ReadKey(&key));
+  EXPECT_EQ("count", key);
+  double number;
+  ASSERT_TRUE(reader.ReadDouble(&number));
+  EXPECT_EQ(42, number);
+
+  EXPECT_FALSE(reader.PeekType(&type));
+  EXPECT_TRUE(reader.is_valid());
+}
+
+TEST(XWalkSerializedValueTest, DiscardKeyWithRewind) {
+  XWalkSerializedValueWriter writer;
+  size_t dictionary = writer.BeginDictionary();
+  size_t offset = writer.offset();
+  writer.WriteKey("discarded");
+  writer.Rewind(offset);
+  writer.WriteKey("kept");
+  writer.WriteBoolean(true);
+  writer.EndDictionary(dictionary, 1);
+
+  XWalkSerializedValueReader reader(writer.data());
+  scoped_ptr<base::Value> result(reader.ReadValue());
+  base::DictionaryValue expected;
+  expected.SetBoolean("kept", true);
+  ASSERT_TRUE(result);
+  EXPECT_TRUE(expected.Equals(result.get()));
+}
+
+TEST(XWalkSerializedValueTest, RejectMalformedData) {
+  XWalkSerializedValueReader empty_reader((base::StringPiece()));
+  EXPECT_FALSE(empty_reader.is_valid());
+
+  XWalkSerializedValueWriter writer;
+  writer.WriteString("a string that will be truncated");
+  std::string truncated = writer.data().substr(0, writer.data().size() - 4);
+  XWalkSerializedValueReader reader(truncated);
+  base::StringPiece string;
+  EXPECT_FALSE(reader.ReadString(&string));
+  EXPECT_FALSE(reader.is_valid());
+  EXPECT_FALSE(reader.ReadValue());
+
+  // A list claiming more elements than there are.
+  XWalkSerializedValueWriter list_writer;
+  size_t list = list_writer.BeginList();
+  list_writer.WriteNull();
+  list_writer.EndList(list, 2);
+  XWalkSerializedValueReader list_reader(list_writer.data());
+  EXPECT_FALSE(list_reader.ReadValue());
+  EXPECT_FALSE(list_reader.is_valid());
+}
@@ -5,6 +5,9 @@
 #ifndef XWALK_EXTENSIONS_EXTENSION_PROCESS_XWALK_EXTENSION_PROCESS_H_
 #define XWALK_EXTENSIONS_EXTENSION_PROCESS_XWALK_EXTENSION_PROCESS_H_
 
+#include <map>
+
+#include "base/memory/linked_ptr.h"
 #include "base/values.h"
 #include "base/synchronization/waitable_event.h"
 #include "base/threading/thread.h"
@@ -33,6 +36,10 @@ class XWalkExtensionRunner;
 // of the extension <-> render process channel.
 // It will be responsible for handling the native side (instances) of
 // External extensions through its XWalkExtensionServer.
+//
+// Extensions are loaded once and shared by all the Render Process channels,
+// each channel has its own server so instances of different Render Processes
+// are kept apart.
 class XWalkExtensionProcess : public IPC::Listener {
  public:
   XWalkExtensionProcess();
@@ -44,16 +51,28 @@ class XWalkExtensionProcess : public IPC::Listener {
 
   // Handlers for IPC messages from XWalkExtensionProcessHost.
   void OnRegisterExtensions(const base::FilePath& extension_path);
+  void OnCreateRenderProcessChannel(int render_process_id);
+  void OnCloseRenderProcessChannel(int render_process_id);
 
   void CreateBrowserProcessChannel();
-  void CreateRenderProcessChannel();
+
+  struct RenderProcessChannel {
+    // The server is declared first so it outlives the channel that is using
+    // it as listener.
+    XWalkExtensionServer server;
+    scoped_ptr<IPC::SyncChannel> channel;
+  };
 
   base::WaitableEvent shutdown_event_;
   base::Thread io_thread_;
   scoped_ptr<IPC::SyncChannel> browser_process_channel_;
+
+  // Owns the loaded extensions, it is not connected to any channel.
   XWalkExtensionServer extensions_server_;
-  scoped_ptr<IPC::SyncChannel> render_process_channel_;
-  IPC::ChannelHandle rp_channel_handle_;
+
+  typedef std::map<int, linked_ptr<RenderProcessChannel> >
+      RenderProcessChannelMap;
+  RenderProcessChannelMap render_process_channels_;
 
   DISALLOW_COPY_AND_ASSIGN(XWalkExtensionProcess);
 };
@@ -0,0 +1,59 @@
+// Copyright (c) 2013 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef XWALK_EXTENSIONS_PUBLIC_XW_EXTENSION_BINARYMESSAGE_H_
+#define XWALK_EXTENSIONS_PUBLIC_XW_EXTENSION_BINARYMESSAGE_H_
+
+#ifndef XWALK_EXTENSIONS_PUBLIC_XW_EXTENSION_H_
+#error "You should include XW_Extension.h before this file"
+#endif
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//
+// XW_BINARY_MESSAGING_INTERFACE: Exchange asynchronous binary messages with
+// JavaScript code provided by extension. Binary messages are delivered to
+// JavaScript as ArrayBuffer objects, and ArrayBuffer (or typed arrays) posted
+// by JavaScript are delivered to the registered binary message callback.
+//
+// Big payloads are transferred using shared memory instead of being copied
+// into the IPC channel, so this interface should be preferred over encoding
+// binary data as strings and using XW_MESSAGING_INTERFACE.
+//
+
+#define XW_BINARY_MESSAGING_INTERFACE_1 "XW_BinaryMessagingInterface_1"
+#define XW_BINARY_MESSAGING_INTERFACE XW_BINARY_MESSAGING_INTERFACE_1
+
+typedef void (*XW_HandleBinaryMessageCallback)(XW_Instance instance,
+                                               const uint8_t* data,
+                                               size_t size);
+
+struct XW_BinaryMessagingInterface_1 {
+  // Register a callback to be called when the JavaScript code associated
+  // with the extension posts an ArrayBuffer. The data is only valid during
+  // the execution of the callback, extensions that need it afterwards must
+  // copy it.
+  void (*Register)(XW_Extension extension,
+                   XW_HandleBinaryMessageCallback handle_message);
+
+  // Post a binary message to the web content associated with the instance.
+  // The message listener set with extension.setMessageListener() will receive
+  // it as an ArrayBuffer. The data is copied before this function returns.
+  //
+  // This function is thread-safe and can be called until the instance is
+  // destroyed.
+  void (*PostMessage)(XW_Instance instance, const uint8_t* data, size_t size);
+};
+
+typedef struct XW_BinaryMessagingInterface_1 XW_BinaryMessagingInterface;
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif
+
+#endif  // XWALK_EXTENSIONS_PUBLIC_XW_EXTENSION_BINARYMESSAGE_H_
@@ -0,0 +1,60 @@
+// Copyright (c) 2013 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef XWALK_EXTENSIONS_PUBLIC_XW_EXTENSION_REQUEST_H_
+#define XWALK_EXTENSIONS_PUBLIC_XW_EXTENSION_REQUEST_H_
+
+#ifndef XWALK_EXTENSIONS_PUBLIC_XW_EXTENSION_H_
+#error "You should include XW_Extension.h before this file"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//
+// XW_REQUEST_INTERFACE: asynchronous request/response messages. JavaScript
+// code sends a request with extension.sendRequest() and is notified when the
+// extension responds to it, without blocking the renderer like the messages
+// from XW_INTERNAL_SYNC_MESSAGING_INTERFACE do.
+//
+// Each request is identified by a XW_Request, unique for the instance. Many
+// requests can be pending for an instance at the same time and they can be
+// responded in any order. This interface should be preferred over
+// synchronous messages.
+//
+
+#define XW_REQUEST_INTERFACE_1 "XW_RequestInterface_1"
+#define XW_REQUEST_INTERFACE XW_REQUEST_INTERFACE_1
+
+typedef int32_t XW_Request;
+
+typedef void (*XW_HandleRequestCallback)(XW_Instance instance,
+                                         XW_Request request,
+                                         const char* message);
+
+struct XW_RequestInterface_1 {
+  // Register a callback to be called when the JavaScript code associated
+  // with the extension sends a request. If no callback is registered, the
+  // requests fail in JavaScript.
+  void (*Register)(XW_Extension extension,
+                   XW_HandleRequestCallback handle_request);
+
+  // Respond to |request|, that can be done after the request callback
+  // returns. Each request should be responded only once, responses to
+  // requests that already timed out in JavaScript are ignored.
+  //
+  // This function is thread-safe and can be called until the instance is
+  // destroyed.
+  void (*Respond)(XW_Instance instance, XW_Request request,
+                  const char* response);
+};
+
+typedef struct XW_RequestInterface_1 XW_RequestInterface;
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif
+
+#endif  // XWALK_EXTENSIONS_PUBLIC_XW_EXTENSION_REQUEST_H_
@@ -4,17 +4,32 @@
 
 #include "xwalk/extensions/renderer/xwalk_extension_client.h"
 
+#include "base/bind.h"
+#include "base/message_loop/message_loop.h"
 #include "base/values.h"
 #include "base/stl_util.h"
 #include "ipc/ipc_sender.h"
+#include "xwalk/extensions/common/xwalk_extension_binary_message.h"
 #include "xwalk/extensions/common/xwalk_extension_messages.h"
 
 namespace xwalk {
 namespace extensions {
 
+namespace {
+
+// Registries are only read once by each client, in the render thread.
+int g_next_registry_id = 1;
+
+}  // namespace
+
 XWalkExtensionClient::XWalkExtensionClient()
     : sender_(0),
-      next_instance_id_(1) {  // Zero is never used for a valid instance.
+      registry_id_(0),
+      next_instance_id_(1),  // Zero is never used for a valid instance.
+      is_serialization_enabled_(true),
+      is_batching_enabled_(false),
+      is_flush_scheduled_(false),
+      weak_factory_(this) {
 }
 
 XWalkExtensionClient::~XWalkExtensionClient() {
@@ -24,9 +39,29 @@ XWalkExtensionClient::~XWalkExtensionClient() {
 bool XWalkExtensionClient::Send(IPC::Message* msg) {
   DCHECK(sender_);
 
+  // Messages waiting in the batch were posted before this one, so they go
+  // first to keep the ordering.
+  SendMessageBatch();
   return sender_->Send(msg);
 }
 
+void XWalkExtensionClient::EnableMessageBatching(base::TimeDelta delay) {
+  is_batching_enabled_ = true;
+  batch_delay_ = delay;
+}
+
+void XWalkExtensionClient::FlushMessageBatch() {
+  is_flush_scheduled_ = false;
+  SendMessageBatch();
+}
+
+void XWalkExtensionClient::SendMessageBatch() {
+  if (message_batch_.empty())
+    return;
+  sender_->Send(
+      message_batch_.Release<XWalkExtensionServerMsg_PostMessagesToNative>());
+}
+
 int64_t XWalkExtensionClient::CreateInstance(
     const std::string& extension_name,
     InstanceHandler* handler) {
@@ -44,6 +79,14 @@ bool XWalkExtensionClient::OnMessageReceived(const IPC::Message& message) {
   IPC_BEGIN_MESSAGE_MAP(XWalkExtensionClient, message)
     IPC_MESSAGE_HANDLER(XWalkExtensionClientMsg_PostMessageToJS,
         OnPostMessageToJS)
+    IPC_MESSAGE_HANDLER(XWalkExtensionClientMsg_PostMessagesToJS,
+        OnPostMessagesToJS)
+    IPC_MESSAGE_HANDLER(XWalkExtensionClientMsg_PostBinaryMessageToJS,
+        OnPostBinaryMessageToJS)
+    IPC_MESSAGE_HANDLER(XWalkExtensionClientMsg_PostSharedBinaryMessageToJS,
+        OnPostSharedBinaryMessageToJS)
+    IPC_MESSAGE_HANDLER(XWalkExtensionClientMsg_PostResponseToJS,
+        OnPostResponseToJS)
     IPC_MESSAGE_HANDLER(XWalkExtensionClientMsg_InstanceDestroyed,
         OnInstanceDestroyed)
     IPC_MESSAGE_UNHANDLED(handled = false)
@@ -52,6 +95,19 @@ bool XWalkExtensionClient::OnMessageReceived(const IPC::Message& message) {
   return handled;
 }
 
+void XWalkExtensionClient::OnChannelError() {
+  // The extension process is gone, and all the instances living there. The
+  // handlers may create new instances while being notified, those fail
+  // since the channel is closed.
+  HandlerMap handlers;
+  handlers.swap(handlers_);
+  HandlerMap::iterator it = handlers.begin();
+  for (; it != handlers.end(); ++it) {
+    if (it->second)
+      it->second->HandleInstanceGone();
+  }
+}
+
 XWalkExtensionClient::ExtensionCodePoints::ExtensionCodePoints() {
 }
 
@@ -76,6 +132,77 @@ void XWalkExtensionClient::OnPostMessageToJS(int64_t instance_id,
   it->second->HandleMessageFromNative(*value);
 }
 
+void XWalkExtensionClient::OnPostMessagesToJS(
+    const std::vector<int64_t>& instance_ids, const base::ListValue& contents) {
+  if (instance_ids.size() != contents.GetSize()) {
+    LOG(WARNING) << "Ignoring malformed batch of messages.";
+    return;
+  }
+
+  // The handler is looked up for every message since running a message
+  // listener may destroy other instances.
+  for (size_t i = 0; i < instance_ids.size(); ++i) {
+    InstanceHandler* handler = GetHandler(instance_ids[i]);
+    if (!handler)
+      continue;
+    const base::Value* value;
+    contents.Get(i, &value);
+    handler->HandleMessageFromNative(*value);
+  }
+}
+
+XWalkExtensionClient::InstanceHandler* XWalkExtensionClient::GetHandler(
+    int64_t instance_id) {
+  HandlerMap::const_iterator it = handlers_.find(instance_id);
+  if (it == handlers_.end()) {
+    LOG(WARNING) << "Can't PostMessage to invalid Extension instance id: "
+                 << instance_id;
+    return NULL;
+  }
+
+  // See comment in DestroyInstance() about two step destruction.
+  return it->second;
+}
+
+void XWalkExtensionClient::OnPostBinaryMessageToJS(int64_t instance_id,
+    const std::vector<uint8_t>& data) {
+  InstanceHandler* handler = GetHandler(instance_id);
+  if (!handler)
+    return;
+  handler->HandleBinaryMessageFromNative(vector_as_array(&data), data.size());
+}
+
+void XWalkExtensionClient::OnPostSharedBinaryMessageToJS(int64_t instance_id,
+    base::SharedMemoryHandle handle, uint32_t size) {
+  // Take ownership of the handle first, so it is closed even if the
+  // instance is not valid anymore.
+  base::SharedMemory shared_memory(handle, true);
+
+  InstanceHandler* handler = GetHandler(instance_id);
+  if (!handler)
+    return;
+
+  if (!MapReceivedSharedMemory(&shared_memory, size)) {
+    LOG(WARNING) << "Couldn't map binary message of " << size
+                 << " bytes for Extension instance id: " << instance_id;
+    return;
+  }
+
+  handler->HandleBinaryMessageFromNative(
+      static_cast<const uint8_t*>(shared_memory.memory()), size);
+}
+
+void XWalkExtensionClient::OnPostResponseToJS(int64_t instance_id,
+    int request_id, const base::ListValue& response) {
+  InstanceHandler* handler = GetHandler(instance_id);
+  if (!handler)
+    return;
+
+  const base::Value* value = NULL;
+  response.Get(0, &value);
+  handler->HandleResponseFromNative(request_id, value);
+}
+
 void XWalkExtensionClient::DestroyInstance(int64_t instance_id) {
   HandlerMap::iterator it = handlers_.find(instance_id);
   if (it == handlers_.end() || !it->second) {
@@ -100,10 +227,12 @@ void XWalkExtensionClient::OnInstanceDestroyed(int64_t instance_id) {
   }
 
   // Second part of the two step destruction. See DestroyInstance() for details.
-  // The system currently assumes that we always control the destruction of
-  // instances.
-  DCHECK(!it->second);
+  // If the handler is still set, the instance was destroyed by the native side
+  // and its handler has to know it.
+  InstanceHandler* handler = it->second;
   handlers_.erase(it);
+  if (handler)
+    handler->HandleInstanceGone();
 }
 
 namespace {
@@ -126,10 +255,37 @@ scoped_ptr<base::ListValue> WrapValueInList(scoped_ptr<base::Value> value) {
 
 void XWalkExtensionClient::PostMessageToNative(int64_t instance_id,
     scoped_ptr<base::Value> msg) {
+  if (is_batching_enabled_) {
+    message_batch_.Append(instance_id, msg.Pass());
+    if (message_batch_.is_full()) {
+      SendMessageBatch();
+    } else if (!is_flush_scheduled_) {
+      is_flush_scheduled_ = true;
+      base::MessageLoop::current()->PostDelayedTask(
+          FROM_HERE,
+          base::Bind(&XWalkExtensionClient::FlushMessageBatch,
+                     weak_factory_.GetWeakPtr()),
+          batch_delay_);
+    }
+    return;
+  }
+
   scoped_ptr<base::ListValue> list_msg = WrapValueInList(msg.Pass());
   Send(new XWalkExtensionServerMsg_PostMessageToNative(instance_id, *list_msg));
 }
 
+void XWalkExtensionClient::PostSerializedMessageToNative(int64_t instance_id,
+    const std::string& msg) {
+  DCHECK(serializes_messages());
+  Send(new XWalkExtensionServerMsg_PostSerializedMessageToNative(instance_id,
+                                                                 msg));
+}
+
+void XWalkExtensionClient::PostBinaryMessageToNative(int64_t instance_id,
+    const uint8_t* data, size_t size) {
+  Send(CreateBinaryMessageToNative(instance_id, data, size));
+}
+
 scoped_ptr<base::Value> XWalkExtensionClient::SendSyncMessageToNative(
     int64_t instance_id, scoped_ptr<base::Value> msg) {
   scoped_ptr<base::ListValue> wrapped_msg = WrapValueInList(msg.Pass());
@@ -142,24 +298,43 @@ scoped_ptr<base::Value> XWalkExtensionClient::SendSyncMessageToNative(
   return reply.Pass();
 }
 
+void XWalkExtensionClient::PostRequestToNative(int64_t instance_id,
+    int request_id, scoped_ptr<base::Value> msg) {
+  scoped_ptr<base::ListValue> wrapped_msg = WrapValueInList(msg.Pass());
+  Send(new XWalkExtensionServerMsg_PostRequestToNative(instance_id, request_id,
+                                                       *wrapped_msg));
+}
+
 void XWalkExtensionClient::Initialize(IPC::Sender* sender) {
   sender_ = sender;
 
-  std::vector<XWalkExtensionServerMsg_ExtensionRegisterParams> extensions;
-  Send(new XWalkExtensionServerMsg_GetExtensions(&extensions));
+  // The JavaScript code of the extensions is not copied, it is used directly
+  // from the registry mapping, that lives as long as the client.
+  base::SharedMemoryHandle handle;
+  uint32_t size = 0;
+  std::string contents;
+  Send(new XWalkExtensionServerMsg_GetExtensionRegistry(&handle, &size,
+                                                        &contents));
+  if (!size)
+    return;
 
-  if (extensions.empty())
+  if (!registry_.Map(handle, size, contents)) {
+    LOG(WARNING) << "Couldn't read the extensions registry.";
     return;
+  }
+  registry_id_ = g_next_registry_id++;
 
-  std::vector<XWalkExtensionServerMsg_ExtensionRegisterParams>::iterator it =
-      extensions.begin();
-  for (; it != extensions.end(); ++it) {
+  const std::vector<XWalkExtensionRegistry::Entry>& entries =
+      registry_.entries();
+  std::vector<XWalkExtensionRegistry::Entry>::const_iterator it =
+      entries.begin();
+  for (; it != entries.end(); ++it) {
     ExtensionCodePoints* codepoint = new ExtensionCodePoints;
-    codepoint->api = (*it).js_api;
+    codepoint->api = it->js_api;
 
-    codepoint->entry_points = (*it).entry_points;
+    codepoint->entry_points = it->entry_points;
 
-    std::string name = (*it).name;
+    std::string name = it->name.as_string();
     extension_apis_[name] = codepoint;
   }
 }
@@ -11,8 +11,14 @@
 #include <vector>
 
 #include "base/memory/scoped_ptr.h"
+#include "base/memory/shared_memory.h"
+#include "base/memory/weak_ptr.h"
+#include "base/strings/string_piece.h"
+#include "base/time/time.h"
 #include "base/values.h"
 #include "ipc/ipc_listener.h"
+#include "xwalk/extensions/common/xwalk_extension_message_batch.h"
+#include "xwalk/extensions/common/xwalk_extension_registry.h"
 
 namespace base {
 class Value;
@@ -36,6 +42,15 @@ class XWalkExtensionClient : public IPC::Listener {
  public:
   struct InstanceHandler {
     virtual void HandleMessageFromNative(const base::Value& msg) = 0;
+    virtual void HandleBinaryMessageFromNative(const uint8_t* data,
+                                               size_t size) = 0;
+    // A NULL |response| means the request failed in the native side.
+    virtual void HandleResponseFromNative(int request_id,
+                                          const base::Value* response) = 0;
+    // Called when the instance goes away without being destroyed by
+    // DestroyInstance(), e.g. when the extension process dies. The handler
+    // is not called anymore for this instance.
+    virtual void HandleInstanceGone() = 0;
    protected:
     ~InstanceHandler() {}
   };
@@ -48,18 +63,40 @@ class XWalkExtensionClient : public IPC::Listener {
   void DestroyInstance(int64_t instance_id);
 
   void PostMessageToNative(int64_t instance_id, scoped_ptr<base::Value> msg);
+  // Posts a message written by XWalkSerializedValueWriter, only allowed when
+  // serializes_messages() is true.
+  void PostSerializedMessageToNative(int64_t instance_id,
+                                     const std::string& msg);
+  void PostBinaryMessageToNative(int64_t instance_id,
+                                 const uint8_t* data, size_t size);
   scoped_ptr<base::Value> SendSyncMessageToNative(int64_t instance_id,
       scoped_ptr<base::Value> msg);
+  void PostRequestToNative(int64_t instance_id, int request_id,
+                           scoped_ptr<base::Value> msg);
 
   void Initialize(IPC::Sender* sender);
 
+  // Messages posted to native will be coalesced and sent together after
+  // |delay| in the current thread's message loop.
+  void EnableMessageBatching(base::TimeDelta delay);
+
+  // Messages are serialized directly from V8 values unless disabled, see
+  // xwalk_serialized_value.h. Batched messages are always sent as
+  // base::Values.
+  void DisableMessageSerialization() { is_serialization_enabled_ = false; }
+  bool serializes_messages() const {
+    return is_serialization_enabled_ && !is_batching_enabled_;
+  }
+
   // IPC::Listener Implementation.
   virtual bool OnMessageReceived(const IPC::Message& message) OVERRIDE;
+  virtual void OnChannelError() OVERRIDE;
 
   struct ExtensionCodePoints {
     ExtensionCodePoints();
     ~ExtensionCodePoints();
-    std::string api;
+    // Points to the registry mapping owned by the client.
+    base::StringPiece api;
     std::vector<std::string> entry_points;
   };
 
@@ -67,20 +104,49 @@ class XWalkExtensionClient : public IPC::Listener {
 
   const ExtensionAPIMap& extension_apis() const { return extension_apis_; }
 
+  // Identifies the registry of this client in the Render Process, the code of
+  // its extensions never changes for a given id.
+  int registry_id() const { return registry_id_; }
+
  private:
   bool Send(IPC::Message* msg);
+  // Called by the delayed task scheduled for the batch.
+  void FlushMessageBatch();
+  void SendMessageBatch();
 
   // Message Handlers.
   void OnInstanceDestroyed(int64_t instance_id);
   void OnPostMessageToJS(int64_t instance_id, const base::ListValue& msg);
+  void OnPostMessagesToJS(const std::vector<int64_t>& instance_ids,
+                          const base::ListValue& contents);
+  void OnPostBinaryMessageToJS(int64_t instance_id,
+                               const std::vector<uint8_t>& data);
+  void OnPostSharedBinaryMessageToJS(int64_t instance_id,
+                                     base::SharedMemoryHandle handle,
+                                     uint32_t size);
+  void OnPostResponseToJS(int64_t instance_id, int request_id,
+                          const base::ListValue& response);
+
+  InstanceHandler* GetHandler(int64_t instance_id);
 
   IPC::Sender* sender_;
+  XWalkExtensionRegistryMapping registry_;
   ExtensionAPIMap extension_apis_;
+  int registry_id_;
 
   typedef std::map<int64_t, InstanceHandler*> HandlerMap;
   HandlerMap handlers_;
 
   int64_t next_instance_id_;
+
+  bool is_serialization_enabled_;
+  bool is_batching_enabled_;
+  base::TimeDelta batch_delay_;
+  XWalkExtensionMessageBatch message_batch_;
+  // Whether a FlushMessageBatch() task is posted, it's reused by the
+  // messages appended after the batch was sent earlier.
+  bool is_flush_scheduled_;
+  base::WeakPtrFactory<XWalkExtensionClient> weak_factory_;
 };
 
 }  // namespace extensions
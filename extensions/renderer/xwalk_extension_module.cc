@@ -5,14 +5,23 @@
 
 #include "xwalk/extensions/renderer/xwalk_extension_module.h"
 
+#include <string.h>
+#include <vector>
+#include "base/bind.h"
 #include "base/logging.h"
+#include "base/message_loop/message_loop.h"
 #include "base/strings/stringprintf.h"
 #include "base/values.h"
 #include "content/public/renderer/v8_value_converter.h"
+#include "third_party/WebKit/public/web/WebArrayBuffer.h"
+#include "third_party/WebKit/public/web/WebArrayBufferView.h"
 #include "third_party/WebKit/public/web/WebFrame.h"
 #include "third_party/WebKit/public/web/WebScopedMicrotaskSuppression.h"
+#include "xwalk/extensions/common/xwalk_serialized_value.h"
+#include "xwalk/extensions/renderer/xwalk_extension_script_cache.h"
 #include "xwalk/extensions/renderer/xwalk_module_system.h"
 #include "xwalk/extensions/renderer/xwalk_v8_utils.h"
+#include "xwalk/extensions/renderer/xwalk_v8_value_serializer.h"
 
 namespace xwalk {
 namespace extensions {
@@ -25,16 +34,19 @@ const char* kXWalkExtensionModule = "kXWalkExtensionModule";
 
 }  // namespace
 
-XWalkExtensionModule::XWalkExtensionModule(XWalkExtensionClient* client,
-                                           XWalkModuleSystem* module_system,
-                                           const std::string& extension_name,
-                                           const std::string& extension_code)
+XWalkExtensionModule::XWalkExtensionModule(
+    XWalkExtensionClient* client,
+    XWalkModuleSystem* module_system,
+    const std::string& extension_name,
+    const base::StringPiece& extension_code)
     : extension_name_(extension_name),
       extension_code_(extension_code),
       converter_(content::V8ValueConverter::create()),
       client_(client),
       module_system_(module_system),
-      instance_id_(0) {
+      instance_id_(0),
+      next_request_id_(1),
+      weak_factory_(this) {
   v8::Isolate* isolate = v8::Isolate::GetCurrent();
   v8::HandleScope handle_scope(isolate);
   v8::Handle<v8::Object> function_data = v8::Object::New();
@@ -50,6 +62,9 @@ XWalkExtensionModule::XWalkExtensionModule(XWalkExtensionClient* client,
   object_template->Set(
       v8::String::NewFromUtf8(isolate, "sendSyncMessage"),
       v8::FunctionTemplate::New(SendSyncMessageCallback, function_data));
+  object_template->Set(
+      v8::String::NewFromUtf8(isolate, "sendRequest"),
+      v8::FunctionTemplate::New(SendRequestCallback, function_data));
   object_template->Set(
       v8::String::NewFromUtf8(isolate, "setMessageListener"),
       v8::FunctionTemplate::New(SetMessageListenerCallback, function_data));
@@ -97,40 +112,51 @@ std::string CodeToEnsureNamespace(const std::string& extension_name) {
 }
 
 // Wrap API code into a callable form that takes extension object as parameter.
-std::string WrapAPICode(const std::string& extension_code,
+std::string WrapAPICode(const base::StringPiece& extension_code,
                         const std::string& extension_name) {
   // We take care here to make sure that line numbering for api_code after
   // wrapping doesn't change, so that syntax errors point to the correct line.
-  return base::StringPrintf(
+  std::string result = base::StringPrintf(
       "var %s; (function(extension, requireNative) { "
       "extension.internal = {};"
       "extension.internal.sendSyncMessage = extension.sendSyncMessage;"
       "delete extension.sendSyncMessage;"
-      "var exports = {}; (function() {'use strict'; %s\n})();"
-      "%s = exports; });",
-      CodeToEnsureNamespace(extension_name).c_str(),
-      extension_code.c_str(),
-      extension_name.c_str());
+      "if (typeof Promise === 'function') {"
+      "  extension.request = function(msg, timeout) {"
+      "    return new Promise(function(resolve, reject) {"
+      "      extension.sendRequest(msg, function(error, response) {"
+      "        if (error !== null) reject(new Error(error));"
+      "        else resolve(response);"
+      "      }, timeout);"
+      "    });"
+      "  };"
+      "}"
+      "var exports = {}; (function() {'use strict'; ",
+      CodeToEnsureNamespace(extension_name).c_str());
+  extension_code.AppendToString(&result);
+  result += "\n})();" + extension_name + " = exports; });";
+  return result;
 }
 
-v8::Handle<v8::Value> RunString(const std::string& code,
+v8::Handle<v8::Value> RunString(const std::string& key,
+                                const std::string& code,
                                 std::string* exception) {
   v8::Isolate* isolate = v8::Isolate::GetCurrent();
   v8::EscapableHandleScope handle_scope(isolate);
-  v8::Handle<v8::String> v8_code(
-      v8::String::NewFromUtf8(isolate, code.c_str()));
 
-  WebKit::WebScopedMicrotaskSuppression suppression;
-  v8::TryCatch try_catch;
-  try_catch.SetVerbose(true);
-
-  v8::Handle<v8::Script> script(v8::Script::New(v8_code, v8::String::Empty()));
-  if (try_catch.HasCaught()) {
-    *exception = ExceptionToString(try_catch);
+  // The compiled code is shared by all the script contexts of the process.
+  v8::Handle<v8::Script> script =
+      XWalkExtensionScriptCache::GetInstance()->GetScript(key, code,
+                                                          exception);
+  if (script.IsEmpty()) {
     return handle_scope.Escape(
         v8::Local<v8::Primitive>(v8::Undefined(isolate)));
   }
 
+  WebKit::WebScopedMicrotaskSuppression suppression;
+  v8::TryCatch try_catch;
+  try_catch.SetVerbose(true);
+
   v8::Local<v8::Value> result = script->Run();
   if (try_catch.HasCaught()) {
     *exception = ExceptionToString(try_catch);
@@ -145,13 +171,15 @@ v8::Handle<v8::Value> RunString(const std::string& code,
 
 void XWalkExtensionModule::LoadExtensionCode(
     v8::Handle<v8::Context> context, v8::Handle<v8::Function> requireNative) {
-  CHECK(!instance_id_);
-  instance_id_ = client_->CreateInstance(extension_name_, this);
-
   std::string exception;
   std::string wrapped_api_code = WrapAPICode(extension_code_, extension_name_);
+  // The code of an extension is identified by its name in the registry of its
+  // client, hashing it for every script context would cost more than running
+  // the cached script.
+  const std::string cache_key = base::StringPrintf(
+      "%d:%s", client_->registry_id(), extension_name_.c_str());
   v8::Handle<v8::Value> result =
-      RunString(wrapped_api_code, &exception);
+      RunString(cache_key, wrapped_api_code, &exception);
   if (!result->IsFunction()) {
     LOG(WARNING) << "Couldn't load JS API code for " << extension_name_
       << ": " << exception;
@@ -189,32 +217,183 @@ void XWalkExtensionModule::HandleMessageFromNative(const base::Value& msg) {
   v8::Context::Scope context_scope(context);
 
   v8::Handle<v8::Value> v8_value(converter_->ToV8Value(&msg, context));
+  CallMessageListener(context, v8_value);
+}
+
+void XWalkExtensionModule::HandleBinaryMessageFromNative(const uint8_t* data,
+                                                         size_t size) {
+  if (message_listener_.IsEmpty())
+    return;
+
+  v8::Isolate* isolate = v8::Isolate::GetCurrent();
+  v8::HandleScope handle_scope(isolate);
+  v8::Handle<v8::Context> context = module_system_->GetV8Context();
+  v8::Context::Scope context_scope(context);
+
+  WebKit::WebArrayBuffer buffer = WebKit::WebArrayBuffer::create(size, 1);
+  if (size)
+    memcpy(buffer.data(), data, size);
+  CallMessageListener(context, buffer.toV8Value());
+}
+
+void XWalkExtensionModule::HandleResponseFromNative(
+    int request_id, const base::Value* response) {
+  v8::Isolate* isolate = v8::Isolate::GetCurrent();
+  v8::HandleScope handle_scope(isolate);
+  v8::Handle<v8::Context> context = module_system_->GetV8Context();
+  v8::Context::Scope context_scope(context);
+
+  if (!response) {
+    CompleteRequest(request_id,
+                    v8::String::NewFromUtf8(isolate, "Request failed"),
+                    v8::Undefined(isolate));
+    return;
+  }
+
+  CompleteRequest(request_id, v8::Null(isolate),
+                  converter_->ToV8Value(response, context));
+}
+
+void XWalkExtensionModule::HandleInstanceGone() {
+  // The next message sent will try to create a new instance.
+  instance_id_ = 0;
+
+  v8::Isolate* isolate = v8::Isolate::GetCurrent();
+  v8::HandleScope handle_scope(isolate);
+  v8::Handle<v8::Context> context = module_system_->GetV8Context();
+  v8::Context::Scope context_scope(context);
+
+  // No response will come for the pending requests. Callbacks may send new
+  // requests, so only the ones pending now are failed.
+  std::vector<int> request_ids;
+  PendingRequestMap::const_iterator it = pending_requests_.begin();
+  for (; it != pending_requests_.end(); ++it)
+    request_ids.push_back(it->first);
+
+  for (size_t i = 0; i < request_ids.size(); ++i) {
+    CompleteRequest(request_ids[i],
+                    v8::String::NewFromUtf8(isolate, "Instance destroyed"),
+                    v8::Undefined(isolate));
+  }
+}
+
+void XWalkExtensionModule::OnRequestTimeout(int request_id) {
+  v8::Isolate* isolate = v8::Isolate::GetCurrent();
+  v8::HandleScope handle_scope(isolate);
+  v8::Handle<v8::Context> context = module_system_->GetV8Context();
+  v8::Context::Scope context_scope(context);
+
+  CompleteRequest(request_id,
+                  v8::String::NewFromUtf8(isolate, "Request timed out"),
+                  v8::Undefined(isolate));
+}
+
+void XWalkExtensionModule::CompleteRequest(int request_id,
+                                           v8::Handle<v8::Value> error,
+                                           v8::Handle<v8::Value> response) {
+  // Responses for requests that already timed out are ignored.
+  PendingRequestMap::iterator it = pending_requests_.find(request_id);
+  if (it == pending_requests_.end())
+    return;
+
+  v8::Isolate* isolate = v8::Isolate::GetCurrent();
+  v8::Handle<v8::Function> callback =
+      v8::Handle<v8::Function>::New(isolate, it->second->callback);
+
+  // The callback may send new requests, so forget this one before.
+  pending_requests_.erase(it);
+
+  v8::Handle<v8::Context> context = module_system_->GetV8Context();
+  v8::Handle<v8::Value> argv[] = { error, response };
+
+  WebKit::WebScopedMicrotaskSuppression suppression;
+  v8::TryCatch try_catch;
+  callback->Call(context->Global(), arraysize(argv), argv);
+  if (try_catch.HasCaught())
+    LOG(WARNING) << "Exception when running request callback: "
+        << ExceptionToString(try_catch);
+}
+
+void XWalkExtensionModule::CallMessageListener(
+    v8::Handle<v8::Context> context, v8::Handle<v8::Value> value) {
   v8::Handle<v8::Function> message_listener =
-      v8::Handle<v8::Function>::New(isolate, message_listener_);;
+      v8::Handle<v8::Function>::New(context->GetIsolate(), message_listener_);
 
   WebKit::WebScopedMicrotaskSuppression suppression;
   v8::TryCatch try_catch;
-  message_listener->Call(context->Global(), 1, &v8_value);
+  message_listener->Call(context->Global(), 1, &value);
   if (try_catch.HasCaught())
     LOG(WARNING) << "Exception when running message listener: "
         << ExceptionToString(try_catch);
 }
 
+bool XWalkExtensionModule::EnsureInstance() {
+  if (!instance_id_)
+    instance_id_ = client_->CreateInstance(extension_name_, this);
+  return instance_id_ != 0;
+}
+
+namespace {
+
+// ArrayBuffers and typed arrays are sent as binary messages, skipping the
+// conversion to base::Value. Returns false if |value| is not binary data.
+// The data returned is owned by |value|.
+bool GetBinaryData(v8::Handle<v8::Value> value,
+                   const uint8_t** data, size_t* size) {
+  scoped_ptr<WebKit::WebArrayBuffer> buffer(
+      WebKit::WebArrayBuffer::createFromV8Value(value));
+  if (buffer) {
+    *data = static_cast<const uint8_t*>(buffer->data());
+    *size = buffer->byteLength();
+    return true;
+  }
+
+  scoped_ptr<WebKit::WebArrayBufferView> view(
+      WebKit::WebArrayBufferView::createFromV8Value(value));
+  if (view) {
+    *data = static_cast<const uint8_t*>(view->baseAddress()) +
+        view->byteOffset();
+    *size = view->byteLength();
+    return true;
+  }
+
+  return false;
+}
+
+}  // namespace
+
 // static
 void XWalkExtensionModule::PostMessageCallback(
     const v8::FunctionCallbackInfo<v8::Value>& info) {
   v8::ReturnValue<v8::Value> result(info.GetReturnValue());
   XWalkExtensionModule* module = GetExtensionModule(info);
-  if (!module || info.Length() != 1) {
+  if (!module || info.Length() != 1 || !module->EnsureInstance()) {
     result.Set(false);
     return;
   }
 
+  const uint8_t* data;
+  size_t size;
+  if (GetBinaryData(info[0], &data, &size)) {
+    module->client_->PostBinaryMessageToNative(module->instance_id_,
+                                               data, size);
+    result.Set(true);
+    return;
+  }
+
+  if (module->client_->serializes_messages()) {
+    XWalkSerializedValueWriter writer;
+    SerializeV8Value(info[0], &writer);
+    module->client_->PostSerializedMessageToNative(module->instance_id_,
+                                                   writer.data());
+    result.Set(true);
+    return;
+  }
+
   v8::Handle<v8::Context> context = info.GetIsolate()->GetCurrentContext();
   scoped_ptr<base::Value> value(
       module->converter_->FromV8Value(info[0], context));
 
-  CHECK(module->instance_id_);
   module->client_->PostMessageToNative(module->instance_id_, value.Pass());
   result.Set(true);
 }
@@ -224,7 +403,7 @@ void XWalkExtensionModule::SendSyncMessageCallback(
     const v8::FunctionCallbackInfo<v8::Value>& info) {
   v8::ReturnValue<v8::Value> result(info.GetReturnValue());
   XWalkExtensionModule* module = GetExtensionModule(info);
-  if (!module || info.Length() != 1) {
+  if (!module || info.Length() != 1 || !module->EnsureInstance()) {
     result.Set(false);
     return;
   }
@@ -233,7 +412,6 @@ void XWalkExtensionModule::SendSyncMessageCallback(
   scoped_ptr<base::Value> value(
       module->converter_->FromV8Value(info[0], context));
 
-  CHECK(module->instance_id_);
   scoped_ptr<base::Value> reply(
       module->client_->SendSyncMessageToNative(module->instance_id_,
                                                value.Pass()));
@@ -244,6 +422,52 @@ void XWalkExtensionModule::SendSyncMessageCallback(
     result.Set(module->converter_->ToV8Value(reply.get(), context));
 }
 
+// Sends |msg| to the native side without blocking. The |callback| is called
+// with (null, response) once the extension responds, or with an error string
+// if the request fails, the instance goes away or no response arrives after
+// |timeout| milliseconds, when given. Returns the id of the request, or false
+// in case of failure.
+//
+// static
+void XWalkExtensionModule::SendRequestCallback(
+    const v8::FunctionCallbackInfo<v8::Value>& info) {
+  v8::ReturnValue<v8::Value> result(info.GetReturnValue());
+  XWalkExtensionModule* module = GetExtensionModule(info);
+  if (!module || info.Length() < 2 || !info[1]->IsFunction() ||
+      !module->EnsureInstance()) {
+    result.Set(false);
+    return;
+  }
+
+  int timeout_ms = 0;
+  if (info.Length() > 2 && info[2]->IsNumber())
+    timeout_ms = info[2]->Int32Value();
+
+  v8::Isolate* isolate = info.GetIsolate();
+  const int request_id = module->next_request_id_++;
+  linked_ptr<PendingRequest> request(new PendingRequest);
+  request->callback.Reset(isolate, info[1].As<v8::Function>());
+  module->pending_requests_[request_id] = request;
+
+  v8::Handle<v8::Context> context = isolate->GetCurrentContext();
+  scoped_ptr<base::Value> value(
+      module->converter_->FromV8Value(info[0], context));
+  if (!value)
+    value.reset(base::Value::CreateNullValue());
+  module->client_->PostRequestToNative(module->instance_id_, request_id,
+                                       value.Pass());
+
+  if (timeout_ms > 0) {
+    base::MessageLoop::current()->PostDelayedTask(
+        FROM_HERE,
+        base::Bind(&XWalkExtensionModule::OnRequestTimeout,
+                   module->weak_factory_.GetWeakPtr(), request_id),
+        base::TimeDelta::FromMilliseconds(timeout_ms));
+  }
+
+  result.Set(request_id);
+}
+
 // static
 void XWalkExtensionModule::SetMessageListenerCallback(
     const v8::FunctionCallbackInfo<v8::Value>& info) {
@@ -260,6 +484,9 @@ void XWalkExtensionModule::SetMessageListenerCallback(
     return;
   }
 
+  // The listener is only registered here, the instance is still created by
+  // the first message sent to the extension. Extensions only send messages
+  // to instances, so there's nothing to listen to before that.
   v8::Isolate* isolate = info.GetIsolate();
   if (info[0]->IsUndefined())
     module->message_listener_.Reset();
@@ -5,7 +5,11 @@
 #ifndef XWALK_EXTENSIONS_RENDERER_XWALK_EXTENSION_MODULE_H_
 #define XWALK_EXTENSIONS_RENDERER_XWALK_EXTENSION_MODULE_H_
 
+#include <map>
 #include <string>
+#include "base/memory/linked_ptr.h"
+#include "base/memory/weak_ptr.h"
+#include "base/strings/string_piece.h"
 #include "xwalk/extensions/renderer/xwalk_extension_client.h"
 #include "xwalk/extensions/renderer/xwalk_module_system.h"
 
@@ -34,7 +38,7 @@ class XWalkExtensionModule : public XWalkExtensionClient::InstanceHandler {
   XWalkExtensionModule(XWalkExtensionClient* client,
                        XWalkModuleSystem* module_system,
                        const std::string& extension_name,
-                       const std::string& extension_code);
+                       const base::StringPiece& extension_code);
   virtual ~XWalkExtensionModule();
 
   // TODO(cmarcelo): Make this return a v8::Handle<v8::Object>, and
@@ -44,15 +48,38 @@ class XWalkExtensionModule : public XWalkExtensionClient::InstanceHandler {
 
   std::string extension_name() const { return extension_name_; }
 
+  // The native instance is only created when the JS API code first sends a
+  // message, pages that just load the API code don't pay for it.
+  bool has_instance() const { return instance_id_ != 0; }
+
  private:
   // XWalkExtensionClient::InstanceHandler implementation.
   virtual void HandleMessageFromNative(const base::Value& msg) OVERRIDE;
+  virtual void HandleBinaryMessageFromNative(const uint8_t* data,
+                                             size_t size) OVERRIDE;
+  virtual void HandleResponseFromNative(int request_id,
+                                        const base::Value* response) OVERRIDE;
+  virtual void HandleInstanceGone() OVERRIDE;
+
+  // Runs and forgets the callback of a pending request. A null |error| means
+  // the request succeeded, otherwise it's a string describing the failure.
+  void CompleteRequest(int request_id, v8::Handle<v8::Value> error,
+                       v8::Handle<v8::Value> response);
+  void OnRequestTimeout(int request_id);
+
+  void CallMessageListener(v8::Handle<v8::Context> context,
+                           v8::Handle<v8::Value> value);
+
+  // Returns false if the instance couldn't be created.
+  bool EnsureInstance();
 
   // Callbacks for JS functions available in 'extension' object.
   static void PostMessageCallback(
       const v8::FunctionCallbackInfo<v8::Value>& info);
   static void SendSyncMessageCallback(
       const v8::FunctionCallbackInfo<v8::Value>& info);
+  static void SendRequestCallback(
+      const v8::FunctionCallbackInfo<v8::Value>& info);
   static void SetMessageListenerCallback(
       const v8::FunctionCallbackInfo<v8::Value>& info);
 
@@ -71,7 +98,8 @@ class XWalkExtensionModule : public XWalkExtensionClient::InstanceHandler {
   v8::Persistent<v8::Function> message_listener_;
 
   std::string extension_name_;
-  std::string extension_code_;
+  // Owned by the client, usually pointing to its registry mapping.
+  base::StringPiece extension_code_;
 
   // TODO(cmarcelo): Move to a single converter, since we always use same
   // parameters.
@@ -80,6 +108,18 @@ class XWalkExtensionModule : public XWalkExtensionClient::InstanceHandler {
   XWalkExtensionClient* client_;
   XWalkModuleSystem* module_system_;
   int64_t instance_id_;
+
+  // Requests sent with 'extension.sendRequest()' waiting for a response,
+  // indexed by their request id.
+  struct PendingRequest {
+    ~PendingRequest() { callback.Reset(); }
+    v8::Persistent<v8::Function> callback;
+  };
+  typedef std::map<int, linked_ptr<PendingRequest> > PendingRequestMap;
+  PendingRequestMap pending_requests_;
+  int next_request_id_;
+
+  base::WeakPtrFactory<XWalkExtensionModule> weak_factory_;
 };
 
 }  // namespace extensions
@@ -16,10 +16,12 @@
 #include "third_party/WebKit/public/web/WebFrame.h"
 #include "third_party/WebKit/public/web/WebScopedMicrotaskSuppression.h"
 #include "v8/include/v8.h"
+#include "xwalk/extensions/common/xwalk_extension_message_batch.h"
 #include "xwalk/extensions/common/xwalk_extension_messages.h"
 #include "xwalk/extensions/common/xwalk_extension_switches.h"
 #include "xwalk/extensions/renderer/xwalk_extension_client.h"
 #include "xwalk/extensions/renderer/xwalk_extension_module.h"
+#include "xwalk/extensions/renderer/xwalk_extension_script_cache.h"
 #include "xwalk/extensions/renderer/xwalk_js_module.h"
 #include "xwalk/extensions/renderer/xwalk_module_system.h"
 #include "xwalk/extensions/renderer/xwalk_v8tools_module.h"
@@ -40,10 +42,26 @@ XWalkExtensionRendererController::XWalkExtensionRendererController(
   SetupBrowserProcessClient(browser_channel);
 
   CommandLine* cmd_line = CommandLine::ForCurrentProcess();
+  if (cmd_line->HasSwitch(switches::kXWalkDisableExtensionScriptCache))
+    XWalkExtensionScriptCache::GetInstance()->set_enabled(false);
+
   if (cmd_line->HasSwitch(switches::kXWalkDisableExtensionProcess))
     LOG(INFO) << "EXTENSION PROCESS DISABLED.";
   else
     SetupExtensionProcessClient(browser_channel);
+
+  if (cmd_line->HasSwitch(switches::kXWalkDisableExtensionValueSerialization)) {
+    in_browser_process_extensions_client_->DisableMessageSerialization();
+    if (external_extensions_client_)
+      external_extensions_client_->DisableMessageSerialization();
+  }
+
+  base::TimeDelta batch_delay;
+  if (GetMessageBatchingDelay(&batch_delay)) {
+    in_browser_process_extensions_client_->EnableMessageBatching(batch_delay);
+    if (external_extensions_client_)
+      external_extensions_client_->EnableMessageBatching(batch_delay);
+  }
 }
 
 XWalkExtensionRendererController::~XWalkExtensionRendererController() {
@@ -0,0 +1,82 @@
+// Copyright (c) 2013 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "xwalk/extensions/renderer/xwalk_extension_script_cache.h"
+
+#include "base/logging.h"
+#include "third_party/WebKit/public/web/WebScopedMicrotaskSuppression.h"
+#include "xwalk/extensions/renderer/xwalk_v8_utils.h"
+
+namespace xwalk {
+namespace extensions {
+
+namespace {
+
+base::LazyInstance<XWalkExtensionScriptCache>::Leaky g_script_cache =
+    LAZY_INSTANCE_INITIALIZER;
+
+}  // namespace
+
+// static
+XWalkExtensionScriptCache* XWalkExtensionScriptCache::GetInstance() {
+  return g_script_cache.Pointer();
+}
+
+XWalkExtensionScriptCache::XWalkExtensionScriptCache()
+    : enabled_(true),
+      hits_(0),
+      misses_(0) {}
+
+XWalkExtensionScriptCache::~XWalkExtensionScriptCache() {
+  for (ScriptMap::iterator it = scripts_.begin(); it != scripts_.end(); ++it)
+    it->second->Reset();
+}
+
+v8::Handle<v8::Script> XWalkExtensionScriptCache::GetScript(
+    const std::string& key, const std::string& source, std::string* error) {
+  v8::Isolate* isolate = v8::Isolate::GetCurrent();
+  v8::EscapableHandleScope handle_scope(isolate);
+
+  if (!enabled_)
+    return handle_scope.Escape(Compile(source, error));
+
+  ScriptMap::iterator it = scripts_.find(key);
+  if (it != scripts_.end()) {
+    hits_++;
+    return handle_scope.Escape(
+        v8::Local<v8::Script>::New(isolate, *it->second));
+  }
+
+  misses_++;
+  v8::Local<v8::Script> script = Compile(source, error);
+  if (script.IsEmpty())
+    return handle_scope.Escape(script);
+
+  linked_ptr<v8::Persistent<v8::Script> > persistent(
+      new v8::Persistent<v8::Script>(isolate, script));
+  scripts_[key] = persistent;
+  return handle_scope.Escape(script);
+}
+
+v8::Local<v8::Script> XWalkExtensionScriptCache::Compile(
+    const std::string& source, std::string* error) {
+  v8::Isolate* isolate = v8::Isolate::GetCurrent();
+  v8::EscapableHandleScope handle_scope(isolate);
+  v8::Handle<v8::String> v8_source(
+      v8::String::NewFromUtf8(isolate, source.c_str()));
+
+  WebKit::WebScopedMicrotaskSuppression suppression;
+  v8::TryCatch try_catch;
+  v8::Local<v8::Script> script =
+      v8::Script::New(v8_source);
+  if (try_catch.HasCaught()) {
+    *error = ExceptionToString(try_catch);
+    return handle_scope.Escape(v8::Local<v8::Script>());
+  }
+
+  return handle_scope.Escape(script);
+}
+
+}  // namespace extensions
+}  // namespace xwalk
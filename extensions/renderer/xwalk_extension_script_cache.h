@@ -0,0 +1,67 @@
+// Copyright (c) 2013 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef XWALK_EXTENSIONS_RENDERER_XWALK_EXTENSION_SCRIPT_CACHE_H_
+#define XWALK_EXTENSIONS_RENDERER_XWALK_EXTENSION_SCRIPT_CACHE_H_
+
+#include <map>
+#include <string>
+#include "base/lazy_instance.h"
+#include "base/memory/linked_ptr.h"
+#include "v8/include/v8.h"
+
+namespace xwalk {
+namespace extensions {
+
+// Caches the compiled JavaScript code of extensions for the whole Render
+// Process. Scripts are compiled without being bound to a context, so a single
+// compilation can be run in every frame that uses the extension instead of
+// parsing and compiling the same source again for each new script context.
+//
+// Nothing compiled is shared with other processes: data produced by a Render
+// Process can't be trusted by another one.
+class XWalkExtensionScriptCache {
+ public:
+  static XWalkExtensionScriptCache* GetInstance();
+
+  // Returns the compiled script for |source|, compiling it only the first
+  // time. The |key| identifies |source| for the whole life of the process,
+  // it must never be used for a different source. In case of compilation
+  // error, returns an empty handle and fills |error|. Must be called with a
+  // context entered.
+  v8::Handle<v8::Script> GetScript(const std::string& key,
+                                   const std::string& source,
+                                   std::string* error);
+
+  // When disabled, scripts are compiled every time GetScript() is called.
+  void set_enabled(bool enabled) { enabled_ = enabled; }
+  bool enabled() const { return enabled_; }
+
+  size_t hits() const { return hits_; }
+  size_t misses() const { return misses_; }
+
+ private:
+  friend struct base::DefaultLazyInstanceTraits<XWalkExtensionScriptCache>;
+
+  XWalkExtensionScriptCache();
+  ~XWalkExtensionScriptCache();
+
+  v8::Local<v8::Script> Compile(const std::string& source,
+                                std::string* error);
+
+  bool enabled_;
+  size_t hits_;
+  size_t misses_;
+
+  typedef std::map<std::string, linked_ptr<v8::Persistent<v8::Script> > >
+      ScriptMap;
+  ScriptMap scripts_;
+
+  DISALLOW_COPY_AND_ASSIGN(XWalkExtensionScriptCache);
+};
+
+}  // namespace extensions
+}  // namespace xwalk
+
+#endif  // XWALK_EXTENSIONS_RENDERER_XWALK_EXTENSION_SCRIPT_CACHE_H_
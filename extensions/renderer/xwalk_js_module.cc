@@ -5,8 +5,10 @@
 #include "xwalk/extensions/renderer/xwalk_js_module.h"
 
 #include "base/logging.h"
+#include "base/strings/stringprintf.h"
 #include "third_party/WebKit/public/web/WebScopedMicrotaskSuppression.h"
 #include "ui/base/resource/resource_bundle.h"
+#include "xwalk/extensions/renderer/xwalk_extension_script_cache.h"
 #include "xwalk/extensions/renderer/xwalk_v8_utils.h"
 
 namespace xwalk {
@@ -16,32 +18,34 @@ scoped_ptr<XWalkNativeModule> CreateJSModuleFromResource(int resource_id) {
   std::string js_api(
       ResourceBundle::GetSharedInstance().GetRawDataResource(
           resource_id).as_string());
-  scoped_ptr<XWalkNativeModule> module(new XWalkJSModule(js_api));
+  scoped_ptr<XWalkNativeModule> module(new XWalkJSModule(
+      base::StringPrintf("resource_%d", resource_id), js_api));
   return module.Pass();
 }
 
-XWalkJSModule::XWalkJSModule(const std::string& js_code)
-    : js_code_(js_code) {
+XWalkJSModule::XWalkJSModule(const std::string& name,
+                             const std::string& js_code)
+    : name_(name),
+      wrapped_js_code_(
+          "'use strict'; (function() { var exports = {}; (function(exports) {"
+          + js_code + "})(exports); return exports; })()") {
 }
 
 XWalkJSModule::~XWalkJSModule() {
-  compiled_script_.Reset();
 }
 
 v8::Handle<v8::Object> XWalkJSModule::NewInstance() {
   v8::Isolate* isolate = v8::Isolate::GetCurrent();
   v8::EscapableHandleScope handle_scope(isolate);
 
-  if (compiled_script_.IsEmpty()) {
-    std::string compilation_error;
-    if (!Compile(isolate, &compilation_error)) {
-      LOG(WARNING) << "Error compiling JS module: " << compilation_error;
-      return handle_scope.Escape(v8::Local<v8::Object>());
-    }
-  }
-
+  std::string compilation_error;
   v8::Handle<v8::Script> script =
-      v8::Handle<v8::Script>::New(isolate, compiled_script_);
+      XWalkExtensionScriptCache::GetInstance()->GetScript(
+          name_, wrapped_js_code_, &compilation_error);
+  if (script.IsEmpty()) {
+    LOG(WARNING) << "Error compiling JS module: " << compilation_error;
+    return handle_scope.Escape(v8::Local<v8::Object>());
+  }
 
   WebKit::WebScopedMicrotaskSuppression suppression;
   v8::TryCatch try_catch;
@@ -55,25 +59,5 @@ v8::Handle<v8::Object> XWalkJSModule::NewInstance() {
   return handle_scope.Escape(result.As<v8::Object>());
 }
 
-bool XWalkJSModule::Compile(v8::Isolate* isolate, std::string* error) {
-  std::string wrapped_js_code =
-      "'use strict'; (function() { var exports = {}; (function(exports) {"
-      + js_code_ + "})(exports); return exports; })()";
-
-  v8::Handle<v8::String> v8_code(
-      v8::String::NewFromUtf8(isolate, wrapped_js_code.c_str()));
-
-  WebKit::WebScopedMicrotaskSuppression suppression;
-  v8::TryCatch try_catch;
-  v8::Handle<v8::Script> script(v8::Script::New(v8_code, v8::String::Empty()));
-  if (try_catch.HasCaught()) {
-    *error = "Error compiling JS module: " + ExceptionToString(try_catch);
-    return false;
-  }
-
-  compiled_script_.Reset(v8::Isolate::GetCurrent(), script);
-  return true;
-}
-
 }  // namespace extensions
 }  // namespace xwalk
@@ -20,17 +20,17 @@ scoped_ptr<XWalkNativeModule> CreateJSModuleFromResource(int resource_id);
 // should be filled with functions and properties that the module will export.
 class XWalkJSModule : public XWalkNativeModule {
  public:
-  explicit XWalkJSModule(const std::string& js_code);
+  // The |name| identifies the code in the XWalkExtensionScriptCache, it must
+  // not be used by a module with a different code.
+  XWalkJSModule(const std::string& name, const std::string& js_code);
   virtual ~XWalkJSModule();
 
  private:
   // XWalkNativeModule implementation.
   virtual v8::Handle<v8::Object> NewInstance() OVERRIDE;
 
-  bool Compile(v8::Isolate* isolate, std::string* error);
-
-  std::string js_code_;
-  v8::Persistent<v8::Script> compiled_script_;
+  std::string name_;
+  std::string wrapped_js_code_;
 };
 
 }  // namespace extensions
@@ -272,9 +272,16 @@ bool XWalkModuleSystem::InstallTrampoline(v8::Handle<v8::Context> context,
     return false;
   }
 
+  return InstallEntryPointsTrampolines(context, entry);
+}
+
+bool XWalkModuleSystem::InstallEntryPointsTrampolines(
+    v8::Handle<v8::Context> context, ExtensionModuleEntry* entry) {
+  v8::Local<v8::External> entry_ptr = v8::External::New(entry);
+
   std::vector<std::string>::const_iterator it = entry->entry_points.begin();
   for (; it != entry->entry_points.end(); ++it) {
-    ret = SetTrampolineAccessorForEntryPoint(context, *it, entry_ptr);
+    bool ret = SetTrampolineAccessorForEntryPoint(context, *it, entry_ptr);
     if (!ret) {
       // TODO(vcgomes): Remove already added trampolines when it fails.
       LOG(WARNING) << "Error installing trampoline for '"
@@ -286,6 +293,42 @@ bool XWalkModuleSystem::InstallTrampoline(v8::Handle<v8::Context> context,
   return true;
 }
 
+void XWalkModuleSystem::InstallChildrenTrampolines(
+    v8::Handle<v8::Context> context, ExtensionModuleEntry* parent) {
+  ExtensionModules::iterator it = extension_modules_.begin();
+  for (; it != extension_modules_.end(); ++it) {
+    if (it->parent != parent || it->loaded)
+      continue;
+
+    v8::Local<v8::External> entry_ptr = v8::External::New(&*it);
+    if (!SetTrampolineAccessorForEntryPoint(context, it->name, entry_ptr))
+      LoadExtensionModule(context, &*it);
+  }
+}
+
+void XWalkModuleSystem::LoadExtensionModule(v8::Handle<v8::Context> context,
+                                            ExtensionModuleEntry* entry) {
+  if (entry->loaded)
+    return;
+
+  // Mark first, so trampolines triggered while running the code (e.g. for
+  // the parent namespace) won't try to load this module again.
+  entry->loaded = true;
+
+  DeleteAccessorForEntryPoint(context, entry->name);
+  std::vector<std::string>::const_iterator it = entry->entry_points.begin();
+  for (; it != entry->entry_points.end(); ++it)
+    DeleteAccessorForEntryPoint(context, *it);
+
+  v8::Handle<v8::FunctionTemplate> require_native_template =
+      v8::Handle<v8::FunctionTemplate>::New(context->GetIsolate(),
+                                            require_native_template_);
+  entry->module->LoadExtensionCode(context,
+                                   require_native_template->GetFunction());
+
+  InstallChildrenTrampolines(context, entry);
+}
+
 v8::Handle<v8::Object> XWalkModuleSystem::RequireNative(
     const std::string& name) {
   NativeModuleMap::iterator it = native_modules_.find(name);
@@ -299,21 +342,41 @@ void XWalkModuleSystem::Initialize() {
   v8::HandleScope handle_scope(isolate);
 
   v8::Handle<v8::Context> context = GetV8Context();
-  v8::Handle<v8::FunctionTemplate> require_native_template =
-      v8::Handle<v8::FunctionTemplate>::New(isolate, require_native_template_);
-  v8::Handle<v8::Function> require_native =
-      require_native_template->GetFunction();
 
-  MarkModulesWithTrampoline();
+  SetParentModules();
 
+  // No JS API code runs here, every extension is loaded when one of its
+  // entry points is first accessed. Extensions nested in the namespace of
+  // another one get their trampolines once the parent is loaded, see
+  // InstallChildrenTrampolines().
   ExtensionModules::iterator it = extension_modules_.begin();
   for (; it != extension_modules_.end(); ++it) {
-    if (it->use_trampoline && InstallTrampoline(context, &*it))
+    if (it->loaded)
       continue;
-    it->module->LoadExtensionCode(context, require_native);
+    if (it->parent) {
+      if (!InstallEntryPointsTrampolines(context, &*it))
+        LoadExtensionModule(context, &*it);
+      continue;
+    }
+    if (!InstallTrampoline(context, &*it))
+      LoadExtensionModule(context, &*it);
   }
 }
 
+XWalkModuleSystem::ExtensionModuleStats
+XWalkModuleSystem::GetExtensionModuleStats() const {
+  ExtensionModuleStats stats;
+  ExtensionModules::const_iterator it = extension_modules_.begin();
+  for (; it != extension_modules_.end(); ++it) {
+    stats.registered++;
+    if (it->loaded)
+      stats.loaded++;
+    if (it->module->has_instance())
+      stats.instances++;
+  }
+  return stats;
+}
+
 v8::Handle<v8::Context> XWalkModuleSystem::GetV8Context() {
   return v8::Handle<v8::Context>::New(v8::Isolate::GetCurrent(), v8_context_);
 }
@@ -355,22 +418,8 @@ void XWalkModuleSystem::TrampolineCallback(
   v8::Isolate* isolate = info.GetIsolate();
   v8::Handle<v8::Context> context = isolate->GetCurrentContext();
 
-  DeleteAccessorForEntryPoint(context, entry->name);
-
-  std::vector<std::string>::const_iterator it = entry->entry_points.begin();
-  for (; it != entry->entry_points.end(); ++it) {
-    DeleteAccessorForEntryPoint(context, *it);
-  }
-
   XWalkModuleSystem* module_system = GetModuleSystemFromContext(context);
-  v8::Handle<v8::FunctionTemplate> require_native_template =
-        v8::Handle<v8::FunctionTemplate>::New(
-            isolate,
-            module_system->require_native_template_);
-
-  XWalkExtensionModule* module = entry->module;
-  module->LoadExtensionCode(module_system->GetV8Context(),
-                            require_native_template->GetFunction());
+  module_system->LoadExtensionModule(module_system->GetV8Context(), entry);
 
   v8::Handle<v8::Object> holder = info.Holder();
   info.GetReturnValue().Set(holder->Get(property));
@@ -380,8 +429,8 @@ XWalkModuleSystem::ExtensionModuleEntry::ExtensionModuleEntry(
   const std::string& name,
   XWalkExtensionModule* module,
   const std::vector<std::string>& entry_points) :
-    name(name), module(module), use_trampoline(true),
-    entry_points(entry_points) {
+    name(name), module(module), entry_points(entry_points), parent(NULL),
+    loaded(false) {
 }
 
 XWalkModuleSystem::ExtensionModuleEntry::~ExtensionModuleEntry() {
@@ -398,25 +447,23 @@ bool XWalkModuleSystem::ExtensionModuleEntry::IsPrefix(
       && std::mismatch(p.begin(), p.end(), s.begin()).first == p.end();
 }
 
-// Mark the extension modules that we want to setup "trampolines"
-// instead of loading the code directly. The current algorithm is very
-// simple: we only create trampolines for extensions that are leaves
-// in the namespace tree.
+// Find the parent of each extension module, that is the closest extension
+// whose name is a prefix of the module's name.
 //
-// For example, if there are two extensions "tizen" and "tizen.time",
-// the first one won't be marked with trampoline, but the second one
-// will. So we'll only load code for "tizen" extension.
-void XWalkModuleSystem::MarkModulesWithTrampoline() {
+// For example, if there are extensions "tizen", "tizen.time" and
+// "tizen.time.zone", "tizen" is the parent of "tizen.time" that is the parent
+// of "tizen.time.zone". Sorting guarantees that parents come first, and that
+// the closest one is the last prefix found.
+void XWalkModuleSystem::SetParentModules() {
   std::sort(extension_modules_.begin(), extension_modules_.end());
 
-  ExtensionModules::iterator it = extension_modules_.begin();
-  while (it != extension_modules_.end()) {
-    it = std::adjacent_find(it, extension_modules_.end(),
-                            &ExtensionModuleEntry::IsPrefix);
-    if (it == extension_modules_.end())
-      break;
-    it->use_trampoline = false;
-    ++it;
+  for (size_t i = 0; i < extension_modules_.size(); ++i) {
+    ExtensionModuleEntry& entry = extension_modules_[i];
+    entry.parent = NULL;
+    for (size_t j = 0; j < i; ++j) {
+      if (ExtensionModuleEntry::IsPrefix(extension_modules_[j], entry))
+        entry.parent = &extension_modules_[j];
+    }
   }
 }
 
@@ -57,6 +57,17 @@ class XWalkModuleSystem {
 
   v8::Handle<v8::Context> GetV8Context();
 
+  // Counters for the extension modules of this context, used to measure how
+  // much work the lazy loading saves.
+  struct ExtensionModuleStats {
+    ExtensionModuleStats() : registered(0), loaded(0), instances(0) {}
+    int registered;
+    int loaded;
+    int instances;
+  };
+
+  ExtensionModuleStats GetExtensionModuleStats() const;
+
  private:
   struct ExtensionModuleEntry {
     ExtensionModuleEntry(const std::string& name, XWalkExtensionModule* module,
@@ -64,8 +75,14 @@ class XWalkModuleSystem {
     ~ExtensionModuleEntry();
     std::string name;
     XWalkExtensionModule* module;
-    bool use_trampoline;
     std::vector<std::string> entry_points;
+
+    // Closest extension whose name is a prefix of this one's. Its JS API
+    // code replaces the namespace object, so the trampoline for this
+    // extension can only be installed after the parent is loaded.
+    ExtensionModuleEntry* parent;
+    bool loaded;
+
     bool operator<(const ExtensionModuleEntry& other) const {
       return name < other.name;
     }
@@ -84,13 +101,21 @@ class XWalkModuleSystem {
 
   bool InstallTrampoline(v8::Handle<v8::Context> context,
                          ExtensionModuleEntry* entry);
+  bool InstallEntryPointsTrampolines(v8::Handle<v8::Context> context,
+                                     ExtensionModuleEntry* entry);
+  void InstallChildrenTrampolines(v8::Handle<v8::Context> context,
+                                  ExtensionModuleEntry* parent);
+
+  // Runs the JS API code of the extension, if it wasn't loaded yet.
+  void LoadExtensionModule(v8::Handle<v8::Context> context,
+                           ExtensionModuleEntry* entry);
 
   static void TrampolineCallback(
       v8::Local<v8::String> property,
       const v8::PropertyCallbackInfo<v8::Value>& info);
 
   bool ContainsEntryPoint(const std::string& entry_point);
-  void MarkModulesWithTrampoline();
+  void SetParentModules();
   void DeleteExtensionModules();
 
   typedef std::vector<ExtensionModuleEntry> ExtensionModules;
@@ -0,0 +1,187 @@
+// Copyright (c) 2013 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "xwalk/extensions/renderer/xwalk_v8_value_serializer.h"
+
+#include <vector>
+#include "base/basictypes.h"
+#include "base/memory/scoped_ptr.h"
+#include "third_party/WebKit/public/web/WebArrayBuffer.h"
+#include "third_party/WebKit/public/web/WebArrayBufferView.h"
+#include "xwalk/extensions/common/xwalk_serialized_value.h"
+
+namespace xwalk {
+namespace extensions {
+
+namespace {
+
+// Same limit as content::V8ValueConverter.
+const size_t kMaxDepth = 100;
+
+class V8ValueSerializer {
+ public:
+  explicit V8ValueSerializer(XWalkSerializedValueWriter* writer)
+      : writer_(writer) {}
+
+  // Returns false if |value| can't be serialized, nothing is written then.
+  bool Write(v8::Handle<v8::Value> value);
+
+ private:
+  void WriteString(v8::Handle<v8::String> value);
+  bool WriteBinary(v8::Handle<v8::Value> value);
+  void WriteList(v8::Handle<v8::Array> array);
+  void WriteDictionary(v8::Handle<v8::Object> object);
+  bool IsBeingWritten(v8::Handle<v8::Object> object) const;
+
+  XWalkSerializedValueWriter* writer_;
+
+  // Objects from the top level value to the one being written, used to detect
+  // cycles.
+  std::vector<v8::Handle<v8::Object> > path_;
+
+  DISALLOW_COPY_AND_ASSIGN(V8ValueSerializer);
+};
+
+bool V8ValueSerializer::Write(v8::Handle<v8::Value> value) {
+  if (value.IsEmpty() || value->IsUndefined() || value->IsFunction())
+    return false;
+
+  if (value->IsNull()) {
+    writer_->WriteNull();
+    return true;
+  }
+
+  if (value->IsBoolean()) {
+    writer_->WriteBoolean(value->BooleanValue());
+    return true;
+  }
+
+  if (value->IsInt32()) {
+    writer_->WriteInteger(value->Int32Value());
+    return true;
+  }
+
+  if (value->IsNumber()) {
+    writer_->WriteDouble(value->NumberValue());
+    return true;
+  }
+
+  if (value->IsString()) {
+    WriteString(value.As<v8::String>());
+    return true;
+  }
+
+  if (!value->IsObject())
+    return false;
+
+  if (value->IsArrayBuffer() || value->IsArrayBufferView())
+    return WriteBinary(value);
+
+  v8::Handle<v8::Object> object = value.As<v8::Object>();
+  if (path_.size() >= kMaxDepth || IsBeingWritten(object))
+    return false;
+
+  path_.push_back(object);
+  if (value->IsArray())
+    WriteList(value.As<v8::Array>());
+  else
+    WriteDictionary(object);
+  path_.pop_back();
+  return true;
+}
+
+// The UTF-8 bytes are written directly into the serialized value.
+void V8ValueSerializer::WriteString(v8::Handle<v8::String> value) {
+  int length = value->Utf8Length();
+  char* buffer = writer_->WriteStringBuffer(length);
+  if (length)
+    value->WriteUtf8(buffer, length, NULL, v8::String::NO_NULL_TERMINATION);
+}
+
+bool V8ValueSerializer::WriteBinary(v8::Handle<v8::Value> value) {
+  scoped_ptr<WebKit::WebArrayBuffer> buffer(
+      WebKit::WebArrayBuffer::createFromV8Value(value));
+  if (buffer) {
+    writer_->WriteBinary(buffer->data(), buffer->byteLength());
+    return true;
+  }
+
+  scoped_ptr<WebKit::WebArrayBufferView> view(
+      WebKit::WebArrayBufferView::createFromV8Value(value));
+  if (view) {
+    writer_->WriteBinary(
+        static_cast<const char*>(view->baseAddress()) + view->byteOffset(),
+        view->byteLength());
+    return true;
+  }
+
+  return false;
+}
+
+void V8ValueSerializer::WriteList(v8::Handle<v8::Array> array) {
+  size_t begin = writer_->BeginList();
+  uint32_t length = array->Length();
+  for (uint32_t i = 0; i < length; ++i) {
+    // Getters can throw, the element becomes null then.
+    v8::TryCatch try_catch;
+    v8::Handle<v8::Value> element = array->Get(i);
+    if (try_catch.HasCaught() || !Write(element))
+      writer_->WriteNull();
+  }
+  writer_->EndList(begin, length);
+}
+
+void V8ValueSerializer::WriteDictionary(v8::Handle<v8::Object> object) {
+  size_t begin = writer_->BeginDictionary();
+  size_t size = 0;
+
+  v8::Handle<v8::Array> names = object->GetOwnPropertyNames();
+  uint32_t length = names->Length();
+  for (uint32_t i = 0; i < length; ++i) {
+    v8::Handle<v8::Value> name = names->Get(i);
+    if (!name->IsString() && !name->IsNumber())
+      continue;
+
+    v8::TryCatch try_catch;
+    v8::Handle<v8::Value> element = object->Get(name);
+    if (try_catch.HasCaught())
+      continue;
+
+    // The key is written before knowing if the element can be serialized, and
+    // discarded otherwise.
+    size_t key_offset = writer_->offset();
+    v8::Handle<v8::String> key = name->ToString();
+    int key_length = key->Utf8Length();
+    char* buffer = writer_->WriteKeyBuffer(key_length);
+    if (key_length)
+      key->WriteUtf8(buffer, key_length, NULL, v8::String::NO_NULL_TERMINATION);
+
+    if (Write(element))
+      ++size;
+    else
+      writer_->Rewind(key_offset);
+  }
+
+  writer_->EndDictionary(begin, size);
+}
+
+bool V8ValueSerializer::IsBeingWritten(v8::Handle<v8::Object> object) const {
+  for (size_t i = 0; i < path_.size(); ++i) {
+    if (path_[i] == object)
+      return true;
+  }
+  return false;
+}
+
+}  // namespace
+
+void SerializeV8Value(v8::Handle<v8::Value> value,
+                      XWalkSerializedValueWriter* writer) {
+  V8ValueSerializer serializer(writer);
+  if (!serializer.Write(value))
+    writer->WriteNull();
+}
+
+}  // namespace extensions
+}  // namespace xwalk
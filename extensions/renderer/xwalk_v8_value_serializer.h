@@ -0,0 +1,26 @@
+// Copyright (c) 2013 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef XWALK_EXTENSIONS_RENDERER_XWALK_V8_VALUE_SERIALIZER_H_
+#define XWALK_EXTENSIONS_RENDERER_XWALK_V8_VALUE_SERIALIZER_H_
+
+#include "v8/include/v8.h"
+
+namespace xwalk {
+namespace extensions {
+
+class XWalkSerializedValueWriter;
+
+// Writes |value| into |writer| without creating intermediate base::Values.
+// Follows the same rules as content::V8ValueConverter: functions, undefined
+// values and cyclic references are dropped from objects and become null in
+// arrays, and ArrayBuffers and their views become binary values. Must be
+// called inside a HandleScope.
+void SerializeV8Value(v8::Handle<v8::Value> value,
+                      XWalkSerializedValueWriter* writer);
+
+}  // namespace extensions
+}  // namespace xwalk
+
+#endif  // XWALK_EXTENSIONS_RENDERER_XWALK_V8_VALUE_SERIALIZER_H_
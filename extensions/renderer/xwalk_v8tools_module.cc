@@ -112,6 +112,29 @@ void GetWindowObject(const v8::FunctionCallbackInfo<v8::Value>& args) {
   args.GetReturnValue().Set(window);
 }
 
+// Returns the counters of extension modules for the current context, see
+// XWalkModuleSystem::GetExtensionModuleStats().
+void GetExtensionModuleStats(const v8::FunctionCallbackInfo<v8::Value>& info) {
+  v8::Isolate* isolate = info.GetIsolate();
+  XWalkModuleSystem* module_system =
+      XWalkModuleSystem::GetModuleSystemFromContext(
+          isolate->GetCurrentContext());
+  if (!module_system)
+    return;
+
+  XWalkModuleSystem::ExtensionModuleStats stats =
+      module_system->GetExtensionModuleStats();
+
+  v8::Handle<v8::Object> result = v8::Object::New();
+  result->Set(v8::String::NewFromUtf8(isolate, "registered"),
+              v8::Integer::New(stats.registered));
+  result->Set(v8::String::NewFromUtf8(isolate, "loaded"),
+              v8::Integer::New(stats.loaded));
+  result->Set(v8::String::NewFromUtf8(isolate, "instances"),
+              v8::Integer::New(stats.instances));
+  info.GetReturnValue().Set(result);
+}
+
 }  // namespace
 
 XWalkV8ToolsModule::XWalkV8ToolsModule() {
@@ -129,6 +152,10 @@ XWalkV8ToolsModule::XWalkV8ToolsModule() {
   object_template->Set(v8::String::NewFromUtf8(isolate, "getWindowObject"),
                        v8::FunctionTemplate::New(GetWindowObject));
 
+  object_template->Set(
+      v8::String::NewFromUtf8(isolate, "getExtensionModuleStats"),
+      v8::FunctionTemplate::New(GetExtensionModuleStats));
+
   object_template_.Reset(isolate, object_template);
 }
 
@@ -9,12 +9,14 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include "xwalk/extensions/public/XW_Extension.h"
+#include "xwalk/extensions/public/XW_Extension_Request.h"
 #include "xwalk/extensions/public/XW_Extension_SyncMessage.h"
 
 XW_Extension g_extension = 0;
 const XW_CoreInterface* g_core = NULL;
 const XW_MessagingInterface* g_messaging = NULL;
 const XW_Internal_SyncMessagingInterface* g_sync_messaging = NULL;
+const XW_RequestInterface* g_request = NULL;
 
 void crash() {
   int* die_sweetie_die = NULL;
@@ -37,6 +39,11 @@ void handle_sync_message(XW_Instance instance, const char* message) {
   crash();
 }
 
+void handle_request(XW_Instance instance, XW_Request request,
+                    const char* message) {
+  crash();
+}
+
 void shutdown(XW_Extension extension) {
 }
 
@@ -54,6 +61,9 @@ int32_t XW_Initialize(XW_Extension extension, XW_GetInterface get_interface) {
       "};"
       "exports.syncDie = function(msg) {"
       "  return extension.internal.sendSyncMessage(msg);"
+      "};"
+      "exports.requestDie = function(msg, callback) {"
+      "  extension.sendRequest(msg, callback);"
       "};";
 
   g_extension = extension;
@@ -70,5 +80,8 @@ int32_t XW_Initialize(XW_Extension extension, XW_GetInterface get_interface) {
   g_sync_messaging = get_interface(XW_INTERNAL_SYNC_MESSAGING_INTERFACE);
   g_sync_messaging->Register(extension, handle_sync_message);
 
+  g_request = get_interface(XW_REQUEST_INTERFACE);
+  g_request->Register(extension, handle_request);
+
   return XW_OK;
 }
@@ -40,3 +40,22 @@ IN_PROC_BROWSER_TEST_F(CrashExtensionTest, CrashExtensionProcessKeepBPAlive) {
 
   EXPECT_EQ(kPassString, title_watcher.WaitAndGetTitle());
 }
+
+// Requests pending when the extension process dies are failed, their
+// callbacks would never be called otherwise.
+IN_PROC_BROWSER_TEST_F(CrashExtensionTest, CrashFailsPendingRequests) {
+  CommandLine* cmd_line = CommandLine::ForCurrentProcess();
+  if (cmd_line->HasSwitch(switches::kXWalkDisableExtensionProcess)) {
+    LOG(INFO) << "--disable-extension-process not supported by " \
+                 "CrashFailsPendingRequests. Skipping test.";
+    return;
+  }
+
+  GURL url = GetExtensionsTestURL(
+      base::FilePath(), base::FilePath().AppendASCII("crash_request.html"));
+  content::TitleWatcher title_watcher(runtime()->web_contents(), kPassString);
+  title_watcher.AlsoWaitForTitle(kFailString);
+
+  xwalk_test_utils::NavigateToURL(runtime(), url);
+  EXPECT_EQ(kPassString, title_watcher.WaitAndGetTitle());
+}
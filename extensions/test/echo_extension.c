@@ -8,13 +8,24 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "xwalk/extensions/public/XW_Extension.h"
 #include "xwalk/extensions/public/XW_Extension_SyncMessage.h"
+#include "xwalk/extensions/public/XW_Extension_BinaryMessage.h"
+#include "xwalk/extensions/public/XW_Extension_Request.h"
 
 XW_Extension g_extension = 0;
 const XW_CoreInterface* g_core = NULL;
 const XW_MessagingInterface* g_messaging = NULL;
 const XW_Internal_SyncMessagingInterface* g_sync_messaging = NULL;
+const XW_BinaryMessagingInterface* g_binary_messaging = NULL;
+const XW_RequestInterface* g_request = NULL;
+
+// A request kept pending until the next one arrives, so the responses are
+// sent out of order.
+XW_Instance g_deferred_instance = 0;
+XW_Request g_deferred_request = 0;
+char* g_deferred_message = NULL;
 
 void instance_created(XW_Instance instance) {
   printf("Instance %d created!\n", instance);
@@ -32,6 +43,31 @@ void handle_sync_message(XW_Instance instance, const char* message) {
   g_sync_messaging->SetSyncReply(instance, message);
 }
 
+void handle_binary_message(XW_Instance instance, const uint8_t* data,
+                           size_t size) {
+  g_binary_messaging->PostMessage(instance, data, size);
+}
+
+void handle_request(XW_Instance instance, XW_Request request,
+                    const char* message) {
+  // Never responded, used to test timeouts.
+  if (!strcmp(message, "never"))
+    return;
+
+  if (!g_deferred_message) {
+    g_deferred_instance = instance;
+    g_deferred_request = request;
+    g_deferred_message = strdup(message);
+    return;
+  }
+
+  g_request->Respond(instance, request, message);
+  g_request->Respond(g_deferred_instance, g_deferred_request,
+                     g_deferred_message);
+  free(g_deferred_message);
+  g_deferred_message = NULL;
+}
+
 void shutdown(XW_Extension extension) {
   printf("Shutdown\n");
 }
@@ -48,8 +84,15 @@ int32_t XW_Initialize(XW_Extension extension, XW_GetInterface get_interface) {
       "  echoListener = callback;"
       "  extension.postMessage(msg);"
       "};"
+      "exports.binaryEcho = function(buffer, callback) {"
+      "  echoListener = callback;"
+      "  extension.postMessage(buffer);"
+      "};"
       "exports.syncEcho = function(msg) {"
       "  return extension.internal.sendSyncMessage(msg);"
+      "};"
+      "exports.requestEcho = function(msg, callback, timeout) {"
+      "  extension.sendRequest(msg, callback, timeout);"
       "};";
 
   g_extension = extension;
@@ -66,5 +109,11 @@ int32_t XW_Initialize(XW_Extension extension, XW_GetInterface get_interface) {
   g_sync_messaging = get_interface(XW_INTERNAL_SYNC_MESSAGING_INTERFACE);
   g_sync_messaging->Register(extension, handle_sync_message);
 
+  g_binary_messaging = get_interface(XW_BINARY_MESSAGING_INTERFACE);
+  g_binary_messaging->Register(extension, handle_binary_message);
+
+  g_request = get_interface(XW_REQUEST_INTERFACE);
+  g_request->Register(extension, handle_request);
+
   return XW_OK;
 }
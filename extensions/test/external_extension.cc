@@ -2,16 +2,20 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+#include "base/command_line.h"
 #include "base/native_library.h"
 #include "base/path_service.h"
 #include "base/strings/utf_string_conversions.h"
 #include "xwalk/extensions/browser/xwalk_extension_service.h"
+#include "xwalk/extensions/common/xwalk_extension_switches.h"
 #include "xwalk/extensions/test/xwalk_extensions_test_base.h"
 #include "xwalk/runtime/browser/runtime.h"
 #include "xwalk/test/base/xwalk_test_utils.h"
+#include "content/public/browser/web_contents.h"
 #include "content/public/test/browser_test_utils.h"
 #include "content/public/test/test_utils.h"
 
+using xwalk::Runtime;
 using xwalk::extensions::XWalkExtensionService;
 
 class ExternalExtensionTest : public XWalkExtensionsTestBase {
@@ -23,6 +27,14 @@ class ExternalExtensionTest : public XWalkExtensionsTestBase {
   }
 };
 
+class SharedExtensionProcessTest : public ExternalExtensionTest {
+ public:
+  virtual void SetUpCommandLine(CommandLine* command_line) OVERRIDE {
+    ExternalExtensionTest::SetUpCommandLine(command_line);
+    command_line->AppendSwitch(switches::kXWalkSharedExtensionProcess);
+  }
+};
+
 class MultipleEntryPointsExtension : public XWalkExtensionsTestBase {
  public:
   virtual void SetUp() OVERRIDE {
@@ -67,6 +79,28 @@ IN_PROC_BROWSER_TEST_F(ExternalExtensionTest, ExternalExtensionSync) {
   EXPECT_EQ(kPassString, title_watcher.WaitAndGetTitle());
 }
 
+IN_PROC_BROWSER_TEST_F(ExternalExtensionTest, ExternalExtensionRequest) {
+  content::RunAllPendingInMessageLoop();
+  GURL url = GetExtensionsTestURL(
+      base::FilePath(),
+      base::FilePath().AppendASCII("request_echo.html"));
+  content::TitleWatcher title_watcher(runtime()->web_contents(), kPassString);
+  title_watcher.AlsoWaitForTitle(kFailString);
+  xwalk_test_utils::NavigateToURL(runtime(), url);
+  EXPECT_EQ(kPassString, title_watcher.WaitAndGetTitle());
+}
+
+IN_PROC_BROWSER_TEST_F(ExternalExtensionTest, ExternalExtensionBinary) {
+  content::RunAllPendingInMessageLoop();
+  GURL url = GetExtensionsTestURL(
+      base::FilePath(),
+      base::FilePath().AppendASCII("binary_echo.html"));
+  content::TitleWatcher title_watcher(runtime()->web_contents(), kPassString);
+  title_watcher.AlsoWaitForTitle(kFailString);
+  xwalk_test_utils::NavigateToURL(runtime(), url);
+  EXPECT_EQ(kPassString, title_watcher.WaitAndGetTitle());
+}
+
 IN_PROC_BROWSER_TEST_F(MultipleEntryPointsExtension,
                        DISABLED_MultipleEntryPoints) {
   content::RunAllPendingInMessageLoop();
@@ -78,3 +112,25 @@ IN_PROC_BROWSER_TEST_F(MultipleEntryPointsExtension,
   xwalk_test_utils::NavigateToURL(runtime(), url);
   EXPECT_EQ(kPassString, title_watcher.WaitAndGetTitle());
 }
+
+IN_PROC_BROWSER_TEST_F(SharedExtensionProcessTest, TwoRenderProcesses) {
+  content::RunAllPendingInMessageLoop();
+  GURL url = GetExtensionsTestURL(base::FilePath(),
+                                  base::FilePath().AppendASCII("echo.html"));
+  content::TitleWatcher title_watcher(runtime()->web_contents(), kPassString);
+  title_watcher.AlsoWaitForTitle(kFailString);
+  xwalk_test_utils::NavigateToURL(runtime(), url);
+  EXPECT_EQ(kPassString, title_watcher.WaitAndGetTitle());
+
+  // The second runtime gets its own render process, served by the same
+  // extension process.
+  Runtime* second = Runtime::CreateWithDefaultWindow(
+      runtime()->runtime_context(), GURL());
+  EXPECT_NE(runtime()->web_contents()->GetRenderProcessHost(),
+            second->web_contents()->GetRenderProcessHost());
+
+  content::TitleWatcher second_watcher(second->web_contents(), kPassString);
+  second_watcher.AlsoWaitForTitle(kFailString);
+  xwalk_test_utils::NavigateToURL(second, url);
+  EXPECT_EQ(kPassString, second_watcher.WaitAndGetTitle());
+}
@@ -2,6 +2,9 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+#include <string>
+
+#include "base/threading/sequenced_worker_pool.h"
 #include "content/public/browser/browser_thread.h"
 #include "content/public/test/browser_test_utils.h"
 #include "content/public/test/test_utils.h"
@@ -14,6 +17,7 @@ using namespace xwalk::extensions;  // NOLINT
 
 const char kInProcessExtensionThread[] = "in_process_extension_thread";
 const char kInProcessUIThread[] = "in_process_ui_thread";
+const char kInProcessConcurrent[] = "in_process_concurrent";
 
 class InProcessExtension;
 
@@ -31,7 +35,22 @@ class InProcessExtensionInstance : public XWalkExtensionInstance {
     return reply.PassAs<base::Value>();
   }
 
+  scoped_ptr<base::Value> IsRunningOnWorkerPool() {
+    bool is_on_worker_pool =
+        base::SequencedWorkerPool::GetSequenceTokenForCurrentThread().IsValid();
+
+    scoped_ptr<base::ListValue> reply(new base::ListValue);
+    reply->AppendBoolean(is_on_worker_pool);
+
+    return reply.PassAs<base::Value>();
+  }
+
   virtual void HandleMessage(scoped_ptr<base::Value> msg) OVERRIDE {
+    std::string query;
+    if (msg->GetAsString(&query) && query == "worker_pool") {
+      PostMessageToJS(IsRunningOnWorkerPool());
+      return;
+    }
     PostMessageToJS(InRunningOnUIThread());
   }
 
@@ -42,8 +61,9 @@ class InProcessExtensionInstance : public XWalkExtensionInstance {
 
 class InProcessExtension : public XWalkExtension {
  public:
-  explicit InProcessExtension(const char* name) {
+  explicit InProcessExtension(const char* name, bool concurrent = false) {
     set_name(name);
+    set_concurrent(concurrent);
     set_javascript_api(
       "var listener = null;"
       "extension.setMessageListener(function(msg) {"
@@ -53,6 +73,10 @@ class InProcessExtension : public XWalkExtension {
       "  listener = callback;"
       "  extension.postMessage('');"
       "};"
+      "exports.isExtensionRunningOnWorkerPool = function(callback) {"
+      "  listener = callback;"
+      "  extension.postMessage('worker_pool');"
+      "};"
       "exports.syncIsExtensionRunningOnUIThread = function() {"
       "  return extension.internal.sendSyncMessage('');"
       "};");
@@ -73,6 +97,7 @@ class InProcessThreadsTest : public XWalkExtensionsTestBase {
   virtual void CreateExtensionsForExtensionThread(
       XWalkExtensionVector* extensions) OVERRIDE {
     extensions->push_back(new InProcessExtension(kInProcessExtensionThread));
+    extensions->push_back(new InProcessExtension(kInProcessConcurrent, true));
   }
 };
 
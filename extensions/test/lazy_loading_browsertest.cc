@@ -0,0 +1,122 @@
+// Copyright (c) 2013 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/strings/stringprintf.h"
+#include "content/public/browser/web_contents.h"
+#include "content/public/test/browser_test_utils.h"
+#include "content/public/test/test_utils.h"
+#include "xwalk/extensions/common/xwalk_extension.h"
+#include "xwalk/extensions/test/xwalk_extensions_test_base.h"
+#include "xwalk/runtime/browser/runtime.h"
+#include "xwalk/test/base/xwalk_test_utils.h"
+
+using namespace xwalk::extensions;  // NOLINT
+
+namespace {
+
+const int kLazyExtensionsCount = 20;
+
+class LazyInstance : public XWalkExtensionInstance {
+ public:
+  virtual void HandleMessage(scoped_ptr<base::Value> msg) OVERRIDE {
+    PostMessageToJS(msg.Pass());
+  }
+};
+
+class LazyExtension : public XWalkExtension {
+ public:
+  explicit LazyExtension(int index) {
+    set_name(base::StringPrintf("lazy_%d", index));
+    set_javascript_api(
+        "var listener = null;"
+        "extension.setMessageListener(function(msg) {"
+        "  listener(msg);"
+        "});"
+        "exports.ping = function(callback) {"
+        "  listener = callback;"
+        "  extension.postMessage('pong');"
+        "};");
+  }
+
+  virtual XWalkExtensionInstance* CreateInstance() OVERRIDE {
+    return new LazyInstance;
+  }
+};
+
+// Exposes the counters of the module system to the test page.
+class ModuleStatsExtension : public XWalkExtension {
+ public:
+  ModuleStatsExtension() {
+    set_name("module_stats");
+    set_javascript_api(
+        "var v8tools = requireNative('v8tools');"
+        "exports.get = function() {"
+        "  return v8tools.getExtensionModuleStats();"
+        "};");
+  }
+
+  virtual XWalkExtensionInstance* CreateInstance() OVERRIDE {
+    return new LazyInstance;
+  }
+};
+
+}  // namespace
+
+class XWalkExtensionsLazyLoadingTest : public XWalkExtensionsTestBase {
+ public:
+  virtual void CreateExtensionsForUIThread(
+      XWalkExtensionVector* extensions) OVERRIDE {
+    for (int i = 0; i < kLazyExtensionsCount; ++i)
+      extensions->push_back(new LazyExtension(i));
+    extensions->push_back(new ModuleStatsExtension);
+  }
+};
+
+// Only the extensions touched by the page should have their JS API code run,
+// and only the ones that sent messages should have a native instance.
+IN_PROC_BROWSER_TEST_F(XWalkExtensionsLazyLoadingTest,
+                       OnlyUsedExtensionsAreLoaded) {
+  content::RunAllPendingInMessageLoop();
+  GURL url = GetExtensionsTestURL(base::FilePath(),
+      base::FilePath().AppendASCII("lazy_loading.html"));
+
+  content::TitleWatcher title_watcher(runtime()->web_contents(), kPassString);
+  title_watcher.AlsoWaitForTitle(kFailString);
+  xwalk_test_utils::NavigateToURL(runtime(), url);
+  EXPECT_EQ(kPassString, title_watcher.WaitAndGetTitle());
+
+  int registered = 0;
+  int loaded = 0;
+  int instances = 0;
+  content::WebContents* web_contents = runtime()->web_contents();
+  ASSERT_TRUE(content::ExecuteScriptAndExtractInt(web_contents,
+      "window.domAutomationController.send(stats.registered)", &registered));
+  ASSERT_TRUE(content::ExecuteScriptAndExtractInt(web_contents,
+      "window.domAutomationController.send(stats.loaded)", &loaded));
+  ASSERT_TRUE(content::ExecuteScriptAndExtractInt(web_contents,
+      "window.domAutomationController.send(stats.instances)", &instances));
+
+  EXPECT_EQ(kLazyExtensionsCount + 1, registered);
+  EXPECT_EQ(2, loaded);
+  EXPECT_EQ(1, instances);
+}
+
+// Setting a message listener doesn't create the instance, the first message
+// sent does. The listener set before gets the replies.
+IN_PROC_BROWSER_TEST_F(XWalkExtensionsLazyLoadingTest,
+                       ListenerDoesNotCreateInstance) {
+  content::RunAllPendingInMessageLoop();
+  GURL url = GetExtensionsTestURL(base::FilePath(),
+      base::FilePath().AppendASCII("lazy_instance.html"));
+
+  content::TitleWatcher title_watcher(runtime()->web_contents(), kPassString);
+  title_watcher.AlsoWaitForTitle(kFailString);
+  xwalk_test_utils::NavigateToURL(runtime(), url);
+  EXPECT_EQ(kPassString, title_watcher.WaitAndGetTitle());
+
+  int instances = 0;
+  ASSERT_TRUE(content::ExecuteScriptAndExtractInt(runtime()->web_contents(),
+      "window.domAutomationController.send(stats.instances)", &instances));
+  EXPECT_EQ(1, instances);
+}
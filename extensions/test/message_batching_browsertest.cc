@@ -0,0 +1,121 @@
+// Copyright (c) 2013 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/atomicops.h"
+#include "base/bind.h"
+#include "base/command_line.h"
+#include "base/message_loop/message_loop.h"
+#include "content/public/test/browser_test_utils.h"
+#include "content/public/test/test_utils.h"
+#include "xwalk/extensions/common/xwalk_extension.h"
+#include "xwalk/extensions/common/xwalk_extension_message_batch.h"
+#include "xwalk/extensions/common/xwalk_extension_switches.h"
+#include "xwalk/extensions/test/xwalk_extensions_test_base.h"
+#include "xwalk/runtime/browser/runtime.h"
+#include "xwalk/test/base/xwalk_test_utils.h"
+
+using namespace xwalk::extensions;  // NOLINT
+
+namespace {
+
+// The number of messages posted by message_throughput.html.
+const int kPostedMessages = 20000;
+
+// The number of tasks of the extension thread that handled messages, each
+// IPC message being dispatched by a task of its own.
+base::subtle::Atomic32 g_dispatch_tasks = 0;
+
+class ThroughputEchoInstance : public XWalkExtensionInstance {
+ public:
+  ThroughputEchoInstance() : is_in_dispatch_task_(false) {}
+
+  virtual void HandleMessage(scoped_ptr<base::Value> msg) OVERRIDE {
+    // The task posted runs once the messages of the current task are done.
+    if (!is_in_dispatch_task_) {
+      is_in_dispatch_task_ = true;
+      base::subtle::NoBarrier_AtomicIncrement(&g_dispatch_tasks, 1);
+      base::MessageLoop::current()->PostTask(FROM_HERE,
+          base::Bind(&ThroughputEchoInstance::EndDispatchTask,
+                     base::Unretained(this)));
+    }
+    PostMessageToJS(msg.Pass());
+  }
+
+ private:
+  void EndDispatchTask() { is_in_dispatch_task_ = false; }
+
+  bool is_in_dispatch_task_;
+};
+
+class ThroughputEchoExtension : public XWalkExtension {
+ public:
+  ThroughputEchoExtension() {
+    set_name("throughput");
+    set_javascript_api(
+        "var listener = null;"
+        "extension.setMessageListener(function(msg) {"
+        "  listener(msg);"
+        "});"
+        "exports.setListener = function(callback) {"
+        "  listener = callback;"
+        "};"
+        "exports.post = function(msg) {"
+        "  extension.postMessage(msg);"
+        "};");
+  }
+
+  virtual XWalkExtensionInstance* CreateInstance() OVERRIDE {
+    return new ThroughputEchoInstance;
+  }
+};
+
+}  // namespace
+
+// Posts messages to an extension running in the extension thread, which
+// echoes them back. The batched variant enables message coalescing.
+class MessageThroughputTest : public XWalkExtensionsTestBase {
+ public:
+  virtual void CreateExtensionsForExtensionThread(
+      XWalkExtensionVector* extensions) OVERRIDE {
+    extensions->push_back(new ThroughputEchoExtension);
+  }
+
+  // The page checks that the messages come back in the order they were
+  // posted.
+  void RunThroughputPage() {
+    content::RunAllPendingInMessageLoop();
+
+    content::TitleWatcher title_watcher(runtime()->web_contents(),
+                                        kPassString);
+    title_watcher.AlsoWaitForTitle(kFailString);
+
+    GURL url = GetExtensionsTestURL(base::FilePath(),
+        base::FilePath().AppendASCII("message_throughput.html"));
+    xwalk_test_utils::NavigateToURL(runtime(), url);
+    EXPECT_EQ(kPassString, title_watcher.WaitAndGetTitle());
+  }
+};
+
+class BatchedMessageThroughputTest : public MessageThroughputTest {
+ public:
+  virtual void SetUpCommandLine(CommandLine* command_line) OVERRIDE {
+    MessageThroughputTest::SetUpCommandLine(command_line);
+    command_line->AppendSwitch(switches::kXWalkExtensionMessageBatching);
+  }
+};
+
+// Each message comes in an IPC message of its own.
+IN_PROC_BROWSER_TEST_F(MessageThroughputTest, MessagesNotBatched) {
+  RunThroughputPage();
+  EXPECT_GT(base::subtle::Acquire_Load(&g_dispatch_tasks),
+            kPostedMessages / 2);
+}
+
+// The messages posted in a row come in full batches.
+IN_PROC_BROWSER_TEST_F(BatchedMessageThroughputTest, MessagesKeepTheirOrder) {
+  RunThroughputPage();
+  const int kMaxBatches =
+      kPostedMessages / XWalkExtensionMessageBatch::kMaxMessages + 1;
+  EXPECT_LE(base::subtle::Acquire_Load(&g_dispatch_tasks), kMaxBatches);
+}
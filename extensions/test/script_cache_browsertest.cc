@@ -0,0 +1,117 @@
+// Copyright (c) 2013 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/command_line.h"
+#include "base/strings/stringprintf.h"
+#include "content/public/common/content_switches.h"
+#include "content/public/test/browser_test_utils.h"
+#include "content/public/test/test_utils.h"
+#include "xwalk/extensions/common/xwalk_extension.h"
+#include "xwalk/extensions/common/xwalk_extension_switches.h"
+#include "xwalk/extensions/renderer/xwalk_extension_script_cache.h"
+#include "xwalk/extensions/test/xwalk_extensions_test_base.h"
+#include "xwalk/runtime/browser/runtime.h"
+#include "xwalk/test/base/xwalk_test_utils.h"
+
+using namespace xwalk::extensions;  // NOLINT
+
+namespace {
+
+const int kBigAPIFunctions = 500;
+
+// The number of frames loaded by script_cache.html, each using the extension.
+const size_t kScriptCacheFrames = 50;
+
+class BigAPIInstance : public XWalkExtensionInstance {
+ public:
+  virtual void HandleMessage(scoped_ptr<base::Value> msg) OVERRIDE {}
+};
+
+class BigAPIExtension : public XWalkExtension {
+ public:
+  BigAPIExtension() {
+    set_name("big_api");
+
+    // Enough code for its compilation to be noticeable in the context
+    // creation time. Each functionN(x) returns x + N.
+    std::string api;
+    for (int i = 0; i < kBigAPIFunctions; i++) {
+      api += base::StringPrintf(
+          "exports.function%d = function(x) {"
+          "  var values = [x, %d];"
+          "  var result = 0;"
+          "  for (var i = 0; i < values.length; i++) {"
+          "    if (typeof values[i] !== 'number')"
+          "      throw new TypeError('Expected a number');"
+          "    result += values[i];"
+          "  }"
+          "  return result;"
+          "};", i, i);
+    }
+    set_javascript_api(api);
+  }
+
+  virtual XWalkExtensionInstance* CreateInstance() OVERRIDE {
+    return new BigAPIInstance;
+  }
+};
+
+}  // namespace
+
+// Loads frames one after the other that use an extension with a big
+// JavaScript API. The renderer runs in the browser process so that the test
+// can check how often the API code was compiled.
+class ScriptCacheTest : public XWalkExtensionsTestBase {
+ public:
+  virtual void SetUpCommandLine(CommandLine* command_line) OVERRIDE {
+    XWalkExtensionsTestBase::SetUpCommandLine(command_line);
+    command_line->AppendSwitch(switches::kSingleProcess);
+  }
+
+  virtual void CreateExtensionsForUIThread(
+      XWalkExtensionVector* extensions) OVERRIDE {
+    extensions->push_back(new BigAPIExtension);
+  }
+
+  // The page checks that the API works in every frame.
+  void RunScriptCachePage() {
+    content::RunAllPendingInMessageLoop();
+
+    content::TitleWatcher title_watcher(runtime()->web_contents(),
+                                        kPassString);
+    title_watcher.AlsoWaitForTitle(kFailString);
+
+    GURL url = GetExtensionsTestURL(base::FilePath(),
+        base::FilePath().AppendASCII("script_cache.html"));
+    xwalk_test_utils::NavigateToURL(runtime(), url);
+    EXPECT_EQ(kPassString, title_watcher.WaitAndGetTitle());
+  }
+};
+
+class UncachedScriptTest : public ScriptCacheTest {
+ public:
+  virtual void SetUpCommandLine(CommandLine* command_line) OVERRIDE {
+    ScriptCacheTest::SetUpCommandLine(command_line);
+    command_line->AppendSwitch(switches::kXWalkDisableExtensionScriptCache);
+  }
+};
+
+// The API code is compiled for the first frame only, the others run the
+// cached script.
+IN_PROC_BROWSER_TEST_F(ScriptCacheTest, CachedScriptInEveryContext) {
+  XWalkExtensionScriptCache* cache = XWalkExtensionScriptCache::GetInstance();
+  size_t hits = cache->hits();
+  size_t misses = cache->misses();
+  RunScriptCachePage();
+  EXPECT_EQ(kScriptCacheFrames - 1, cache->hits() - hits);
+  EXPECT_EQ(1u, cache->misses() - misses);
+}
+
+IN_PROC_BROWSER_TEST_F(UncachedScriptTest, CompiledInEveryContext) {
+  XWalkExtensionScriptCache* cache = XWalkExtensionScriptCache::GetInstance();
+  RunScriptCachePage();
+  EXPECT_FALSE(cache->enabled());
+  EXPECT_EQ(0u, cache->hits());
+  EXPECT_EQ(0u, cache->misses());
+}
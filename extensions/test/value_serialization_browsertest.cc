@@ -0,0 +1,158 @@
+// Copyright (c) 2013 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/atomicops.h"
+#include "base/command_line.h"
+#include "content/public/test/browser_test_utils.h"
+#include "content/public/test/test_utils.h"
+#include "xwalk/extensions/common/xwalk_extension.h"
+#include "xwalk/extensions/common/xwalk_extension_switches.h"
+#include "xwalk/extensions/common/xwalk_serialized_value.h"
+#include "xwalk/extensions/test/xwalk_extensions_test_base.h"
+#include "xwalk/runtime/browser/runtime.h"
+#include "xwalk/test/base/xwalk_test_utils.h"
+
+using namespace xwalk::extensions;  // NOLINT
+
+namespace {
+
+// The number of messages posted by value_serialization.html.
+const int kPostedMessages = 4 * 50;
+
+// The messages received by the extension, counted on the extension thread,
+// through each of its handlers.
+base::subtle::Atomic32 g_value_messages = 0;
+base::subtle::Atomic32 g_serialized_messages = 0;
+
+// Counts the scalar values in the next value of |reader|, without creating
+// any base::Value.
+int CountLeaves(XWalkSerializedValueReader* reader) {
+  size_t size;
+  int count = 0;
+  if (reader->ReadList(&size)) {
+    for (size_t i = 0; i < size; ++i)
+      count += CountLeaves(reader);
+    return count;
+  }
+
+  if (reader->ReadDictionary(&size)) {
+    base::StringPiece key;
+    for (size_t i = 0; i < size && reader->ReadKey(&key); ++i)
+      count += CountLeaves(reader);
+    return count;
+  }
+
+  return reader->Skip() ? 1 : 0;
+}
+
+int CountLeaves(const base::Value& value) {
+  const base::ListValue* list;
+  const base::DictionaryValue* dictionary;
+  int count = 0;
+  if (value.GetAsList(&list)) {
+    for (size_t i = 0; i < list->GetSize(); ++i) {
+      const base::Value* element;
+      list->Get(i, &element);
+      count += CountLeaves(*element);
+    }
+    return count;
+  }
+
+  if (value.GetAsDictionary(&dictionary)) {
+    base::DictionaryValue::Iterator it(*dictionary);
+    for (; !it.IsAtEnd(); it.Advance())
+      count += CountLeaves(it.value());
+    return count;
+  }
+
+  return 1;
+}
+
+class SerializationInstance : public XWalkExtensionInstance {
+ public:
+  virtual void HandleMessage(scoped_ptr<base::Value> msg) OVERRIDE {
+    base::subtle::NoBarrier_AtomicIncrement(&g_value_messages, 1);
+    PostMessageToJS(scoped_ptr<base::Value>(
+        new base::FundamentalValue(CountLeaves(*msg))));
+  }
+
+  virtual void HandleSerializedMessage(
+      XWalkSerializedValueReader* reader) OVERRIDE {
+    base::subtle::NoBarrier_AtomicIncrement(&g_serialized_messages, 1);
+    PostMessageToJS(scoped_ptr<base::Value>(
+        new base::FundamentalValue(CountLeaves(reader))));
+  }
+};
+
+class SerializationExtension : public XWalkExtension {
+ public:
+  SerializationExtension() {
+    set_name("serialization");
+    set_javascript_api(
+        "var listener = null;"
+        "extension.setMessageListener(function(msg) {"
+        "  listener(msg);"
+        "});"
+        "exports.setListener = function(callback) {"
+        "  listener = callback;"
+        "};"
+        "exports.post = function(msg) {"
+        "  extension.postMessage(msg);"
+        "};");
+  }
+
+  virtual XWalkExtensionInstance* CreateInstance() OVERRIDE {
+    return new SerializationInstance;
+  }
+};
+
+}  // namespace
+
+// Posts messages of different shapes to an extension that reads every value
+// in them. They're serialized directly from V8 values unless the base::Value
+// conversion is forced by the command line.
+class ValueSerializationTest : public XWalkExtensionsTestBase {
+ public:
+  virtual void CreateExtensionsForExtensionThread(
+      XWalkExtensionVector* extensions) OVERRIDE {
+    extensions->push_back(new SerializationExtension);
+  }
+
+  // The page checks that the extension read every value of the messages.
+  void RunSerializationPage() {
+    content::RunAllPendingInMessageLoop();
+
+    content::TitleWatcher title_watcher(runtime()->web_contents(),
+                                        kPassString);
+    title_watcher.AlsoWaitForTitle(kFailString);
+
+    GURL url = GetExtensionsTestURL(base::FilePath(),
+        base::FilePath().AppendASCII("value_serialization.html"));
+    xwalk_test_utils::NavigateToURL(runtime(), url);
+    EXPECT_EQ(kPassString, title_watcher.WaitAndGetTitle());
+  }
+};
+
+class BaseValueSerializationTest : public ValueSerializationTest {
+ public:
+  virtual void SetUpCommandLine(CommandLine* command_line) OVERRIDE {
+    ValueSerializationTest::SetUpCommandLine(command_line);
+    command_line->AppendSwitch(
+        switches::kXWalkDisableExtensionValueSerialization);
+  }
+};
+
+IN_PROC_BROWSER_TEST_F(ValueSerializationTest, SerializedMessagesAreRead) {
+  RunSerializationPage();
+  // The page got every reply, the counts are final.
+  EXPECT_EQ(kPostedMessages,
+            base::subtle::Acquire_Load(&g_serialized_messages));
+  EXPECT_EQ(0, base::subtle::Acquire_Load(&g_value_messages));
+}
+
+IN_PROC_BROWSER_TEST_F(BaseValueSerializationTest, BaseValueMessagesAreRead) {
+  RunSerializationPage();
+  EXPECT_EQ(kPostedMessages, base::subtle::Acquire_Load(&g_value_messages));
+  EXPECT_EQ(0, base::subtle::Acquire_Load(&g_serialized_messages));
+}
@@ -43,7 +43,13 @@ const int kDefaultHeight = 600;
 
 // static
 Runtime* Runtime::Create(RuntimeContext* runtime_context, const GURL& url) {
-  WebContents::CreateParams params(runtime_context, NULL);
+  return Create(runtime_context, url, NULL);
+}
+
+// static
+Runtime* Runtime::Create(RuntimeContext* runtime_context, const GURL& url,
+                         content::SiteInstance* site_instance) {
+  WebContents::CreateParams params(runtime_context, site_instance);
   params.routing_id = MSG_ROUTING_NONE;
   WebContents* web_contents = WebContents::Create(params);
 
@@ -211,6 +217,7 @@ void Runtime::WebContentsCreated(
     const GURL& target_url,
     content::WebContents* new_contents) {
   Runtime* new_runtime = new Runtime(new_contents);
+  RuntimeRegistry::Get()->RuntimeOpened(this, new_runtime);
   new_runtime->AttachDefaultWindow();
 }
 
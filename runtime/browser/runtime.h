@@ -22,6 +22,7 @@
 namespace content {
 class ColorChooser;
 struct FileChooserParams;
+class SiteInstance;
 class WebContents;
 }
 
@@ -40,6 +41,9 @@ class Runtime : public content::WebContentsDelegate,
  public:
   // Create a new Runtime instance with the given browsing context.
   static Runtime* Create(RuntimeContext*, const GURL&);
+  // Same, in |site_instance|, whose process may already be running.
+  static Runtime* Create(RuntimeContext*, const GURL&,
+                         content::SiteInstance* site_instance);
   // Create a new Runtime instance which binds to a default app window.
   static Runtime* CreateWithDefaultWindow(RuntimeContext*, const GURL&);
 
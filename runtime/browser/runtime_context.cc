@@ -16,7 +16,6 @@
 #include "content/public/browser/web_contents.h"
 #include "content/public/common/content_switches.h"
 #include "xwalk/application/browser/application_protocols.h"
-#include "xwalk/application/browser/application_service.h"
 #include "xwalk/application/browser/application_system.h"
 #include "xwalk/application/common/constants.h"
 #include "xwalk/runtime/browser/runtime_download_manager_delegate.h"
@@ -168,16 +167,12 @@ net::URLRequestContextGetter* RuntimeContext::CreateRequestContext(
     content::ProtocolHandlerMap* protocol_handlers) {
   DCHECK(!url_request_getter_);
 
-  xwalk::application::ApplicationService* service =
-    application_system_.get()->application_service();
-  const xwalk::application::ApplicationData* running_app =
-    service->GetRunningApplication();
-  if (running_app) {
-    protocol_handlers->insert(std::pair<std::string,
-        linked_ptr<net::URLRequestJobFactory::ProtocolHandler> >(
-          application::kApplicationScheme,
-          CreateApplicationProtocolHandler(running_app)));
-  }
+  // The handler serves the resources of the applications launched later on,
+  // as they're launched.
+  protocol_handlers->insert(std::pair<std::string,
+      linked_ptr<net::URLRequestJobFactory::ProtocolHandler> >(
+        application::kApplicationScheme,
+        CreateApplicationProtocolHandler()));
 
   url_request_getter_ = new RuntimeURLRequestContextGetter(
       false, /* ignore_certificate_error = false */
@@ -78,6 +78,11 @@ void RuntimeRegistry::RuntimeAppIconChanged(Runtime* runtime) {
                     OnRuntimeAppIconChanged(runtime));
 }
 
+void RuntimeRegistry::RuntimeOpened(Runtime* opener, Runtime* runtime) {
+  FOR_EACH_OBSERVER(RuntimeRegistryObserver, observer_list_,
+                    OnRuntimeOpened(opener, runtime));
+}
+
 Runtime* RuntimeRegistry::GetRuntimeFromRenderViewHost(
     RenderViewHost* render_view_host) const {
   for (RuntimeList::const_iterator it = runtime_list_.begin();
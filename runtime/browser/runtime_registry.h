@@ -28,6 +28,10 @@ class RuntimeRegistryObserver {
   // Called when Runtime's app icon is changed.
   virtual void OnRuntimeAppIconChanged(Runtime* runtime) = 0;
 
+  // Called when |runtime|, already added, was opened by the page of
+  // |opener|, e.g. with window.open().
+  virtual void OnRuntimeOpened(Runtime* opener, Runtime* runtime) {}
+
  protected:
   virtual ~RuntimeRegistryObserver() {}
 };
@@ -49,6 +53,7 @@ class RuntimeRegistry {
   void RemoveRuntime(Runtime* runtime);
 
   void RuntimeAppIconChanged(Runtime* runtime);
+  void RuntimeOpened(Runtime* opener, Runtime* runtime);
 
   // Find a runtime from a RenderViewHost
   Runtime* GetRuntimeFromRenderViewHost(
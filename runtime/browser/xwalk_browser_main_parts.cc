@@ -196,6 +196,7 @@ void XWalkBrowserMainParts::PreMainMessageLoopRun() {
     // In service mode, Crosswalk doesn't launch anything, just waits
     // for external requests to launch apps.
     VLOG(1) << "Crosswalk running as Service.";
+    app_system->process_manager()->PrelaunchRenderers();
     return;
   }
 
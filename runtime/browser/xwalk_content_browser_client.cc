@@ -108,15 +108,15 @@ XWalkContentBrowserClient::CreateRequestContextForStoragePartition(
 void XWalkContentBrowserClient::AppendExtraCommandLineSwitches(
     CommandLine* command_line, int child_process_id) {
   CommandLine* browser_process_cmd_line = CommandLine::ForCurrentProcess();
-  const int extra_switches_count = 1;
-  const char* extra_switches[extra_switches_count] = {
-    switches::kXWalkDisableExtensionProcess
+  const char* extra_switches[] = {
+    switches::kXWalkDisableExtensionProcess,
+    switches::kXWalkDisableExtensionScriptCache,
+    switches::kXWalkDisableExtensionValueSerialization,
+    switches::kXWalkExtensionMessageBatching
   };
 
-  for (int i = 0; i < extra_switches_count; i++) {
-    if (browser_process_cmd_line->HasSwitch(extra_switches[i]))
-      command_line->AppendSwitch(extra_switches[i]);
-  }
+  command_line->CopySwitchesFrom(*browser_process_cmd_line, extra_switches,
+                                 arraysize(extra_switches));
 }
 
 content::QuotaPermissionContext*
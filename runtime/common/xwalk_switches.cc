@@ -16,12 +16,32 @@ const char kAppIcon[] = "app-icon";
 // Specifies the window whether launched with fullscreen mode.
 const char kFullscreen[] = "fullscreen";
 
+// The number of events an application may have queued while its main
+// document loads. The oldest ones are dropped beyond this.
+const char kLazyEventQueueSize[] = "lazy-event-queue-size";
+
 // Specifies list all installed applications.
 const char kListApplications[] = "list-apps";
 
 // Specifies install an application.
 const char kInstall[] = "install";
 
+// Installs applications without extracting their package, their resources are
+// read from it when they run.
+const char kInstallAsArchive[] = "install-as-archive";
+
+// Writes compressed copies of the text resources of the applications being
+// installed, read instead of them when they run.
+const char kPrecompressResources[] = "precompress-resources";
+
+// The memory, in megabytes, the render processes started ahead of time may
+// use together. See kPrelaunchRenderers.
+const char kPrelaunchMemoryBudget[] = "prelaunch-memory-budget";
+
+// When running as a service, keeps this number of render processes started
+// ahead of time, so that the applications launched don't wait for them.
+const char kPrelaunchRenderers[] = "prelaunch-renderers";
+
 // Specifies uninstall an application from runtime.
 const char kUninstall[] = "uninstall";
 
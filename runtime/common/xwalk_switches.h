@@ -16,8 +16,18 @@ extern const char kFullscreen[];
 
 extern const char kInstall[];
 
+extern const char kInstallAsArchive[];
+
+extern const char kLazyEventQueueSize[];
+
 extern const char kListApplications[];
 
+extern const char kPrecompressResources[];
+
+extern const char kPrelaunchMemoryBudget[];
+
+extern const char kPrelaunchRenderers[];
+
 extern const char kUninstall[];
 
 extern const char kXWalkAllowExternalExtensionsForRemoteSources[];
@@ -15,6 +15,7 @@ RuntimeExtension::RuntimeExtension() {
   set_name("xwalk.runtime");
   set_javascript_api(ResourceBundle::GetSharedInstance().GetRawDataResource(
       IDR_XWALK_RUNTIME_API).as_string());
+  set_concurrent(true);
 }
 
 XWalkExtensionInstance* RuntimeExtension::CreateInstance() {
@@ -5,6 +5,7 @@
 #include "xwalk/sysapps/common/sysapps_manager.h"
 
 #include "base/basictypes.h"
+#include "base/lazy_instance.h"
 #include "xwalk/runtime/common/xwalk_runtime_features.h"
 #include "xwalk/sysapps/device_capabilities_new/cpu_info_provider.h"
 #include "xwalk/sysapps/device_capabilities_new/device_capabilities_extension_new.h"
@@ -13,21 +14,20 @@
 namespace xwalk {
 namespace sysapps {
 
+namespace {
+
+base::LazyInstance<CPUInfoProvider>::Leaky g_cpu_info_provider =
+    LAZY_INSTANCE_INITIALIZER;
+
+}  // namespace
+
 SysAppsManager::SysAppsManager() {}
 
 SysAppsManager::~SysAppsManager() {}
 
 void SysAppsManager::CreateExtensionsForUIThread(
     XWalkExtensionVector* extensions) {
-  if (!XWalkRuntimeFeatures::isSysAppsEnabled())
-    return;
-
-  // FIXME(tmpsantos): Device Capabilities needs to be in the UI Thread because
-  // it uses Chromium's StorageMonitor, which requires that. We can move it back
-  // to the ExtensionThread if we make StorageMonitor a truly self-contained
-  // module on Chromium upstream.
-  if (XWalkRuntimeFeatures::isDeviceCapabilitiesAPIEnabled())
-    extensions->push_back(new experimental::DeviceCapabilitiesExtension());
+  // None of the SysApps APIs need the UI thread at the moment.
 }
 
 void SysAppsManager::CreateExtensionsForExtensionThread(
@@ -35,15 +35,20 @@ void SysAppsManager::CreateExtensionsForExtensionThread(
   if (!XWalkRuntimeFeatures::isSysAppsEnabled())
     return;
 
+  // Device Capabilities only queries the CPU so far. If it starts using
+  // Chromium's StorageMonitor it has to move to the UI thread, which that
+  // requires.
+  if (XWalkRuntimeFeatures::isDeviceCapabilitiesAPIEnabled())
+    extensions->push_back(new experimental::DeviceCapabilitiesExtension());
+
   if (XWalkRuntimeFeatures::isRawSocketsAPIEnabled())
     extensions->push_back(new RawSocketExtension());
 }
 
 // static
 CPUInfoProvider* SysAppsManager::GetCPUInfoProvider() {
-  CR_DEFINE_STATIC_LOCAL(CPUInfoProvider, provider, ());
-
-  return &provider;
+  // Concurrent extensions may ask for the provider from many threads.
+  return g_cpu_info_provider.Pointer();
 }
 
 }  // namespace sysapps
@@ -19,6 +19,9 @@ DeviceCapabilitiesExtension::DeviceCapabilitiesExtension() {
   set_name("xwalk.experimental.system");
   set_javascript_api(ResourceBundle::GetSharedInstance().GetRawDataResource(
       IDR_XWALK_SYSAPPS_DEVICE_CAPABILITIES_NEW_API).as_string());
+
+  // Reading the CPU load can block, so don't hold the extension thread.
+  set_concurrent(true);
 }
 
 DeviceCapabilitiesExtension::~DeviceCapabilitiesExtension() {}